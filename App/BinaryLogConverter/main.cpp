@@ -0,0 +1,63 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <kvs/File>
+#include <kvs/String>
+#include "../../Lib/BinaryLog.h"
+
+
+void Usage( const char* program )
+{
+    std::cerr << "Usage: " << program << " [-o output_dir] [-t time_step] <file.bin> ..." << std::endl;
+}
+
+// Regenerates the per-step CSV files (<basename><time step>.csv) from the
+// binary logs written in situ (e.g. output_entropies.bin), which are the
+// same as the ones written without the binary log.
+int main( int argc, char** argv )
+{
+    std::string output_dir;
+    long time_step = -1;
+    std::vector<std::string> files;
+    for ( int i = 1; i < argc; ++i )
+    {
+        const std::string arg( argv[i] );
+        if ( arg == "-o" && i + 1 < argc ) { output_dir = argv[++i]; }
+        else if ( arg == "-t" && i + 1 < argc ) { time_step = std::stol( argv[++i] ); }
+        else { files.push_back( arg ); }
+    }
+
+    if ( files.empty() ) { Usage( argv[0] ); return 1; }
+
+    int ret = 0;
+    for ( const auto& filename : files )
+    {
+        InSituVis::BinaryLogReader log;
+        if ( !log.open( filename ) )
+        {
+            std::cerr << "ERROR: Cannot read " << filename << std::endl;
+            ret = 1;
+            continue;
+        }
+
+        const auto dirname = output_dir.empty() ? kvs::File( filename ).pathName() : output_dir;
+        for ( size_t i = 0; i < log.numberOfEntries(); ++i )
+        {
+            const auto key = log.entries()[i].key;
+            if ( time_step >= 0 && key != static_cast<size_t>( time_step ) ) { continue; }
+
+            const auto basename = log.name() + kvs::String::From( key, 6, '0' );
+            const auto output = dirname + "/" + basename + ".csv";
+            if ( !log.writeCSV( i, output ) )
+            {
+                std::cerr << "ERROR: Cannot write " << output << std::endl;
+                ret = 1;
+                break;
+            }
+        }
+
+        std::cout << filename << ": " << log.numberOfEntries() << " steps" << std::endl;
+    }
+
+    return ret;
+}
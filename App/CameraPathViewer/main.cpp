@@ -18,6 +18,7 @@
 #include <kvs/Label>
 #include <kvs/String>
 #include <kvs/ValueArray>
+#include "../../Lib/BinaryLog.h"
 
 using namespace std;
 
@@ -105,6 +106,26 @@ tuple<vector<float>, float, float> loadTable( string file_path )
     return { table, max_value, min_value };
 }
 
+// Loads the entropy table of the time step from the memory-mapped binary log
+// that has the same basename as the per-step CSV files (e.g. the records of
+// "output_entropy_table_" are appended into "output_entropy_table.bin"). The
+// table is given by the last column of the records. An empty table is
+// returned if the time step is not found or the number of the records does
+// not match the table size.
+tuple<vector<float>, float, float> loadTable( const InSituVis::BinaryLogReader& log, size_t time_step, size_t table_size )
+{
+    const long entry = log.find( time_step );
+    if( entry < 0 || log.entries()[ entry ].count != table_size ) return { vector<float>(), 0.0f, 0.0f };
+
+    vector<float> table = log.values( entry, log.columns().size() - 1 );
+    if( table.empty() ) return { table, 0.0f, 0.0f };
+
+    float max_value = *max_element( table.begin(), table.end() );
+    float min_value = *min_element( table.begin(), table.end() );
+
+    return { table, max_value, min_value };
+}
+
 vector<float> loadPosition( string file_path )
 {
     vector<float> positions;
@@ -362,12 +383,18 @@ int main( int argc, char** argv )
 
         if( HEATMAP )
         {
+            // The binary log is used only if it was written for the entropy
+            // tables. Otherwise, the per-step CSV files are read.
+            const string table_basename = "output_entropy_table_";
+            InSituVis::BinaryLogReader log( "./Outputs/" + optimum_file + "/output_entropy_table.bin" );
+            const bool use_log = log.isOpened() && log.name() == table_basename && !log.columns().empty();
             for( size_t i = 0; i < time_steps; i++ )
             {
                 size_t time_step = i * time_interval;
-                string input_file_name =  "output_entropy_table_" + kvs::String::From( time_step, 6, '0' ) + ".csv";
+                string input_file_name =  table_basename + kvs::String::From( time_step, 6, '0' ) + ".csv";
                 string input_file_path = "./Outputs/" + optimum_file + "/" + input_file_name;
-                auto [a, b, c] = loadTable( input_file_path );
+                auto [a, b, c] = use_log ? loadTable( log, time_step, dim_lati * dim_long ) : tuple<vector<float>, float, float>();
+                if( a.empty() ) tie( a, b, c ) = loadTable( input_file_path );
                 tables.push_back( a );
                 max_values.push_back( b );
                 min_values.push_back( c );
@@ -0,0 +1,170 @@
+// The PNG output needs zlib and the JPEG output needs libjpeg, which are
+// linked in kvsmake.conf.
+#define INSITUVIS_USE_ZLIB
+#define INSITUVIS_USE_JPEG
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <iostream>
+#include <kvs/ColorImage>
+#include <kvs/File>
+#include <kvs/ValueArray>
+#include "../../Lib/SphericalBuffer.h"
+#include "../../Lib/ImageEncoder.h"
+
+
+// Cube map written by InSituVis::Adaptor::writeCubeMap (*.cube).
+struct CubeMap
+{
+    size_t width = 0;
+    size_t height = 0;
+    size_t channels = 4;
+    std::vector<std::string> faces{};
+};
+
+bool ReadCubeMap( const std::string& filename, CubeMap* cube_map )
+{
+    std::ifstream ifs( filename );
+    if ( !ifs ) { return false; }
+
+    cube_map->faces.resize( 6 );
+    std::string line;
+    while ( std::getline( ifs, line ) )
+    {
+        if ( line.empty() || line[0] == '#' ) { continue; }
+
+        std::istringstream iss( line );
+        std::string key;
+        iss >> key;
+        if ( key == "width" ) { iss >> cube_map->width; }
+        else if ( key == "height" ) { iss >> cube_map->height; }
+        else if ( key == "channels" ) { iss >> cube_map->channels; }
+        else if ( key == "face" )
+        {
+            size_t index = 0;
+            std::string face;
+            iss >> index >> face;
+            if ( index < cube_map->faces.size() ) { cube_map->faces[ index ] = face; }
+        }
+    }
+
+    for ( const auto& face : cube_map->faces ) { if ( face.empty() ) { return false; } }
+    return cube_map->width > 0 && cube_map->height > 0;
+}
+
+// Reads the face image as RGBA pixels.
+kvs::ValueArray<kvs::UInt8> ReadFace( const std::string& filename, const CubeMap& cube_map )
+{
+    const auto npixels = cube_map.width * cube_map.height;
+    kvs::ValueArray<kvs::UInt8> pixels( npixels * 4 );
+
+    if ( kvs::File( filename ).extension() == "raw" )
+    {
+        const auto nchannels = cube_map.channels;
+        std::vector<kvs::UInt8> data( npixels * nchannels );
+        std::ifstream ifs( filename, std::ios::binary );
+        if ( !ifs.read( reinterpret_cast<char*>( data.data() ), data.size() ) ) { return {}; }
+        for ( size_t i = 0; i < npixels; ++i )
+        {
+            for ( size_t c = 0; c < 4; ++c )
+            {
+                pixels[ 4 * i + c ] = c < nchannels ? data[ nchannels * i + c ] : 255;
+            }
+        }
+        return pixels;
+    }
+
+    kvs::ColorImage image;
+    if ( !image.read( filename ) ) { return {}; }
+    if ( image.width() != cube_map.width || image.height() != cube_map.height ) { return {}; }
+
+    const auto& rgb = image.pixels();
+    for ( size_t i = 0; i < npixels; ++i )
+    {
+        pixels[ 4 * i + 0 ] = rgb[ 3 * i + 0 ];
+        pixels[ 4 * i + 1 ] = rgb[ 3 * i + 1 ];
+        pixels[ 4 * i + 2 ] = rgb[ 3 * i + 2 ];
+        pixels[ 4 * i + 3 ] = 255;
+    }
+    return pixels;
+}
+
+InSituVis::ImageEncoder Encoder( const std::string& format )
+{
+    if ( format == "png" ) { return InSituVis::ImageEncoder::PNGEncoder(); }
+    if ( format == "jpg" || format == "jpeg" ) { return InSituVis::ImageEncoder::JPEGEncoder(); }
+    if ( format == "raw" ) { return InSituVis::ImageEncoder::RawEncoder(); }
+    return InSituVis::ImageEncoder::BMPEncoder();
+}
+
+void Usage( const char* program )
+{
+    std::cerr << "Usage: " << program << " [-f bmp|png|jpg|raw] [-t nthreads] <file.cube> ..." << std::endl;
+}
+
+// Stitches the cube faces written in situ into the equirectangular images
+// (<basename>.bmp etc.), which are the same as the ones stitched in situ.
+int main( int argc, char** argv )
+{
+    std::string format = "bmp";
+    size_t nthreads = std::thread::hardware_concurrency();
+    std::vector<std::string> files;
+    for ( int i = 1; i < argc; ++i )
+    {
+        const std::string arg( argv[i] );
+        if ( arg == "-f" && i + 1 < argc ) { format = argv[++i]; }
+        else if ( arg == "-t" && i + 1 < argc ) { nthreads = std::stoul( argv[++i] ); }
+        else { files.push_back( arg ); }
+    }
+
+    if ( files.empty() ) { Usage( argv[0] ); return 1; }
+
+    auto encoder = Encoder( format );
+    encoder.setNumberOfThreads( nthreads > 1 ? nthreads - 1 : 0 );
+
+    int ret = 0;
+    for ( const auto& filename : files )
+    {
+        CubeMap cube_map;
+        if ( !ReadCubeMap( filename, &cube_map ) )
+        {
+            std::cerr << "ERROR: Cannot read " << filename << std::endl;
+            ret = 1;
+            continue;
+        }
+
+        using SphericalColorBuffer = InSituVis::SphericalBuffer<kvs::UInt8>;
+        SphericalColorBuffer buffer( cube_map.width, cube_map.height );
+
+        const auto dirname = kvs::File( filename ).pathName();
+        bool success = true;
+        for ( size_t i = 0; i < cube_map.faces.size(); ++i )
+        {
+            const auto face_filename = dirname + "/" + cube_map.faces[i];
+            const auto face = ReadFace( face_filename, cube_map );
+            if ( face.size() == 0 )
+            {
+                std::cerr << "ERROR: Cannot read " << face_filename << std::endl;
+                success = false;
+                break;
+            }
+            buffer.setBuffer( SphericalColorBuffer::Direction(i), face );
+        }
+        if ( !success ) { ret = 1; continue; }
+
+        const auto stitched = buffer.stitch<4>();
+        const auto output = dirname + "/" + kvs::File( filename ).baseName() + encoder.extension();
+        if ( !encoder.write( output, buffer.stitchedWidth(), buffer.stitchedHeight(), 4, stitched.data() ) )
+        {
+            std::cerr << "ERROR: Cannot write " << output << std::endl;
+            ret = 1;
+            continue;
+        }
+
+        std::cout << output << std::endl;
+    }
+
+    return ret;
+}
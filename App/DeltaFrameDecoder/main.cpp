@@ -0,0 +1,157 @@
+// The delta frames and the PNG output need zlib, and the JPEG output needs
+// libjpeg, which are linked in kvsmake.conf.
+#define INSITUVIS_USE_ZLIB
+#define INSITUVIS_USE_JPEG
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <algorithm>
+#include <kvs/File>
+#include "../../Lib/TileDeltaEncoder.h"
+#include "../../Lib/FrameContainer.h"
+#include "../../Lib/ImageEncoder.h"
+
+
+void Usage( const char* program )
+{
+    std::cerr << "Usage: " << program << " [-l] [-o output_dir] [-f bmp|png|jpg|raw] <file.frames | file.delta ...>" << std::endl;
+}
+
+InSituVis::ImageEncoder Encoder( const std::string& format )
+{
+    if ( format == "png" ) { return InSituVis::ImageEncoder::PNGEncoder(); }
+    if ( format == "jpg" ) { return InSituVis::ImageEncoder::JPEGEncoder(); }
+    if ( format == "raw" ) { return InSituVis::ImageEncoder::RawEncoder(); }
+    return InSituVis::ImageEncoder::BMPEncoder();
+}
+
+struct Frame
+{
+    std::string name; ///< name of the delta frame
+    std::string stream; ///< stream name
+    std::uint64_t sequence; ///< frame number in the stream
+    bool keyframe; ///< true if the frame is a keyframe
+    std::string filename; ///< delta file (empty if stored in the container)
+    long index; ///< index in the container
+};
+
+// Rebuilds the full frames from the delta frames (*.delta) written in situ
+// with TileDeltaEncoder (Adaptor::setStreamEncoder), given as the files or
+// the frame container. The frames of each stream are decoded in the order
+// of the sequence numbers from the keyframes, and written with the original
+// names in the image format. With -l, the frames are listed.
+int main( int argc, char** argv )
+{
+    bool list = false;
+    std::string output_dir;
+    std::string format = "bmp";
+    std::vector<std::string> args;
+    for ( int i = 1; i < argc; ++i )
+    {
+        const std::string arg( argv[i] );
+        if ( arg == "-l" ) { list = true; }
+        else if ( arg == "-o" && i + 1 < argc ) { output_dir = argv[++i]; }
+        else if ( arg == "-f" && i + 1 < argc ) { format = argv[++i]; }
+        else { args.push_back( arg ); }
+    }
+
+    if ( args.empty() ) { Usage( argv[0] ); return 1; }
+
+    auto Read = [] ( const std::string& filename )
+    {
+        std::ifstream file( filename, std::ios::binary );
+        return InSituVis::TileDeltaEncoder::Bytes( std::istreambuf_iterator<char>( file ), {} );
+    };
+
+    // Collect the delta frames with their headers.
+    InSituVis::FrameContainerReader container;
+    std::vector<Frame> frames;
+    for ( const auto& arg : args )
+    {
+        InSituVis::TileDeltaEncoder::Delta delta;
+        if ( kvs::File( arg ).extension() == "frames" )
+        {
+            if ( !container.isOpened() && !container.open( arg ) )
+            {
+                std::cerr << "ERROR: Cannot read " << arg << std::endl;
+                return 1;
+            }
+
+            for ( size_t i = 0; i < container.numberOfFrames(); ++i )
+            {
+                const auto& e = container.entries()[i];
+                const auto* data = reinterpret_cast<const kvs::UInt8*>( container.data( i ) );
+                if ( !InSituVis::TileDeltaDecoder::ReadHeader( data, e.size, delta ) ) { continue; }
+                frames.push_back( { e.name, delta.stream, delta.sequence, delta.keyframe, "", static_cast<long>( i ) } );
+            }
+            continue;
+        }
+
+        const auto bytes = Read( arg );
+        if ( !InSituVis::TileDeltaDecoder::ReadHeader( bytes.data(), bytes.size(), delta ) )
+        {
+            std::cerr << "WARNING: " << arg << " is not a delta frame." << std::endl;
+            continue;
+        }
+        frames.push_back( { arg, delta.stream, delta.sequence, delta.keyframe, arg, -1 } );
+    }
+
+    // The frames may be written out of order by the writer threads.
+    std::sort( frames.begin(), frames.end(), [] ( const Frame& a, const Frame& b )
+    {
+        return a.stream != b.stream ? a.stream < b.stream : a.sequence < b.sequence;
+    } );
+
+    if ( list )
+    {
+        for ( const auto& f : frames )
+        {
+            std::cout << f.stream << " " << f.sequence << ( f.keyframe ? " key " : " delta " ) << f.name << std::endl;
+        }
+        return 0;
+    }
+
+    const auto encoder = Encoder( format );
+    std::map<std::string,InSituVis::TileDeltaDecoder> decoders;
+    int ret = 0;
+    for ( const auto& f : frames )
+    {
+        auto& decoder = decoders[ f.stream ];
+        bool decoded = false;
+        if ( f.filename.empty() )
+        {
+            const auto* data = reinterpret_cast<const kvs::UInt8*>( container.data( f.index ) );
+            decoded = decoder.decode( data, container.entries()[ f.index ].size );
+        }
+        else
+        {
+            const auto bytes = Read( f.filename );
+            decoded = decoder.decode( bytes.data(), bytes.size() );
+        }
+
+        if ( !decoded )
+        {
+            std::cerr << "ERROR: Cannot decode " << f.name << " (missing previous frame)." << std::endl;
+            ret = 1;
+            continue;
+        }
+
+        const kvs::File file( f.name );
+        const auto dirname = !output_dir.empty() ? output_dir : f.filename.empty() ? kvs::File( args.front() ).pathName() : file.pathName();
+        const auto output = dirname + "/" + file.baseName() + encoder.extension();
+        if ( !encoder.write( output, decoder.width(), decoder.height(), decoder.channels(), decoder.pixels().data() ) )
+        {
+            std::cerr << "ERROR: Cannot write " << output << std::endl;
+            ret = 1;
+            continue;
+        }
+
+        std::cout << output << std::endl;
+    }
+
+    return ret;
+}
@@ -0,0 +1,89 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <kvs/File>
+#include "../../Lib/FrameContainer.h"
+
+
+void Usage( const char* program )
+{
+    std::cerr << "Usage: " << program << " [-l] [-o output_dir] [-t time] [-s space] <file.frames> [name ...]" << std::endl;
+}
+
+// Lists or extracts the image files stored in the frame container written
+// in situ (<basename>.frames). The frames can be selected by the time and
+// space indices or by the names, and all of the frames are extracted if no
+// frame is selected. The extracted files are the same as the ones written
+// without the container.
+int main( int argc, char** argv )
+{
+    bool list = false;
+    std::string output_dir;
+    long time = -1;
+    long space = -1;
+    std::vector<std::string> args;
+    for ( int i = 1; i < argc; ++i )
+    {
+        const std::string arg( argv[i] );
+        if ( arg == "-l" ) { list = true; }
+        else if ( arg == "-o" && i + 1 < argc ) { output_dir = argv[++i]; }
+        else if ( arg == "-t" && i + 1 < argc ) { time = std::stol( argv[++i] ); }
+        else if ( arg == "-s" && i + 1 < argc ) { space = std::stol( argv[++i] ); }
+        else { args.push_back( arg ); }
+    }
+
+    if ( args.empty() ) { Usage( argv[0] ); return 1; }
+
+    const auto filename = args.front();
+    const std::vector<std::string> names( args.begin() + 1, args.end() );
+
+    InSituVis::FrameContainerReader container;
+    if ( !container.open( filename ) )
+    {
+        std::cerr << "ERROR: Cannot read " << filename << std::endl;
+        return 1;
+    }
+
+    if ( container.isRecovered() )
+    {
+        std::cerr << "WARNING: The index is rebuilt from " << container.numberOfFrames() << " frames." << std::endl;
+    }
+
+    auto selected = [&] ( const InSituVis::FrameContainer::Entry& e )
+    {
+        if ( time >= 0 && e.ids[0] != time ) { return false; }
+        if ( space >= 0 && e.ids[1] != space ) { return false; }
+        if ( names.empty() ) { return true; }
+        for ( const auto& name : names )
+        {
+            if ( e.name == name || kvs::File( e.name ).fileName() == name ) { return true; }
+        }
+        return false;
+    };
+
+    const auto dirname = output_dir.empty() ? kvs::File( filename ).pathName() : output_dir;
+    int ret = 0;
+    for ( size_t i = 0; i < container.numberOfFrames(); ++i )
+    {
+        const auto& e = container.entries()[i];
+        if ( !selected( e ) ) { continue; }
+
+        if ( list )
+        {
+            std::cout << e.name << " " << e.size << std::endl;
+            continue;
+        }
+
+        const auto output = dirname + "/" + kvs::File( e.name ).fileName();
+        if ( !container.extract( i, output ) )
+        {
+            std::cerr << "ERROR: Cannot write " << output << std::endl;
+            ret = 1;
+            continue;
+        }
+
+        std::cout << output << std::endl;
+    }
+
+    return ret;
+}
@@ -0,0 +1,117 @@
+// The PNG output needs zlib and the JPEG output needs libjpeg, which are
+// linked in kvsmake.conf.
+#define INSITUVIS_USE_ZLIB
+#define INSITUVIS_USE_JPEG
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <kvs/String>
+#include "../../Lib/FrameRing.h"
+#include "../../Lib/ImageEncoder.h"
+
+
+void Usage( const char* program )
+{
+    std::cerr << "Usage: " << program << " [-i] [-l] [-n nframes] [-o output_dir] [-f bmp|png|jpg|raw] [-p msec] <name>" << std::endl;
+}
+
+InSituVis::ImageEncoder Encoder( const std::string& format )
+{
+    if ( format == "png" ) { return InSituVis::ImageEncoder::PNGEncoder(); }
+    if ( format == "jpg" ) { return InSituVis::ImageEncoder::JPEGEncoder(); }
+    if ( format == "raw" ) { return InSituVis::ImageEncoder::RawEncoder(); }
+    return InSituVis::ImageEncoder::BMPEncoder();
+}
+
+// Reads the frames published in situ into the shared-memory frame ring
+// (Adaptor::setFrameSink) on the same node. The frames are listed,
+// and written into the output directory if specified, until the producer
+// is closed or the given number of frames is read. With -l, only the
+// latest frame is read at each polling as a live monitor. With -i, the
+// state of the ring is printed.
+int main( int argc, char** argv )
+{
+    bool info = false;
+    bool latest = false;
+    long nframes = -1;
+    std::string output_dir;
+    std::string format = "bmp";
+    long interval = 1;
+    std::vector<std::string> args;
+    for ( int i = 1; i < argc; ++i )
+    {
+        const std::string arg( argv[i] );
+        if ( arg == "-i" ) { info = true; }
+        else if ( arg == "-l" ) { latest = true; }
+        else if ( arg == "-n" && i + 1 < argc ) { nframes = std::stol( argv[++i] ); }
+        else if ( arg == "-o" && i + 1 < argc ) { output_dir = argv[++i]; }
+        else if ( arg == "-f" && i + 1 < argc ) { format = argv[++i]; }
+        else if ( arg == "-p" && i + 1 < argc ) { interval = std::stol( argv[++i] ); }
+        else { args.push_back( arg ); }
+    }
+
+    if ( args.size() != 1 ) { Usage( argv[0] ); return 1; }
+
+    InSituVis::FrameRingReader ring;
+    if ( !ring.open( args.front() ) )
+    {
+        std::cerr << "ERROR: Cannot open the frame ring " << args.front() << std::endl;
+        return 1;
+    }
+
+    if ( info )
+    {
+        const bool drop = ring.policy() == InSituVis::FrameRing::Drop;
+        std::cout << "Name: " << ring.name() << std::endl;
+        std::cout << "Policy: " << ( drop ? "drop" : "overwrite" ) << std::endl;
+        std::cout << "Number of slots: " << ring.numberOfSlots() << std::endl;
+        std::cout << "Slot size: " << ring.slotSize() << " bytes" << std::endl;
+        std::cout << "Published frames: " << ring.numberOfPublishedFrames() << std::endl;
+        std::cout << "Dropped frames: " << ring.numberOfDroppedFrames() << std::endl;
+        std::cout << "Closed: " << ( ring.isClosed() ? "yes" : "no" ) << std::endl;
+        return 0;
+    }
+
+    const auto encoder = Encoder( format );
+    InSituVis::FrameRing::Frame frame;
+    std::vector<std::uint8_t> pixels;
+    long count = 0;
+    int ret = 0;
+    while ( nframes < 0 || count < nframes )
+    {
+        // The closed flag is checked before reading, so that the frames
+        // published just before closing are not lost.
+        const bool closed = ring.isClosed();
+        if ( latest ) { ring.seekLatest(); }
+        if ( !ring.read( frame, pixels ) )
+        {
+            if ( closed ) { break; }
+            std::this_thread::sleep_for( std::chrono::milliseconds( interval ) );
+            continue;
+        }
+
+        count++;
+        std::cout << frame.sequence << " " << frame.time_step << " " << frame.location << " ";
+        std::cout << frame.width << "x" << frame.height << "x" << frame.channels << " " << frame.timestamp;
+
+        if ( !output_dir.empty() )
+        {
+            const auto time = kvs::String::From( frame.time_step, 6, '0' );
+            const auto space = kvs::String::From( frame.location, 6, '0' );
+            const auto output = output_dir + "/frame_" + time + "_" + space + encoder.extension();
+            if ( !encoder.write( output, frame.width, frame.height, frame.channels, pixels.data() ) )
+            {
+                std::cerr << "ERROR: Cannot write " << output << std::endl;
+                ret = 1;
+            }
+            std::cout << " " << output;
+        }
+        std::cout << std::endl;
+    }
+
+    std::cerr << "Read: " << count << ", Missed: " << ring.numberOfMissedFrames();
+    std::cerr << ", Dropped: " << ring.numberOfDroppedFrames() << std::endl;
+    return ret;
+}
@@ -8,12 +8,17 @@
 #include <functional>
 #include <csignal>
 #include <list>
+#include <utility>
+#include <vector>
+#include <array>
+#include <memory>
 #include <kvs/OffScreen>
 #include <kvs/ObjectBase>
 #include <kvs/ColorImage>
 #include <kvs/GrayImage>
 #include <kvs/String>
 #include <kvs/Type>
+#include <kvs/Math>
 #include <kvs/CubicImage>
 #include <kvs/SphericalImage>
 #include <kvs/Background>
@@ -23,9 +28,25 @@
 #include <kvs/LogStream>
 #include <kvs/StampTimer>
 #include <kvs/StampTimerList>
+#if defined( KVS_SUPPORT_OSMESA )
+#include <GL/osmesa.h>
+#endif
 #include "Viewpoint.h"
 #include "OutputDirectory.h"
 #include "SphericalBuffer.h"
+#include "ImageWriter.h"
+#include "ImageEncoder.h"
+#include "OffScreenPool.h"
+#include "FrameBufferPool.h"
+#include "ThreadPool.h"
+#include "AsyncExecutor.h"
+#include "Profiler.h"
+#include "StreamingSink.h"
+#include "MetricsBuffer.h"
+#include "TimeBudgetController.h"
+#include "FrameStore.h"
+#include "FrameSink.h"
+#include "StreamEncoder.h"
 
 
 namespace InSituVis
@@ -43,8 +64,25 @@ public:
     using Object = kvs::ObjectBase;
     using ObjectList = std::list<Object::Pointer>;
     using Pipeline = std::function<void(Screen&,const Object&)>;
+    using Mapper = std::function<Object*(const Object&)>; // thread-safe mapping stage
+    using Registrar = std::function<void(Screen&,Object*)>; // registration stage (takes the mapped object)
+    using Replicator = std::function<Object*(const Object&)>; // thread-safe copy of the mapped object
+    using AsyncPolicy = InSituVis::AsyncExecutor::Policy;
     using ColorBuffer = kvs::ValueArray<kvs::UInt8>;
     using DepthBuffer = kvs::ValueArray<kvs::Real32>;
+    using CubeMapBuffers = SphericalBuffer<kvs::UInt8>::Buffers; // 6 faces
+    using Metrics = InSituVis::MetricsBuffer::Statistics;
+
+    // Processing stages measured in the online metrics.
+    enum Stage
+    {
+        PipeStage,
+        RendStage,
+        CompStage,
+        EntrStage,
+        SaveStage,
+        NumberOfStages
+    };
 
     struct FrameBuffer
     {
@@ -59,6 +97,18 @@ public:
             depth_buffer( width * height ) {}
     };
 
+    // Rectangle of a box projected onto the screen in the normalized device
+    // coordinates, clipped by the screen (empty: out of the view frustum).
+    struct ProjectedRect
+    {
+        kvs::Vec2 min{ 1.0f, 1.0f };
+        kvs::Vec2 max{ -1.0f, -1.0f };
+        ProjectedRect() = default;
+        ProjectedRect( const kvs::Vec2& mn, const kvs::Vec2& mx ): min( mn ), max( mx ) {}
+        bool empty() const { return min.x() > max.x() || min.y() > max.y(); }
+        float area() const { return this->empty() ? 0.0f : ( max.x() - min.x() ) * ( max.y() - min.y() ) / 4.0f; }
+    };
+
     // Simulation time information.
     struct SimTime
     {
@@ -71,19 +121,58 @@ private:
     Screen m_screen{}; ///< rendering screen (off-screen)
     ObjectList m_objects{}; ///< object list
     Pipeline m_pipeline{}; ///< visualization pipeline
+    Mapper m_mapper{}; ///< mapping stage of the two-phase pipeline
+    Registrar m_registrar{}; ///< registration stage of the two-phase pipeline
+    Replicator m_replicator{}; ///< copy of the mapped objects for the rendering threads
+    std::unique_ptr<InSituVis::ThreadPool> m_pipeline_pool{}; ///< threads for mapping the objects concurrently (null: disabled)
     InSituVis::Viewpoint m_viewpoint{}; ///< rendering viewpoint
     InSituVis::OutputDirectory m_output_directory{}; ///< output directory
+    std::unique_ptr<InSituVis::ImageWriter> m_image_writer{}; ///< writer threads of the output files (null: written synchronously)
+    InSituVis::ImageEncoder m_image_encoder{}; ///< image encoder (BMP by default)
+    std::shared_ptr<InSituVis::FrameStore> m_frame_store{}; ///< storage of the output files (null: file system)
+    std::shared_ptr<InSituVis::FrameSink> m_frame_sink{}; ///< consumer of the rendered frames (null: disabled)
+    std::shared_ptr<InSituVis::StreamEncoder> m_stream_encoder{}; ///< encoder of the color images as frame streams (null: image files)
+    std::unique_ptr<InSituVis::OffScreenPool> m_screen_pool{}; ///< off-screen contexts for parallel rendering (null: disabled)
+    mutable InSituVis::FrameBufferPool m_frame_buffer_pool{}; ///< reusable color/depth buffers
+    size_t m_nrendering_threads = 0; ///< number of rendering threads (0: main thread only)
+    std::vector<const Object*> m_mapped_objects{}; ///< objects mapped at the current step (owned by the main screen)
+    size_t m_pipeline_count = 0; ///< number of pipeline executions
+    std::vector<size_t> m_synced_pipeline_counts{}; ///< pipeline count applied to each context
+    std::vector<float> m_location_costs{}; ///< rendering time of each viewpoint location [msec]
+    std::vector<float> m_position_costs{}; ///< rendering time of each position in the list of derived locations [msec]
     std::string m_output_filename = "output"; ///< basename of output file
     size_t m_image_width = 512; ///< width of rendering image
     size_t m_image_height = 512; ///< height of rendering image
     bool m_enable_output_image = true; ///< flag for writing final rendering image data
+    bool m_enable_zero_copy_readback = false; ///< flag for rendering directly into the color buffer (OSMesa, opt-in)
+    bool m_enable_depth_stitching = true; ///< flag for stitching depth buffers of omni-directional views
+    bool m_enable_cube_map_output = false; ///< flag for writing omni-directional views as cube faces
+    float m_evaluation_image_scale = 1.0f; ///< scale of the evaluation images to the output images
+    bool m_enable_evaluation_check = false; ///< flag for checking the evaluation at full resolution
+    std::vector<kvs::Vec3i> m_evaluation_checks{}; ///< time step, selected index (scaled and full resolution)
+    bool m_enable_viewpoint_culling = false; ///< flag for culling the viewpoint locations before rendering
+    float m_culling_area_ratio = 0.0f; ///< minimum projected area of the object to the screen area
     size_t m_analysis_interval = 1; ///< analysis time interval (l)
-    kvs::UInt32 m_time_step = 0; ///< current time step
+    kvs::UInt32 m_time_step = 0; ///< current time step (time step being visualized in async mode)
+    kvs::UInt32 m_exec_time_step = 0; ///< current time step of the simulation in async mode
+    ObjectList m_exec_objects{}; ///< objects put by the simulation in async mode
+    bool m_enable_async_execution = false; ///< flag for visualizing in the background thread
+    bool m_enable_async_deep_copy = true; ///< flag for deep-copying the put objects in async mode
+    bool m_initialized = false; ///< flag set after the screens and the outputs are initialized
     kvs::LogStream m_log{}; ///< log stream
     kvs::StampTimer m_tstep_list{}; ///< time step list
     kvs::StampTimer m_pipe_timer{}; ///< timer for pipeline execution process
     kvs::StampTimer m_rend_timer{}; ///< timer for rendering process
     kvs::StampTimer m_save_timer{}; ///< timer for image saving process
+    kvs::StampTimer m_cull_list{}; ///< number of culled viewpoint locations
+    kvs::StampTimer m_stall_tstep_list{}; ///< time step list of the exec calls in async mode
+    kvs::StampTimer m_stall_timer{}; ///< timer for the time that the simulation is stalled in async mode
+    kvs::StampTimer m_vis_timer{}; ///< timer for the whole visualization in the background thread
+    size_t m_log_interval = 0; ///< number of records flushed into the log files at once (0: written at dump)
+    InSituVis::StreamingSink m_log_sink{}; ///< sink for the log files
+    std::unique_ptr<std::array<InSituVis::MetricsBuffer,NumberOfStages>> m_metrics{}; ///< recent processing times of each stage (null: disabled)
+    std::unique_ptr<InSituVis::TimeBudgetController> m_budget_controller{}; ///< controller of the visualization time budget (null: disabled)
+    InSituVis::AsyncExecutor m_vis_executor{}; ///< background visualization thread (destroyed first)
 
 public:
     Adaptor();
@@ -93,24 +182,86 @@ public:
     size_t imageWidth() const { return m_image_width; }
     size_t imageHeight() const { return m_image_height; }
     bool isOutputImageEnabled() const { return m_enable_output_image; }
+    bool isZeroCopyReadbackEnabled() const { return m_enable_zero_copy_readback; }
+    bool isDepthStitchingEnabled() const { return m_enable_depth_stitching; }
+    bool isCubeMapOutputEnabled() const { return m_enable_cube_map_output; }
+    float evaluationImageScale() const { return m_evaluation_image_scale; }
+    kvs::Vec2ui evaluationImageSize() const;
+    bool isEvaluationCheckEnabled() const { return m_enable_evaluation_check; }
+    bool isAsyncExecutionEnabled() const { return m_enable_async_execution; }
+    bool isInitialized() const { return m_initialized; }
+    AsyncPolicy asyncPolicy() const { return m_vis_executor.policy(); }
+    bool isProfilingEnabled() const { return InSituVis::Profiler::Instance().isEnabled(); }
+    bool isViewpointCullingEnabled() const { return m_enable_viewpoint_culling; }
+    float cullingAreaRatio() const { return m_culling_area_ratio; }
+    bool isStreamingOutputEnabled() const { return m_log_interval > 0; }
+    size_t streamingInterval() const { return m_log_interval; }
+    bool isMetricsEnabled() const { return m_metrics != nullptr; }
+    size_t metricsWindowSize() const { return m_metrics ? ( *m_metrics )[0].capacity() : 0; }
+    Metrics metrics( const Stage stage ) const { return m_metrics ? ( *m_metrics )[ stage ].statistics() : Metrics{}; }
+    float metricsPercentile( const Stage stage, const float p ) const { return m_metrics ? ( *m_metrics )[ stage ].percentile( p ) : 0.0f; }
+    bool isTimeBudgetEnabled() const { return m_budget_controller != nullptr; }
+    InSituVis::TimeBudgetController* timeBudgetController() { return m_budget_controller.get(); }
     std::ostream& log() { return m_log(); }
     std::ostream& log( const bool enable ) { return m_log( enable ); }
     Screen& screen() { return m_screen; }
     const InSituVis::Viewpoint& viewpoint() const { return m_viewpoint; }
     InSituVis::OutputDirectory& outputDirectory() { return m_output_directory; }
+    bool isAsyncImageWritingEnabled() const { return m_image_writer != nullptr; }
+    const std::shared_ptr<InSituVis::FrameStore>& frameStore() const { return m_frame_store; }
+    const std::shared_ptr<InSituVis::FrameSink>& frameSink() const { return m_frame_sink; }
+    const std::shared_ptr<InSituVis::StreamEncoder>& streamEncoder() const { return m_stream_encoder; }
+    InSituVis::FrameBufferPool& frameBufferPool() { return m_frame_buffer_pool; }
+    size_t numberOfRenderingThreads() const { return m_nrendering_threads; }
+    size_t numberOfPipelineThreads() const { return m_pipeline_pool ? m_pipeline_pool->numberOfThreads() : 0; }
+    bool isTwoPhasePipeline() const { return m_mapper && m_registrar; }
+    const InSituVis::ImageEncoder& imageEncoder() const { return m_image_encoder; }
     size_t analysisInterval() const { return m_analysis_interval; }
     kvs::StampTimer& tstepList() { return m_tstep_list; }
     kvs::StampTimer& pipeTimer() { return m_pipe_timer; }
     kvs::StampTimer& rendTimer() { return m_rend_timer; }
     kvs::StampTimer& saveTimer() { return m_save_timer; }
+    kvs::StampTimer& cullList() { return m_cull_list; }
+    kvs::StampTimer& stallTimer() { return m_stall_timer; }
+    kvs::StampTimer& visTimer() { return m_vis_timer; }
 
     void setViewpoint( const Viewpoint& viewpoint ) { m_viewpoint = viewpoint; }
     void setAnalysisInterval( const size_t interval ) { m_analysis_interval = interval; }
     void setPipeline( Pipeline pipeline ) { m_pipeline = pipeline; }
+    void setPipeline( Mapper mapper, Registrar registrar, Replicator replicator = {} );
     void setOutputDirectory( const InSituVis::OutputDirectory& directory ) { m_output_directory = directory; }
     void setOutputFilename( const std::string& filename ) { m_output_filename = filename; }
-    void setImageSize( const size_t width, const size_t height ) { m_image_width = width; m_image_height = height; }
+    void setImageSize( const size_t width, const size_t height );
     void setOutputImageEnabled( const bool enable = true ) { m_enable_output_image = enable; }
+    void setZeroCopyReadbackEnabled( const bool enable = true ) { m_enable_zero_copy_readback = enable; }
+    void setDepthStitchingEnabled( const bool enable = true ) { m_enable_depth_stitching = enable; }
+    void setCubeMapOutputEnabled( const bool enable = true ) { m_enable_cube_map_output = enable; }
+    void setEvaluationImageScale( const float scale ) { m_evaluation_image_scale = kvs::Math::Clamp( scale, 0.0f, 1.0f ); }
+    void setEvaluationCheckEnabled( const bool enable = true ) { m_enable_evaluation_check = enable; }
+    void setProfilingEnabled( const bool enable = true ) { InSituVis::Profiler::Instance().setEnabled( enable ); }
+    void setViewpointCullingEnabled( const bool enable = true, const float area_ratio = 0.0f );
+    void setStreamingOutputEnabled( const bool enable = true, const size_t interval = 1000 );
+    void setMetricsEnabled( const bool enable = true, const size_t window_size = 64 );
+    void setTimeBudgetEnabled( const bool enable = true, const float target_overhead = 0.1f );
+    void addAnalysisIntervalKnob( const size_t min, const size_t max, const size_t step = 1 );
+    void setImageEncoder( const InSituVis::ImageEncoder& encoder );
+    void setFrameStore( std::shared_ptr<InSituVis::FrameStore> store ) { m_frame_store = store; }
+    void setFrameSink( std::shared_ptr<InSituVis::FrameSink> sink ) { m_frame_sink = sink; }
+    void setStreamEncoder( std::shared_ptr<InSituVis::StreamEncoder> encoder );
+    void setAsyncImageWritingEnabled(
+        const bool enable = true,
+        const size_t nthreads = 1,
+        const size_t max_jobs = 32 );
+    void setParallelRenderingEnabled(
+        const bool enable = true,
+        const size_t nthreads = 0 );
+    void setAsyncExecutionEnabled(
+        const bool enable = true,
+        const AsyncPolicy policy = AsyncPolicy::Block,
+        const bool deep_copy = true );
+    void setConcurrentPipelineEnabled(
+        const bool enable = true,
+        const size_t nthreads = 0 );
 
     virtual bool initialize();
     virtual bool finalize();
@@ -126,29 +277,113 @@ protected:
     virtual ColorBuffer drawScreen();
     virtual FrameBuffer drawFrameBuffer();
 //    virtual ColorBuffer drawColorBuffer();
+    virtual bool isParallelRenderingSupported() const { return true; }
+    // Adaptors overriding exec() support async mode by calling execAsync()
+    // at the beginning of exec(). The MPI adaptors return false.
+    virtual bool isAsyncExecutionSupported() const { return true; }
+    // Adaptors whose controllers derive the steps from the analysis interval
+    // (e.g. the camera path) return false, so that it is fixed during the run.
+    virtual bool isAnalysisIntervalAdjustable() const { return true; }
 
+    void setInitialized( const bool initialized = true ) { m_initialized = initialized; }
     kvs::UInt32 timeStep() const { return m_time_step; }
     void setTimeStep( const size_t step ) { m_time_step = step; }
-    void incrementTimeStep() { m_time_step++; }
+    void incrementTimeStep();
+    bool execAsync( const SimTime sim_time );
+    void waitForVisualization() { m_vis_executor.flush(); }
     bool isAnalysisStep() const { return m_time_step % m_analysis_interval == 0; }
+    bool isEvaluationImageScaled() const { return this->evaluationImageSize() != kvs::Vec2ui( m_image_width, m_image_height ); }
     void clearObjects() { m_objects.clear(); }
     ObjectList& objects() { return m_objects; }
 
+    bool isOmniDirectional( const Viewpoint::Location& location ) const;
+    virtual void resizeScreen( const size_t width, const size_t height );
+    void beginEvaluation();
+    void endEvaluation();
+    void stampEvaluationCheck( const int index, const int full_index );
+    void stampTime( const Stage stage, kvs::StampTimer& timer, const float time );
+
+    virtual std::pair<kvs::Vec3,kvs::Vec3> objectBounds();
+    virtual bool streamLogs();
+    virtual bool flushOutputs() { return true; }
+    virtual float reduceOverhead( const float overhead ) { return overhead; }
+    bool isCulled( const Viewpoint::Location& location, const std::pair<kvs::Vec3,kvs::Vec3>& bounds ) const;
+    ProjectedRect projectedRect(
+        const std::pair<kvs::Vec3,kvs::Vec3>& bounds,
+        const kvs::Vec3& position,
+        const kvs::Vec3& look_at,
+        const kvs::Vec3& up_vector ) const;
+    std::vector<bool> cullLocations( const Viewpoint::Locations& locations );
+
     kvs::Vec2ui outputImageSize( const Viewpoint::Location& location ) const;
     std::string outputImageName( const Viewpoint::Location& location, const std::string& surfix = "" ) const;
     ColorBuffer backgroundColorBuffer() const;
     DepthBuffer backgroundDepthBuffer() const;
+    FrameBuffer backgroundFrameBuffer( const Viewpoint::Location& location ) const;
+    ColorBuffer drawColorBuffer( Screen& screen );
+    ColorBuffer readbackColorBuffer( Screen& screen );
+    DepthBuffer readbackDepthBuffer( Screen& screen );
+    ColorBuffer stitchColorBuffer( SphericalBuffer<kvs::UInt8>& buffer );
+    DepthBuffer stitchDepthBuffer( SphericalBuffer<kvs::Real32>& buffer );
     bool isInsideObject( const kvs::Vec3& position, const kvs::ObjectBase* object ) const;
     ColorBuffer readback( const Viewpoint::Location& location );
+    ColorBuffer readback( Screen& screen, const Viewpoint::Location& location );
     FrameBuffer readbackFrameBuffer( const Viewpoint::Location& location );
+    FrameBuffer readbackFrameBuffer( Screen& screen, const Viewpoint::Location& location );
+    std::vector<FrameBuffer> readbackFrameBuffers( const Viewpoint::Locations& locations );
+    std::vector<FrameBuffer> readbackFrameBuffers( const Viewpoint::Locations& locations, const std::vector<bool>& culled );
+    CubeMapBuffers readbackCubeMap( Screen& screen, const Viewpoint::Location& location );
+
+    void writeColorImage( const std::string& filename, const kvs::Vec2ui& size, const ColorBuffer& buffer );
+    void writeDepthImage( const std::string& filename, const kvs::Vec2ui& size, const DepthBuffer& buffer );
+    void writeAlphaImage( const std::string& filename, const kvs::Vec2ui& size, const ColorBuffer& buffer );
+    void writeCubeMap( const std::string& filename, const Viewpoint::Location& location, const CubeMapBuffers& buffers );
+    bool writeDrainTime( const std::string& filename );
+    bool writePoolCount( const std::string& filename );
+    bool writeProcTime( const std::string& filename, const bool final = true );
+    bool writeEvaluationCheck( const std::string& filename, const bool final = true );
+    bool writeCullCount( const std::string& filename, const bool final = true );
+    bool writeStallTime( const std::string& filename, const bool final = true );
+    bool writeAsyncCount( const std::string& filename );
+    bool writeTrace( const std::string& filename, const bool final = true );
+    bool writeBudgetLog( const std::string& filename );
+    void openFrameStore( const std::string& filename );
+    bool flushFrameStore();
+    void writeFile( const std::string& filename, InSituVis::ImageWriter::Function write );
+    void flushFiles();
+    bool openFrameSink();
+    virtual std::string outputStreamName( const std::string& filename ) const;
+    void publishFrame( const Viewpoint::Location& location, const kvs::Vec2ui& size, const ColorBuffer& buffer );
 
 private:
-    ColorBuffer readback_uni_buffer( const Viewpoint::Location& location );
-    ColorBuffer readback_omn_buffer( const Viewpoint::Location& location );
-    ColorBuffer readback_adp_buffer( const Viewpoint::Location& location );
-    FrameBuffer readback_frame_buffer_uni( const Viewpoint::Location& location );
-    FrameBuffer readback_frame_buffer_omn( const Viewpoint::Location& location );
-    FrameBuffer readback_frame_buffer_adp( const Viewpoint::Location& location );
+    void create_screens();
+    void exec_async();
+    void stamp_stall( const kvs::UInt32 step, kvs::Timer& timer );
+    void terminate_if_requested();
+    void end_time_step();
+    void update_budget();
+    std::string frame_name( const std::string& filename ) const;
+    static bool WriteImage(
+        const std::shared_ptr<InSituVis::FrameStore>& store,
+        const std::string& name,
+        const InSituVis::ImageEncoder& encoder,
+        const std::string& filename,
+        const size_t width,
+        const size_t height,
+        const size_t nchannels,
+        const kvs::UInt8* pixels );
+    const Object* exec_pipeline( Screen& screen, const Object& object );
+    void render_locations(
+        const Viewpoint::Locations& locations,
+        std::function<void(Screen&,size_t)> func );
+    ColorBuffer draw_color_buffer( Screen& screen );
+    FrameBuffer draw_frame_buffer( Screen& screen );
+    ColorBuffer readback_uni_buffer( Screen& screen, const Viewpoint::Location& location );
+    ColorBuffer readback_omn_buffer( Screen& screen, const Viewpoint::Location& location );
+    ColorBuffer readback_adp_buffer( Screen& screen, const Viewpoint::Location& location );
+    FrameBuffer readback_frame_buffer_uni( Screen& screen, const Viewpoint::Location& location );
+    FrameBuffer readback_frame_buffer_omn( Screen& screen, const Viewpoint::Location& location );
+    FrameBuffer readback_frame_buffer_adp( Screen& screen, const Viewpoint::Location& location );
 };
 
 } // end of namespace InSituVis
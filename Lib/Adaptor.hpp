@@ -13,20 +13,96 @@
 #include <kvs/StructuredVolumeObject>
 #include <kvs/UnstructuredVolumeObject>
 #include <kvs/StructuredVolumeObjectList>
+#include <kvs/OpenGL>
+#include <kvs/File>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <cstring>
 
-// Termination process.
+// Termination process. While the visualization thread is running, dumping
+// the logs waits for the thread, so only the flag is set in the handler and
+// the logs are dumped in the simulation thread at the next exec(). The default
+// handler is restored so that another signal terminates the process.
 namespace
 {
 std::function<void(int)> Dump;
-void Terminate( int sig ) { Dump( sig ); }
+volatile std::sig_atomic_t DumpDeferred = 0;
+volatile std::sig_atomic_t TerminationRequested = 0;
+void Terminate( int sig )
+{
+    if ( !DumpDeferred ) { Dump( sig ); }
+    TerminationRequested = 1;
+    std::signal( sig, SIG_DFL );
+}
 }
 
-// Shallow-copied object pointer.
+// Flip the rows of the read-back buffer (bottom-up to top-down).
 namespace
 {
 
+template <typename T>
+inline void FlipRows( T* data, const size_t row_size, const size_t nrows )
+{
+    for ( size_t j = 0; j < nrows / 2; ++j )
+    {
+        auto* upper = data + j * row_size;
+        auto* lower = data + ( nrows - 1 - j ) * row_size;
+        std::swap_ranges( upper, upper + row_size, lower );
+    }
+}
+
+// Read back the front buffer in the top-down row order. Mesa (OSMesa) writes
+// the rows in that order in glReadPixels with GL_MESA_pack_invert, so that
+// the rows are not flipped in another pass over the buffer.
+template <typename T>
+inline void ReadPixelsTopDown(
+    const GLsizei width,
+    const GLsizei height,
+    const GLenum format,
+    const GLenum type,
+    const size_t nchannels,
+    T* data )
+{
+    kvs::OpenGL::SetReadBuffer( GL_FRONT );
+    kvs::OpenGL::SetPixelStorageMode( GL_PACK_ALIGNMENT, GLint(4) );
+#if defined( KVS_SUPPORT_OSMESA ) && defined( GL_PACK_INVERT_MESA )
+    static const bool invert = []
+    {
+        const auto* extensions = reinterpret_cast<const char*>( glGetString( GL_EXTENSIONS ) );
+        return extensions && std::strstr( extensions, "GL_MESA_pack_invert" );
+    }();
+    if ( invert )
+    {
+        kvs::OpenGL::SetPixelStorageMode( GL_PACK_INVERT_MESA, GLint( GL_TRUE ) );
+        kvs::OpenGL::ReadPixels( 0, 0, width, height, format, type, data );
+        kvs::OpenGL::SetPixelStorageMode( GL_PACK_INVERT_MESA, GLint( GL_FALSE ) );
+        return;
+    }
+#endif
+    kvs::OpenGL::ReadPixels( 0, 0, width, height, format, type, data );
+    ::FlipRows( data, width * nchannels, height );
+}
+
+}
+
+// Shallow-copied (or deep-copied) object pointer.
+namespace
+{
+
+template <typename T>
+inline void CopyObject( T* dst, const T* src, const bool deep )
+{
+    if ( deep ) { dst->deepCopy( *src ); }
+    else { dst->shallowCopy( *src ); }
+}
+
 inline kvs::ObjectBase* GeometryObjectPointer(
-    const kvs::GeometryObjectBase* geometry )
+    const kvs::GeometryObjectBase* geometry,
+    const bool deep )
 {
     switch ( geometry->geometryType() )
     {
@@ -34,21 +110,21 @@ inline kvs::ObjectBase* GeometryObjectPointer(
     {
         using Geom = kvs::PointObject;
         auto* ret = new Geom();
-        ret->shallowCopy( *Geom::DownCast( geometry ) );
+        CopyObject( ret, Geom::DownCast( geometry ), deep );
         return ret;
     }
     case kvs::GeometryObjectBase::Line:
     {
         using Geom = kvs::LineObject;
         auto* ret = new Geom();
-        ret->shallowCopy( *Geom::DownCast( geometry ) );
+        CopyObject( ret, Geom::DownCast( geometry ), deep );
         return ret;
     }
     case kvs::GeometryObjectBase::Polygon:
     {
         using Geom = kvs::PolygonObject;
         auto* ret = new Geom();
-        ret->shallowCopy( *Geom::DownCast( geometry ) );
+        CopyObject( ret, Geom::DownCast( geometry ), deep );
         return ret;
     }
     default: return nullptr;
@@ -56,7 +132,8 @@ inline kvs::ObjectBase* GeometryObjectPointer(
 }
 
 inline kvs::ObjectBase* VolumeObjectPointer(
-    const kvs::VolumeObjectBase* volume )
+    const kvs::VolumeObjectBase* volume,
+    const bool deep )
 {
     switch ( volume->volumeType() )
     {
@@ -64,33 +141,33 @@ inline kvs::ObjectBase* VolumeObjectPointer(
     {
         using Volume = kvs::StructuredVolumeObject;
         auto* ret = new Volume();
-        ret->shallowCopy( *Volume::DownCast( volume ) );
+        CopyObject( ret, Volume::DownCast( volume ), deep );
         return ret;
     }
     case kvs::VolumeObjectBase::Unstructured:
     {
         using Volume = kvs::UnstructuredVolumeObject;
         auto* ret = new Volume();
-        ret->shallowCopy( *Volume::DownCast( volume ) );
+        CopyObject( ret, Volume::DownCast( volume ), deep );
         return ret;
     }
     default: return nullptr;
     }
 }
 
-inline kvs::ObjectBase* ObjectPointer( const kvs::ObjectBase& object )
+inline kvs::ObjectBase* ObjectPointer( const kvs::ObjectBase& object, const bool deep = false )
 {
     switch ( object.objectType() )
     {
     case kvs::ObjectBase::Geometry:
     {
         using Geom = kvs::GeometryObjectBase;
-        return GeometryObjectPointer( Geom::DownCast( &object ) );
+        return GeometryObjectPointer( Geom::DownCast( &object ), deep );
     }
     case kvs::ObjectBase::Volume:
     {
         using Volume = kvs::VolumeObjectBase;
-        return VolumeObjectPointer( Volume::DownCast( &object ) );
+        return VolumeObjectPointer( Volume::DownCast( &object ), deep );
     }
     default:
     {
@@ -98,7 +175,7 @@ inline kvs::ObjectBase* ObjectPointer( const kvs::ObjectBase& object )
         if ( const auto* volume_list = VolumeList::DownCast( &object ) )
         {
             auto* ret = new VolumeList();
-            ret->shallowCopy( *volume_list );
+            CopyObject( ret, volume_list, deep );
             return ret;
         }
         return nullptr;
@@ -121,6 +198,154 @@ inline Adaptor::Adaptor()
     std::signal( SIGINT,  ::Terminate ); // Ctrl + c
 }
 
+inline void Adaptor::setAsyncImageWritingEnabled(
+    const bool enable,
+    const size_t nthreads,
+    const size_t max_jobs )
+{
+    // The writer threads are stopped after the queued files are written.
+    m_image_writer.reset();
+    if ( enable && nthreads > 0 )
+    {
+        m_image_writer.reset( new InSituVis::ImageWriter() );
+        m_image_writer->start( nthreads, max_jobs );
+    }
+}
+
+inline void Adaptor::setImageEncoder( const InSituVis::ImageEncoder& encoder )
+{
+    // The PNG images need zlib (INSITUVIS_USE_ZLIB) and the JPEG images need
+    // libjpeg (INSITUVIS_USE_JPEG).
+    if ( !InSituVis::ImageEncoder::IsSupported( encoder.format() ) )
+    {
+        this->log() << "ERROR: " << "Image format is not supported. Define INSITUVIS_USE_ZLIB for PNG or INSITUVIS_USE_JPEG for JPEG." << std::endl;
+        return;
+    }
+    m_image_encoder = encoder;
+}
+
+inline void Adaptor::setStreamEncoder( std::shared_ptr<InSituVis::StreamEncoder> encoder )
+{
+    // e.g. the delta encoding needs zlib (INSITUVIS_USE_ZLIB).
+    if ( encoder && !encoder->isSupported() )
+    {
+        this->log() << "ERROR: " << "Stream encoder is not supported in this build." << std::endl;
+        return;
+    }
+    m_stream_encoder = encoder;
+}
+
+inline void Adaptor::setPipeline( Mapper mapper, Registrar registrar, Replicator replicator )
+{
+    // The replicator is required for the parallel rendering, where each
+    // rendering thread registers a copy of the mapped objects to its own
+    // screen (the objects are mapped only once by the main thread).
+    m_mapper = mapper;
+    m_registrar = registrar;
+    m_replicator = replicator;
+}
+
+inline void Adaptor::setImageSize( const size_t width, const size_t height )
+{
+    // The off-screen surfaces, the frame sink and the image compositors are
+    // created with the image size in initialize(), so the size cannot be
+    // changed after that.
+    if ( m_initialized )
+    {
+        this->log() << "ERROR: " << "Cannot change the image size after initialization." << std::endl;
+        return;
+    }
+    m_image_width = width;
+    m_image_height = height;
+}
+
+inline void Adaptor::setParallelRenderingEnabled( const bool enable, const size_t nthreads )
+{
+    // The main thread renders with its own screen in addition to the threads.
+    const size_t ncores = std::thread::hardware_concurrency();
+    const size_t n = nthreads > 0 ? nthreads : ( ncores > 1 ? ncores - 1 : 0 );
+    m_nrendering_threads = enable ? n : 0;
+}
+
+inline void Adaptor::setAsyncExecutionEnabled(
+    const bool enable,
+    const AsyncPolicy policy,
+    const bool deep_copy )
+{
+    // The visualization thread is started in initialize(). The adaptors
+    // overriding exec() hand their steps over to the thread with execAsync(),
+    // and their steps are never dropped or coalesced, since the controllers
+    // need every step. The mode is disabled in initialize() for the adaptors
+    // not supporting it (e.g. the MPI adaptors, whose composition is a
+    // collective operation issued by each rank).
+    m_enable_async_execution = enable;
+    m_enable_async_deep_copy = deep_copy;
+    m_vis_executor.setPolicy( policy );
+}
+
+inline void Adaptor::setConcurrentPipelineEnabled( const bool enable, const size_t nthreads )
+{
+    // The calling thread maps one of the objects in addition to the threads.
+    const size_t ncores = std::thread::hardware_concurrency();
+    const size_t n = nthreads > 0 ? nthreads : ( ncores > 1 ? ncores - 1 : 0 );
+    m_pipeline_pool.reset( enable && n > 0 ? new InSituVis::ThreadPool( n ) : nullptr );
+}
+
+inline void Adaptor::setViewpointCullingEnabled( const bool enable, const float area_ratio )
+{
+    m_enable_viewpoint_culling = enable;
+    m_culling_area_ratio = kvs::Math::Clamp( area_ratio, 0.0f, 1.0f );
+}
+
+inline void Adaptor::setStreamingOutputEnabled( const bool enable, const size_t interval )
+{
+    m_log_interval = enable ? kvs::Math::Max( interval, size_t( 1 ) ) : 0;
+}
+
+inline void Adaptor::setMetricsEnabled( const bool enable, const size_t window_size )
+{
+    // The buffers are queried from the solver while the visualization thread
+    // pushes the times, so they must not be replaced during the run.
+    if ( !enable ) { m_metrics.reset(); return; }
+    m_metrics.reset( new std::array<InSituVis::MetricsBuffer,NumberOfStages>() );
+    for ( auto& m : *m_metrics ) { m.setCapacity( window_size ); }
+}
+
+inline void Adaptor::setTimeBudgetEnabled( const bool enable, const float target_overhead )
+{
+    // The knobs are kept while the controller is enabled.
+    if ( !enable ) { m_budget_controller.reset(); return; }
+    if ( !m_budget_controller ) { m_budget_controller.reset( new InSituVis::TimeBudgetController() ); }
+    m_budget_controller->setTargetOverhead( target_overhead );
+}
+
+inline void Adaptor::addAnalysisIntervalKnob( const size_t min, const size_t max, const size_t step )
+{
+    if ( !m_budget_controller )
+    {
+        this->log() << "ERROR: " << "Time budget control is not enabled." << std::endl;
+        return;
+    }
+
+    // The controllers of the camera path and the time step hold the steps
+    // derived from the analysis interval, so it cannot be changed for them.
+    if ( !this->isAnalysisIntervalAdjustable() )
+    {
+        this->log() << "ERROR: " << "Analysis interval cannot be adjusted with this adaptor." << std::endl;
+        return;
+    }
+
+    // The visualization gets cheaper as the analysis interval increases.
+    m_budget_controller->addKnob(
+        "analysis_interval",
+        [this] { return static_cast<int>( m_analysis_interval ); },
+        [this] ( const int value ) { m_analysis_interval = static_cast<size_t>( value ); },
+        static_cast<int>( kvs::Math::Max( min, size_t( 1 ) ) ),
+        static_cast<int>( max ),
+        static_cast<int>( step ),
+        false );
+}
+
 inline bool Adaptor::initialize()
 {
     if ( !m_output_directory.create() )
@@ -128,24 +353,73 @@ inline bool Adaptor::initialize()
         this->log() << "ERRROR: " << "Cannot create output directory." << std::endl;
         return false;
     }
-    m_screen.setSize( m_image_width, m_image_height );
-    m_screen.create();
+
+    this->openFrameStore( m_output_directory.name() + "/" + m_output_filename + ".frames" );
+    if ( !this->openFrameSink() )
+    {
+        this->log() << "ERROR: " << "Cannot open frame sink." << std::endl;
+        return false;
+    }
+
+    // The adaptors not supporting async mode render in the calling thread,
+    // which has no rendering context if the screens are created in the thread.
+    if ( m_enable_async_execution && !this->isAsyncExecutionSupported() )
+    {
+        this->log() << "WARNING: " << "Async execution is not supported with this adaptor." << std::endl;
+        this->setAsyncExecutionEnabled( false );
+    }
+
+    // The knobs cannot be changed while the visualization thread is running.
+    if ( m_enable_async_execution && m_budget_controller )
+    {
+        this->log() << "WARNING: " << "Time budget control is not supported in async mode." << std::endl;
+        m_budget_controller.reset();
+    }
+
+    // In async mode, the screens are created in the visualization thread,
+    // since the rendering context is used by the thread that created it.
+    if ( m_enable_async_execution )
+    {
+        m_exec_time_step = m_time_step;
+        m_vis_executor.start( [this] { this->create_screens(); } );
+        ::DumpDeferred = 1;
+    }
+    else
+    {
+        this->create_screens();
+    }
+    m_initialized = true;
     return true;
 }
 
 inline bool Adaptor::finalize()
 {
-    return this->dump();
+    const bool ret = this->dump();
+    m_vis_executor.stop();
+    ::DumpDeferred = 0;
+    if ( m_frame_sink ) { m_frame_sink->close(); }
+    return ret;
 }
 
 inline void Adaptor::put( const Adaptor::Object& object )
 {
-    auto* p = ::ObjectPointer( object ); // pointer to the shallow copied object
-    if ( p ) { m_objects.push_back( Object::Pointer( p ) ); }
+    // The objects are deep-copied in async mode, since the simulation may
+    // overwrite the data while they are visualized in the background. They
+    // are put into a separate list from the one used in the thread.
+    const bool deep = m_vis_executor.isRunning() && m_enable_async_deep_copy;
+    auto* p = ::ObjectPointer( object, deep ); // pointer to the copied object
+    auto& objects = m_vis_executor.isRunning() ? m_exec_objects : m_objects;
+    if ( p ) { objects.push_back( Object::Pointer( p ) ); }
 }
 
 inline void Adaptor::exec( const SimTime sim_time )
 {
+    if ( m_vis_executor.isRunning() )
+    {
+        this->exec_async();
+        return;
+    }
+
     if ( this->isAnalysisStep() )
     {
         // Stack current time step.
@@ -163,37 +437,76 @@ inline void Adaptor::exec( const SimTime sim_time )
 
 inline bool Adaptor::dump()
 {
-    if ( m_tstep_list.title().empty() ) { m_tstep_list.setTitle( "Time step" ); }
-    if ( m_pipe_timer.title().empty() ) { m_pipe_timer.setTitle( "Pipe time" ); }
-    if ( m_rend_timer.title().empty() ) { m_rend_timer.setTitle( "Rend time" ); }
-    if ( m_save_timer.title().empty() ) { m_save_timer.setTitle( "Save time" ); }
+    // Wait for the visualization in the background thread and the image
+    // files queued in the writer threads.
+    this->waitForVisualization();
+    this->flushFiles();
+    if ( !this->flushFrameStore() ) return false;
 
+    // In streaming mode, the records remaining after the last flush are
+    // appended to the log files.
     const auto dir = m_output_directory.name() + "/";
-    kvs::StampTimerList timer_list;
-    timer_list.push( m_tstep_list );
-    timer_list.push( m_pipe_timer );
-    timer_list.push( m_rend_timer );
-    timer_list.push( m_save_timer );
-    return timer_list.write( dir + "vis_proc_time" + ".csv" );
+    if ( !this->writeDrainTime( dir + "vis_drain_time" + ".csv" ) ) return false;
+    if ( !this->writePoolCount( dir + "vis_pool_count" + ".csv" ) ) return false;
+    if ( !this->writeEvaluationCheck( dir + "vis_eval_check" + ".csv" ) ) return false;
+    if ( !this->writeCullCount( dir + "vis_cull_count" + ".csv" ) ) return false;
+    if ( !this->writeStallTime( dir + "vis_stall_time" + ".csv" ) ) return false;
+    if ( !this->writeAsyncCount( dir + "vis_async_count" + ".csv" ) ) return false;
+    if ( !this->writeTrace( dir + "vis_trace" + ".json" ) ) return false;
+    if ( !this->writeBudgetLog( dir + "vis_budget_log" + ".csv" ) ) return false;
+    return this->writeProcTime( dir + "vis_proc_time" + ".csv" );
 }
 
 inline void Adaptor::execPipeline( const Object& object )
 {
-    m_pipeline( m_screen, object );
+    this->exec_pipeline( m_screen, object );
 }
 
 inline void Adaptor::execPipeline( const ObjectList& objects )
 {
+    InSituVis::ProfileScope scope( "pipeline" );
     kvs::Timer timer( kvs::Timer::Start );
-    for ( auto& pobject : objects )
+    if ( this->isTwoPhasePipeline() && m_pipeline_pool && objects.size() > 1 )
+    {
+        // The objects are mapped concurrently, and then the mapped objects
+        // are registered to the screen one by one in the order of the list.
+        std::vector<const Object*> inputs;
+        for ( auto& pobject : objects ) { inputs.push_back( pobject.get() ); }
+
+        std::vector<Object*> mapped( inputs.size(), nullptr );
+        m_pipeline_pool->parallelFor( inputs.size(), [&] ( const size_t begin, const size_t end )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                InSituVis::ProfileScope map_scope( "map", static_cast<long>( i ) );
+                mapped[i] = m_mapper( *inputs[i] );
+            }
+        }, inputs.size() );
+
+        m_mapped_objects.clear();
+        for ( auto* object : mapped )
+        {
+            m_registrar( m_screen, object );
+            m_mapped_objects.push_back( object );
+        }
+    }
+    else
     {
-        auto& object = *( pobject.get() );
-        this->execPipeline( object );
+        m_mapped_objects.clear();
+        for ( auto& pobject : objects )
+        {
+            auto& object = *( pobject.get() );
+            m_mapped_objects.push_back( this->exec_pipeline( m_screen, object ) );
+        }
     }
     timer.stop();
 
+    // The mapped objects are copied to the screens of the rendering threads
+    // when the viewpoints are rendered in parallel.
+    if ( m_screen_pool ) { m_pipeline_count++; }
+
     const auto pipe_time = m_pipe_timer.time( timer );
-    m_pipe_timer.stamp( pipe_time );
+    this->stampTime( PipeStage, m_pipe_timer, pipe_time );
 }
 
 inline void Adaptor::execPipeline()
@@ -203,6 +516,7 @@ inline void Adaptor::execPipeline()
 
 inline void Adaptor::execRendering()
 {
+    InSituVis::ProfileScope scope( "rendering" );
     float rend_time = 0.0f;
     float save_time = 0.0f;
     {
@@ -210,63 +524,297 @@ inline void Adaptor::execRendering()
         kvs::Timer timer_save;
         for ( const auto& location : m_viewpoint.locations() )
         {
+            // Output the cube faces as they are without stitching
+            if ( m_enable_cube_map_output && this->isOmniDirectional( location ) )
+            {
+                timer_rend.start();
+                const auto buffers = this->readbackCubeMap( m_screen, location );
+                timer_rend.stop();
+                rend_time += m_rend_timer.time( timer_rend );
+
+                timer_save.start();
+                if ( m_enable_output_image )
+                {
+                    this->writeCubeMap( this->outputImageName( location ), location, buffers );
+                }
+                timer_save.stop();
+                save_time += m_save_timer.time( timer_save );
+                continue;
+            }
+
             // Draw and readback framebuffer
             timer_rend.start();
             auto color_buffer = this->readback( location );
             timer_rend.stop();
             rend_time += m_rend_timer.time( timer_rend );
 
-            // Output framebuffer to image file
+            // Output framebuffer to image file and the frame ring
             timer_save.start();
+            const auto size = this->outputImageSize( location );
             if ( m_enable_output_image )
             {
-                const auto size = this->outputImageSize( location );
-                const auto width = size.x();
-                const auto height = size.y();
-                kvs::ColorImage image( width, height, color_buffer );
-                image.write( this->outputImageName( location ) );
+                const auto filename = this->outputImageName( location );
+                this->writeColorImage( filename, size, color_buffer );
             }
+            this->publishFrame( location, size, color_buffer );
             timer_save.stop();
             save_time += m_save_timer.time( timer_save );
         }
     }
-    m_rend_timer.stamp( rend_time );
-    m_save_timer.stamp( save_time );
+    this->stampTime( RendStage, m_rend_timer, rend_time );
+    this->stampTime( SaveStage, m_save_timer, save_time );
 }
 
 inline Adaptor::ColorBuffer Adaptor::drawScreen()
-//inline Adaptor::ColorBuffer Adaptor::drawColorBuffer()
 {
-    m_screen.draw();
-    return m_screen.readbackColorBuffer();
+    return this->drawColorBuffer( m_screen );
 }
 
 inline Adaptor::FrameBuffer Adaptor::drawFrameBuffer()
 {
     const auto color_buffer = this->drawScreen();
-    const auto depth_buffer = m_screen.readbackDepthBuffer();
+    const auto depth_buffer = this->readbackDepthBuffer( m_screen );
     return { color_buffer, depth_buffer };
 }
 
-inline kvs::Vec2ui Adaptor::outputImageSize( const Viewpoint::Location& location ) const
+inline kvs::Vec2ui Adaptor::evaluationImageSize() const
+{
+    const auto s = m_evaluation_image_scale;
+    const auto w = static_cast<unsigned int>( kvs::Math::Round( m_image_width * s ) );
+    const auto h = static_cast<unsigned int>( kvs::Math::Round( m_image_height * s ) );
+    return { kvs::Math::Max( w, 1u ), kvs::Math::Max( h, 1u ) };
+}
+
+inline void Adaptor::resizeScreen( const size_t width, const size_t height )
+{
+    // Only the viewport is changed within the off-screen surface created with
+    // the image size, so the size must not exceed the image size.
+    const int w = static_cast<int>( kvs::Math::Min( width, m_image_width ) );
+    const int h = static_cast<int>( kvs::Math::Min( height, m_image_height ) );
+    if ( m_screen.width() == w && m_screen.height() == h ) { return; }
+
+    m_screen.setSize( w, h );
+    m_screen.resizeEvent( w, h );
+}
+
+inline void Adaptor::incrementTimeStep()
+{
+    m_time_step++;
+    this->end_time_step();
+}
+
+inline void Adaptor::end_time_step()
+{
+    // Per-step housekeeping, which is run by the thread owning the screens
+    // and the outputs (the visualization thread in async mode).
+    m_frame_buffer_pool.evict();
+    if ( m_budget_controller ) { this->update_budget(); }
+    if ( m_log_interval > 0 && !this->streamLogs() )
+    {
+        this->log() << "ERROR: " << "Cannot write the log files." << std::endl;
+    }
+    if ( !this->flushOutputs() )
+    {
+        this->log() << "ERROR: " << "Cannot write the output files." << std::endl;
+    }
+}
+
+inline bool Adaptor::streamLogs()
+{
+    // Flush the records into the log files every m_log_interval records.
+    const auto dir = m_output_directory.name() + "/";
+    bool ret = this->writeProcTime( dir + "vis_proc_time" + ".csv", false );
+    ret = this->writeEvaluationCheck( dir + "vis_eval_check" + ".csv", false ) && ret;
+    ret = this->writeCullCount( dir + "vis_cull_count" + ".csv", false ) && ret;
+    ret = this->writeTrace( dir + "vis_trace" + ".json", false ) && ret;
+    return ret;
+}
+
+inline void Adaptor::beginEvaluation()
+{
+    const auto size = this->evaluationImageSize();
+    this->resizeScreen( size.x(), size.y() );
+}
+
+inline void Adaptor::endEvaluation()
+{
+    this->resizeScreen( m_image_width, m_image_height );
+}
+
+inline void Adaptor::stampEvaluationCheck( const int index, const int full_index )
+{
+    m_evaluation_checks.emplace_back( static_cast<int>( m_time_step ), index, full_index );
+}
+
+inline void Adaptor::stampTime( const Stage stage, kvs::StampTimer& timer, const float time )
+{
+    // The time is also recorded in the metrics queried by the solver.
+    timer.stamp( time );
+    if ( m_metrics ) { ( *m_metrics )[ stage ].push( time ); }
+    if ( m_budget_controller ) { m_budget_controller->addVisTime( time ); }
+
+    // The drain time of the image writer is stamped with the save time, so
+    // that both have the same number of the records.
+    if ( stage == SaveStage && m_image_writer ) { m_image_writer->stampDrainTime(); }
+}
+
+inline std::pair<kvs::Vec3,kvs::Vec3> Adaptor::objectBounds()
 {
-    const auto image_size = kvs::Vec2ui( m_image_width, m_image_height );
+    // Bounding box of the object manager in the world coordinates. An empty
+    // (inverted) box is returned if no object is registered.
+    const auto fmax = std::numeric_limits<float>::max();
+    kvs::Vec3 min_coord( fmax, fmax, fmax );
+    kvs::Vec3 max_coord( -fmax, -fmax, -fmax );
+
+    const auto* object = m_screen.scene()->objectManager();
+    if ( !object->hasObject() ) { return { min_coord, max_coord }; }
+
+    const auto min_obj = object->minObjectCoord();
+    const auto max_obj = object->maxObjectCoord();
+    for ( size_t i = 0; i < 8; i++ )
+    {
+        const kvs::Vec3 corner(
+            ( i & 1 ) ? max_obj.x() : min_obj.x(),
+            ( i & 2 ) ? max_obj.y() : min_obj.y(),
+            ( i & 4 ) ? max_obj.z() : min_obj.z() );
+        const auto p = kvs::ObjectCoordinate( corner, object ).toWorldCoordinate().position();
+        for ( int k = 0; k < 3; k++ )
+        {
+            min_coord[k] = kvs::Math::Min( min_coord[k], p[k] );
+            max_coord[k] = kvs::Math::Max( max_coord[k], p[k] );
+        }
+    }
+    return { min_coord, max_coord };
+}
+
+inline bool Adaptor::isCulled(
+    const Viewpoint::Location& location,
+    const std::pair<kvs::Vec3,kvs::Vec3>& bounds ) const
+{
+    const auto& min_coord = bounds.first;
+    const auto& max_coord = bounds.second;
+    if ( min_coord.x() > max_coord.x() ) { return false; } // no object
+
+    // The omni-directional views, and the adaptive views inside the object,
+    // always see the object.
+    const auto& p = location.position;
+    const bool inside =
+        ( min_coord.x() <= p.x() ) && ( p.x() <= max_coord.x() ) &&
+        ( min_coord.y() <= p.y() ) && ( p.y() <= max_coord.y() ) &&
+        ( min_coord.z() <= p.z() ) && ( p.z() <= max_coord.z() );
     switch ( location.direction )
     {
-    case Viewpoint::Direction::Uni: return image_size;
-    case Viewpoint::Direction::Omni: return image_size * kvs::Vec2ui( 4, 3 );
+    case Viewpoint::Direction::Uni: break;
+    case Viewpoint::Direction::Adaptive: if ( inside ) { return false; } break;
+    default: return false;
+    }
+
+    // The area is not estimated (whole screen) if the box crosses the near
+    // plane.
+    const auto rect = this->projectedRect( bounds, p, location.look_at, location.up_vector );
+    if ( rect.empty() ) { return true; }
+    return m_culling_area_ratio > 0.0f && rect.area() < m_culling_area_ratio;
+}
+
+inline Adaptor::ProjectedRect Adaptor::projectedRect(
+    const std::pair<kvs::Vec3,kvs::Vec3>& bounds,
+    const kvs::Vec3& position,
+    const kvs::Vec3& look_at,
+    const kvs::Vec3& up_vector ) const
+{
+    // The whole screen is returned if the projection is not estimated
+    // (orthographic camera, or the box crosses the near plane).
+    const ProjectedRect whole( { -1.0f, -1.0f }, { 1.0f, 1.0f } );
+    const auto* camera = m_screen.scene()->camera();
+    if ( camera->projectionType() != kvs::Camera::Perspective ) { return whole; }
+    if ( position == look_at ) { return whole; }
+
+    // Camera coordinate system of the location.
+    const auto& p = position;
+    const auto& min_coord = bounds.first;
+    const auto& max_coord = bounds.second;
+    const auto f = ( look_at - p ).normalized();
+    const auto s = f.cross( up_vector ).normalized();
+    const auto u = s.cross( f );
+    const auto ty = std::tan( kvs::Math::Deg2Rad( camera->fieldOfView() * 0.5f ) );
+    const auto tx = ty * m_screen.width() / m_screen.height();
+    const auto front = camera->front();
+    const auto back = camera->back();
+
+    // Count the corners outside each of the six frustum planes.
+    int outside[6] = { 0, 0, 0, 0, 0, 0 };
+    bool behind = false;
+    kvs::Vec2 min_ndc( 1.0f, 1.0f );
+    kvs::Vec2 max_ndc( -1.0f, -1.0f );
+    for ( size_t i = 0; i < 8; i++ )
+    {
+        const kvs::Vec3 corner(
+            ( i & 1 ) ? max_coord.x() : min_coord.x(),
+            ( i & 2 ) ? max_coord.y() : min_coord.y(),
+            ( i & 4 ) ? max_coord.z() : min_coord.z() );
+        const auto d = corner - p;
+        const auto x = d.dot( s );
+        const auto y = d.dot( u );
+        const auto z = d.dot( f );
+        if ( z < front ) { outside[0]++; }
+        if ( z > back ) { outside[1]++; }
+        if ( x < -z * tx ) { outside[2]++; }
+        if ( x > z * tx ) { outside[3]++; }
+        if ( y < -z * ty ) { outside[4]++; }
+        if ( y > z * ty ) { outside[5]++; }
+
+        if ( z < front ) { behind = true; continue; }
+        const kvs::Vec2 ndc( x / ( z * tx ), y / ( z * ty ) );
+        min_ndc.x() = kvs::Math::Min( min_ndc.x(), ndc.x() );
+        min_ndc.y() = kvs::Math::Min( min_ndc.y(), ndc.y() );
+        max_ndc.x() = kvs::Math::Max( max_ndc.x(), ndc.x() );
+        max_ndc.y() = kvs::Math::Max( max_ndc.y(), ndc.y() );
+    }
+    for ( const auto n : outside ) { if ( n == 8 ) { return {}; } }
+    if ( behind ) { return whole; }
+
+    // Clipped by the screen.
+    return {
+        { kvs::Math::Max( min_ndc.x(), -1.0f ), kvs::Math::Max( min_ndc.y(), -1.0f ) },
+        { kvs::Math::Min( max_ndc.x(), 1.0f ), kvs::Math::Min( max_ndc.y(), 1.0f ) } };
+}
+
+inline std::vector<bool> Adaptor::cullLocations( const Viewpoint::Locations& locations )
+{
+    std::vector<bool> culled( locations.size(), false );
+    if ( !m_enable_viewpoint_culling ) { return culled; }
+
+    const auto bounds = this->objectBounds();
+    size_t nculled = 0;
+    for ( size_t i = 0; i < locations.size(); i++ )
+    {
+        culled[i] = this->isCulled( locations[i], bounds );
+        if ( culled[i] ) { nculled++; }
+    }
+
+    m_cull_list.stamp( static_cast<float>( nculled ) );
+    return culled;
+}
+
+inline bool Adaptor::isOmniDirectional( const Viewpoint::Location& location ) const
+{
+    switch ( location.direction )
+    {
+    case Viewpoint::Direction::Omni: return true;
     case Viewpoint::Direction::Adaptive:
     {
         const auto* object = m_screen.scene()->objectManager();
-        if ( this->isInsideObject( location.position, object ) )
-        {
-            return image_size * kvs::Vec2ui( 4, 3 );
-        }
-        break;
+        return this->isInsideObject( location.position, object );
     }
-    default: break;
+    default: return false;
     }
-    return image_size;
+}
+
+inline kvs::Vec2ui Adaptor::outputImageSize( const Viewpoint::Location& location ) const
+{
+    // Current screen size, which is the evaluation image size while evaluating.
+    const auto image_size = kvs::Vec2ui( m_screen.width(), m_screen.height() );
+    return this->isOmniDirectional( location ) ? image_size * kvs::Vec2ui( 4, 3 ) : image_size;
 }
 
 inline std::string Adaptor::outputImageName( const Viewpoint::Location& location, const std::string& surfix ) const
@@ -278,36 +826,457 @@ inline std::string Adaptor::outputImageName( const Viewpoint::Location& location
 
     const auto output_basename = m_output_filename;
     const auto output_filename = output_basename + "_" + output_time + "_" + output_space;
-    const auto filename = m_output_directory.name() + "/" + output_filename + surfix + ".bmp";
+    const auto filename = m_output_directory.name() + "/" + output_filename + surfix + m_image_encoder.extension();
     return filename;
 }
 
+inline void Adaptor::writeColorImage(
+    const std::string& filename,
+    const kvs::Vec2ui& size,
+    const ColorBuffer& buffer )
+{
+    // With the stream encoder (e.g. the delta encoding), the frame is taken
+    // into the stream here in the order of the frames, and only the
+    // serialization is done in the writer thread.
+    const auto store = m_frame_store;
+    if ( m_stream_encoder )
+    {
+        const auto stream_filename = filename.substr( 0, filename.find_last_of( '.' ) ) + m_stream_encoder->extension();
+        const auto name = this->frame_name( stream_filename );
+        const auto job = m_stream_encoder->encode( this->outputStreamName( name ), size.x(), size.y(), 4, buffer.data() );
+        this->writeFile( stream_filename, [job,store,name] ( const std::string& f )
+        {
+            InSituVis::ProfileScope scope( "encode" );
+            const auto bytes = job();
+            if ( bytes.empty() ) { return false; }
+            if ( store ) { return store->append( name, bytes.data(), bytes.size() ); }
+
+            std::ofstream file( f, std::ios::binary );
+            file.write( reinterpret_cast<const char*>( bytes.data() ), bytes.size() );
+            return file.good();
+        } );
+        return;
+    }
+
+    // The buffer and the encoder are shared with the job, so the encoding
+    // and the file writing are both done in the writer thread. The RGBA
+    // buffer is passed to the encoder directly without any conversion.
+    const auto encoder = m_image_encoder;
+    const auto name = this->frame_name( filename );
+    this->writeFile( filename, [size,buffer,encoder,store,name] ( const std::string& f )
+    {
+        InSituVis::ProfileScope scope( "encode" );
+        return WriteImage( store, name, encoder, f, size.x(), size.y(), 4, buffer.data() );
+    } );
+}
+
+inline void Adaptor::writeDepthImage(
+    const std::string& filename,
+    const kvs::Vec2ui& size,
+    const DepthBuffer& buffer )
+{
+    const auto encoder = m_image_encoder;
+    const auto store = m_frame_store;
+    const auto name = this->frame_name( filename );
+    this->writeFile( filename, [size,buffer,encoder,store,name] ( const std::string& f )
+    {
+        // Normalize the depth values into [0,255] (same as kvs::GrayImage).
+        kvs::Real32 min_value = buffer[0];
+        kvs::Real32 max_value = buffer[0];
+        for ( const auto d : buffer )
+        {
+            min_value = kvs::Math::Min( min_value, d );
+            max_value = kvs::Math::Max( max_value, d );
+        }
+
+        const auto range = max_value - min_value;
+        const auto scale = range > 0.0f ? 255.0f / range : 0.0f;
+        kvs::ValueArray<kvs::UInt8> pixels( buffer.size() );
+        for ( size_t i = 0; i < buffer.size(); ++i )
+        {
+            pixels[i] = static_cast<kvs::UInt8>( ( buffer[i] - min_value ) * scale );
+        }
+        return WriteImage( store, name, encoder, f, size.x(), size.y(), 1, pixels.data() );
+    } );
+}
+
+inline void Adaptor::writeAlphaImage(
+    const std::string& filename,
+    const kvs::Vec2ui& size,
+    const ColorBuffer& buffer )
+{
+    const auto encoder = m_image_encoder;
+    const auto store = m_frame_store;
+    const auto name = this->frame_name( filename );
+    this->writeFile( filename, [size,buffer,encoder,store,name] ( const std::string& f )
+    {
+        const size_t channel = 3; // alpha channel in the RGBA buffer
+        kvs::ValueArray<kvs::UInt8> pixels( buffer.size() / 4 );
+        for ( size_t i = 0; i < pixels.size(); ++i )
+        {
+            pixels[i] = buffer[ 4 * i + channel ];
+        }
+        return WriteImage( store, name, encoder, f, size.x(), size.y(), 1, pixels.data() );
+    } );
+}
+
+inline void Adaptor::writeCubeMap(
+    const std::string& filename,
+    const Viewpoint::Location& location,
+    const CubeMapBuffers& buffers )
+{
+    using Direction = SphericalBuffer<kvs::UInt8>::Direction;
+
+    // The faces are written as <basename>_<direction><extension> together with
+    // the cube map file <basename>.cube, which is read by the stitching tool.
+    const auto extension = m_image_encoder.extension();
+    const auto basename = filename.substr( 0, filename.size() - extension.size() );
+    const auto size = kvs::Vec2ui( m_screen.width(), m_screen.height() );
+
+    std::vector<std::string> face_filenames;
+    for ( size_t i = 0; i < Direction::NumberOfDirections; i++ )
+    {
+        const auto d = Direction(i);
+        const auto face_filename = basename + "_" + SphericalBuffer<kvs::UInt8>::DirectionName(d) + extension;
+        this->writeColorImage( face_filename, size, buffers[i] );
+        face_filenames.push_back( kvs::File( face_filename ).fileName() );
+    }
+
+    const auto p = location.position;
+    const auto store = m_frame_store;
+    const auto name = this->frame_name( basename + ".cube" );
+    this->writeFile( basename + ".cube", [size,p,face_filenames,store,name] ( const std::string& f )
+    {
+        std::ostringstream ofs;
+
+        ofs << "# InSituVis cube map" << std::endl;
+        ofs << "width " << size.x() << std::endl;
+        ofs << "height " << size.y() << std::endl;
+        ofs << "channels " << 4 << std::endl;
+        ofs << "position " << p.x() << " " << p.y() << " " << p.z() << std::endl;
+        for ( size_t i = 0; i < face_filenames.size(); i++ )
+        {
+            const auto d = Direction(i);
+            const auto dir = SphericalBuffer<kvs::UInt8>::DirectionVector(d);
+            const auto up = SphericalBuffer<kvs::UInt8>::UpVector(d);
+            ofs << "face " << i << " " << face_filenames[i]
+                << " " << dir.x() << " " << dir.y() << " " << dir.z()
+                << " " << up.x() << " " << up.y() << " " << up.z() << std::endl;
+        }
+
+        const auto text = ofs.str();
+        if ( store ) { return store->append( name, text.data(), text.size() ); }
+
+        std::ofstream file( f );
+        if ( !file ) { return false; }
+        file << text;
+        return file.good();
+    } );
+}
+
+inline void Adaptor::openFrameStore( const std::string& filename )
+{
+    // The store is opened after the output directory is created.
+    if ( m_frame_store ) { m_frame_store->open( filename ); }
+}
+
+inline bool Adaptor::openFrameSink()
+{
+    // The sink is opened for the largest output image.
+    if ( !m_frame_sink ) { return true; }
+
+    // The omni-directional images are 4x3 times larger than the image size.
+    size_t npixels = m_image_width * m_image_height;
+    for ( const auto& location : m_viewpoint.locations() )
+    {
+        if ( location.direction != Viewpoint::Direction::Uni ) { npixels *= 12; break; }
+    }
+    return m_frame_sink->open( npixels * 4 );
+}
+
+inline void Adaptor::writeFile( const std::string& filename, InSituVis::ImageWriter::Function write )
+{
+    // The file is written by the writer threads in async writing mode, or
+    // immediately in the calling thread.
+    if ( m_image_writer ) { m_image_writer->push( filename, write ); return; }
+    if ( !write( filename ) )
+    {
+        this->log() << "ERROR: " << "Cannot write " << filename << "." << std::endl;
+    }
+}
+
+inline void Adaptor::flushFiles()
+{
+    // Wait for the files queued in the writer threads.
+    if ( m_image_writer ) { m_image_writer->flush(); }
+}
+
+inline std::string Adaptor::outputStreamName( const std::string& filename ) const
+{
+    // The frames at the same viewpoint location make a stream, so the time
+    // step is removed from the name.
+    return InSituVis::StreamEncoder::StreamName( filename, 1 );
+}
+
+inline void Adaptor::publishFrame(
+    const Viewpoint::Location& location,
+    const kvs::Vec2ui& size,
+    const ColorBuffer& buffer )
+{
+    // The RGBA pixels are published without waiting for the consumers, so a
+    // slow consumer never stalls the simulation. The dropped frames are
+    // counted in the sink (e.g. the frame ring).
+    if ( !m_frame_sink ) { return; }
+    m_frame_sink->publish( this->timeStep(), location.index, size.x(), size.y(), 4, buffer.data() );
+}
+
+inline bool Adaptor::flushFrameStore()
+{
+    // The files are made readable (e.g. the frames and the index of the
+    // container are written) even if the simulation is terminated after that.
+    if ( !m_frame_store ) { return true; }
+    return m_frame_store->flush();
+}
+
+inline std::string Adaptor::frame_name( const std::string& filename ) const
+{
+    // Name of the file in the store, which is the path relative to the
+    // base directory (e.g. "output_000010_000000.bmp").
+    const auto base = m_output_directory.baseDirectoryName() + "/";
+    return filename.compare( 0, base.size(), base ) == 0 ? filename.substr( base.size() ) : filename;
+}
+
+inline bool Adaptor::WriteImage(
+    const std::shared_ptr<InSituVis::FrameStore>& store,
+    const std::string& name,
+    const InSituVis::ImageEncoder& encoder,
+    const std::string& filename,
+    const size_t width,
+    const size_t height,
+    const size_t nchannels,
+    const kvs::UInt8* pixels )
+{
+    if ( !store ) { return encoder.write( filename, width, height, nchannels, pixels ); }
+
+    const auto bytes = encoder.encode( width, height, nchannels, pixels );
+    if ( bytes.empty() ) { return false; }
+    return store->append( name, bytes.data(), bytes.size() );
+}
+
+inline bool Adaptor::writeDrainTime( const std::string& filename )
+{
+    if ( !m_image_writer ) { return true; }
+
+    auto& drain_timer = m_image_writer->drainTimer();
+    if ( drain_timer.title().empty() ) { drain_timer.setTitle( "Drain time" ); }
+
+    kvs::StampTimerList timer_list;
+    timer_list.push( drain_timer );
+    return timer_list.write( filename );
+}
+
+inline bool Adaptor::writePoolCount( const std::string& filename )
+{
+    std::ofstream file( filename );
+    if ( !file ) { return false; }
+
+    file << "Pool hits,Pool misses" << std::endl;
+    file << m_frame_buffer_pool.numberOfHits() << "," << m_frame_buffer_pool.numberOfMisses() << std::endl;
+    return true;
+}
+
+inline bool Adaptor::writeProcTime( const std::string& filename, const bool final )
+{
+    if ( m_tstep_list.title().empty() ) { m_tstep_list.setTitle( "Time step" ); }
+    if ( m_pipe_timer.title().empty() ) { m_pipe_timer.setTitle( "Pipe time" ); }
+    if ( m_rend_timer.title().empty() ) { m_rend_timer.setTitle( "Rend time" ); }
+    if ( m_save_timer.title().empty() ) { m_save_timer.setTitle( "Save time" ); }
+
+    InSituVis::StreamingSink::Timers timers = { &m_tstep_list, &m_pipe_timer, &m_rend_timer, &m_save_timer };
+    if ( m_vis_executor.isRunning() )
+    {
+        if ( m_vis_timer.title().empty() ) { m_vis_timer.setTitle( "Vis time" ); }
+        timers.push_back( &m_vis_timer );
+    }
+    return m_log_sink.write( filename, timers, m_log_interval, final );
+}
+
+inline bool Adaptor::writeEvaluationCheck( const std::string& filename, const bool final )
+{
+    if ( m_evaluation_checks.empty() ) { return true; }
+    if ( !final && ( m_log_interval == 0 || m_evaluation_checks.size() < m_log_interval ) ) { return true; }
+
+    const auto size = this->evaluationImageSize();
+    std::ostringstream header;
+    header << "Time step,Index (" << size.x() << "x" << size.y() << "),";
+    header << "Index (" << m_image_width << "x" << m_image_height << "),Match";
+
+    std::ostringstream records;
+    for ( const auto& c : m_evaluation_checks )
+    {
+        records << c[0] << "," << c[1] << "," << c[2] << "," << ( c[1] == c[2] ? 1 : 0 ) << std::endl;
+    }
+
+    const auto n = m_evaluation_checks.size();
+    if ( !m_log_sink.append( filename, header.str(), records.str(), n ) ) { return false; }
+    m_evaluation_checks.clear();
+    return true;
+}
+
+inline bool Adaptor::writeStallTime( const std::string& filename, const bool final )
+{
+    if ( !m_vis_executor.isRunning() ) { return true; }
+
+    if ( m_stall_tstep_list.title().empty() ) { m_stall_tstep_list.setTitle( "Time step" ); }
+    if ( m_stall_timer.title().empty() ) { m_stall_timer.setTitle( "Stall time" ); }
+    const InSituVis::StreamingSink::Timers timers = { &m_stall_tstep_list, &m_stall_timer };
+    return m_log_sink.write( filename, timers, m_log_interval, final );
+}
+
+inline bool Adaptor::writeAsyncCount( const std::string& filename )
+{
+    if ( !m_vis_executor.isRunning() ) { return true; }
+
+    std::ofstream file( filename );
+    if ( !file ) { return false; }
+
+    file << "Pushed steps,Dropped steps,Coalesced steps" << std::endl;
+    file << m_vis_executor.numberOfPushedJobs() << ",";
+    file << m_vis_executor.numberOfDroppedJobs() << ",";
+    file << m_vis_executor.numberOfCoalescedJobs() << std::endl;
+    return true;
+}
+
+inline bool Adaptor::writeTrace( const std::string& filename, const bool final )
+{
+    // The events recorded since the previous write are appended to the file.
+    if ( !InSituVis::Profiler::Instance().isEnabled() ) { return true; }
+    if ( !final && ( m_log_interval == 0 || m_time_step % m_log_interval != 0 ) ) { return true; }
+    return InSituVis::Profiler::Instance().write( filename );
+}
+
+inline bool Adaptor::writeBudgetLog( const std::string& filename )
+{
+    if ( !m_budget_controller ) { return true; }
+    return m_budget_controller->write( filename );
+}
+
+inline bool Adaptor::writeCullCount( const std::string& filename, const bool final )
+{
+    if ( !m_enable_viewpoint_culling ) { return true; }
+
+    if ( m_cull_list.title().empty() ) { m_cull_list.setTitle( "Culled locations" ); }
+    return m_log_sink.write( filename, { &m_cull_list }, m_log_interval, final );
+}
+
 inline Adaptor::ColorBuffer Adaptor::backgroundColorBuffer() const
 {
+    // The buffer is cached until the screen size or the color is changed.
     const auto color = m_screen.scene()->background()->color();
     const auto width = m_screen.width();
     const auto height = m_screen.height();
-    const size_t npixels = width * height;
-    ColorBuffer buffer( npixels * 4 );
-    for ( size_t i = 0; i < npixels; ++i )
-    {
-        buffer[ 4 * i + 0 ] = color.r();
-        buffer[ 4 * i + 1 ] = color.g();
-        buffer[ 4 * i + 2 ] = color.b();
-        buffer[ 4 * i + 3 ] = 255;
-    }
-    return buffer;
+    return m_frame_buffer_pool.constantColorBuffer( width * height, color );
 }
 
 inline Adaptor::DepthBuffer Adaptor::backgroundDepthBuffer() const
 {
     const auto width = m_screen.width();
     const auto height = m_screen.height();
-    DepthBuffer buffer( width * height );
-    buffer.fill( 1.0f );
+    return m_frame_buffer_pool.constantDepthBuffer( width * height, 1.0f );
+}
+
+inline Adaptor::FrameBuffer Adaptor::backgroundFrameBuffer( const Viewpoint::Location& location ) const
+{
+    const auto size = this->outputImageSize( location );
+    const auto npixels = size.x() * size.y();
+    const auto color = m_screen.scene()->background()->color();
+    return {
+        m_frame_buffer_pool.constantColorBuffer( npixels, color ),
+        m_frame_buffer_pool.constantDepthBuffer( npixels, 1.0f ) };
+}
+
+inline Adaptor::ColorBuffer Adaptor::drawColorBuffer( Screen& screen )
+{
+#if defined( KVS_SUPPORT_OSMESA )
+    // In zero-copy mode (opt-in with setZeroCopyReadbackEnabled), OSMesa
+    // renders into host memory, so a buffer taken from the pool is bound as
+    // the color buffer of the context and the scene is rendered into it
+    // directly (no readback copy). The color buffer of the screen is bound
+    // again before the buffer is returned, so that the later GL calls never
+    // write into the buffer owned by the caller.
+    if ( m_enable_zero_copy_readback )
+    {
+        auto context = OSMesaGetCurrentContext();
+        GLint width = 0;
+        GLint height = 0;
+        GLint format = 0;
+        void* data = nullptr;
+        // The evaluation images (smaller screen) are read back from the surface,
+        // since rebinding a smaller buffer would reallocate the depth buffer.
+        if ( context && OSMesaGetColorBuffer( context, &width, &height, &format, &data ) && format == OSMESA_RGBA &&
+             width == screen.width() && height == screen.height() )
+        {
+            auto buffer = m_frame_buffer_pool.colorBuffer( width * height * 4 );
+            if ( OSMesaMakeCurrent( context, buffer.data(), GL_UNSIGNED_BYTE, width, height ) )
+            {
+                OSMesaPixelStore( OSMESA_Y_UP, 0 ); // top-down rows (same as the readback)
+                screen.draw();
+                kvs::OpenGL::Finish();
+                OSMesaMakeCurrent( context, data, GL_UNSIGNED_BYTE, width, height );
+                OSMesaPixelStore( OSMESA_Y_UP, 1 );
+                return buffer;
+            }
+        }
+    }
+#endif
+    screen.draw();
+    return this->readbackColorBuffer( screen );
+}
+
+inline Adaptor::ColorBuffer Adaptor::readbackColorBuffer( Screen& screen )
+{
+    const auto width = screen.width();
+    const auto height = screen.height();
+    auto buffer = m_frame_buffer_pool.colorBuffer( width * height * 4 );
+    ::ReadPixelsTopDown( width, height, GL_RGBA, GL_UNSIGNED_BYTE, 4, buffer.data() );
+    return buffer;
+}
+
+inline Adaptor::DepthBuffer Adaptor::readbackDepthBuffer( Screen& screen )
+{
+    // The depth buffer is read with glReadPixels also in zero-copy mode.
+    // OSMesaGetDepthBuffer exposes the depth storage of the driver, whose
+    // width (16 or 32 bits) and packing (e.g. 24-bit depth with stencil) are
+    // implementation-defined, so the float values must be converted from it
+    // in any case, which is what glReadPixels does.
+    const auto width = screen.width();
+    const auto height = screen.height();
+    auto buffer = m_frame_buffer_pool.depthBuffer( width * height );
+    ::ReadPixelsTopDown( width, height, GL_DEPTH_COMPONENT, GL_FLOAT, 1, buffer.data() );
     return buffer;
 }
 
+inline Adaptor::ColorBuffer Adaptor::stitchColorBuffer( SphericalBuffer<kvs::UInt8>& buffer )
+{
+    // The stitching gathers the pixels with the cached remap table, which is
+    // bound by the memory bandwidth, so it is done in the calling thread.
+    InSituVis::ProfileScope scope( "stitch" );
+    const size_t nchannels = 4; // rgba
+    const auto size = buffer.stitchedWidth() * buffer.stitchedHeight();
+    return buffer.stitch<nchannels>( m_frame_buffer_pool.colorBuffer( size * nchannels ) );
+}
+
+inline Adaptor::DepthBuffer Adaptor::stitchDepthBuffer( SphericalBuffer<kvs::Real32>& buffer )
+{
+    // The cached background depth is returned if no consumer (e.g. the depth
+    // entropy) needs the stitched depth.
+    const auto size = buffer.stitchedWidth() * buffer.stitchedHeight();
+    if ( !m_enable_depth_stitching ) { return m_frame_buffer_pool.constantDepthBuffer( size, 1.0f ); }
+
+    InSituVis::ProfileScope scope( "stitch_depth" );
+    return buffer.stitch<1>( m_frame_buffer_pool.depthBuffer( size ) );
+}
+
 inline bool Adaptor::isInsideObject( const kvs::Vec3& position, const kvs::ObjectBase* object ) const
 {
     const auto min_obj = object->minObjectCoord();
@@ -321,27 +1290,331 @@ inline bool Adaptor::isInsideObject( const kvs::Vec3& position, const kvs::Objec
 
 inline Adaptor::ColorBuffer Adaptor::readback( const Viewpoint::Location& location )
 {
+    return this->readback( m_screen, location );
+}
+
+inline Adaptor::ColorBuffer Adaptor::readback( Screen& screen, const Viewpoint::Location& location )
+{
+    InSituVis::ProfileScope scope( "render", static_cast<long>( location.index ) );
     switch ( location.direction )
     {
-    case Viewpoint::Direction::Uni: return this->readback_uni_buffer( location );
-    case Viewpoint::Direction::Omni: return this->readback_omn_buffer( location );
-    case Viewpoint::Direction::Adaptive: return this->readback_adp_buffer( location );
+    case Viewpoint::Direction::Uni: return this->readback_uni_buffer( screen, location );
+    case Viewpoint::Direction::Omni: return this->readback_omn_buffer( screen, location );
+    case Viewpoint::Direction::Adaptive: return this->readback_adp_buffer( screen, location );
     default: return this->backgroundColorBuffer();
     }
 }
 
 inline Adaptor::FrameBuffer Adaptor::readbackFrameBuffer( const Viewpoint::Location& location )
 {
+    return this->readbackFrameBuffer( m_screen, location );
+}
+
+inline Adaptor::FrameBuffer Adaptor::readbackFrameBuffer( Screen& screen, const Viewpoint::Location& location )
+{
+    InSituVis::ProfileScope scope( "render", static_cast<long>( location.index ) );
     switch ( location.direction )
     {
-    case Viewpoint::Direction::Uni: return this->readback_frame_buffer_uni( location );
-    case Viewpoint::Direction::Omni: return this->readback_frame_buffer_omn( location );
-    case Viewpoint::Direction::Adaptive: return this->readback_frame_buffer_adp( location );
+    case Viewpoint::Direction::Uni: return this->readback_frame_buffer_uni( screen, location );
+    case Viewpoint::Direction::Omni: return this->readback_frame_buffer_omn( screen, location );
+    case Viewpoint::Direction::Adaptive: return this->readback_frame_buffer_adp( screen, location );
     default: return { this->backgroundColorBuffer(), this->backgroundDepthBuffer() };
     }
 }
 
-inline Adaptor::ColorBuffer Adaptor::readback_uni_buffer( const Viewpoint::Location& location )
+inline std::vector<Adaptor::FrameBuffer> Adaptor::readbackFrameBuffers( const Viewpoint::Locations& locations )
+{
+    std::vector<FrameBuffer> frame_buffers( locations.size() );
+    this->render_locations( locations, [&] ( Screen& screen, const size_t i )
+    {
+        frame_buffers[i] = this->readbackFrameBuffer( screen, locations[i] );
+    } );
+    return frame_buffers;
+}
+
+inline std::vector<Adaptor::FrameBuffer> Adaptor::readbackFrameBuffers(
+    const Viewpoint::Locations& locations,
+    const std::vector<bool>& culled )
+{
+    // The culled locations are not rendered and the background buffers are
+    // returned for them instead.
+    Viewpoint::Locations visible_locations;
+    std::vector<size_t> indices;
+    for ( size_t i = 0; i < locations.size(); i++ )
+    {
+        if ( culled[i] ) { continue; }
+        visible_locations.push_back( locations[i] );
+        indices.push_back( i );
+    }
+    if ( indices.size() == locations.size() ) { return this->readbackFrameBuffers( locations ); }
+
+    const auto visible_buffers = this->readbackFrameBuffers( visible_locations );
+    std::vector<FrameBuffer> frame_buffers( locations.size() );
+    for ( size_t i = 0; i < locations.size(); i++ )
+    {
+        if ( culled[i] ) { frame_buffers[i] = this->backgroundFrameBuffer( locations[i] ); }
+    }
+    for ( size_t k = 0; k < indices.size(); k++ ) { frame_buffers[ indices[k] ] = visible_buffers[k]; }
+    return frame_buffers;
+}
+
+inline void Adaptor::create_screens()
+{
+    m_screen.setSize( m_image_width, m_image_height );
+    m_screen.create();
+
+    // Create the off-screen contexts for the rendering threads.
+    if ( m_nrendering_threads > 0 && !this->isParallelRenderingSupported() )
+    {
+        this->log() << "WARNING: " << "Parallel rendering is not supported by this adaptor." << std::endl;
+        m_nrendering_threads = 0;
+    }
+    if ( m_nrendering_threads > 0 && !( this->isTwoPhasePipeline() && m_replicator ) )
+    {
+        this->log() << "WARNING: " << "Parallel rendering requires the two-phase pipeline with the replicator." << std::endl;
+        m_nrendering_threads = 0;
+    }
+    if ( m_nrendering_threads > 0 )
+    {
+        m_screen_pool.reset( new InSituVis::OffScreenPool() );
+        m_screen_pool->start( m_nrendering_threads, m_image_width, m_image_height );
+        m_synced_pipeline_counts.assign( m_screen_pool->numberOfContexts(), 0 );
+    }
+}
+
+inline void Adaptor::exec_async()
+{
+    if ( m_exec_time_step % m_analysis_interval == 0 )
+    {
+        // The put objects are handed over to the visualization thread, and
+        // the simulation is stalled only while the job is pushed (or while
+        // waiting for a free slot with the Block policy).
+        InSituVis::ProfileScope scope( "stall", static_cast<long>( m_exec_time_step ) );
+        kvs::Timer timer( kvs::Timer::Start );
+        const auto step = m_exec_time_step;
+        const auto objects = m_exec_objects;
+        m_vis_executor.push( [this,step,objects]
+        {
+            InSituVis::ProfileScope vis_scope( "vis", static_cast<long>( step ) );
+            kvs::Timer vis_timer( kvs::Timer::Start );
+            m_time_step = step;
+            m_tstep_list.stamp( static_cast<float>( step ) );
+            this->execPipeline( objects );
+            this->execRendering();
+            vis_timer.stop();
+            m_vis_timer.stamp( m_vis_timer.time( vis_timer ) );
+
+            // The logs and the outputs of this thread are flushed in this thread.
+            this->end_time_step();
+        } );
+        this->stamp_stall( step, timer );
+    }
+
+    m_exec_time_step++;
+    m_exec_objects.clear();
+    this->terminate_if_requested();
+}
+
+inline bool Adaptor::execAsync( const SimTime sim_time )
+{
+    // Called at the beginning of exec() overridden by the adaptors. In async
+    // mode, the step is handed over to the visualization thread, in which
+    // exec() is called again with the objects put at the step, and true is
+    // returned. Otherwise, false is returned and the step is executed by the
+    // caller. All of the steps are handed over, since the controllers of the
+    // adaptors count and cache the steps themselves.
+    if ( !m_vis_executor.isRunning() || m_vis_executor.isExecutorThread() ) { return false; }
+
+    InSituVis::ProfileScope scope( "stall", static_cast<long>( m_exec_time_step ) );
+    kvs::Timer timer( kvs::Timer::Start );
+    const auto step = m_exec_time_step;
+    const auto objects = m_exec_objects;
+    m_vis_executor.push( [this,step,objects,sim_time]
+    {
+        InSituVis::ProfileScope vis_scope( "vis", static_cast<long>( step ) );
+        kvs::Timer vis_timer( kvs::Timer::Start );
+        m_objects = objects;
+        this->exec( sim_time );
+        vis_timer.stop();
+        m_vis_timer.stamp( m_vis_timer.time( vis_timer ) );
+    }, AsyncExecutor::Block );
+    this->stamp_stall( step, timer );
+
+    m_exec_time_step++;
+    m_exec_objects.clear();
+    this->terminate_if_requested();
+    return true;
+}
+
+inline void Adaptor::terminate_if_requested()
+{
+    // Called at the end of each exec() in the simulation thread in async
+    // mode. If a termination signal has been caught, the logs are dumped and
+    // the process exits. Only the flag of this process is checked, since the
+    // MPI adaptors do not run the visualization thread.
+    if ( !::TerminationRequested ) { return; }
+    this->dump();
+    exit( 0 );
+}
+
+inline void Adaptor::stamp_stall( const kvs::UInt32 step, kvs::Timer& timer )
+{
+    timer.stop();
+    m_stall_tstep_list.stamp( static_cast<float>( step ) );
+    m_stall_timer.stamp( m_stall_timer.time( timer ) );
+    if ( m_log_interval > 0 )
+    {
+        const auto filename = m_output_directory.name() + "/vis_stall_time.csv";
+        if ( !this->writeStallTime( filename, false ) )
+        {
+            this->log() << "ERROR: " << "Cannot write the log files." << std::endl;
+        }
+    }
+}
+
+inline void Adaptor::update_budget()
+{
+    // The cycle between the time steps consists of the solver and the
+    // visualization, whose time is stamped into the stage timers, so the
+    // cycle time is converted in the same unit.
+    if ( !m_budget_controller->endCycle( m_pipe_timer ) ) { return; }
+
+    // The knobs are changed based on the overhead agreed by all of the ranks.
+    const auto overhead = this->reduceOverhead( m_budget_controller->overhead() );
+    if ( m_budget_controller->adjust( m_time_step, overhead ) )
+    {
+        const auto& a = m_budget_controller->adjustments().back();
+        this->log() << "Time budget: " << a.name << " " << a.from << " -> " << a.to;
+        this->log() << " (overhead: " << overhead << ")" << std::endl;
+    }
+}
+
+inline const Adaptor::Object* Adaptor::exec_pipeline( Screen& screen, const Object& object )
+{
+    if ( this->isTwoPhasePipeline() )
+    {
+        auto* mapped = m_mapper( object );
+        m_registrar( screen, mapped );
+        return mapped;
+    }
+    m_pipeline( screen, object );
+    return nullptr;
+}
+
+inline void Adaptor::render_locations(
+    const Viewpoint::Locations& locations,
+    std::function<void(Screen&,size_t)> func )
+{
+    // Longest-job-first order based on the rendering time of each viewpoint
+    // location in the previous steps. The locations derived from the same
+    // viewpoint location (e.g. zoom levels) share its index, so their costs
+    // are recorded separately by the position in the list.
+    std::vector<size_t> indices;
+    for ( const auto& location : locations ) { indices.push_back( location.index ); }
+    std::sort( indices.begin(), indices.end() );
+    const bool by_index = std::adjacent_find( indices.begin(), indices.end() ) == indices.end();
+    auto& costs = by_index ? m_location_costs : m_position_costs;
+    auto key = [&] ( const size_t i ) { return by_index ? locations[i].index : i; };
+    auto cost = [&] ( const size_t i )
+    {
+        const auto k = key( i );
+        return k < costs.size() ? costs[ k ] : 0.0f;
+    };
+
+    std::vector<size_t> order( locations.size() );
+    for ( size_t i = 0; i < order.size(); ++i ) { order[i] = i; }
+    std::stable_sort( order.begin(), order.end(),
+        [&] ( const size_t a, const size_t b ) { return cost( a ) > cost( b ); } );
+
+    std::vector<float> times( locations.size(), 0.0f );
+    auto render = [&] ( Screen& screen, const size_t i )
+    {
+        kvs::Timer timer( kvs::Timer::Start );
+        func( screen, i );
+        timer.stop();
+        times[i] = static_cast<float>( timer.msec() );
+    };
+
+    if ( !m_screen_pool || locations.size() < 2 )
+    {
+        for ( const auto i : order ) { render( m_screen, i ); }
+    }
+    else
+    {
+        // Camera, light and background of the main screen, which are copied
+        // to the screens of the rendering threads.
+        const auto* camera = m_screen.scene()->camera();
+        const auto projection = camera->projectionType();
+        const auto fov = camera->fieldOfView();
+        const auto front = camera->front();
+        const auto back = camera->back();
+        const auto cp = camera->position();
+        const auto ca = camera->lookAt();
+        const auto cu = camera->upVector();
+        const auto lp = m_screen.scene()->light()->position();
+        const auto bg = m_screen.scene()->background()->color();
+
+        std::atomic<size_t> next( 0 );
+        m_screen_pool->execute( m_screen, [&] ( Screen& screen, const size_t context )
+        {
+            if ( context > 0 )
+            {
+                // Register the copies of the objects mapped at the current
+                // step (the registrar only touches the screen of this thread).
+                if ( m_synced_pipeline_counts[ context ] != m_pipeline_count )
+                {
+                    for ( auto* object : m_mapped_objects )
+                    {
+                        if ( object ) { m_registrar( screen, m_replicator( *object ) ); }
+                    }
+                    m_synced_pipeline_counts[ context ] = m_pipeline_count;
+                }
+
+                auto* c = screen.scene()->camera();
+                c->setProjectionType( projection );
+                c->setFieldOfView( fov );
+                c->setFront( front );
+                c->setBack( back );
+                c->setPosition( cp, ca, cu );
+                screen.scene()->light()->setPosition( lp );
+                screen.scene()->background()->setColor( bg );
+                if ( screen.width() != m_screen.width() || screen.height() != m_screen.height() )
+                {
+                    screen.setSize( m_screen.width(), m_screen.height() );
+                    screen.resizeEvent( m_screen.width(), m_screen.height() );
+                }
+            }
+
+            for ( size_t k = next++; k < order.size(); k = next++ )
+            {
+                render( screen, order[k] );
+            }
+        } );
+    }
+
+    for ( size_t i = 0; i < locations.size(); ++i )
+    {
+        const auto k = key( i );
+        if ( k >= costs.size() ) { costs.resize( k + 1, 0.0f ); }
+        costs[ k ] = times[i];
+    }
+}
+
+inline Adaptor::ColorBuffer Adaptor::draw_color_buffer( Screen& screen )
+{
+    if ( &screen == &m_screen ) { return this->drawScreen(); }
+    return this->drawColorBuffer( screen );
+}
+
+inline Adaptor::FrameBuffer Adaptor::draw_frame_buffer( Screen& screen )
+{
+    if ( &screen == &m_screen ) { return this->drawFrameBuffer(); }
+    const auto color_buffer = this->draw_color_buffer( screen );
+    const auto depth_buffer = this->readbackDepthBuffer( screen );
+    return { color_buffer, depth_buffer };
+}
+
+inline Adaptor::ColorBuffer Adaptor::readback_uni_buffer( Screen& screen, const Viewpoint::Location& location )
 {
     const auto p = location.position;
     const auto a = location.look_at;
@@ -352,8 +1625,8 @@ inline Adaptor::ColorBuffer Adaptor::readback_uni_buffer( const Viewpoint::Locat
     }
     else
     {
-        auto* camera = m_screen.scene()->camera();
-        auto* light = m_screen.scene()->light();
+        auto* camera = screen.scene()->camera();
+        auto* light = screen.scene()->light();
 
         // Backup camera and light info.
         const auto p0 = camera->position();
@@ -363,7 +1636,7 @@ inline Adaptor::ColorBuffer Adaptor::readback_uni_buffer( const Viewpoint::Locat
         //Draw the scene.
         camera->setPosition( p, a, u );
         light->setPosition( p );
-        const auto buffer = this->drawScreen();
+        const auto buffer = this->draw_color_buffer( screen );
 
         // Restore camera and light info.
         camera->setPosition( p0, a0, u0 );
@@ -373,12 +1646,13 @@ inline Adaptor::ColorBuffer Adaptor::readback_uni_buffer( const Viewpoint::Locat
     }
 }
 
-inline Adaptor::ColorBuffer Adaptor::readback_omn_buffer( const Viewpoint::Location& location )
+inline Adaptor::CubeMapBuffers Adaptor::readbackCubeMap( Screen& screen, const Viewpoint::Location& location )
 {
+    InSituVis::ProfileScope scope( "cube_map", static_cast<long>( location.index ) );
     using SphericalColorBuffer = InSituVis::SphericalBuffer<kvs::UInt8>;
 
-    auto* camera = m_screen.scene()->camera();
-    auto* light = m_screen.scene()->light();
+    auto* camera = screen.scene()->camera();
+    auto* light = screen.scene()->light();
 
     // Backup camera and light info.
     const auto fov = camera->fieldOfView();
@@ -394,15 +1668,14 @@ inline Adaptor::ColorBuffer Adaptor::readback_omn_buffer( const Viewpoint::Locat
     camera->setFront( 0.1 );
     light->setPosition( p );
 
-    SphericalColorBuffer color_buffer( m_screen.width(), m_screen.height() );
+    CubeMapBuffers buffers;
     for ( size_t i = 0; i < SphericalColorBuffer::Direction::NumberOfDirections; i++ )
     {
         const auto d = SphericalColorBuffer::Direction(i);
         const auto dir = SphericalColorBuffer::DirectionVector(d);
         const auto up = SphericalColorBuffer::UpVector(d);
         camera->setPosition( p, p + dir, up );
-        const auto buffer = this->drawScreen();
-        color_buffer.setBuffer( d, buffer );
+        buffers[i] = this->draw_color_buffer( screen );
     }
 
     // Restore camera and light info.
@@ -411,27 +1684,40 @@ inline Adaptor::ColorBuffer Adaptor::readback_omn_buffer( const Viewpoint::Locat
     camera->setPosition( cp, ca, cu );
     light->setPosition( lp );
 
-    const size_t nchannels = 4; // rgba
-    return color_buffer.stitch<nchannels>();
+    return buffers;
 }
 
-inline Adaptor::ColorBuffer Adaptor::readback_adp_buffer( const Viewpoint::Location& location )
+inline Adaptor::ColorBuffer Adaptor::readback_omn_buffer( Screen& screen, const Viewpoint::Location& location )
 {
-    const auto* object = m_screen.scene()->objectManager();
+    using SphericalColorBuffer = InSituVis::SphericalBuffer<kvs::UInt8>;
+
+    const auto buffers = this->readbackCubeMap( screen, location );
+    SphericalColorBuffer color_buffer( screen.width(), screen.height() );
+    for ( size_t i = 0; i < SphericalColorBuffer::Direction::NumberOfDirections; i++ )
+    {
+        color_buffer.setBuffer( SphericalColorBuffer::Direction(i), buffers[i] );
+    }
+
+    return this->stitchColorBuffer( color_buffer );
+}
+
+inline Adaptor::ColorBuffer Adaptor::readback_adp_buffer( Screen& screen, const Viewpoint::Location& location )
+{
+    const auto* object = screen.scene()->objectManager();
     return this->isInsideObject( location.position, object ) ?
-        this->readback_omn_buffer( location ) :
-        this->readback_uni_buffer( location );
+        this->readback_omn_buffer( screen, location ) :
+        this->readback_uni_buffer( screen, location );
 }
 
-inline Adaptor::FrameBuffer Adaptor::readback_frame_buffer_uni( const Viewpoint::Location& location )
+inline Adaptor::FrameBuffer Adaptor::readback_frame_buffer_uni( Screen& screen, const Viewpoint::Location& location )
 {
     const auto p = location.position;
     const auto a = location.look_at;
     const auto u = location.up_vector;
     if ( p == a ) return { this->backgroundColorBuffer(), this->backgroundDepthBuffer() };
 
-    auto* camera = m_screen.scene()->camera();
-    auto* light = m_screen.scene()->light();
+    auto* camera = screen.scene()->camera();
+    auto* light = screen.scene()->light();
 
     const auto p0 = camera->position();
     const auto a0 = camera->lookAt();
@@ -439,7 +1725,7 @@ inline Adaptor::FrameBuffer Adaptor::readback_frame_buffer_uni( const Viewpoint:
 
     camera->setPosition( p, a, u );
     light->setPosition( p );
-    const auto buffer = this->drawFrameBuffer();
+    const auto buffer = this->draw_frame_buffer( screen );
 
     camera->setPosition( p0, a0, u0 );
     light->setPosition( p0 );
@@ -447,13 +1733,13 @@ inline Adaptor::FrameBuffer Adaptor::readback_frame_buffer_uni( const Viewpoint:
     return buffer;
 }
 
-inline Adaptor::FrameBuffer Adaptor::readback_frame_buffer_omn( const Viewpoint::Location& location )
+inline Adaptor::FrameBuffer Adaptor::readback_frame_buffer_omn( Screen& screen, const Viewpoint::Location& location )
 {
     using SphericalColorBuffer = InSituVis::SphericalBuffer<kvs::UInt8>;
     using SphericalDepthBuffer = InSituVis::SphericalBuffer<kvs::Real32>;
 
-    auto* camera = m_screen.scene()->camera();
-    auto* light = m_screen.scene()->light();
+    auto* camera = screen.scene()->camera();
+    auto* light = screen.scene()->light();
 
     const auto fov = camera->fieldOfView();
     const auto front = camera->front();
@@ -467,14 +1753,14 @@ inline Adaptor::FrameBuffer Adaptor::readback_frame_buffer_omn( const Viewpoint:
     camera->setFront( 0.1 );
     light->setPosition( p );
 
-    SphericalColorBuffer color_buffer( m_screen.width(), m_screen.height() );
-    SphericalDepthBuffer depth_buffer( m_screen.width(), m_screen.height() );
+    SphericalColorBuffer color_buffer( screen.width(), screen.height() );
+    SphericalDepthBuffer depth_buffer( screen.width(), screen.height() );
 
     for ( size_t i = 0; i < SphericalColorBuffer::Direction::NumberOfDirections; i++ )
     {
         const auto d = SphericalColorBuffer::Direction(i);
         camera->setPosition( p, p + SphericalColorBuffer::DirectionVector(d), SphericalColorBuffer::UpVector(d) );
-        const auto buffer = this->drawFrameBuffer();
+        const auto buffer = this->draw_frame_buffer( screen );
         color_buffer.setBuffer( d, buffer.color_buffer );
         depth_buffer.setBuffer( d, buffer.depth_buffer );
     }
@@ -484,14 +1770,14 @@ inline Adaptor::FrameBuffer Adaptor::readback_frame_buffer_omn( const Viewpoint:
     camera->setPosition( cp, ca, cu );
     light->setPosition( lp );
 
-    return { color_buffer.stitch<4>(), depth_buffer.stitch<1>() };
+    return { this->stitchColorBuffer( color_buffer ), this->stitchDepthBuffer( depth_buffer ) };
 }
 
-inline Adaptor::FrameBuffer Adaptor::readback_frame_buffer_adp( const Viewpoint::Location& location )
+inline Adaptor::FrameBuffer Adaptor::readback_frame_buffer_adp( Screen& screen, const Viewpoint::Location& location )
 {
-    const auto* object = m_screen.scene()->objectManager();
+    const auto* object = screen.scene()->objectManager();
     return this->isInsideObject( location.position, object ) ?
-        this->readback_frame_buffer_omn( location ) :
-        this->readback_frame_buffer_uni( location );
+        this->readback_frame_buffer_omn( screen, location ) :
+        this->readback_frame_buffer_uni( screen, location );
 }
 } // end of namespace InSituVis
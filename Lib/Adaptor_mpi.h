@@ -7,10 +7,13 @@
 #pragma once
 #include "Adaptor.h"
 #if defined( KVS_USE_MPI )
+#include <unistd.h>
+#include <map>
 #include <kvs/mpi/Communicator>
 #include <kvs/mpi/LogStream>
-#include <kvs/mpi/ImageCompositor>
 #include <kvs/mpi/StampTimer>
+#include "FrameAggregator_mpi.h"
+#include "ImageCompositor_mpi.h"
 
 
 namespace InSituVis
@@ -28,13 +31,17 @@ class Adaptor : public InSituVis::Adaptor
 {
 public:
     using BaseClass = InSituVis::Adaptor;
+    using ColorBuffer = BaseClass::ColorBuffer;
     using DepthBuffer = BaseClass::DepthBuffer;
     using FrameBuffer = BaseClass::FrameBuffer;
+    using ImageCompositor = InSituVis::mpi::ImageCompositor;
 
 private:
     kvs::mpi::Communicator m_world{}; ///< MPI communicator
     kvs::mpi::LogStream m_log{ m_world }; ///< MPI log stream
-    kvs::mpi::ImageCompositor m_image_compositor{ m_world }; ///< image compositor
+    ImageCompositor m_image_compositor{ m_world }; ///< image compositor
+    std::unique_ptr<ImageCompositor> m_evaluation_image_compositor{}; ///< image compositor for evaluation images (null: not used yet)
+    kvs::Vec2ui m_evaluation_image_size{ 0, 0 }; ///< image size of the evaluation image compositor
     bool m_enable_alpha_blending = false; ///< flag for image composition with alpha blending
     bool m_enable_output_subimage = false; ///< flag for writing sub-object rendering image
     bool m_enable_output_subimage_depth = false; ///< flag for writing sub-object rendering image (depth image)
@@ -42,6 +49,23 @@ private:
     float m_rend_time = 0.0f; ///< rendering time per frame
     float m_comp_time = 0.0f; ///< image composition time per frame
     kvs::mpi::StampTimer m_comp_timer{ m_world }; ///< timer for image composition process
+    InSituVis::StreamingSink m_log_sink{}; ///< sink for the processing times of this rank and those reduced to the root
+    int m_naggregators = 0; ///< number of the aggregators for the shared output file (0: disabled)
+    size_t m_aggregation_interval = 1; ///< number of the time steps between the collective writes
+    std::shared_ptr<FrameAggregator> m_aggregator{}; ///< shared output file of all of the ranks
+    size_t m_composition_batch_size = 1; ///< max. number of the views composited at once
+    std::map<std::pair<size_t,size_t>,std::unique_ptr<ImageCompositor>> m_batch_compositors{}; ///< compositors for the stacked views
+    bool m_enable_pipelined_composition = false; ///< flag for composition pipelined with rendering of the next view
+    bool m_enable_bounding_rectangle = false; ///< flag for drawing and compositing only the bounding rectangle of the sub-domain
+    ImageCompositor::Rect m_drawn_rect{}; ///< bounding rectangle of the last partial image
+    bool m_has_drawn_rect = false; ///< true if the last partial image is drawn in the bounding rectangle
+    size_t m_active_pixels = 0; ///< number of the pixels in the bounding rectangles in the time step
+    size_t m_total_pixels = 0; ///< number of the pixels of the partial images in the time step
+    kvs::StampTimer m_active_pixel_list{}; ///< ratio of the active pixels in the partial images
+    bool m_enable_rank_culling = false; ///< flag for skipping the drawing of the sub-domain out of the view frustum
+    size_t m_nculled_views = 0; ///< number of the views in which the rank draws nothing in the time step
+    size_t m_nviews = 0; ///< number of the views drawn by the rank in the time step
+    kvs::StampTimer m_culled_view_list{}; ///< ratio of the views in which the rank draws nothing
 
 public:
     Adaptor( const MPI_Comm world = MPI_COMM_WORLD, const int root = 0 ): m_world( world, root ) {}
@@ -51,14 +75,34 @@ public:
     std::ostream& log() { return m_log( m_world.root() ); }
     std::ostream& log( const int rank ) { return m_log( rank ); }
     kvs::StampTimer& compTimer() { return m_comp_timer; }
+    Metrics reducedMetrics( const Stage stage, const MPI_Op op = MPI_MAX );
 
     void setOutputSubImageEnabled(
         const bool enable = true,
         const bool enable_depth = false,
         const bool enable_alpha = false );
 
+    void setAggregatedOutputEnabled(
+        const bool enable = true,
+        const int naggregators = 1,
+        const size_t interval = 1 );
+
     void setAlphaBlendingEnabled( const bool enable = true ) { m_enable_alpha_blending = enable; }
     bool isAlphaBlendingEnabled() const { return m_enable_alpha_blending; }
+    bool isAggregatedOutputEnabled() const { return m_naggregators > 0; }
+    size_t compositionBatchSize() const { return m_composition_batch_size; }
+    void setCompositionBatchSize( const size_t size ) { m_composition_batch_size = kvs::Math::Max( size, size_t( 1 ) ); }
+    ImageCompositor::Method compositionMethod() const { return m_image_compositor.method(); }
+    void setCompositionMethod(
+        const ImageCompositor::Method method,
+        const size_t radix = 4,
+        const bool enable_compression = true );
+    void setPipelinedCompositionEnabled( const bool enable = true ) { m_enable_pipelined_composition = enable; }
+    virtual bool isPipelinedCompositionEnabled() const { return m_enable_pipelined_composition; }
+    void setBoundingRectangleEnabled( const bool enable = true ) { m_enable_bounding_rectangle = enable; }
+    bool isBoundingRectangleEnabled() const { return m_enable_bounding_rectangle; }
+    void setRankCullingEnabled( const bool enable = true ) { m_enable_rank_culling = enable; }
+    bool isRankCullingEnabled() const { return m_enable_rank_culling; }
 
     bool initialize() override;
     bool finalize() override;
@@ -69,14 +113,20 @@ protected:
     using BaseClass::drawScreen;
 
     void execRendering() override;
+    void resizeScreen( const size_t width, const size_t height ) override;
+    std::pair<kvs::Vec3,kvs::Vec3> objectBounds() override;
+    bool streamLogs() override;
+    bool flushOutputs() override;
+    float reduceOverhead( const float overhead ) override;
     virtual FrameBuffer drawScreen( std::function<void(const FrameBuffer&)> func );
 
+    void stampTime( const Stage stage, kvs::StampTimer& timer, const float time );
     float rendTime() const { return m_rend_time; }
     float compTime() const { return m_comp_time; }
     void setRendTime( const float time ) { m_rend_time = time; }
     void setCompTime( const float time ) { m_comp_time = time; }
 
-    kvs::mpi::ImageCompositor& imageCompositor() { return m_image_compositor; }
+    ImageCompositor& imageCompositor() { return m_image_compositor; }
     std::string outputFinalImageName( const Viewpoint::Location& location );
     void outputSubImages(
         const FrameBuffer& frame_buffer,
@@ -85,11 +135,30 @@ protected:
 
     DepthBuffer backgroundDepthBuffer();
     FrameBuffer readback( const Viewpoint::Location& location );
+    void readback(
+        const Viewpoint::Locations& locations,
+        const std::vector<bool>& culled,
+        std::function<void(const size_t,const FrameBuffer&)> func );
 
 private:
+    using CubeMapFrameBuffers = std::array<FrameBuffer,6>;
+
+    CubeMapFrameBuffers readback_cube_map( const Viewpoint::Location& location );
     FrameBuffer readback_uni_buffer( const Viewpoint::Location& location );
     FrameBuffer readback_omn_buffer( const Viewpoint::Location& location );
     FrameBuffer readback_adp_buffer( const Viewpoint::Location& location );
+    FrameBuffer draw_local_buffer( const Viewpoint::Location& location );
+    FrameBuffer draw_partial_buffer();
+    FrameBuffer draw_rectangle_buffer( const ImageCompositor::Rect& rect );
+    ImageCompositor::Rect bounding_rectangle();
+    ImageCompositor& screen_compositor();
+    void start_composition( FrameBuffer& frame_buffer );
+    void finish_composition();
+    ImageCompositor& batch_compositor( const size_t width, const size_t height );
+    std::string rank_filename( const std::string& basename );
+    bool aggregate_rank_files();
+    bool merge_traces( const std::string& filename );
+    bool write_proc_time( const bool final = true );
 };
 
 } // end of namespace mpi
@@ -14,14 +14,105 @@ inline void Adaptor::setOutputSubImageEnabled(
     m_enable_output_subimage_alpha = enable_alpha;
 }
 
+inline void Adaptor::setAggregatedOutputEnabled(
+    const bool enable,
+    const int naggregators,
+    const size_t interval )
+{
+    m_naggregators = enable ? std::max( naggregators, 1 ) : 0;
+    m_aggregation_interval = std::max( interval, size_t( 1 ) );
+}
+
+inline void Adaptor::setCompositionMethod(
+    const ImageCompositor::Method method,
+    const size_t radix,
+    const bool enable_compression )
+{
+    // Must be called before initialize(). The compositors for the evaluation
+    // images and the batches are created with the same method.
+    if ( BaseClass::isInitialized() )
+    {
+        this->log() << "ERROR: " << "Cannot change the composition method after initialization." << std::endl;
+        return;
+    }
+
+    m_image_compositor.setMethod( method, radix );
+    m_image_compositor.setCompressionEnabled( enable_compression );
+}
+
+inline Adaptor::Metrics Adaptor::reducedMetrics( const Stage stage, const MPI_Op op )
+{
+    // Collective operation. Each statistic of the rank is reduced over the
+    // ranks with the operation, e.g. MPI_MAX for the slowest rank.
+    // The statistics are packed so that they are reduced in a single call.
+    // The metrics must be enabled on all of the ranks or none of them.
+    const auto local = BaseClass::metrics( stage );
+    const float send[7] = {
+        local.last, local.average, local.min, local.max,
+        local.p50, local.p90, local.p99 };
+    float recv[7] = {};
+    MPI_Allreduce( send, recv, 7, MPI_FLOAT, op, m_world.handler() );
+
+    auto reduced = local;
+    reduced.last = recv[0];
+    reduced.average = recv[1];
+    reduced.min = recv[2];
+    reduced.max = recv[3];
+    reduced.p50 = recv[4];
+    reduced.p90 = recv[5];
+    reduced.p99 = recv[6];
+    return reduced;
+}
+
 inline bool Adaptor::initialize()
 {
+    // The image composition is a collective operation issued by each rank,
+    // so the visualization is not moved to a background thread.
+    if ( BaseClass::isAsyncExecutionEnabled() )
+    {
+        this->log() << "WARNING: " << "Async execution is not supported with MPI." << std::endl;
+        BaseClass::setAsyncExecutionEnabled( false );
+    }
+
     if ( !BaseClass::outputDirectory().create( m_world ) )
     {
         this->log() << "ERROR: " << "Cannot create output directories." << std::endl;
         return false;
     }
 
+    // In aggregated mode, all of the images and the per-rank logs are written
+    // into a single file shared by the ranks. Otherwise, if a frame store is
+    // given, the root writes the final images and its sub-images into the
+    // store in the base directory, and the other ranks write their sub-images
+    // into their own stores (e.g. containers created only if any frame is
+    // written).
+    const auto rank = kvs::String::From( m_world.rank(), 4, '0' );
+    const auto output_filename = BaseClass::outputFilename();
+    const auto basedir = BaseClass::outputDirectory().baseDirectoryName() + "/";
+    if ( this->isAggregatedOutputEnabled() )
+    {
+        m_aggregator = std::make_shared<FrameAggregator>();
+        if ( !m_aggregator->open( m_world.handler(), basedir + output_filename + ".frames", m_naggregators ) )
+        {
+            this->log() << "ERROR: " << "Cannot open the aggregated output file." << std::endl;
+            return false;
+        }
+        BaseClass::setFrameStore( m_aggregator );
+    }
+    else
+    {
+        BaseClass::openFrameStore( m_world.isRoot() ?
+            basedir + output_filename + ".frames" :
+            BaseClass::outputDirectory().name() + "/" + output_filename + "_" + rank + ".frames" );
+    }
+
+    // Only the root publishes the composited frames into the frame sink.
+    if ( m_world.isRoot() && !BaseClass::openFrameSink() )
+    {
+        this->log() << "ERROR: " << "Cannot open frame sink." << std::endl;
+        return false;
+    }
+
     const bool depth_testing = !m_enable_alpha_blending;
     const auto width = BaseClass::imageWidth();
     const auto height = BaseClass::imageHeight();
@@ -34,16 +125,34 @@ inline bool Adaptor::initialize()
     BaseClass::screen().setSize( width, height );
     BaseClass::screen().create();
 
+    // The image size and the composition method are fixed from here, since
+    // the compositors and the screen are sized with them.
+    BaseClass::setInitialized();
+
+    // Align the time stamps of the trace timelines of all of the ranks.
+    InSituVis::Profiler::Instance().setProcessID( m_world.rank() );
+    m_world.barrier();
+    InSituVis::Profiler::Instance().resetOrigin();
+
     return true;
 }
 
 inline bool Adaptor::finalize()
 {
-    if ( m_image_compositor.destroy() )
+    if ( m_evaluation_image_size.x() > 0 ) { m_evaluation_image_compositor->destroy(); }
+    m_evaluation_image_compositor.reset();
+    m_evaluation_image_size = kvs::Vec2ui( 0, 0 );
+    for ( auto& compositor : m_batch_compositors ) { compositor.second->destroy(); }
+    m_batch_compositors.clear();
+    if ( !m_image_compositor.destroy() ) { return false; }
+
+    bool ret = BaseClass::finalize();
+    if ( m_aggregator )
     {
-        return BaseClass::finalize();
+        ret = this->aggregate_rank_files() && ret;
+        m_aggregator->close();
     }
-    return false;
+    return ret;
 }
 
 inline void Adaptor::exec( const BaseClass::SimTime sim_time )
@@ -63,6 +172,126 @@ inline void Adaptor::exec( const BaseClass::SimTime sim_time )
 }
 
 inline bool Adaptor::dump()
+{
+    // Wait for the image files queued in the writer threads.
+    BaseClass::flushFiles();
+
+    // The errors on a rank do not return before the collective operations
+    // below, so that the other ranks do not wait for the rank.
+    const std::string rank = kvs::String::From( this->world().rank(), 4, '0' );
+    bool ret = BaseClass::writeDrainTime( this->rank_filename( "vis_drain_time_" + rank + ".csv" ) );
+    ret = BaseClass::writePoolCount( this->rank_filename( "vis_pool_count_" + rank + ".csv" ) ) && ret;
+    ret = BaseClass::writeEvaluationCheck( this->rank_filename( "vis_eval_check_" + rank + ".csv" ) ) && ret;
+    ret = BaseClass::writeCullCount( this->rank_filename( "vis_cull_count_" + rank + ".csv" ) ) && ret;
+    ret = BaseClass::writeTrace( this->rank_filename( "vis_trace_" + rank + ".json" ) ) && ret;
+    ret = this->write_proc_time() && ret;
+
+    // In aggregated mode, the per-rank files are moved into the shared file
+    // in finalize(), since dump() may be called more than once.
+    ret = BaseClass::flushFrameStore() && ret;
+
+    // The status is reduced over the ranks, which also waits for the traces
+    // of all of the ranks to be written before they are merged.
+    int local = ret ? 1 : 0;
+    int reduced = 0;
+    MPI_Allreduce( &local, &reduced, 1, MPI_INT, MPI_MIN, m_world.handler() );
+    if ( reduced == 0 ) return false;
+    if ( !this->world().isRoot() ) return true;
+
+    // The knobs are adjusted in the same way on all of the ranks.
+    const auto basedir = BaseClass::outputDirectory().baseDirectoryName() + "/";
+    if ( !BaseClass::writeBudgetLog( basedir + "vis_budget_log.csv" ) ) return false;
+    return this->merge_traces( basedir + "vis_trace.json" );
+}
+
+inline bool Adaptor::streamLogs()
+{
+    const std::string rank = kvs::String::From( this->world().rank(), 4, '0' );
+    bool ret = this->write_proc_time( false );
+    ret = BaseClass::writeEvaluationCheck( this->rank_filename( "vis_eval_check_" + rank + ".csv" ), false ) && ret;
+    ret = BaseClass::writeCullCount( this->rank_filename( "vis_cull_count_" + rank + ".csv" ), false ) && ret;
+    ret = BaseClass::writeTrace( this->rank_filename( "vis_trace_" + rank + ".json" ), false ) && ret;
+    return ret;
+}
+
+inline bool Adaptor::flushOutputs()
+{
+    // Collective operation. The frames buffered on each rank are written
+    // into the shared file every aggregation interval.
+    if ( !m_aggregator ) { return true; }
+    if ( BaseClass::timeStep() % m_aggregation_interval != 0 ) { return true; }
+
+    BaseClass::flushFiles();
+    return BaseClass::flushFrameStore();
+}
+
+inline float Adaptor::reduceOverhead( const float overhead )
+{
+    // The largest overhead (the slowest rank) is used on every rank, so that
+    // all of the ranks agree on the adjustments of the knobs.
+    float reduced = 0.0f;
+    m_world.allReduce( overhead, reduced, MPI_MAX );
+    return reduced;
+}
+
+inline std::string Adaptor::rank_filename( const std::string& basename )
+{
+    // The per-rank files are written into the sub-directory of the rank also
+    // in aggregated mode, so that the streamed records are kept on a crash.
+    BaseClass::outputDirectory().createSubDirectory();
+    return BaseClass::outputDirectory().name() + "/" + basename;
+}
+
+inline bool Adaptor::aggregate_rank_files()
+{
+    // Collective operation called once in finalize() before the shared file
+    // is closed. The per-rank files are moved into the shared file, and the
+    // sub-directory of the rank is removed if it is empty. The barrier waits
+    // for the root merging the traces of the ranks in dump().
+    if ( !m_aggregator ) { return true; }
+    m_world.barrier();
+
+    // The files are named as in the sub-directory of the rank, e.g.
+    // Process0001/vis_proc_time_0001.csv.
+    const auto rank = kvs::String::From( m_world.rank(), 4, '0' );
+    const auto subdir = BaseClass::outputDirectory().subDirectoryName() + rank + "/";
+    const std::vector<std::string> basenames = {
+        "vis_drain_time_" + rank + ".csv",
+        "vis_pool_count_" + rank + ".csv",
+        "vis_eval_check_" + rank + ".csv",
+        "vis_cull_count_" + rank + ".csv",
+        "vis_trace_" + rank + ".json",
+        "vis_proc_time_" + rank + ".csv" };
+
+    bool ret = true;
+    for ( const auto& basename : basenames )
+    {
+        const auto filename = this->rank_filename( basename );
+        if ( !kvs::File( filename ).exists() ) { continue; }
+        ret = m_aggregator->appendFile( subdir + basename, filename ) && ret;
+    }
+    ::rmdir( BaseClass::outputDirectory().name().c_str() );
+    return ret;
+}
+
+inline bool Adaptor::merge_traces( const std::string& filename )
+{
+    // The trace of each rank has been written into its sub-directory before
+    // the reduction in dump().
+    if ( !InSituVis::Profiler::Instance().isEnabled() ) { return true; }
+
+    const auto& directory = BaseClass::outputDirectory();
+    std::vector<std::string> filenames;
+    for ( int i = 0; i < m_world.size(); i++ )
+    {
+        const auto rank = kvs::String::From( i, 4, '0' );
+        const auto subdir = directory.baseDirectoryName() + "/" + directory.subDirectoryName() + rank + "/";
+        filenames.push_back( subdir + "vis_trace_" + rank + ".json" );
+    }
+    return InSituVis::Profiler::Merge( filenames, filename );
+}
+
+inline bool Adaptor::write_proc_time( const bool final )
 {
     auto& tstep_list = BaseClass::tstepList();
     auto& pipe_timer = BaseClass::pipeTimer();
@@ -75,148 +304,235 @@ inline bool Adaptor::dump()
     if ( save_timer.title().empty() ) { save_timer.setTitle( "Save time" ); }
     if ( comp_timer.title().empty() ) { comp_timer.setTitle( "Comp time" ); }
 
+    // The timers are stamped at the collective steps, so the number of the
+    // records, and hence the reductions below, are the same on every rank.
+    using Sink = InSituVis::StreamingSink;
+    Sink::Timers timers = { &tstep_list, &pipe_timer, &rend_timer, &save_timer, &comp_timer };
+    if ( m_enable_bounding_rectangle )
+    {
+        if ( m_active_pixel_list.title().empty() ) { m_active_pixel_list.setTitle( "Active pixel ratio" ); }
+        timers.push_back( &m_active_pixel_list );
+    }
+    if ( m_enable_rank_culling )
+    {
+        if ( m_culled_view_list.title().empty() ) { m_culled_view_list.setTitle( "Culled view ratio" ); }
+        timers.push_back( &m_culled_view_list );
+    }
+    const auto interval = BaseClass::streamingInterval();
+    const auto n = final ? Sink::MaxRecords( timers ) : Sink::MinRecords( timers );
+    if ( !final && ( interval == 0 || n < interval ) ) { return true; }
     const std::string rank = kvs::String::From( this->world().rank(), 4, '0' );
-    const std::string subdir = BaseClass::outputDirectory().name() + "/";
+    const auto filename = this->rank_filename( "vis_proc_time_" + rank + ".csv" );
+    if ( m_log_sink.isOpened( filename ) && n == 0 ) { return true; }
+
     kvs::StampTimerList timer_list;
-    timer_list.push( tstep_list );
-    timer_list.push( pipe_timer );
-    timer_list.push( rend_timer );
-    timer_list.push( save_timer );
-    timer_list.push( comp_timer );
-    if ( !timer_list.write( subdir + "vis_proc_time_" + rank + ".csv" ) ) return false;
+    for ( const auto* timer : timers ) { timer_list.push( Sink::Head( *timer, n ) ); }
+    bool ret = m_log_sink.append( filename, timer_list, n );
 
+    // Min, max and average of the times over the ranks.
     using Time = kvs::mpi::StampTimer;
-    Time pipe_time_min( this->world(), pipe_timer ); pipe_time_min.reduceMin();
-    Time pipe_time_max( this->world(), pipe_timer ); pipe_time_max.reduceMax();
-    Time pipe_time_ave( this->world(), pipe_timer ); pipe_time_ave.reduceAve();
-    Time rend_time_min( this->world(), rend_timer ); rend_time_min.reduceMin();
-    Time rend_time_max( this->world(), rend_timer ); rend_time_max.reduceMax();
-    Time rend_time_ave( this->world(), rend_timer ); rend_time_ave.reduceAve();
-    Time save_time_min( this->world(), save_timer ); save_time_min.reduceMin();
-    Time save_time_max( this->world(), save_timer ); save_time_max.reduceMax();
-    Time save_time_ave( this->world(), save_timer ); save_time_ave.reduceAve();
-    Time comp_time_min( this->world(), comp_timer ); comp_time_min.reduceMin();
-    Time comp_time_max( this->world(), comp_timer ); comp_time_max.reduceMax();
-    Time comp_time_ave( this->world(), comp_timer ); comp_time_ave.reduceAve();
+    kvs::StampTimerList reduced_list;
+    reduced_list.push( Sink::Head( tstep_list, n ) );
+    for ( size_t i = 1; i < timers.size(); i++ )
+    {
+        const auto head = Sink::Head( *timers[i], n );
+        Time time_min( this->world(), head ); time_min.reduceMin();
+        Time time_max( this->world(), head ); time_max.reduceMax();
+        Time time_ave( this->world(), head ); time_ave.reduceAve();
+        time_min.setTitle( head.title() + " (min)" );
+        time_max.setTitle( head.title() + " (max)" );
+        time_ave.setTitle( head.title() + " (ave)" );
+        reduced_list.push( time_min );
+        reduced_list.push( time_max );
+        reduced_list.push( time_ave );
+    }
 
-    if ( !this->world().isRoot() ) return true;
+    // Average number of the culled ranks per view.
+    if ( m_enable_rank_culling )
+    {
+        Time ratio_ave( this->world(), Sink::Head( m_culled_view_list, n ) ); ratio_ave.reduceAve();
+        kvs::StampTimer culled_ranks;
+        culled_ranks.setTitle( "Culled ranks per view" );
+        for ( const auto ratio : ratio_ave.stamps() ) { culled_ranks.stamp( ratio * this->world().size() ); }
+        reduced_list.push( culled_ranks );
+    }
 
-    pipe_time_min.setTitle( pipe_timer.title() + " (min)" );
-    pipe_time_max.setTitle( pipe_timer.title() + " (max)" );
-    pipe_time_ave.setTitle( pipe_timer.title() + " (ave)" );
-    rend_time_min.setTitle( rend_timer.title() + " (min)" );
-    rend_time_max.setTitle( rend_timer.title() + " (max)" );
-    rend_time_ave.setTitle( rend_timer.title() + " (ave)" );
-    save_time_min.setTitle( save_timer.title() + " (min)" );
-    save_time_max.setTitle( save_timer.title() + " (max)" );
-    save_time_ave.setTitle( save_timer.title() + " (ave)" );
-    comp_time_min.setTitle( comp_timer.title() + " (min)" );
-    comp_time_max.setTitle( comp_timer.title() + " (max)" );
-    comp_time_ave.setTitle( comp_timer.title() + " (ave)" );
-
-    timer_list.clear();
-    timer_list.push( tstep_list );
-    timer_list.push( pipe_time_min );
-    timer_list.push( pipe_time_max );
-    timer_list.push( pipe_time_ave );
-    timer_list.push( rend_time_min );
-    timer_list.push( rend_time_max );
-    timer_list.push( rend_time_ave );
-    timer_list.push( save_time_min );
-    timer_list.push( save_time_max );
-    timer_list.push( save_time_ave );
-    timer_list.push( comp_time_min );
-    timer_list.push( comp_time_max );
-    timer_list.push( comp_time_ave );
+    for ( auto* timer : timers ) { Sink::Erase( *timer, n ); }
+
+    if ( !this->world().isRoot() ) return ret;
 
     const auto basedir = BaseClass::outputDirectory().baseDirectoryName() + "/";
-    return timer_list.write( basedir + "vis_proc_time.csv" );
+    return m_log_sink.append( basedir + "vis_proc_time.csv", reduced_list, n ) && ret;
 }
 
 inline void Adaptor::execRendering()
 {
+    InSituVis::ProfileScope scope( "rendering" );
     m_rend_time = 0.0f;
     m_comp_time = 0.0f;
     float save_time = 0.0f;
     {
-        for ( const auto& location : BaseClass::viewpoint().locations() )
+        // Output framebuffer to image file and the frame ring at the root node
+        auto Output = [&] ( const Viewpoint::Location& location, const FrameBuffer& frame_buffer )
         {
-            // Draw and readback framebuffer
-            auto frame_buffer = this->readback( location );
-
-            // Output framebuffer to image file at the root node
             kvs::Timer timer( kvs::Timer::Start );
             if ( m_world.isRoot() )
             {
+                const auto size = BaseClass::outputImageSize( location );
                 if ( BaseClass::isOutputImageEnabled() )
                 {
-                    const auto size = BaseClass::outputImageSize( location );
-                    const auto width = size.x();
-                    const auto height = size.y();
-                    const auto buffer = frame_buffer.color_buffer;
-                    kvs::ColorImage image( width, height, buffer );
-                    image.write( this->outputFinalImageName( location ) );
+                    const auto filename = this->outputFinalImageName( location );
+                    BaseClass::writeColorImage( filename, size, frame_buffer.color_buffer );
                 }
+                BaseClass::publishFrame( location, size, frame_buffer.color_buffer );
             }
             timer.stop();
             save_time += BaseClass::saveTimer().time( timer );
+        };
+
+        // In pipelined mode, the composition of a uni-directional view is
+        // completed after the next view is drawn.
+        const auto& locations = BaseClass::viewpoint().locations();
+        const Viewpoint::Location* pending_location = nullptr;
+        FrameBuffer pending_buffer;
+        auto Finish = [&] ()
+        {
+            if ( !pending_location ) { return; }
+            this->finish_composition();
+            Output( *pending_location, pending_buffer );
+            pending_location = nullptr;
+            pending_buffer = FrameBuffer();
+        };
+
+        for ( const auto& location : locations )
+        {
+            // Output the composited cube faces as they are without stitching
+            if ( BaseClass::isCubeMapOutputEnabled() && BaseClass::isOmniDirectional( location ) )
+            {
+                Finish();
+                const auto frame_buffers = this->readback_cube_map( location );
+
+                kvs::Timer timer( kvs::Timer::Start );
+                if ( m_world.isRoot() && BaseClass::isOutputImageEnabled() )
+                {
+                    BaseClass::CubeMapBuffers buffers;
+                    for ( size_t i = 0; i < buffers.size(); i++ ) { buffers[i] = frame_buffers[i].color_buffer; }
+                    const auto filename = this->outputFinalImageName( location );
+                    BaseClass::writeCubeMap( filename, location, buffers );
+                }
+                timer.stop();
+                save_time += BaseClass::saveTimer().time( timer );
+                continue;
+            }
+
+            const bool pipelined =
+                this->isPipelinedCompositionEnabled() &&
+                location.direction == Viewpoint::Direction::Uni &&
+                location.position != location.look_at;
+            if ( pipelined )
+            {
+                auto frame_buffer = this->draw_local_buffer( location );
+                Finish();
+                this->start_composition( frame_buffer );
+                pending_location = &location;
+                pending_buffer = frame_buffer;
+                continue;
+            }
+
+            // Draw and readback framebuffer
+            Finish();
+            Output( location, this->readback( location ) );
         }
+        Finish();
     }
-    BaseClass::saveTimer().stamp( save_time );
-    BaseClass::rendTimer().stamp( m_rend_time );
-    m_comp_timer.stamp( m_comp_time );
+    BaseClass::stampTime( BaseClass::SaveStage, BaseClass::saveTimer(), save_time );
+    BaseClass::stampTime( BaseClass::RendStage, BaseClass::rendTimer(), m_rend_time );
+    this->stampTime( BaseClass::CompStage, m_comp_timer, m_comp_time );
 }
 
-inline Adaptor::FrameBuffer Adaptor::drawScreen( std::function<void(const FrameBuffer&)> func )
+inline void Adaptor::stampTime( const Stage stage, kvs::StampTimer& timer, const float time )
 {
-    // Draw and read-back image
-    kvs::Timer timer_rend( kvs::Timer::Start );
-    BaseClass::screen().draw();
-    timer_rend.stop();
-    m_rend_time += BaseClass::rendTimer().time( timer_rend );
+    BaseClass::stampTime( stage, timer, time );
 
-    auto ObjectDepth = [&]()
+    // The ratio of the pixels in the bounding rectangles to the pixels of the
+    // partial images drawn in the time step is stamped with the composition
+    // time, so that both have the same number of the records.
+    if ( stage == BaseClass::CompStage && m_enable_bounding_rectangle )
     {
-        const bool has_object = BaseClass::objects().size() > 0;
-        float depth = 0.0f;
-        if ( has_object )
-        {
-            const auto id = BaseClass::objects().size() + 1;
-            const auto* object = BaseClass::screen().scene()->object( id );
-            const auto origin = kvs::Vec3( 0, 0, 0 );
-            const auto offset = object->objectCenter();
-            const auto Oa = kvs::ObjectCoordinate( origin, object ).toWorldCoordinate().position();
-            const auto Ob = kvs::ObjectCoordinate( offset, object ).toWorldCoordinate().position();
-            const auto O = Ob - Oa;
-            const auto C = BaseClass::screen().scene()->camera()->position();
-            depth = ( O - C ).length();
-        }
+        const auto ratio = m_total_pixels > 0 ? float( m_active_pixels ) / float( m_total_pixels ) : 1.0f;
+        m_active_pixel_list.stamp( ratio );
+        m_active_pixels = 0;
+        m_total_pixels = 0;
+    }
 
-        const auto width = BaseClass::imageWidth();
-        const auto height = BaseClass::imageHeight();
-        kvs::ValueArray<float> depth_buffer( width * height );
-        depth_buffer.fill( depth );
-        return depth_buffer;
-    };
+    // The ratio of the views in which the rank draws nothing.
+    if ( stage == BaseClass::CompStage && m_enable_rank_culling )
+    {
+        const auto ratio = m_nviews > 0 ? float( m_nculled_views ) / float( m_nviews ) : 0.0f;
+        m_culled_view_list.stamp( ratio );
+        m_nculled_views = 0;
+        m_nviews = 0;
+    }
+}
 
-    // Apply the func for partial rendering buffers before image composition.
-    auto color_buffer = BaseClass::screen().readbackColorBuffer();
-    auto depth_buffer = m_enable_alpha_blending ? ObjectDepth() : BaseClass::screen().readbackDepthBuffer();
-    func( { color_buffer, depth_buffer } );
+inline void Adaptor::resizeScreen( const size_t width, const size_t height )
+{
+    BaseClass::resizeScreen( width, height );
 
-    // Image composition
-    kvs::Timer timer_comp( kvs::Timer::Start );
-    const auto success = m_enable_alpha_blending ?
-        m_image_compositor.run( color_buffer, depth_buffer[0] ):
-        m_image_compositor.run( color_buffer, depth_buffer );
-    if ( !success )
+    // The evaluation images are composited with another compositor, which is
+    // created at the first evaluation and initialized again when the
+    // evaluation image size is changed.
+    const auto size = kvs::Vec2ui( BaseClass::screen().width(), BaseClass::screen().height() );
+    const auto image_size = kvs::Vec2ui( BaseClass::imageWidth(), BaseClass::imageHeight() );
+    if ( size == image_size || size == m_evaluation_image_size ) { return; }
+
+    if ( !m_evaluation_image_compositor )
     {
-        this->log() << "ERROR: " << "Cannot compose images." << std::endl;
+        m_evaluation_image_compositor.reset( new ImageCompositor( m_world ) );
+        m_evaluation_image_compositor->setMethod( m_image_compositor.method(), m_image_compositor.radix() );
+        m_evaluation_image_compositor->setCompressionEnabled( m_image_compositor.isCompressionEnabled() );
     }
-    timer_comp.stop();
-    m_comp_time += m_comp_timer.time( timer_comp );
+    else if ( m_evaluation_image_size.x() > 0 ) { m_evaluation_image_compositor->destroy(); }
 
-    return { color_buffer, depth_buffer };
+    const bool depth_testing = !m_enable_alpha_blending;
+    if ( !m_evaluation_image_compositor->initialize( size.x(), size.y(), depth_testing ) )
+    {
+        this->log() << "ERROR: " << "Cannot initialize image compositor." << std::endl;
+        m_evaluation_image_size = kvs::Vec2ui( 0, 0 );
+        return;
+    }
+    m_evaluation_image_size = size;
+}
+
+inline std::pair<kvs::Vec3,kvs::Vec3> Adaptor::objectBounds()
+{
+    // The bounding boxes of the sub-objects are merged so that all of the
+    // ranks make the same culling decision and the composition stays
+    // collective. Ranks without objects contribute an empty box. The max
+    // coordinates are negated so that the box is reduced in a single call.
+    const auto bounds = BaseClass::objectBounds();
+    float send[6];
+    float recv[6];
+    for ( int k = 0; k < 3; k++ )
+    {
+        send[k] = bounds.first[k];
+        send[ k + 3 ] = -bounds.second[k];
+    }
+    MPI_Allreduce( send, recv, 6, MPI_FLOAT, MPI_MIN, m_world.handler() );
+    const kvs::Vec3 min_coord( recv[0], recv[1], recv[2] );
+    const kvs::Vec3 max_coord( -recv[3], -recv[4], -recv[5] );
+    return { min_coord, max_coord };
+}
+
+inline Adaptor::FrameBuffer Adaptor::drawScreen( std::function<void(const FrameBuffer&)> func )
+{
+    // Apply the func for partial rendering buffers before image composition.
+    auto frame_buffer = this->draw_partial_buffer();
+    func( frame_buffer );
+
+    this->start_composition( frame_buffer );
+    this->finish_composition();
+    return frame_buffer;
 }
 
 inline std::string Adaptor::outputFinalImageName( const Viewpoint::Location& location )
@@ -228,7 +544,7 @@ inline std::string Adaptor::outputFinalImageName( const Viewpoint::Location& loc
 
     const auto output_basename = BaseClass::outputFilename();
     const auto output_filename = output_basename + "_" + output_time + "_" + output_space;
-    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".bmp";
+    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + BaseClass::imageEncoder().extension();
     return filename;
 }
 
@@ -239,27 +555,29 @@ inline void Adaptor::outputSubImages(
 {
     if ( m_enable_output_subimage )
     {
+        // The sub-directory is not needed if the images are written into the
+        // shared file.
+        if ( !m_aggregator ) { BaseClass::outputDirectory().createSubDirectory(); }
+
         const auto& color_buffer = frame_buffer.color_buffer;
         const auto& depth_buffer = frame_buffer.depth_buffer;
 
         // Color image
         const auto width = BaseClass::imageWidth();
         const auto height = BaseClass::imageHeight();
-        kvs::ColorImage image( width, height, color_buffer );
-        image.write( BaseClass::outputImageName( location, "_color_" + suffix ) );
+        const auto size = kvs::Vec2ui( width, height );
+        BaseClass::writeColorImage( BaseClass::outputImageName( location, "_color_" + suffix ), size, color_buffer );
 
         // Depth image
         if ( m_enable_output_subimage_depth )
         {
-            kvs::GrayImage depth_image( width, height, depth_buffer );
-            depth_image.write( BaseClass::outputImageName( location, "_depth_" + suffix ) );
+            BaseClass::writeDepthImage( BaseClass::outputImageName( location, "_depth_" + suffix ), size, depth_buffer );
         }
 
         // Alpha image
         if ( m_enable_output_subimage_alpha )
         {
-            kvs::GrayImage alpha_image( width, height, color_buffer, 3 );
-            alpha_image.write( BaseClass::outputImageName( location, "_alpha_" + suffix ) );
+            BaseClass::writeAlphaImage( BaseClass::outputImageName( location, "_alpha_" + suffix ), size, color_buffer );
         }
     }
 }
@@ -275,6 +593,7 @@ inline Adaptor::DepthBuffer Adaptor::backgroundDepthBuffer()
 
 inline Adaptor::FrameBuffer Adaptor::readback( const Viewpoint::Location& location )
 {
+    InSituVis::ProfileScope scope( "render", static_cast<long>( location.index ) );
     switch ( location.direction )
     {
     case Viewpoint::Direction::Uni: return this->readback_uni_buffer( location );
@@ -284,6 +603,342 @@ inline Adaptor::FrameBuffer Adaptor::readback( const Viewpoint::Location& locati
     }
 }
 
+inline void Adaptor::readback(
+    const Viewpoint::Locations& locations,
+    const std::vector<bool>& culled,
+    std::function<void(const size_t,const FrameBuffer&)> func )
+{
+    // The uni-directional views are rendered into the local stack, and up to
+    // the batch size of the views are composited at once as a single image
+    // with the views stacked vertically, so that the collective latency of
+    // the composition is paid once per batch. The other views (culled,
+    // omni-directional and adaptive ones) are processed one by one. In alpha
+    // blending mode, the ranks are ordered by a single depth per image, so
+    // the views are composited one by one. The function is called in the
+    // order of the locations.
+    const size_t batch_size = m_enable_alpha_blending ? 1 : m_composition_batch_size;
+    const size_t width = BaseClass::screen().width();
+    const size_t height = BaseClass::screen().height();
+    const size_t npixels = width * height;
+
+    std::vector<size_t> batch;
+    ColorBuffer colors;
+    DepthBuffer depths;
+    auto Flush = [&] ()
+    {
+        if ( batch.empty() ) { return; }
+
+        InSituVis::ProfileScope scope( "composite" );
+        const auto n = batch.size();
+        if ( n < batch_size )
+        {
+            // A partial batch is padded with the background (depth = 1), so
+            // that a single compositor of the full stack is used for each
+            // image size.
+            std::fill( colors.data() + n * npixels * 4, colors.data() + colors.size(), kvs::UInt8( 0 ) );
+            std::fill( depths.data() + n * npixels, depths.data() + depths.size(), 1.0f );
+        }
+
+        kvs::Timer timer_comp( kvs::Timer::Start );
+        if ( !this->batch_compositor( width, height * batch_size ).run( colors, depths ) )
+        {
+            this->log() << "ERROR: " << "Cannot compose images." << std::endl;
+        }
+        timer_comp.stop();
+        m_comp_time += m_comp_timer.time( timer_comp );
+
+        for ( size_t j = 0; j < n; j++ )
+        {
+            auto color_buffer = BaseClass::frameBufferPool().colorBuffer( npixels * 4 );
+            auto depth_buffer = BaseClass::frameBufferPool().depthBuffer( npixels );
+            std::copy_n( colors.data() + j * npixels * 4, npixels * 4, color_buffer.data() );
+            std::copy_n( depths.data() + j * npixels, npixels, depth_buffer.data() );
+            func( batch[j], { color_buffer, depth_buffer } );
+        }
+        batch.clear();
+    };
+
+    for ( size_t i = 0; i < locations.size(); i++ )
+    {
+        const auto& location = locations[i];
+        const bool is_culled = i < culled.size() && culled[i];
+        const bool stacked =
+            batch_size > 1 && !is_culled &&
+            location.direction == Viewpoint::Direction::Uni &&
+            location.position != location.look_at;
+        if ( !stacked )
+        {
+            Flush();
+            func( i, is_culled ? BaseClass::backgroundFrameBuffer( location ) : this->readback( location ) );
+            continue;
+        }
+
+        if ( batch.empty() )
+        {
+            colors = ColorBuffer( batch_size * npixels * 4 );
+            depths = DepthBuffer( batch_size * npixels );
+        }
+
+        const auto buffer = this->draw_local_buffer( location );
+        const auto j = batch.size();
+        std::copy_n( buffer.color_buffer.data(), npixels * 4, colors.data() + j * npixels * 4 );
+        std::copy_n( buffer.depth_buffer.data(), npixels, depths.data() + j * npixels );
+        batch.push_back( i );
+        if ( batch.size() == batch_size ) { Flush(); }
+    }
+    Flush();
+}
+
+inline Adaptor::FrameBuffer Adaptor::draw_local_buffer( const Viewpoint::Location& location )
+{
+    // Same as readback_uni_buffer() except for the image composition.
+    InSituVis::ProfileScope scope( "render", static_cast<long>( location.index ) );
+    auto* camera = BaseClass::screen().scene()->camera();
+    auto* light = BaseClass::screen().scene()->light();
+    const auto p0 = camera->position();
+    const auto a0 = camera->lookAt();
+    const auto u0 = camera->upVector();
+
+    camera->setPosition( location.position, location.look_at, location.up_vector );
+    light->setPosition( location.position );
+
+    const auto frame_buffer = this->draw_partial_buffer();
+    this->outputSubImages( frame_buffer, location );
+
+    camera->setPosition( p0, a0, u0 );
+    light->setPosition( p0 );
+    return frame_buffer;
+}
+
+inline Adaptor::FrameBuffer Adaptor::draw_partial_buffer()
+{
+    auto ObjectDepth = [&]()
+    {
+        const bool has_object = BaseClass::objects().size() > 0;
+        float depth = 0.0f;
+        if ( has_object )
+        {
+            const auto id = BaseClass::objects().size() + 1;
+            const auto* object = BaseClass::screen().scene()->object( id );
+            const auto origin = kvs::Vec3( 0, 0, 0 );
+            const auto offset = object->objectCenter();
+            const auto Oa = kvs::ObjectCoordinate( origin, object ).toWorldCoordinate().position();
+            const auto Ob = kvs::ObjectCoordinate( offset, object ).toWorldCoordinate().position();
+            const auto O = Ob - Oa;
+            const auto C = BaseClass::screen().scene()->camera()->position();
+            depth = ( O - C ).length();
+        }
+
+        const auto width = BaseClass::screen().width();
+        const auto height = BaseClass::screen().height();
+        auto depth_buffer = BaseClass::frameBufferPool().depthBuffer( width * height );
+        depth_buffer.fill( depth );
+        return depth_buffer;
+    };
+
+    // The ranks whose sub-domains are out of the view frustum draw nothing
+    // and give the empty rectangles to the compositor. In alpha blending
+    // mode, the partial images of the other ranks are composited as a whole,
+    // and the empty partial images are transparent.
+    m_has_drawn_rect = false;
+    const bool bounding = m_enable_bounding_rectangle && !m_enable_alpha_blending;
+    if ( bounding || m_enable_rank_culling )
+    {
+        const auto rect = this->bounding_rectangle();
+        m_nviews++;
+        if ( rect.empty() ) { m_nculled_views++; }
+
+        const size_t width = BaseClass::screen().width();
+        const size_t height = BaseClass::screen().height();
+        const ImageCompositor::Rect screen = { 0, 0, width, height };
+        if ( !m_enable_alpha_blending )
+        {
+            auto frame_buffer = this->draw_rectangle_buffer( bounding || rect.empty() ? rect : screen );
+            this->screen_compositor().test();
+            return frame_buffer;
+        }
+
+        m_drawn_rect = screen;
+        m_has_drawn_rect = true;
+        if ( rect.empty() )
+        {
+            const size_t npixels = width * height;
+            const auto color = BaseClass::screen().scene()->background()->color();
+            auto color_buffer = BaseClass::frameBufferPool().colorBuffer( npixels * 4 );
+            for ( size_t i = 0; i < npixels; i++ )
+            {
+                color_buffer[ 4 * i + 0 ] = color.r();
+                color_buffer[ 4 * i + 1 ] = color.g();
+                color_buffer[ 4 * i + 2 ] = color.b();
+                color_buffer[ 4 * i + 3 ] = 0;
+            }
+            m_drawn_rect = rect;
+            return { color_buffer, ObjectDepth() };
+        }
+    }
+
+    // Draw and read-back image
+    kvs::Timer timer_rend( kvs::Timer::Start );
+    auto color_buffer = BaseClass::drawColorBuffer( BaseClass::screen() );
+    timer_rend.stop();
+    m_rend_time += BaseClass::rendTimer().time( timer_rend );
+
+    // Let the composition of the previous view advance to its next round.
+    this->screen_compositor().test();
+
+    auto depth_buffer = m_enable_alpha_blending ? ObjectDepth() : BaseClass::readbackDepthBuffer( BaseClass::screen() );
+    return { color_buffer, depth_buffer };
+}
+
+inline Adaptor::FrameBuffer Adaptor::draw_rectangle_buffer( const ImageCompositor::Rect& rect )
+{
+    // Only the pixels in the rectangle are drawn and read back. The others
+    // are the background, and nothing is drawn if the rectangle is empty.
+    kvs::Timer timer_rend( kvs::Timer::Start );
+    const size_t width = BaseClass::screen().width();
+    const size_t height = BaseClass::screen().height();
+    m_active_pixels += rect.width * rect.height;
+    m_total_pixels += width * height;
+    m_drawn_rect = rect;
+    m_has_drawn_rect = true;
+    if ( rect.width == width && rect.height == height )
+    {
+        auto color_buffer = BaseClass::drawColorBuffer( BaseClass::screen() );
+        auto depth_buffer = BaseClass::readbackDepthBuffer( BaseClass::screen() );
+        timer_rend.stop();
+        m_rend_time += BaseClass::rendTimer().time( timer_rend );
+        return { color_buffer, depth_buffer };
+    }
+
+    auto color_buffer = BaseClass::frameBufferPool().colorBuffer( width * height * 4 );
+    auto depth_buffer = BaseClass::frameBufferPool().depthBuffer( width * height );
+    const auto background = BaseClass::backgroundColorBuffer();
+    std::copy_n( background.data(), width * height * 4, color_buffer.data() );
+    depth_buffer.fill( 1.0f );
+    if ( !rect.empty() )
+    {
+        // The drawing (including the clear) is restricted to the rectangle
+        // with the scissor test. The pixels out of it are left undefined in
+        // the screen and are not read back.
+        const auto x = static_cast<GLint>( rect.x );
+        const auto y = static_cast<GLint>( height - rect.y - rect.height );
+        const auto w = static_cast<GLsizei>( rect.width );
+        const auto h = static_cast<GLsizei>( rect.height );
+        kvs::OpenGL::Enable( GL_SCISSOR_TEST );
+        glScissor( x, y, w, h );
+        BaseClass::screen().draw();
+        kvs::OpenGL::Disable( GL_SCISSOR_TEST );
+
+        // The rows are read bottom-up and flipped into the top-down buffers.
+        auto colors = BaseClass::frameBufferPool().colorBuffer( rect.width * rect.height * 4 );
+        auto depths = BaseClass::frameBufferPool().depthBuffer( rect.width * rect.height );
+        kvs::OpenGL::SetReadBuffer( GL_FRONT );
+        kvs::OpenGL::SetPixelStorageMode( GL_PACK_ALIGNMENT, GLint(4) );
+        kvs::OpenGL::ReadPixels( x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, colors.data() );
+        kvs::OpenGL::ReadPixels( x, y, w, h, GL_DEPTH_COMPONENT, GL_FLOAT, depths.data() );
+        for ( size_t j = 0; j < rect.height; j++ )
+        {
+            const size_t offset = ( rect.y + rect.height - 1 - j ) * width + rect.x;
+            std::copy_n( colors.data() + j * rect.width * 4, rect.width * 4, color_buffer.data() + offset * 4 );
+            std::copy_n( depths.data() + j * rect.width, rect.width, depth_buffer.data() + offset );
+        }
+    }
+    timer_rend.stop();
+    m_rend_time += BaseClass::rendTimer().time( timer_rend );
+    return { color_buffer, depth_buffer };
+}
+
+inline Adaptor::ImageCompositor::Rect Adaptor::bounding_rectangle()
+{
+    // Screen-space bounding rectangle of the local sub-domain projected with
+    // the current camera. An empty one is returned if the rank has no object
+    // or the box is out of the view frustum, and the whole screen if the
+    // projection is not estimated (see BaseClass::projectedRect).
+    const size_t width = BaseClass::screen().width();
+    const size_t height = BaseClass::screen().height();
+
+    const auto bounds = BaseClass::objectBounds(); // not merged over the ranks
+    const auto& min_coord = bounds.first;
+    const auto& max_coord = bounds.second;
+    if ( min_coord.x() > max_coord.x() ) { return {}; }
+
+    const auto* camera = BaseClass::screen().scene()->camera();
+    const auto rect = BaseClass::projectedRect( bounds, camera->position(), camera->lookAt(), camera->upVector() );
+    if ( rect.empty() ) { return {}; }
+    const auto& min_ndc = rect.min;
+    const auto& max_ndc = rect.max;
+
+    // Pixels with a margin of one pixel (rows are top-down).
+    auto Clamp = [] ( const float v, const size_t n ) { return static_cast<size_t>( kvs::Math::Clamp( v, 0.0f, float( n ) ) ); };
+    const auto x0 = Clamp( std::floor( ( min_ndc.x() + 1.0f ) * 0.5f * width ) - 1.0f, width );
+    const auto x1 = Clamp( std::ceil( ( max_ndc.x() + 1.0f ) * 0.5f * width ) + 1.0f, width );
+    const auto y0 = Clamp( std::floor( ( 1.0f - max_ndc.y() ) * 0.5f * height ) - 1.0f, height );
+    const auto y1 = Clamp( std::ceil( ( 1.0f - min_ndc.y() ) * 0.5f * height ) + 1.0f, height );
+    if ( x0 >= x1 || y0 >= y1 ) { return {}; }
+    return { x0, y0, x1 - x0, y1 - y0 };
+}
+
+inline Adaptor::ImageCompositor& Adaptor::screen_compositor()
+{
+    const auto size = kvs::Vec2ui( BaseClass::screen().width(), BaseClass::screen().height() );
+    const auto image_size = kvs::Vec2ui( BaseClass::imageWidth(), BaseClass::imageHeight() );
+    return size == image_size ? m_image_compositor : *m_evaluation_image_compositor;
+}
+
+inline void Adaptor::start_composition( FrameBuffer& frame_buffer )
+{
+    // Collective operation. The frame buffer is composited in place, and
+    // must be kept until finish_composition() is called.
+    InSituVis::ProfileScope scope( "composite" );
+    kvs::Timer timer_comp( kvs::Timer::Start );
+    auto& compositor = this->screen_compositor();
+    auto& color_buffer = frame_buffer.color_buffer;
+    auto& depth_buffer = frame_buffer.depth_buffer;
+    const auto success = m_has_drawn_rect ?
+        ( m_enable_alpha_blending ?
+          compositor.start( color_buffer, depth_buffer[0], m_drawn_rect ) :
+          compositor.start( color_buffer, depth_buffer, m_drawn_rect ) ) :
+        ( m_enable_alpha_blending ?
+          compositor.start( color_buffer, depth_buffer[0] ) :
+          compositor.start( color_buffer, depth_buffer ) );
+    if ( !success )
+    {
+        this->log() << "ERROR: " << "Cannot compose images." << std::endl;
+    }
+    timer_comp.stop();
+    m_comp_time += m_comp_timer.time( timer_comp );
+}
+
+inline void Adaptor::finish_composition()
+{
+    InSituVis::ProfileScope scope( "composite" );
+    kvs::Timer timer_comp( kvs::Timer::Start );
+    if ( !this->screen_compositor().wait() )
+    {
+        this->log() << "ERROR: " << "Cannot compose images." << std::endl;
+    }
+    timer_comp.stop();
+    m_comp_time += m_comp_timer.time( timer_comp );
+}
+
+inline Adaptor::ImageCompositor& Adaptor::batch_compositor( const size_t width, const size_t height )
+{
+    // Collective operation when a new compositor is initialized, which is
+    // done in the same order on all of the ranks.
+    auto& compositor = m_batch_compositors[ { width, height } ];
+    if ( !compositor )
+    {
+        compositor.reset( new ImageCompositor( m_world ) );
+        compositor->setMethod( m_image_compositor.method(), m_image_compositor.radix() );
+        compositor->setCompressionEnabled( m_image_compositor.isCompressionEnabled() );
+        if ( !compositor->initialize( width, height, true ) )
+        {
+            this->log() << "ERROR: " << "Cannot initialize image compositor." << std::endl;
+        }
+    }
+    return *compositor;
+}
+
 inline Adaptor::FrameBuffer Adaptor::readback_uni_buffer( const Viewpoint::Location& location )
 {
     const auto p = location.position;
@@ -325,10 +980,9 @@ inline Adaptor::FrameBuffer Adaptor::readback_uni_buffer( const Viewpoint::Locat
     }
 }
 
-inline Adaptor::FrameBuffer Adaptor::readback_omn_buffer( const Viewpoint::Location& location )
+inline Adaptor::CubeMapFrameBuffers Adaptor::readback_cube_map( const Viewpoint::Location& location )
 {
-    using SphericalColorBuffer = InSituVis::SphericalBuffer<kvs::UInt8>;
-    using SphericalDepthBuffer = InSituVis::SphericalBuffer<kvs::Real32>;
+    using Direction = InSituVis::SphericalBuffer<kvs::UInt8>::Direction;
 
     auto* camera = BaseClass::screen().scene()->camera();
     auto* light = BaseClass::screen().scene()->light();
@@ -347,31 +1001,36 @@ inline Adaptor::FrameBuffer Adaptor::readback_omn_buffer( const Viewpoint::Locat
     camera->setFront( 0.1 );
     light->setPosition( p );
 
-    float rend_time = 0.0f;
-    float comp_time = 0.0f;
-    SphericalColorBuffer color_buffer( BaseClass::screen().width(), BaseClass::screen().height() );
-    SphericalDepthBuffer depth_buffer( BaseClass::screen().width(), BaseClass::screen().height() );
-    for ( size_t i = 0; i < SphericalColorBuffer::Direction::NumberOfDirections; i++ )
+    CubeMapFrameBuffers frame_buffers;
+    const bool pipelined = this->isPipelinedCompositionEnabled();
+    for ( size_t i = 0; i < Direction::NumberOfDirections; i++ )
     {
         // Rendering.
-        const auto d = SphericalColorBuffer::Direction(i);
-        const auto dir = SphericalColorBuffer::DirectionVector(d);
-        const auto up = SphericalColorBuffer::UpVector(d);
+        const auto d = Direction(i);
+        const auto dir = InSituVis::SphericalBuffer<kvs::UInt8>::DirectionVector(d);
+        const auto up = InSituVis::SphericalBuffer<kvs::UInt8>::UpVector(d);
         camera->setPosition( p, p + dir, up );
-        const auto buffer = this->drawScreen(
+
+        // Output rendering image (partial rendering image) for each direction
+        const auto dname = InSituVis::SphericalBuffer<kvs::UInt8>::DirectionName(d);
+        if ( pipelined )
+        {
+            // The composition of the previous face is completed after this
+            // face is drawn.
+            frame_buffers[i] = this->draw_partial_buffer();
+            this->outputSubImages( frame_buffers[i], location, dname );
+            if ( i > 0 ) { this->finish_composition(); }
+            this->start_composition( frame_buffers[i] );
+            continue;
+        }
+
+        frame_buffers[i] = this->drawScreen(
             [&] ( const FrameBuffer& frame_buffer )
             {
-                // Output rendering image (partial rendering image) for each direction
-                const auto dname = SphericalColorBuffer::DirectionName(d);
                 this->outputSubImages( frame_buffer, location, dname );
             } );
-
-        color_buffer.setBuffer( d, buffer.color_buffer );
-        depth_buffer.setBuffer( d, buffer.depth_buffer );
     }
-
-    m_rend_time = rend_time;
-    m_comp_time = comp_time;
+    if ( pipelined ) { this->finish_composition(); }
 
     // Restore camera and light info.
     camera->setFieldOfView( fov );
@@ -379,8 +1038,26 @@ inline Adaptor::FrameBuffer Adaptor::readback_omn_buffer( const Viewpoint::Locat
     camera->setPosition( cp, ca, cu );
     light->setPosition( lp );
 
+    return frame_buffers;
+}
+
+inline Adaptor::FrameBuffer Adaptor::readback_omn_buffer( const Viewpoint::Location& location )
+{
+    using SphericalColorBuffer = InSituVis::SphericalBuffer<kvs::UInt8>;
+    using SphericalDepthBuffer = InSituVis::SphericalBuffer<kvs::Real32>;
+
+    const auto frame_buffers = this->readback_cube_map( location );
+    SphericalColorBuffer color_buffer( BaseClass::screen().width(), BaseClass::screen().height() );
+    SphericalDepthBuffer depth_buffer( BaseClass::screen().width(), BaseClass::screen().height() );
+    for ( size_t i = 0; i < SphericalColorBuffer::Direction::NumberOfDirections; i++ )
+    {
+        const auto d = SphericalColorBuffer::Direction(i);
+        color_buffer.setBuffer( d, frame_buffers[i].color_buffer );
+        depth_buffer.setBuffer( d, frame_buffers[i].depth_buffer );
+    }
+
     // Return frame buffer
-    return { color_buffer.stitch<4>(), depth_buffer.stitch<1>() };
+    return { BaseClass::stitchColorBuffer( color_buffer ), BaseClass::stitchDepthBuffer( depth_buffer ) };
 }
 
 inline Adaptor::FrameBuffer Adaptor::readback_adp_buffer( const Viewpoint::Location& location )
@@ -0,0 +1,171 @@
+/*****************************************************************************/
+/**
+ *  @file   AsyncExecutor.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Asynchronous executor class.
+ *
+ *  Jobs are executed one by one in a dedicated thread. At most one job waits
+ *  while another one is executed (double buffering). When a job is pushed
+ *  while a job is waiting, the new job is handled according to the policy:
+ *  the caller is blocked until the waiting job is taken (Block), the new job
+ *  is discarded (Drop), or the waiting job is replaced by the new one
+ *  (Coalesce).
+ */
+/*===========================================================================*/
+class AsyncExecutor
+{
+public:
+    using Job = std::function<void()>;
+
+    enum Policy
+    {
+        Block,
+        Drop,
+        Coalesce
+    };
+
+private:
+    Policy m_policy = Block; ///< policy for the job pushed while a job is waiting
+    bool m_terminated = false; ///< flag for terminating the thread
+    bool m_active = false; ///< flag set while the job is executed
+    Job m_job{}; ///< waiting job
+    std::thread m_thread{}; ///< execution thread
+    std::mutex m_mutex{}; ///< mutex for the waiting job
+    std::condition_variable m_pushed{}; ///< notified when a job is pushed
+    std::condition_variable m_popped{}; ///< notified when a job is taken or completed
+    size_t m_npushed = 0; ///< number of the pushed jobs
+    size_t m_ndropped = 0; ///< number of the jobs discarded by Drop
+    size_t m_ncoalesced = 0; ///< number of the waiting jobs replaced by Coalesce
+
+public:
+    AsyncExecutor() = default;
+    AsyncExecutor( const AsyncExecutor& ) = delete;
+    AsyncExecutor& operator = ( const AsyncExecutor& ) = delete;
+    ~AsyncExecutor() { this->stop(); }
+
+    bool isRunning() const { return m_thread.joinable(); }
+    Policy policy() const { return m_policy; }
+    size_t numberOfPushedJobs() const { return m_npushed; }
+    size_t numberOfDroppedJobs() const { return m_ndropped; }
+    size_t numberOfCoalescedJobs() const { return m_ncoalesced; }
+
+    void setPolicy( const Policy policy ) { m_policy = policy; }
+
+    // Starts the thread, in which init is executed before any job (e.g. to
+    // create the rendering context owned by the thread). The function
+    // returns after init is completed.
+    void start( Job init = nullptr )
+    {
+        this->stop();
+
+        m_terminated = false;
+        m_active = true;
+        m_thread = std::thread( [this,init] { this->run( init ); } );
+
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_popped.wait( lock, [this] { return !m_active; } );
+    }
+
+    void stop()
+    {
+        if ( !this->isRunning() ) { return; }
+
+        this->flush();
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_terminated = true;
+        }
+        m_pushed.notify_all();
+        m_thread.join();
+    }
+
+    // Returns true if called from the thread executing the jobs.
+    bool isExecutorThread() const { return std::this_thread::get_id() == m_thread.get_id(); }
+
+    // Returns false if the job is discarded.
+    bool push( Job job ) { return this->push( std::move( job ), m_policy ); }
+
+    // Pushes the job with the given policy instead of the policy of the
+    // executor (e.g. Block for the jobs that must not be discarded).
+    bool push( Job job, const Policy policy )
+    {
+        if ( !this->isRunning() )
+        {
+            job();
+            return true;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_npushed++;
+            if ( m_job )
+            {
+                switch ( policy )
+                {
+                case Drop: m_ndropped++; return false;
+                case Coalesce: m_ncoalesced++; break;
+                default: m_popped.wait( lock, [this] { return !m_job; } ); break;
+                }
+            }
+            m_job = std::move( job );
+        }
+        m_pushed.notify_one();
+        return true;
+    }
+
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_popped.wait( lock, [this] { return !m_job && !m_active; } );
+    }
+
+private:
+    void run( Job init )
+    {
+        if ( init ) { init(); }
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_active = false;
+        }
+        m_popped.notify_all();
+
+        for ( ;; )
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock( m_mutex );
+                m_pushed.wait( lock, [this] { return m_terminated || m_job; } );
+                if ( !m_job ) { return; } // terminated
+
+                job = std::move( m_job );
+                m_job = nullptr;
+                m_active = true;
+            }
+            m_popped.notify_all();
+
+            job();
+
+            {
+                std::lock_guard<std::mutex> lock( m_mutex );
+                m_active = false;
+            }
+            m_popped.notify_all();
+        }
+    }
+};
+
+} // end of namespace InSituVis
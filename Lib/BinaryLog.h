@@ -0,0 +1,437 @@
+/*****************************************************************************/
+/**
+ *  @file   BinaryLog.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Append-only binary log of the time-series records.
+ *
+ *  The records given for each time step (e.g. the entropies of the
+ *  viewpoints) are appended into a single file instead of creating a CSV
+ *  file for each time step. The file consists of the header with the column
+ *  schema, the records of each time step, and the footer with the index of
+ *  the time steps:
+ *
+ *    header:  magic "ISVLOG\0\0", version, number of columns, record size,
+ *             name length, name (basename of the per-step CSV files),
+ *             {type, name length, name} for each column, padded to 8 bytes
+ *    steps:   magic "ISVSTEP\0", time step, number of records, and record
+ *             size bytes for each record (4 bytes for each column)
+ *    footer:  {time step, offset of the records, number of records} for
+ *             each step, index offset, number of steps, magic "ISVLOGIX"
+ *
+ *  The footer is written only when the log is closed. A file without the
+ *  footer (e.g. the simulation was aborted) is still readable since the
+ *  reader recovers the index by scanning the step headers. The records are
+ *  read by memory mapping (BinaryLogReader). The values are stored in the
+ *  native (little-endian) byte order.
+ */
+/*===========================================================================*/
+class BinaryLog
+{
+public:
+    enum Type : std::uint32_t
+    {
+        Int32 = 0,
+        UInt32 = 1,
+        Float32 = 2
+    };
+
+    struct Column
+    {
+        std::string name; ///< column name (header of the CSV file)
+        Type type; ///< value type
+    };
+
+    struct Entry
+    {
+        std::uint64_t key; ///< time step
+        std::uint64_t first; ///< offset of the first record in the file
+        std::uint64_t count; ///< number of the records
+    };
+
+    static constexpr const char* Magic() { return "ISVLOG\0\0"; }
+    static constexpr const char* IndexMagic() { return "ISVLOGIX"; }
+    static constexpr const char* StepMagic() { return "ISVSTEP\0"; }
+    static constexpr std::uint32_t Version = 2;
+    static constexpr size_t MagicSize = 8;
+    static constexpr size_t StepHeaderSize = MagicSize + 8 + 8;
+    static constexpr size_t TrailerSize = 8 + 8 + MagicSize;
+
+private:
+    std::string m_filename{}; ///< filename
+    std::string m_name{}; ///< basename of the per-step CSV files
+    std::vector<Column> m_columns{}; ///< column schema
+    std::fstream m_file{}; ///< output file kept opened
+    std::uint64_t m_data_begin = 0; ///< offset of the first step
+    std::uint64_t m_data_end = 0; ///< offset of the end of the records
+    std::uint64_t m_nrecords = 0; ///< number of the records
+    std::uint64_t m_nsteps = 0; ///< number of the time steps
+
+public:
+    BinaryLog() = default;
+    BinaryLog( const BinaryLog& ) = delete;
+    BinaryLog& operator = ( const BinaryLog& ) = delete;
+    ~BinaryLog() { this->close(); }
+
+    const std::string& filename() const { return m_filename; }
+    const std::string& name() const { return m_name; }
+    const std::vector<Column>& columns() const { return m_columns; }
+    size_t numberOfSteps() const { return static_cast<size_t>( m_nsteps ); }
+    size_t numberOfRecords() const { return static_cast<size_t>( m_nrecords ); }
+    size_t recordSize() const { return m_columns.size() * 4; }
+    bool isOpened() const { return m_file.is_open(); }
+
+    // Creates the file with the header. The existing file is overwritten.
+    bool open(
+        const std::string& filename,
+        const std::string& name,
+        const std::vector<Column>& columns )
+    {
+        this->close();
+        m_filename = filename;
+        m_name = name;
+        m_columns = columns;
+        m_nrecords = 0;
+        m_nsteps = 0;
+
+        m_file.open( filename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc );
+        if ( !m_file ) { return false; }
+
+        std::string header( Magic(), MagicSize );
+        Put( header, Version );
+        Put( header, static_cast<std::uint32_t>( columns.size() ) );
+        Put( header, static_cast<std::uint32_t>( this->recordSize() ) );
+        Put( header, static_cast<std::uint32_t>( name.size() ) );
+        header += name;
+        for ( const auto& column : columns )
+        {
+            Put( header, static_cast<std::uint32_t>( column.type ) );
+            Put( header, static_cast<std::uint32_t>( column.name.size() ) );
+            header += column.name;
+        }
+        header.resize( ( header.size() + 7 ) / 8 * 8, '\0' );
+
+        m_file.write( header.data(), header.size() );
+        m_file.flush();
+        m_data_begin = header.size();
+        m_data_end = header.size();
+        return static_cast<bool>( m_file );
+    }
+
+    // Writes the footer with the index of the time steps and closes the file.
+    void close()
+    {
+        if ( m_file.is_open() )
+        {
+            this->write_footer();
+            m_file.close();
+        }
+    }
+
+    // Appends the records of the time step. The record data is given in the
+    // record-major order with 4 bytes for each column.
+    bool append( const std::uint64_t key, const void* data, const size_t nrecords )
+    {
+        if ( !m_file.is_open() ) { return false; }
+
+        std::string header( StepMagic(), MagicSize );
+        Put( header, key );
+        Put( header, static_cast<std::uint64_t>( nrecords ) );
+
+        const auto size = nrecords * this->recordSize();
+        m_file.seekp( static_cast<std::streamoff>( m_data_end ) );
+        m_file.write( header.data(), header.size() );
+        m_file.write( static_cast<const char*>( data ), size );
+        m_file.flush();
+        m_data_end += header.size() + size;
+        m_nrecords += nrecords;
+        m_nsteps++;
+        return static_cast<bool>( m_file );
+    }
+
+    // Appends the values with the indices (e.g. "Index,Entropy").
+    bool append( const std::uint64_t key, const std::vector<float>& values )
+    {
+        std::vector<char> data( values.size() * 8 );
+        for ( size_t i = 0; i < values.size(); i++ )
+        {
+            const auto index = static_cast<std::uint32_t>( i );
+            std::memcpy( data.data() + i * 8, &index, 4 );
+            std::memcpy( data.data() + i * 8 + 4, &values[i], 4 );
+        }
+        return this->append( key, data.data(), values.size() );
+    }
+
+private:
+    template <typename T>
+    static void Put( std::string& buffer, const T value )
+    {
+        buffer.append( reinterpret_cast<const char*>( &value ), sizeof( T ) );
+    }
+
+    bool write_footer()
+    {
+        // The index is built from the step headers in the file, so that it
+        // is not kept in memory during the run.
+        std::string footer;
+        std::uint64_t offset = m_data_begin;
+        while ( offset < m_data_end )
+        {
+            std::uint64_t header[2] = { 0, 0 };
+            m_file.seekg( static_cast<std::streamoff>( offset + MagicSize ) );
+            m_file.read( reinterpret_cast<char*>( header ), sizeof( header ) );
+            if ( !m_file ) { return false; }
+
+            offset += StepHeaderSize;
+            Put( footer, header[0] );
+            Put( footer, offset );
+            Put( footer, header[1] );
+            offset += header[1] * this->recordSize();
+        }
+        Put( footer, m_data_end );
+        Put( footer, m_nsteps );
+        footer.append( IndexMagic(), MagicSize );
+
+        m_file.seekp( static_cast<std::streamoff>( m_data_end ) );
+        m_file.write( footer.data(), footer.size() );
+        m_file.flush();
+        return static_cast<bool>( m_file );
+    }
+};
+
+/*===========================================================================*/
+/**
+ *  @brief  Reader of the binary log with memory mapping.
+ */
+/*===========================================================================*/
+class BinaryLogReader
+{
+public:
+    using Column = BinaryLog::Column;
+    using Entry = BinaryLog::Entry;
+
+private:
+    const char* m_data = nullptr; ///< mapped file
+    size_t m_size = 0; ///< file size
+    size_t m_data_begin = 0; ///< offset of the first step
+    size_t m_record_size = 0; ///< record size in bytes
+    std::string m_name{}; ///< basename of the per-step CSV files
+    std::vector<Column> m_columns{}; ///< column schema
+    std::vector<Entry> m_entries{}; ///< index of the time steps
+
+public:
+    BinaryLogReader() = default;
+    explicit BinaryLogReader( const std::string& filename ) { this->open( filename ); }
+    BinaryLogReader( const BinaryLogReader& ) = delete;
+    BinaryLogReader& operator = ( const BinaryLogReader& ) = delete;
+    ~BinaryLogReader() { this->close(); }
+
+    bool isOpened() const { return m_data != nullptr; }
+    const std::string& name() const { return m_name; }
+    const std::vector<Column>& columns() const { return m_columns; }
+    const std::vector<Entry>& entries() const { return m_entries; }
+    size_t numberOfEntries() const { return m_entries.size(); }
+    size_t recordSize() const { return m_record_size; }
+
+    bool open( const std::string& filename )
+    {
+        this->close();
+
+        const int fd = ::open( filename.c_str(), O_RDONLY );
+        if ( fd < 0 ) { return false; }
+
+        struct stat st;
+        if ( ::fstat( fd, &st ) != 0 || st.st_size < 24 )
+        {
+            ::close( fd );
+            return false;
+        }
+
+        void* data = ::mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        ::close( fd );
+        if ( data == MAP_FAILED ) { return false; }
+
+        m_data = static_cast<const char*>( data );
+        m_size = static_cast<size_t>( st.st_size );
+        if ( !this->parse() ) { this->close(); return false; }
+        return true;
+    }
+
+    void close()
+    {
+        if ( m_data ) { ::munmap( const_cast<char*>( m_data ), m_size ); }
+        m_data = nullptr;
+        m_size = 0;
+        m_data_begin = 0;
+        m_record_size = 0;
+        m_name.clear();
+        m_columns.clear();
+        m_entries.clear();
+    }
+
+    // Returns the index of the entry of the time step, or -1.
+    long find( const std::uint64_t key ) const
+    {
+        for ( size_t i = 0; i < m_entries.size(); i++ )
+        {
+            if ( m_entries[i].key == key ) { return static_cast<long>( i ); }
+        }
+        return -1;
+    }
+
+    // Returns the pointer to the i-th record of the entry in the mapped file.
+    const char* record( const size_t entry, const size_t i ) const
+    {
+        return m_data + m_entries[ entry ].first + i * m_record_size;
+    }
+
+    template <typename T>
+    T value( const size_t entry, const size_t i, const size_t column ) const
+    {
+        T v;
+        std::memcpy( &v, this->record( entry, i ) + column * 4, 4 );
+        return v;
+    }
+
+    // Returns the values of the column for the entry as float.
+    std::vector<float> values( const size_t entry, const size_t column ) const
+    {
+        const auto& e = m_entries[ entry ];
+        std::vector<float> v( e.count );
+        for ( size_t i = 0; i < e.count; i++ ) { v[i] = this->as_float( entry, i, column ); }
+        return v;
+    }
+
+    // Writes the records of the entry in the CSV format, which is identical
+    // to the per-step CSV file.
+    bool writeCSV( const size_t entry, const std::string& filename ) const
+    {
+        std::ofstream file( filename );
+        if ( !file ) { return false; }
+
+        for ( size_t j = 0; j < m_columns.size(); j++ )
+        {
+            file << ( j > 0 ? "," : "" ) << m_columns[j].name;
+        }
+        file << std::endl;
+
+        const auto& e = m_entries[ entry ];
+        for ( size_t i = 0; i < e.count; i++ )
+        {
+            for ( size_t j = 0; j < m_columns.size(); j++ )
+            {
+                if ( j > 0 ) { file << ","; }
+                switch ( m_columns[j].type )
+                {
+                case BinaryLog::Int32: file << this->value<std::int32_t>( entry, i, j ); break;
+                case BinaryLog::UInt32: file << this->value<std::uint32_t>( entry, i, j ); break;
+                default: file << this->value<float>( entry, i, j ); break;
+                }
+            }
+            file << std::endl;
+        }
+        return true;
+    }
+
+private:
+    template <typename T>
+    T get( const size_t offset ) const
+    {
+        T v;
+        std::memcpy( &v, m_data + offset, sizeof( T ) );
+        return v;
+    }
+
+    float as_float( const size_t entry, const size_t i, const size_t column ) const
+    {
+        switch ( m_columns[ column ].type )
+        {
+        case BinaryLog::Int32: return static_cast<float>( this->value<std::int32_t>( entry, i, column ) );
+        case BinaryLog::UInt32: return static_cast<float>( this->value<std::uint32_t>( entry, i, column ) );
+        default: return this->value<float>( entry, i, column );
+        }
+    }
+
+    bool parse()
+    {
+        if ( std::memcmp( m_data, BinaryLog::Magic(), BinaryLog::MagicSize ) != 0 ) { return false; }
+        if ( this->get<std::uint32_t>( 8 ) != BinaryLog::Version ) { return false; }
+
+        const auto ncolumns = this->get<std::uint32_t>( 12 );
+        m_record_size = this->get<std::uint32_t>( 16 );
+        const auto name_length = this->get<std::uint32_t>( 20 );
+        size_t offset = 24;
+        if ( offset + name_length > m_size ) { return false; }
+        m_name = std::string( m_data + offset, name_length );
+        offset += name_length;
+        for ( std::uint32_t i = 0; i < ncolumns; i++ )
+        {
+            if ( offset + 8 > m_size ) { return false; }
+            const auto type = static_cast<BinaryLog::Type>( this->get<std::uint32_t>( offset ) );
+            const auto length = this->get<std::uint32_t>( offset + 4 );
+            offset += 8;
+            if ( offset + length > m_size ) { return false; }
+            m_columns.push_back( { std::string( m_data + offset, length ), type } );
+            offset += length;
+        }
+        offset = ( offset + 7 ) / 8 * 8;
+        if ( offset > m_size ) { return false; }
+        m_data_begin = offset;
+
+        if ( this->parse_footer() ) { return true; }
+
+        // The file was not closed (no footer), so the index is recovered by
+        // scanning the step headers. A step truncated at the end is ignored.
+        m_entries.clear();
+        while ( offset + BinaryLog::StepHeaderSize <= m_size )
+        {
+            if ( std::memcmp( m_data + offset, BinaryLog::StepMagic(), BinaryLog::MagicSize ) != 0 ) { break; }
+            const auto key = this->get<std::uint64_t>( offset + 8 );
+            const auto count = this->get<std::uint64_t>( offset + 16 );
+            const auto first = offset + BinaryLog::StepHeaderSize;
+            if ( m_record_size > 0 && count > ( m_size - first ) / m_record_size ) { break; }
+            m_entries.push_back( { key, first, count } );
+            offset = first + count * m_record_size;
+        }
+        return true;
+    }
+
+    bool parse_footer()
+    {
+        if ( m_size < m_data_begin + BinaryLog::TrailerSize ) { return false; }
+        const auto trailer = m_size - BinaryLog::TrailerSize;
+        if ( std::memcmp( m_data + trailer + 16, BinaryLog::IndexMagic(), BinaryLog::MagicSize ) != 0 ) { return false; }
+        const auto index_offset = this->get<std::uint64_t>( trailer );
+        const auto nentries = this->get<std::uint64_t>( trailer + 8 );
+        if ( index_offset < m_data_begin || index_offset > trailer ) { return false; }
+        if ( ( trailer - index_offset ) / 24 != nentries || ( trailer - index_offset ) % 24 != 0 ) { return false; }
+
+        for ( std::uint64_t i = 0; i < nentries; i++ )
+        {
+            const auto p = index_offset + i * 24;
+            m_entries.push_back( { this->get<std::uint64_t>( p ), this->get<std::uint64_t>( p + 8 ), this->get<std::uint64_t>( p + 16 ) } );
+        }
+        return true;
+    }
+};
+
+} // end of namespace InSituVis
@@ -29,6 +29,7 @@ private:
     kvs::StampTimer m_entr_timer{}; ///< timer for entropy evaluation
     kvs::StampTimer m_focus_timer{}; ///< timer for entropy evaluation
     kvs::StampTimer m_zoom_timer{}; ///< timer for entropy evaluation
+    InSituVis::StreamingSink m_log_sink{}; ///< sink for the log files of the timers
     size_t m_final_time_step = 0;
     size_t m_zoom_level = 1; ///< zoom level
     kvs::Vec2ui m_frame_divs{ 1, 1 }; ///< number of frame divisions
@@ -55,6 +56,7 @@ public:
 
     void exec( const BaseClass::SimTime sim_time = {} ) override;
     bool dump() override;
+    bool isAnalysisIntervalAdjustable() const override { return false; }
 
 protected:
     using Controller::process;
@@ -70,6 +72,8 @@ protected:
         const kvs::Vec3 focus );
 
     void execRendering() override;
+    bool streamLogs() override;
+    bool writeLogs( const bool final );
     void process( const Data& data ) override;
     void process( const Data& data, const float radius, const kvs::Quat& rotation, const kvs::Vec3& focus ) override;
 
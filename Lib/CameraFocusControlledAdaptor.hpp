@@ -66,42 +66,52 @@ CameraFocusControlledAdaptor::focusedLocation(
 
 inline bool CameraFocusControlledAdaptor::dump()
 {
-    bool ret = true;
-    bool ret_f = true;
-    bool ret_z = true;
-    if ( m_entr_timer.title().empty() ) { m_entr_timer.setTitle( "Ent time" ); }
-    kvs::StampTimerList timer_list;
-    timer_list.push( m_entr_timer );
+    // The logs are written after the steps in the visualization thread.
+    BaseClass::waitForVisualization();
+    const bool ret = this->writeLogs( true );
+    return BaseClass::dump() && ret;
+}
 
-    const auto basedir = BaseClass::outputDirectory().baseDirectoryName() + "/";
-    ret = timer_list.write( basedir + "ent_proc_time.csv" );
+inline bool CameraFocusControlledAdaptor::streamLogs()
+{
+    const bool ret = this->writeLogs( false );
+    return BaseClass::streamLogs() && ret;
+}
 
-    if ( m_focus_timer.title().empty() ) { m_focus_timer.setTitle( "focus time" ); }
-    kvs::StampTimerList f_timer_list;
-    f_timer_list.push( m_focus_timer );
-    ret_f = f_timer_list.write( basedir + "focus_proc_time.csv" );
+inline bool CameraFocusControlledAdaptor::writeLogs( const bool final )
+{
+    // The records are flushed into the files every streaming interval in
+    // streaming mode, and the remaining records are written at dump.
+    const auto interval = BaseClass::streamingInterval();
+    const auto directory = BaseClass::outputDirectory();
 
+    bool ret = true;
+    const auto basedir = directory.baseDirectoryName() + "/";
+    if ( m_entr_timer.title().empty() ) { m_entr_timer.setTitle( "Ent time" ); }
+    ret = m_log_sink.write( basedir + "ent_proc_time.csv", { &m_entr_timer }, interval, final ) && ret;
+    if ( m_focus_timer.title().empty() ) { m_focus_timer.setTitle( "focus time" ); }
+    ret = m_log_sink.write( basedir + "focus_proc_time.csv", { &m_focus_timer }, interval, final ) && ret;
     if ( m_zoom_timer.title().empty() ) { m_zoom_timer.setTitle( "zoom time" ); }
-    kvs::StampTimerList z_timer_list;
-    z_timer_list.push( m_zoom_timer );
-    ret_z = z_timer_list.write( basedir + "zoom_proc_time.csv" );
+    ret = m_log_sink.write( basedir + "zoom_proc_time.csv", { &m_zoom_timer }, interval, final ) && ret;
 
-//    const auto interval = BaseClass::analysisInterval();
-    const auto directory = BaseClass::outputDirectory();
     const auto File = [&]( const std::string& name ) { return Controller::logDataFilename( name, directory ); };
+    if ( !final )
+    {
+        Controller::flushLogs( directory, BaseClass::analysisInterval(), interval );
+        return ret;
+    }
+
     Controller::outputPathCalcTimes( File( "output_path_calc_times" ) );
     Controller::outputViewpointCoords( File( "output_viewpoint_coords" ), BaseClass::viewpoint() );
     Controller::outputNumImages( File( "output_num_images" ), BaseClass::analysisInterval() );
-//    Controller::outputPathEntropies( File( "output_path_entropies" ), interval );
-//    Controller::outputPathPositions( File( "output_path_positions"), interval );
-    //this->outputPathCalcTimes( Controller::pathCalcTimes() );
-    //this->outputViewpointCoords();
-
-    return BaseClass::dump() && ret && ret_f && ret_z;
+    return ret;
 }
 
 inline void CameraFocusControlledAdaptor::exec( const BaseClass::SimTime sim_time )
 {
+    // In async mode, the step is executed in the visualization thread.
+    if ( BaseClass::execAsync( sim_time ) ) { return; }
+
     Controller::setCacheEnabled( BaseClass::isAnalysisStep() );
     Controller::setIsEntStep( this->isEntropyStep() );
     Controller::updateCacheSize();
@@ -137,21 +147,29 @@ inline void CameraFocusControlledAdaptor::execRendering()
 
     if ( Controller::isEntStep() && !Controller::isErpStep() )
     {
+        // Draw and readback framebuffers (in parallel if enabled)
+        // at the evaluation image size.
+        const auto& locations = BaseClass::viewpoint().locations();
+        kvs::Timer timer_rend( kvs::Timer::Start );
+        // The locations from which the object cannot be seen are culled
+        // without rendering, and their entropies are zero.
+        BaseClass::beginEvaluation();
+        const auto culled = BaseClass::cullLocations( locations );
+        frame_buffers = BaseClass::readbackFrameBuffers( locations, culled );
+        timer_rend.stop();
+        rend_time += BaseClass::rendTimer().time( timer_rend );
+
         // Entropy evaluation
-        for ( const auto& location : BaseClass::viewpoint().locations() )
+        for ( size_t i = 0; i < locations.size(); i++ )
         {
-            // Draw and readback framebuffer
-            kvs::Timer timer_rend( kvs::Timer::Start );
-            auto frame_buffer = BaseClass::readbackFrameBuffer( location );
-            timer_rend.stop();
-            rend_time += BaseClass::rendTimer().time( timer_rend );
+            const auto& location = locations[i];
+            const auto& frame_buffer = frame_buffers[i];
 
             // Output framebuffer to image file at the root node
             kvs::Timer timer( kvs::Timer::Start );
 
-            const auto entropy = Controller::entropy( frame_buffer );
+            const auto entropy = culled[i] ? 0.0f : Controller::entropy( frame_buffer );
             entropies.push_back( entropy );
-            frame_buffers.push_back( frame_buffer );
 
             if ( entropy > max_entropy )
             {
@@ -181,8 +199,27 @@ inline void CameraFocusControlledAdaptor::execRendering()
             const auto basename = "output_entropies_";
             const auto timestep = BaseClass::timeStep();
             const auto directory = BaseClass::outputDirectory();
-            const auto filename = Controller::logDataFilename( basename, timestep, directory );
-            Controller::outputEntropies( filename, entropies );
+            Controller::outputEntropies( basename, timestep, directory, entropies );
+        }
+
+        // Evaluate all of the viewpoints at full resolution as well.
+        if ( BaseClass::isEvaluationImageScaled() && BaseClass::isEvaluationCheckEnabled() )
+        {
+            BaseClass::endEvaluation();
+            const auto full_frame_buffers = BaseClass::readbackFrameBuffers( locations, culled );
+            float full_max_entropy = -1.0f;
+            int full_max_index = 0;
+            for ( size_t i = 0; i < locations.size(); i++ )
+            {
+                const auto entropy = culled[i] ? 0.0f : Controller::entropy( full_frame_buffers[i] );
+                if ( entropy > full_max_entropy )
+                {
+                    full_max_entropy = entropy;
+                    full_max_index = locations[i].index;
+                }
+            }
+            BaseClass::stampEvaluationCheck( max_index, full_max_index );
+            BaseClass::beginEvaluation();
         }
 
         // Distribute the index indicates the max entropy image
@@ -212,20 +249,32 @@ inline void CameraFocusControlledAdaptor::execRendering()
         auto max_zoom_entropy = -1.0f;
         auto estimated_zoom_level = 0;
         auto estimated_zoom_position = max_position;
+
+        // Update camera positions.
+        timer.start();
+        Viewpoint::Locations zoom_locations( m_zoom_level, location );
         for ( size_t level = 0; level < m_zoom_level; level++ )
         {
-            // Update camera position.
-            timer.start();
             auto t = static_cast<float>( level ) / static_cast<float>( m_zoom_level );
-            location.position = ( 1 - t ) * max_position + t * at;
-            timer.stop();
-            zoom_time += m_zoom_timer.time( timer );
+            zoom_locations[ level ].position = ( 1 - t ) * max_position + t * at;
+        }
+        timer.stop();
+        zoom_time += m_zoom_timer.time( timer );
 
-            // Rendering at the updated camera position.
-            kvs::Timer timer_rend( kvs::Timer::Start );
-            auto frame_buffer = BaseClass::readbackFrameBuffer( location );
-            timer_rend.stop();
-            rend_time += BaseClass::rendTimer().time( timer_rend );
+        // Rendering at the updated camera positions. The zoom levels are
+        // evaluated at the evaluation image size only for the auto zooming.
+        timer_rend.start();
+        if ( !Controller::isAutoZoomingEnabled() ) { BaseClass::endEvaluation(); }
+        const auto zoom_buffers = BaseClass::readbackFrameBuffers( zoom_locations );
+        BaseClass::endEvaluation();
+        timer_rend.stop();
+        rend_time += BaseClass::rendTimer().time( timer_rend );
+
+        for ( size_t level = 0; level < m_zoom_level; level++ )
+        {
+            InSituVis::ProfileScope zoom_scope( "zoom", static_cast<long>( level ) );
+            location = zoom_locations[ level ];
+            const auto& frame_buffer = zoom_buffers[ level ];
 
             // Output the rendering images and the heatmap of entropies.
             if ( Controller::isAutoZoomingEnabled() )
@@ -266,8 +315,16 @@ inline void CameraFocusControlledAdaptor::execRendering()
 
             if ( BaseClass::isOutputImageEnabled() )
             {
+                // Render the selected zoom level at the output image size.
                 const auto level = estimated_zoom_level;
-                const auto frame_buffer = zoom_frame_buffers[ level ];
+                auto frame_buffer = zoom_frame_buffers[ level ];
+                if ( BaseClass::isEvaluationImageScaled() )
+                {
+                    timer_rend.start();
+                    frame_buffer = BaseClass::readbackFrameBuffer( zoom_locations[ level ] );
+                    timer_rend.stop();
+                    rend_time += BaseClass::rendTimer().time( timer_rend );
+                }
                 timer.start();
                 if ( Controller::isOutputColorImage() ) this->outputColorImage( max_location, frame_buffer, level );
                 else {this->outputDepthImage( max_location, frame_buffer, level );}
@@ -312,20 +369,28 @@ inline void CameraFocusControlledAdaptor::execRendering()
 
             // Zooming
             const auto p = location.position;
+
+            // Update camera positions.
+            timer.start();
+            Viewpoint::Locations zoom_locations( m_zoom_level, location );
             for ( size_t level = 0; level < m_zoom_level; level++ )
             {
-                // Update camera position.
-                timer.start();
                 auto t = static_cast<float>( level ) / static_cast<float>( m_zoom_level );
-                location.position = ( 1 - t ) * p + t * focus;
-                timer.stop();
-                zoom_time += m_zoom_timer.time( timer );
+                zoom_locations[ level ].position = ( 1 - t ) * p + t * focus;
+            }
+            timer.stop();
+            zoom_time += m_zoom_timer.time( timer );
+
+            // Rendering at the updated camera positions.
+            kvs::Timer timer_rend( kvs::Timer::Start );
+            const auto zoom_buffers = BaseClass::readbackFrameBuffers( zoom_locations );
+            timer_rend.stop();
+            rend_time += BaseClass::rendTimer().time( timer_rend );
 
-                // Rendering at the updated camera position.
-                kvs::Timer timer_rend( kvs::Timer::Start );
-                auto frame_buffer = BaseClass::readbackFrameBuffer( location );
-                timer_rend.stop();
-                rend_time += BaseClass::rendTimer().time( timer_rend );
+            for ( size_t level = 0; level < m_zoom_level; level++ )
+            {
+                location = zoom_locations[ level ];
+                const auto& frame_buffer = zoom_buffers[ level ];
 
                 //if ( level == 0 )
                 //{
@@ -346,11 +411,11 @@ inline void CameraFocusControlledAdaptor::execRendering()
         }
     }
 
-    m_entr_timer.stamp( entr_time );
+    BaseClass::stampTime( BaseClass::EntrStage, m_entr_timer, entr_time );
     m_focus_timer.stamp( focus_time );
     m_zoom_timer.stamp( zoom_time );
-    BaseClass::saveTimer().stamp( save_time );
-    BaseClass::rendTimer().stamp( rend_time );
+    BaseClass::stampTime( BaseClass::SaveStage, BaseClass::saveTimer(), save_time );
+    BaseClass::stampTime( BaseClass::RendStage, BaseClass::rendTimer(), rend_time );
 }
 
 inline void CameraFocusControlledAdaptor::process( const Data& data )
@@ -398,7 +463,7 @@ inline std::string CameraFocusControlledAdaptor::outputFinalImageName( const siz
     const auto output_basename = BaseClass::outputFilename();
     const auto output_zoom_level = kvs::String::From( level, 6, '0' );
     const auto output_filename = output_basename + "_" + output_time + "_" + output_zoom_level;
-    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".bmp";
+    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + BaseClass::imageEncoder().extension();
     return filename;
 }
 
@@ -408,9 +473,8 @@ inline void CameraFocusControlledAdaptor::outputColorImage(
     const size_t level )
 {
     const auto size = BaseClass::outputImageSize( location );
-    const auto buffer = frame_buffer.color_buffer;
-    kvs::ColorImage image( size.x(), size.y(), buffer );
-    image.write( this->outputFinalImageName( level ) );
+    const auto filename = this->outputFinalImageName( level );
+    BaseClass::writeColorImage( filename, size, frame_buffer.color_buffer );
 }
 
 inline void CameraFocusControlledAdaptor::outputDepthImage(
@@ -419,15 +483,15 @@ inline void CameraFocusControlledAdaptor::outputDepthImage(
     const size_t level )
 {
     const auto size = BaseClass::outputImageSize( location );
-    const auto buffer = frame_buffer.depth_buffer;
-    kvs::GrayImage image( size.x(), size.y(), buffer );
-    image.write( this->outputFinalImageName( level ) );
+    const auto filename = this->outputFinalImageName( level );
+    BaseClass::writeDepthImage( filename, size, frame_buffer.depth_buffer );
 }
 
 inline kvs::Vec3 CameraFocusControlledAdaptor::look_at_in_window( const FrameBuffer& frame_buffer )
 {
-    const auto w = BaseClass::imageWidth(); // frame buffer width
-    const auto h = BaseClass::imageHeight(); // frame buffer height
+    InSituVis::ProfileScope scope( "focus" );
+    const auto w = static_cast<size_t>( BaseClass::screen().width() ); // frame buffer width
+    const auto h = static_cast<size_t>( BaseClass::screen().height() ); // frame buffer height
 //    const auto cw = w / m_frame_divs.x(); // cropped frame buffer width
 //    const auto ch = h / m_frame_divs.y(); // cropped frame buffer height
 //    const auto cw = ( w + 1 ) / m_frame_divs.x(); // cropped frame buffer width
@@ -496,8 +560,7 @@ inline kvs::Vec3 CameraFocusControlledAdaptor::look_at_in_window( const FrameBuf
         const auto basename = "output_frame_entropies_";
         const auto timestep = BaseClass::timeStep();
         const auto directory = BaseClass::outputDirectory();
-        const auto filename = Controller::logDataFilename( basename, timestep, directory );
-        Controller::outputFrameEntropies( filename, focus_entropies );
+        Controller::outputFrameEntropies( basename, timestep, directory, focus_entropies );
     }
 
     return { static_cast<float>( center.x() ), static_cast<float>( center.y() ), depth };
@@ -558,8 +621,8 @@ CameraFocusControlledAdaptor::crop_frame_buffer(
     KVS_ASSERT( indices[0] < static_cast<int>( m_frame_divs[0] ) );
     KVS_ASSERT( indices[1] < static_cast<int>( m_frame_divs[1] ) );
 
-    const auto w = BaseClass::imageWidth(); // frame buffer width
-    const auto h = BaseClass::imageHeight(); // frame buffer height
+    const auto w = static_cast<size_t>( BaseClass::screen().width() ); // frame buffer width
+    const auto h = static_cast<size_t>( BaseClass::screen().height() ); // frame buffer height
 //    const auto cw = w / m_frame_divs.x(); // cropped frame buffer width
 //    const auto ch = h / m_frame_divs.y(); // cropped frame buffer height
     const auto cw = w / m_frame_divs.x() + 1; // cropped frame buffer width
@@ -576,8 +639,8 @@ CameraFocusControlledAdaptor::crop_frame_buffer(
 
     // Cropped frame buffer.
     FrameBuffer cropped_buffer;
-    cropped_buffer.color_buffer.allocate( aw * ah * 4 );
-    cropped_buffer.depth_buffer.allocate( aw * ah );
+    cropped_buffer.color_buffer = BaseClass::frameBufferPool().colorBuffer( aw * ah * 4 );
+    cropped_buffer.depth_buffer = BaseClass::frameBufferPool().depthBuffer( aw * ah );
 
     auto* dst_color_buffer = cropped_buffer.color_buffer.data();
     auto* dst_depth_buffer = cropped_buffer.depth_buffer.data();
@@ -628,20 +691,10 @@ inline kvs::Quat CameraFocusControlledAdaptor::rotation( const kvs::Vec3& positi
 inline void CameraFocusControlledAdaptor::outputZoomEntropies(
     const std::vector<float> zoom_entropies )
 {
-    const auto time = BaseClass::timeStep();
-    const auto output_time = kvs::String::From( time, 6, '0' );
-    const auto output_filename = "output_zoom_entropies" + output_time;
-    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".csv";
-
-    std::ofstream file( filename );
-    {
-        file << "Zoomlevel,Entropy" << std::endl;
-        for ( size_t i = 0; i < zoom_entropies.size(); i++ )
-        {
-            file << i << "," << zoom_entropies[i] << std::endl;
-        }
-    }
-    file.close();
+    const auto basename = "output_zoom_entropies";
+    const auto timestep = BaseClass::timeStep();
+    const auto directory = BaseClass::outputDirectory();
+    Controller::outputZoomEntropies( basename, timestep, directory, zoom_entropies );
 }
 
 } // end of namespace InSituVis
@@ -34,6 +34,7 @@ private:
     kvs::mpi::StampTimer m_entr_timer{ BaseClass::world() }; ///< timer for entropy evaluation
     kvs::mpi::StampTimer m_focus_timer{ BaseClass::world() }; ///< timer for entropy evaluation
     kvs::mpi::StampTimer m_zoom_timer{ BaseClass::world() }; ///< timer for entropy evaluation
+    InSituVis::StreamingSink m_log_sink{}; ///< sink for the log files of the timers
     size_t m_final_time_step = 0;
 
     size_t m_zoom_level = 1; ///< zoom level
@@ -50,6 +51,8 @@ public:
     kvs::mpi::StampTimer& focusTimer() { return m_focus_timer; }
     kvs::mpi::StampTimer& zoomTimer() { return m_zoom_timer; }
     void exec( const BaseClass::SimTime sim_time = {} ) override;
+    bool isAsyncExecutionSupported() const override { return false; }
+    bool isAnalysisIntervalAdjustable() const override { return false; }
     bool dump() override;
     void setFinalTimeStep( const size_t step ) { m_final_time_step = step; }
 
@@ -80,6 +83,8 @@ protected:
         const kvs::Vec3 focus );
 
     void execRendering() override;
+    bool streamLogs() override;
+    bool writeLogs( const bool final );
     void process( const Data& data ) override;
     void process( const Data& data, const float radius, const kvs::Quaternion& rotation, const kvs::Vec3& focus, const int route_num ) override;
 
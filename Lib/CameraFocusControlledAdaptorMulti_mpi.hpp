@@ -54,37 +54,54 @@ CameraFocusControlledAdaptorMulti::focusedLocation(
 
 inline bool CameraFocusControlledAdaptorMulti::dump()
 {
-    bool ret = true;
-    bool ret_f = true;
-    bool ret_z = true;
-    if ( BaseClass::world().isRoot() )
-    {
-        if ( m_entr_timer.title().empty() ) { m_entr_timer.setTitle( "Ent time" ); }
-        kvs::StampTimerList entr_timer_list;
-        entr_timer_list.push( m_entr_timer );
-
-        const auto basedir = BaseClass::outputDirectory().baseDirectoryName() + "/";
-        ret = entr_timer_list.write( basedir + "ent_proc_time.csv" );
+    const bool ret = this->writeLogs( true );
+    return BaseClass::dump() && ret;
+}
 
-        if ( m_focus_timer.title().empty() ) { m_focus_timer.setTitle( "focus time" ); }
-        kvs::StampTimerList f_timer_list;
-        f_timer_list.push( m_focus_timer );
-        ret_f = f_timer_list.write( basedir + "focus_proc_time.csv" );
+inline bool CameraFocusControlledAdaptorMulti::streamLogs()
+{
+    const bool ret = this->writeLogs( false );
+    return BaseClass::streamLogs() && ret;
+}
 
-        if ( m_zoom_timer.title().empty() ) { m_zoom_timer.setTitle( "zoom time" ); }
-        kvs::StampTimerList z_timer_list;
-        z_timer_list.push( m_zoom_timer );
-        ret_z = z_timer_list.write( basedir + "zoom_proc_time.csv" );
+inline bool CameraFocusControlledAdaptorMulti::writeLogs( const bool final )
+{
+    // The records are flushed into the files every streaming interval in
+    // streaming mode, and the remaining records are written at dump.
+    const auto interval = BaseClass::streamingInterval();
+    const auto directory = BaseClass::outputDirectory();
+    if ( !BaseClass::world().isRoot() )
+    {
+        // Only the root writes the logs, so the records are discarded.
+        if ( final ) { return true; }
+        if ( m_entr_timer.numberOfStamps() >= interval ) { InSituVis::StreamingSink::Erase( m_entr_timer, interval ); }
+        if ( m_focus_timer.numberOfStamps() >= interval ) { InSituVis::StreamingSink::Erase( m_focus_timer, interval ); }
+        if ( m_zoom_timer.numberOfStamps() >= interval ) { InSituVis::StreamingSink::Erase( m_zoom_timer, interval ); }
+        Controller::flushLogs( directory, BaseClass::analysisInterval(), interval, false );
+        return true;
+    }
 
-        const auto directory = BaseClass::outputDirectory();
-        const auto File = [&]( const std::string& name ) { return Controller::logDataFilename( name, directory ); };
-        Controller::outputPathCalcTimes( File( "output_path_calc_times" ) );
-        Controller::outputViewpointCoords( File( "output_viewpoint_coords" ), BaseClass::viewpoint() );
-        Controller::outputNumImages( File( "output_num_images" ), BaseClass::analysisInterval() );
-        Controller::outputVideoParams( File("output_video_params" ), Controller::outputFilenames(), Controller::focusEntropies(), Controller::focusPathLength(), Controller::cameraPathLength() );
+    bool ret = true;
+    const auto basedir = directory.baseDirectoryName() + "/";
+    if ( m_entr_timer.title().empty() ) { m_entr_timer.setTitle( "Ent time" ); }
+    ret = m_log_sink.write( basedir + "ent_proc_time.csv", { &m_entr_timer }, interval, final ) && ret;
+    if ( m_focus_timer.title().empty() ) { m_focus_timer.setTitle( "focus time" ); }
+    ret = m_log_sink.write( basedir + "focus_proc_time.csv", { &m_focus_timer }, interval, final ) && ret;
+    if ( m_zoom_timer.title().empty() ) { m_zoom_timer.setTitle( "zoom time" ); }
+    ret = m_log_sink.write( basedir + "zoom_proc_time.csv", { &m_zoom_timer }, interval, final ) && ret;
+
+    const auto File = [&]( const std::string& name ) { return Controller::logDataFilename( name, directory ); };
+    if ( !final )
+    {
+        Controller::flushLogs( directory, BaseClass::analysisInterval(), interval );
+        return ret;
     }
 
-    return BaseClass::dump() && ret && ret_f && ret_z;
+    Controller::outputPathCalcTimes( File( "output_path_calc_times" ) );
+    Controller::outputViewpointCoords( File( "output_viewpoint_coords" ), BaseClass::viewpoint() );
+    Controller::outputNumImages( File( "output_num_images" ), BaseClass::analysisInterval() );
+    Controller::outputVideoParams( File("output_video_params" ), Controller::outputFilenames(), Controller::focusEntropies(), Controller::focusPathLength(), Controller::cameraPathLength() );
+    return ret;
 }
 
 inline void CameraFocusControlledAdaptorMulti::exec( const BaseClass::SimTime sim_time )
@@ -120,17 +137,19 @@ inline void CameraFocusControlledAdaptorMulti::execRendering()
 
     if ( Controller::isEntStep() && !Controller::isErpStep())
     {
-        // Entropy evaluation
-        for ( const auto& location : BaseClass::viewpoint().locations() )
+        // Entropy evaluation. The culled locations, which are the same on
+        // all of the ranks, are neither rendered nor composited.
+        const auto& candidates = BaseClass::viewpoint().locations();
+        const auto culled = BaseClass::cullLocations( candidates );
+        BaseClass::readback( candidates, culled, [&] ( const size_t i, const FrameBuffer& frame_buffer )
         {
-            // Draw and readback framebuffer
-            auto frame_buffer = BaseClass::readback( location );
+            const auto& location = candidates[i];
 
             // Output framebuffer to image file at the root node
             kvs::Timer timer( kvs::Timer::Start );
             if ( BaseClass::world().isRoot() )
             {
-                const auto entropy = Controller::entropy( frame_buffer );
+                const auto entropy = culled[i] ? 0.0f : Controller::entropy( frame_buffer );
                 entropies.push_back( entropy );
                 frame_buffers.push_back( frame_buffer );
 
@@ -154,7 +173,7 @@ inline void CameraFocusControlledAdaptorMulti::execRendering()
             }
             timer.stop();
             entr_time += m_entr_timer.time( timer );
-        }
+        } );
 
         // Output entropies (entropy heatmap)
         if ( BaseClass::world().isRoot() )
@@ -164,8 +183,7 @@ inline void CameraFocusControlledAdaptorMulti::execRendering()
                 const auto basename = "output_entropies_";
                 const auto timestep = BaseClass::timeStep();
                 const auto directory = BaseClass::outputDirectory();
-                const auto filename = Controller::logDataFilename( basename, timestep, directory );
-                Controller::outputEntropies( filename, entropies );
+                Controller::outputEntropies( basename, timestep, directory, entropies );
             }
         }
 
@@ -221,6 +239,7 @@ inline void CameraFocusControlledAdaptorMulti::execRendering()
             auto estimated_zoom_position = max_position;
             for ( size_t level = 0; level < m_zoom_level; level++ )
             {
+                InSituVis::ProfileScope zoom_scope( "zoom", static_cast<long>( level ) );
                 // Update camera position.
                 timer.start();
                 auto t = static_cast<float>( level ) / static_cast<float>( m_zoom_level );
@@ -360,12 +379,12 @@ inline void CameraFocusControlledAdaptorMulti::execRendering()
         }
     }
 
-    m_entr_timer.stamp( entr_time );
+    BaseClass::stampTime( BaseClass::EntrStage, m_entr_timer, entr_time );
     m_focus_timer.stamp( focus_time );
     m_zoom_timer.stamp( zoom_time );
-    BaseClass::saveTimer().stamp( save_time );
-    BaseClass::rendTimer().stamp( BaseClass::rendTime() );
-    BaseClass::compTimer().stamp( BaseClass::compTime() );
+    BaseClass::stampTime( BaseClass::SaveStage, BaseClass::saveTimer(), save_time );
+    BaseClass::stampTime( BaseClass::RendStage, BaseClass::rendTimer(), BaseClass::rendTime() );
+    BaseClass::stampTime( BaseClass::CompStage, BaseClass::compTimer(), BaseClass::compTime() );
 }
 
 inline void CameraFocusControlledAdaptorMulti::process( const Data& data )
@@ -411,7 +430,7 @@ inline std::string CameraFocusControlledAdaptorMulti::outputFinalImageName( cons
     const auto output_zoom_level = kvs::String::From( level, 6, '0' );
     const auto output_route = kvs::String::From( from_to, 6, '0');
     const auto output_filename = output_basename + "_" + output_time + "_" + output_candidate_num + "_" + output_zoom_level + "_" + output_route;
-    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".bmp";
+    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + BaseClass::imageEncoder().extension();
     return filename;
 }
 
@@ -423,9 +442,8 @@ inline void CameraFocusControlledAdaptorMulti::outputColorImage(
     const size_t from_to )
 {
     const auto size = BaseClass::outputImageSize( location );
-    const auto buffer = frame_buffer.color_buffer;
-    kvs::ColorImage image( size.x(), size.y(), buffer );
-    image.write( this->outputFinalImageName( candidateNum, level, from_to ) );
+    const auto filename = this->outputFinalImageName( candidateNum, level, from_to );
+    BaseClass::writeColorImage( filename, size, frame_buffer.color_buffer );
 }
 
 inline void CameraFocusControlledAdaptorMulti::outputDepthImage(
@@ -436,13 +454,13 @@ inline void CameraFocusControlledAdaptorMulti::outputDepthImage(
     const size_t from_to)
 {
     const auto size = BaseClass::outputImageSize( location );
-    const auto buffer = frame_buffer.depth_buffer;
-    kvs::GrayImage image( size.x(), size.y(), buffer );
-    image.write( this->outputFinalImageName( candidateNum, level, from_to ) );
+    const auto filename = this->outputFinalImageName( candidateNum, level, from_to );
+    BaseClass::writeDepthImage( filename, size, frame_buffer.depth_buffer );
 }
 
 inline std::vector<kvs::Vec3> CameraFocusControlledAdaptorMulti::look_at_in_window( const FrameBuffer& frame_buffer )
 {
+    InSituVis::ProfileScope scope( "focus" );
     const auto w = BaseClass::imageWidth(); // frame buffer width
     const auto h = BaseClass::imageHeight(); // frame buffer height
 //    const auto cw = w / m_frame_divs.x(); // cropped frame buffer width
@@ -550,8 +568,7 @@ inline std::vector<kvs::Vec3> CameraFocusControlledAdaptorMulti::look_at_in_wind
         const auto basename = "output_frame_entropies_";
         const auto timestep = BaseClass::timeStep();
         const auto directory = BaseClass::outputDirectory();
-        const auto filename = Controller::logDataFilename( basename, timestep, directory );
-        Controller::outputFrameEntropies( filename, focus_entropies );
+        Controller::outputFrameEntropies( basename, timestep, directory, focus_entropies );
     }
 
     //return { static_cast<float>( centers.x() ), static_cast<float>( centers.y() ), depthes };
@@ -683,20 +700,10 @@ inline kvs::Quat CameraFocusControlledAdaptorMulti::rotation( const kvs::Vec3& p
 inline void CameraFocusControlledAdaptorMulti::outputZoomEntropies(
     const std::vector<float> zoom_entropies )
 {
-    const auto time = BaseClass::timeStep();
-    const auto output_time = kvs::String::From( time, 6, '0' );
-    const auto output_filename = "output_zoom_entropies" + output_time;
-    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".csv";
-
-    std::ofstream file( filename );
-    {
-        file << "Zoomlevel,Entropy" << std::endl;
-        for ( size_t i = 0; i < zoom_entropies.size(); i++ )
-        {
-            file << i << "," << zoom_entropies[i] << std::endl;
-        }
-    }
-    file.close();
+    const auto basename = "output_zoom_entropies";
+    const auto timestep = BaseClass::timeStep();
+    const auto directory = BaseClass::outputDirectory();
+    Controller::outputZoomEntropies( basename, timestep, directory, zoom_entropies );
 }
 
 
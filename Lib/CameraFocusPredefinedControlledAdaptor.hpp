@@ -65,10 +65,8 @@ inline void CameraFocusPredefinedControlledAdaptor::execRendering()
             if ( m_enable_output_image )
             {
                 const auto size = this->outputImageSize( updated_location );
-                const auto width = size.x();
-                const auto height = size.y();
-                kvs::ColorImage image( width, height, color_buffer );
-                image.write( this->outputFinalImageName( 10 ) );
+                const auto filename = this->outputFinalImageName( 10 );
+                BaseClass::writeColorImage( filename, size, color_buffer );
             }
             timer_save.stop();
             save_time += m_save_timer.time( timer_save );
@@ -96,10 +94,8 @@ inline void CameraFocusPredefinedControlledAdaptor::execRendering()
                     if ( m_enable_output_image )
                     {
                         const auto size = this->outputImageSize( updated_location );
-                        const auto width = size.x();
-                        const auto height = size.y();
-                        kvs::ColorImage image( width, height, color_buffer );
-                        image.write( this->outputFinalImageName( i+1 ) );
+                        const auto filename = this->outputFinalImageName( i+1 );
+                        BaseClass::writeColorImage( filename, size, color_buffer );
                     }
                     this->focusPath().pop();
                     std::cout << "path size :" << focusPath().size() << std::endl;
@@ -107,8 +103,8 @@ inline void CameraFocusPredefinedControlledAdaptor::execRendering()
             }
         }
     }
-    m_rend_timer.stamp( rend_time );
-    m_save_timer.stamp( save_time );
+    BaseClass::stampTime( BaseClass::RendStage, m_rend_timer, rend_time );
+    BaseClass::stampTime( BaseClass::SaveStage, m_save_timer, save_time );
 }
 
 inline std::string CameraFocusPredefinedControlledAdaptor::outputFinalImageName( const size_t level )
@@ -118,7 +114,7 @@ inline std::string CameraFocusPredefinedControlledAdaptor::outputFinalImageName(
     const auto output_basename = BaseClass::outputFilename();
     const auto output_zoom_level = kvs::String::From( level, 6, '0' );
     const auto output_filename = output_basename + "_" + output_time + "_" + output_zoom_level;
-    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".bmp";
+    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + BaseClass::imageEncoder().extension();
     return filename;
 }
 
@@ -837,7 +837,7 @@ inline std::string CameraFocusPredefinedControlledAdaptorMulti::outputFinalImage
     const auto output_filename =
         output_basename + "_" + output_time + "_" + output_level + "_cand" + output_cand;
 
-    return BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".bmp";
+    return BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + BaseClass::imageEncoder().extension();
 }
 
 
@@ -848,10 +848,10 @@ inline std::string CameraFocusPredefinedControlledAdaptorMulti::outputInterpImag
     char buf[512];
     std::snprintf(
         buf, sizeof(buf),
-        "extrema_%06zu_000000_pairP%06zu_C%06zu_s%06zu.bmp",
+        "extrema_%06zu_000000_pairP%06zu_C%06zu_s%06zu",
         (size_t)time, prev_id, curr_id, s_id );
 
-    return BaseClass::outputDirectory().baseDirectoryName() + "/" +  std::string(buf);
+    return BaseClass::outputDirectory().baseDirectoryName() + "/" +  std::string(buf) + BaseClass::imageEncoder().extension();
 }
 
 
@@ -1038,10 +1038,8 @@ inline void CameraFocusPredefinedControlledAdaptorMulti::execRendering()
                                 if (m_enable_output_image)
                                 {
                                     const auto size = this->outputImageSize(updated);
-                                    kvs::ColorImage image(size.x(), size.y(), color);
-
                                     // ★補間専用の命名（prev id, curr id, s）
-                                    image.write(this->outputInterpImageName(pid, cid, s));
+                                    BaseClass::writeColorImage(this->outputInterpImageName(pid, cid, s), size, color);
                                 }
                                 ts.stop();
                                 save_time += m_save_timer.time(ts);
@@ -1084,10 +1082,8 @@ inline void CameraFocusPredefinedControlledAdaptorMulti::execRendering()
                     if (m_enable_output_image)
                     {
                         const auto size = this->outputImageSize(updated);
-                        kvs::ColorImage image(size.x(), size.y(), color);
-
                         // 通常は従来命名（level=1, cid）
-                        image.write(this->outputFinalImageName(1, cid));
+                        BaseClass::writeColorImage(this->outputFinalImageName(1, cid), size, color);
                     }
                     ts.stop();
                     save_time += m_save_timer.time(ts);
@@ -1135,8 +1131,7 @@ inline void CameraFocusPredefinedControlledAdaptorMulti::execRendering()
                 if (m_enable_output_image)
                 {
                     const auto size = this->outputImageSize(updated);
-                    kvs::ColorImage image(size.x(), size.y(), color);
-                    image.write(this->outputFinalImageName(1, 0));
+                    BaseClass::writeColorImage(this->outputFinalImageName(1, 0), size, color);
                 }
                 ts.stop();
                 save_time += m_save_timer.time(ts);
@@ -1168,16 +1163,15 @@ inline void CameraFocusPredefinedControlledAdaptorMulti::execRendering()
             if (m_enable_output_image)
             {
                 const auto size = this->outputImageSize(updated);
-                kvs::ColorImage image(size.x(), size.y(), fb.color_buffer);
-                image.write(this->outputFinalImageName(1, 0));
+                BaseClass::writeColorImage(this->outputFinalImageName(1, 0), size, fb.color_buffer);
             }
             ts.stop();
             save_time += m_save_timer.time(ts);
         }
     }
 
-    m_rend_timer.stamp(rend_time);
-    m_save_timer.stamp(save_time);
+    BaseClass::stampTime(BaseClass::RendStage, m_rend_timer, rend_time);
+    BaseClass::stampTime(BaseClass::SaveStage, m_save_timer, save_time);
 }
 
 // =============================================================
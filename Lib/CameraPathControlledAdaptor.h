@@ -26,8 +26,18 @@ public:
     using Location = Viewpoint::Location;
 
 private:
+    struct PathFrame
+    {
+        kvs::UInt32 time_step; ///< time step of the data
+        size_t sub_time_index; ///< index of the frame in the time step
+        Location location; ///< camera location on the path
+    };
+
     kvs::StampTimer m_entr_timer{}; ///< timer for entropy evaluation
+    InSituVis::StreamingSink m_log_sink{}; ///< sink for the log files of the timers
     size_t m_final_time_step = 0;
+    Data m_path_data{}; ///< data of the queued path frames
+    std::vector<PathFrame> m_path_frames{}; ///< path frames queued for parallel rendering
 
 public:
     CameraPathControlledAdaptor() = default;
@@ -37,6 +47,7 @@ public:
 
     void exec( const BaseClass::SimTime sim_time = {} ) override;
     bool dump() override;
+    bool isAnalysisIntervalAdjustable() const override { return false; }
     void setFinalTimeStep( const size_t step ) { m_final_time_step = step; }
 
 protected:
@@ -47,14 +58,22 @@ protected:
         const Viewpoint::Direction dir = Viewpoint::Uni );
 
     void execRendering() override;
+    bool streamLogs() override;
+    bool writeLogs( const bool final );
     void process( const Data& data ) override;
     void process( const Data& data , const float radius, const kvs::Quat& rotation ) override;
 
     std::string outputColorImageName( const Viewpoint::Location& location );
+    std::string outputColorImageName( const Viewpoint::Location& location, const size_t sub_time );
     std::string outputDepthImageName( const Viewpoint::Location& location );
+    std::string outputStreamName( const std::string& filename ) const override;
 
     void outputColorImage( const Viewpoint::Location& location, const FrameBuffer& frame_buffer );
+    void outputColorImage( const Viewpoint::Location& location, const size_t sub_time, const FrameBuffer& frame_buffer );
     void outputDepthImage( const Viewpoint::Location& location, const FrameBuffer& frame_buffer );
+
+private:
+    void render_path_frames();
 };
 
 } // end of namespace InSituVis
@@ -30,29 +30,53 @@ CameraPathControlledAdaptor::erpLocation(
 
 inline bool CameraPathControlledAdaptor::dump()
 {
-    bool ret = true;
-    if ( m_entr_timer.title().empty() ) { m_entr_timer.setTitle( "Ent time" ); }
-    kvs::StampTimerList entr_timer_list;
-    entr_timer_list.push( m_entr_timer );
+    // The logs are written after the steps in the visualization thread.
+    BaseClass::waitForVisualization();
+    const bool ret = this->writeLogs( true );
+    return BaseClass::dump() && ret;
+}
 
-    const auto basedir = BaseClass::outputDirectory().baseDirectoryName() + "/";
-    ret = entr_timer_list.write( basedir + "ent_proc_time.csv" );
+inline bool CameraPathControlledAdaptor::streamLogs()
+{
+    const bool ret = this->writeLogs( false );
+    return BaseClass::streamLogs() && ret;
+}
 
+inline bool CameraPathControlledAdaptor::writeLogs( const bool final )
+{
+    // The records are flushed into the files every streaming interval in
+    // streaming mode, and the remaining records are written at dump.
+    const auto interval = BaseClass::streamingInterval();
     const auto directory = BaseClass::outputDirectory();
+
+    bool ret = true;
+    const auto basedir = directory.baseDirectoryName() + "/";
+    if ( m_entr_timer.title().empty() ) { m_entr_timer.setTitle( "Ent time" ); }
+    ret = m_log_sink.write( basedir + "ent_proc_time.csv", { &m_entr_timer }, interval, final ) && ret;
+
     const auto File = [&]( const std::string& name ) { return Controller::logDataFilename( name, directory ); };
+    if ( !final )
+    {
+        Controller::flushLogs( directory, BaseClass::analysisInterval(), interval );
+        return ret;
+    }
+
     Controller::outputPathCalcTimes( File( "output_path_calc_times" ) );
     Controller::outputViewpointCoords( File( "output_viewpoint_coords" ), BaseClass::viewpoint() );
     Controller::outputNumImages( File( "output_num_images" ), BaseClass::analysisInterval() );
-
-    return BaseClass::dump() && ret;
+    return ret;
 }
 
 inline void CameraPathControlledAdaptor::exec( const BaseClass::SimTime sim_time )
 {
+    // In async mode, the step is executed in the visualization thread.
+    if ( BaseClass::execAsync( sim_time ) ) { return; }
+
     Controller::setCacheEnabled( BaseClass::isAnalysisStep() );
     Controller::setIsEntStep( this->isEntropyStep() );
     Controller::updateCacheSize();
     Controller::push( BaseClass::objects() );
+    this->render_path_frames();
 
     BaseClass::incrementTimeStep();
     if( this->isFinalTimeStep())
@@ -60,6 +84,7 @@ inline void CameraPathControlledAdaptor::exec( const BaseClass::SimTime sim_time
         Controller::setIsFinalStep( true );
         const auto dummy = Data();
         Controller::push( dummy );
+        this->render_path_frames();
     }
     BaseClass::clearObjects();
 }
@@ -78,20 +103,28 @@ inline void CameraPathControlledAdaptor::execRendering()
 
     if ( Controller::isEntStep() && !Controller::isErpStep() )
     {
+        // Draw and readback framebuffers (in parallel if enabled)
+        // at the evaluation image size.
+        const auto& locations = BaseClass::viewpoint().locations();
+        kvs::Timer timer_rend( kvs::Timer::Start );
+        // The locations from which the object cannot be seen are culled
+        // without rendering, and their entropies are zero.
+        BaseClass::beginEvaluation();
+        const auto culled = BaseClass::cullLocations( locations );
+        frame_buffers = BaseClass::readbackFrameBuffers( locations, culled );
+        timer_rend.stop();
+        rend_time += BaseClass::rendTimer().time( timer_rend );
+
         // Entropy evaluation
-        for ( const auto& location : BaseClass::viewpoint().locations() )
+        for ( size_t i = 0; i < locations.size(); i++ )
         {
-            // Draw and readback framebuffer
-            kvs::Timer timer_rend( kvs::Timer::Start );
-            auto frame_buffer = BaseClass::readbackFrameBuffer( location );
-            timer_rend.stop();
-            rend_time += BaseClass::rendTimer().time( timer_rend );
+            const auto& location = locations[i];
+            const auto& frame_buffer = frame_buffers[i];
 
             // Output framebuffer to image file at the root node
             kvs::Timer timer( kvs::Timer::Start );
-            const auto entropy = Controller::entropy( frame_buffer );
+            const auto entropy = culled[i] ? 0.0f : Controller::entropy( frame_buffer );
             entropies.push_back( entropy );
-            frame_buffers.push_back( frame_buffer );
 
             if ( entropy > max_entropy )
             {
@@ -119,8 +152,7 @@ inline void CameraPathControlledAdaptor::execRendering()
             const auto basename = "output_entropies_";
             const auto timestep = BaseClass::timeStep();
             const auto directory = BaseClass::outputDirectory();
-            const auto filename = Controller::logDataFilename( basename, timestep, directory );
-            Controller::outputEntropies( filename, entropies );
+            Controller::outputEntropies( basename, timestep, directory, entropies );
         }
 
         // Distribute the index indicates the max entropy image
@@ -132,6 +164,37 @@ inline void CameraPathControlledAdaptor::execRendering()
         Controller::setMaxRotation( max_rotation );
         Controller::setMaxEntropy( max_entropy );
 
+        // Render the selected viewpoint at the output image size.
+        BaseClass::endEvaluation();
+        if ( BaseClass::isEvaluationImageScaled() )
+        {
+            timer_rend.start();
+            if ( BaseClass::isEvaluationCheckEnabled() )
+            {
+                // Evaluate all of the viewpoints at full resolution as well.
+                auto full_frame_buffers = BaseClass::readbackFrameBuffers( locations, culled );
+                float full_max_entropy = -1.0f;
+                int full_max_index = 0;
+                for ( size_t i = 0; i < locations.size(); i++ )
+                {
+                    const auto entropy = culled[i] ? 0.0f : Controller::entropy( full_frame_buffers[i] );
+                    if ( entropy > full_max_entropy )
+                    {
+                        full_max_entropy = entropy;
+                        full_max_index = locations[i].index;
+                    }
+                }
+                BaseClass::stampEvaluationCheck( max_index, full_max_index );
+                frame_buffers = full_frame_buffers;
+            }
+            else if ( BaseClass::isOutputImageEnabled() )
+            {
+                frame_buffers[ max_index ] = BaseClass::readbackFrameBuffer( max_location );
+            }
+            timer_rend.stop();
+            rend_time += BaseClass::rendTimer().time( timer_rend );
+        }
+
         // Output the rendering images and the heatmap of entropies.
         kvs::Timer timer( kvs::Timer::Start );
         if ( BaseClass::isOutputImageEnabled() )
@@ -144,7 +207,7 @@ inline void CameraPathControlledAdaptor::execRendering()
         }
         timer.stop();
         save_time += BaseClass::saveTimer().time( timer );
-        m_entr_timer.stamp( entr_time );
+        BaseClass::stampTime( BaseClass::EntrStage, m_entr_timer, entr_time );
     }
     else
     {
@@ -165,8 +228,8 @@ inline void CameraPathControlledAdaptor::execRendering()
         save_time += BaseClass::saveTimer().time( timer );
     }
 
-    BaseClass::saveTimer().stamp( save_time );
-    BaseClass::rendTimer().stamp( rend_time );
+    BaseClass::stampTime( BaseClass::SaveStage, BaseClass::saveTimer(), save_time );
+    BaseClass::stampTime( BaseClass::RendStage, BaseClass::rendTimer(), rend_time );
 }
 
 inline void CameraPathControlledAdaptor::process( const Data& data )
@@ -190,16 +253,78 @@ inline void CameraPathControlledAdaptor::process( const Data& data, const float
     // Execute vis. pipeline and rendering.
     Controller::setErpRotation( rotation );
     Controller::setErpRadius( radius );
+    if ( BaseClass::numberOfRenderingThreads() > 0 && Controller::isErpStep() )
+    {
+        // The frames along the path are queued while the data is the same,
+        // and rendered at once on the rendering threads.
+        if ( !m_path_frames.empty() && data != m_path_data ) { this->render_path_frames(); }
+        m_path_data = data;
+        m_path_frames.push_back( { static_cast<kvs::UInt32>( step ), Controller::subTimeIndex(), this->erpLocation() } );
+        BaseClass::setTimeStep( current_step );
+        return;
+    }
     BaseClass::execPipeline( data );
     this->execRendering();
 
     BaseClass::setTimeStep( current_step );
 }
 
+inline void CameraPathControlledAdaptor::render_path_frames()
+{
+    if ( m_path_frames.empty() ) { return; }
+
+    // The objects are mapped once for the queued frames, so the pipeline
+    // time is stamped to the first frame. The rendering time of the frames
+    // rendered in parallel is divided equally among them.
+    const auto current_step = BaseClass::timeStep();
+    const auto nframes = m_path_frames.size();
+    BaseClass::setTimeStep( m_path_frames.front().time_step );
+    BaseClass::execPipeline( m_path_data );
+    for ( size_t i = 1; i < nframes; i++ ) { BaseClass::stampTime( BaseClass::PipeStage, BaseClass::pipeTimer(), 0.0f ); }
+
+    Viewpoint::Locations locations;
+    for ( const auto& frame : m_path_frames ) { locations.push_back( frame.location ); }
+    kvs::Timer timer_rend( kvs::Timer::Start );
+    const auto frame_buffers = BaseClass::readbackFrameBuffers( locations );
+    timer_rend.stop();
+    const auto rend_time = BaseClass::rendTimer().time( timer_rend ) / nframes;
+
+    for ( size_t i = 0; i < nframes; i++ )
+    {
+        const auto& frame = m_path_frames[i];
+        kvs::Timer timer( kvs::Timer::Start );
+        if ( BaseClass::isOutputImageEnabled() )
+        {
+            BaseClass::setTimeStep( frame.time_step );
+            this->outputColorImage( frame.location, frame.sub_time_index, frame_buffers[i] );
+        }
+        timer.stop();
+        BaseClass::stampTime( BaseClass::SaveStage, BaseClass::saveTimer(), BaseClass::saveTimer().time( timer ) );
+        BaseClass::stampTime( BaseClass::RendStage, BaseClass::rendTimer(), rend_time );
+    }
+
+    m_path_frames.clear();
+    m_path_data = Data();
+    BaseClass::setTimeStep( current_step );
+}
+
+inline std::string CameraPathControlledAdaptor::outputStreamName( const std::string& filename ) const
+{
+    // The interpolated frames along the camera path make a stream, so the
+    // time step and the sub-time index are removed from the name.
+    return InSituVis::StreamEncoder::StreamName( filename, 2 );
+}
+
 inline std::string CameraPathControlledAdaptor::outputColorImageName( const Viewpoint::Location& location )
+{
+    return this->outputColorImageName( location, Controller::subTimeIndex() );
+}
+
+inline std::string CameraPathControlledAdaptor::outputColorImageName(
+    const Viewpoint::Location& location,
+    const size_t sub_time )
 {
     const auto time = BaseClass::timeStep();
-    const auto sub_time = Controller::subTimeIndex();
     const auto space = location.index;
     const auto output_time = kvs::String::From( time, 6, '0' );
     const auto output_sub_time = kvs::String::From( sub_time, 6, '0' );
@@ -207,9 +332,7 @@ inline std::string CameraPathControlledAdaptor::outputColorImageName( const View
 
     const auto output_basename = BaseClass::outputFilename();
     const auto output_filename = output_basename + "_" + output_time + "_" + output_sub_time+ "_" + output_space;
-    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".bmp";
-    // const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".jpg";
-    // const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".png";
+    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + BaseClass::imageEncoder().extension();
     return filename;
 }
 
@@ -222,18 +345,25 @@ inline std::string CameraPathControlledAdaptor::outputDepthImageName( const View
 
     const auto output_basename = BaseClass::outputFilename();
     const auto output_filename = output_basename + "_depth_" + output_time + "_" + output_space;
-    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".bmp";
+    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + BaseClass::imageEncoder().extension();
     return filename;
 }
 
 inline void CameraPathControlledAdaptor::outputColorImage(
     const InSituVis::Viewpoint::Location& location,
     const FrameBuffer& frame_buffer )
+{
+    this->outputColorImage( location, Controller::subTimeIndex(), frame_buffer );
+}
+
+inline void CameraPathControlledAdaptor::outputColorImage(
+    const InSituVis::Viewpoint::Location& location,
+    const size_t sub_time,
+    const FrameBuffer& frame_buffer )
 {
     const auto size = BaseClass::outputImageSize( location );
-    const auto buffer = frame_buffer.color_buffer;
-    kvs::ColorImage image( size.x(), size.y(), buffer );
-    image.write( this->outputColorImageName( location ) );
+    const auto filename = this->outputColorImageName( location, sub_time );
+    BaseClass::writeColorImage( filename, size, frame_buffer.color_buffer );
 }
 
 inline void CameraPathControlledAdaptor::outputDepthImage(
@@ -241,9 +371,8 @@ inline void CameraPathControlledAdaptor::outputDepthImage(
     const FrameBuffer& frame_buffer )
 {
     const auto size = BaseClass::outputImageSize( location );
-    const auto buffer = frame_buffer.depth_buffer;
-    kvs::GrayImage image( size.x(), size.y(), buffer );
-    image.write( this->outputDepthImageName( location ) );
+    const auto filename = this->outputDepthImageName( location );
+    BaseClass::writeDepthImage( filename, size, frame_buffer.depth_buffer );
 }
 
 } // end of namespace InSituVis
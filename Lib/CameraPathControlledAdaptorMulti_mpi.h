@@ -34,6 +34,7 @@ private:
     kvs::mpi::StampTimer m_entr_timer{ BaseClass::world() }; ///< timer for entropy evaluation
     kvs::mpi::StampTimer m_focus_timer{ BaseClass::world() }; ///< timer for entropy evaluation
     kvs::mpi::StampTimer m_zoom_timer{ BaseClass::world() }; ///< timer for entropy evaluation
+    InSituVis::StreamingSink m_log_sink{}; ///< sink for the log files of the timers
     size_t m_final_time_step = 0;
     size_t m_zoom_level = 1; ///< zoom level
     int m_route_num;
@@ -62,6 +63,8 @@ public:
     void setViewDim( const kvs::Vec3ui& viewDim ){ m_viewDim = viewDim; }
 
     void exec( const BaseClass::SimTime sim_time = {} ) override;
+    bool isAsyncExecutionSupported() const override { return false; }
+    bool isAnalysisIntervalAdjustable() const override { return false; }
     bool dump() override;
 
     // backward compatibility
@@ -80,6 +83,8 @@ protected:
         const kvs::Vec3 focus );
 
     void execRendering() override;
+    bool streamLogs() override;
+    bool writeLogs( const bool final );
     void process( const Data& data ) override;
     void process( const Data& data, const float radius, const kvs::Quaternion& rotation, const kvs::Vec3& focus, const int route_num ) override;
 
@@ -79,44 +79,60 @@ CameraPathControlledAdaptorMulti::focusedLocation(
  * ========================= */
 inline bool CameraPathControlledAdaptorMulti::dump()
 {
-    bool ret = true;
-    bool ret_f = true;
-    bool ret_z = true;
+    const bool ret = this->writeLogs( true );
+    return BaseClass::dump() && ret;
+}
 
-    if ( BaseClass::world().isRoot() )
+inline bool CameraPathControlledAdaptorMulti::streamLogs()
+{
+    const bool ret = this->writeLogs( false );
+    return BaseClass::streamLogs() && ret;
+}
+
+inline bool CameraPathControlledAdaptorMulti::writeLogs( const bool final )
+{
+    // The records are flushed into the files every streaming interval in
+    // streaming mode, and the remaining records are written at dump.
+    const auto interval = BaseClass::streamingInterval();
+    const auto directory = BaseClass::outputDirectory();
+    if ( !BaseClass::world().isRoot() )
     {
-        if ( m_entr_timer.title().empty() ) { m_entr_timer.setTitle( "Ent time" ); }
-        kvs::StampTimerList entr_timer_list;
-        entr_timer_list.push( m_entr_timer );
-
-        const auto basedir = BaseClass::outputDirectory().baseDirectoryName() + "/";
-        ret = entr_timer_list.write( basedir + "ent_proc_time.csv" );
-
-        if ( m_focus_timer.title().empty() ) { m_focus_timer.setTitle( "focus time" ); }
-        kvs::StampTimerList f_timer_list;
-        f_timer_list.push( m_focus_timer );
-        ret_f = f_timer_list.write( basedir + "focus_proc_time.csv" );
-
-        if ( m_zoom_timer.title().empty() ) { m_zoom_timer.setTitle( "zoom time" ); }
-        kvs::StampTimerList z_timer_list;
-        z_timer_list.push( m_zoom_timer );
-        ret_z = z_timer_list.write( basedir + "zoom_proc_time.csv" );
-
-        const auto directory = BaseClass::outputDirectory();
-        const auto File = [&]( const std::string& name ) { return Controller::logDataFilename( name, directory ); };
-        Controller::outputPathCalcTimes( File( "output_path_calc_times" ) );
-        Controller::outputViewpointCoords( File( "output_viewpoint_coords" ), BaseClass::viewpoint() );
-        Controller::outputNumImages( File( "output_num_images" ), BaseClass::analysisInterval() );
-        Controller::outputVideoParams(
-            File("output_video_params" ),
-            Controller::outputFilenames(),
-            Controller::focusEntropies(),
-            Controller::focusPathLength(),
-            Controller::cameraPathLength()
-        );
+        // Only the root writes the logs, so the records are discarded.
+        if ( final ) { return true; }
+        if ( m_entr_timer.numberOfStamps() >= interval ) { InSituVis::StreamingSink::Erase( m_entr_timer, interval ); }
+        if ( m_focus_timer.numberOfStamps() >= interval ) { InSituVis::StreamingSink::Erase( m_focus_timer, interval ); }
+        if ( m_zoom_timer.numberOfStamps() >= interval ) { InSituVis::StreamingSink::Erase( m_zoom_timer, interval ); }
+        Controller::flushLogs( directory, BaseClass::analysisInterval(), interval, false );
+        return true;
     }
 
-    return BaseClass::dump() && ret && ret_f && ret_z;
+    bool ret = true;
+    const auto basedir = directory.baseDirectoryName() + "/";
+    if ( m_entr_timer.title().empty() ) { m_entr_timer.setTitle( "Ent time" ); }
+    ret = m_log_sink.write( basedir + "ent_proc_time.csv", { &m_entr_timer }, interval, final ) && ret;
+    if ( m_focus_timer.title().empty() ) { m_focus_timer.setTitle( "focus time" ); }
+    ret = m_log_sink.write( basedir + "focus_proc_time.csv", { &m_focus_timer }, interval, final ) && ret;
+    if ( m_zoom_timer.title().empty() ) { m_zoom_timer.setTitle( "zoom time" ); }
+    ret = m_log_sink.write( basedir + "zoom_proc_time.csv", { &m_zoom_timer }, interval, final ) && ret;
+
+    const auto File = [&]( const std::string& name ) { return Controller::logDataFilename( name, directory ); };
+    if ( !final )
+    {
+        Controller::flushLogs( directory, BaseClass::analysisInterval(), interval );
+        return ret;
+    }
+
+    Controller::outputPathCalcTimes( File( "output_path_calc_times" ) );
+    Controller::outputViewpointCoords( File( "output_viewpoint_coords" ), BaseClass::viewpoint() );
+    Controller::outputNumImages( File( "output_num_images" ), BaseClass::analysisInterval() );
+    Controller::outputVideoParams(
+        File("output_video_params" ),
+        Controller::outputFilenames(),
+        Controller::focusEntropies(),
+        Controller::focusPathLength(),
+        Controller::cameraPathLength()
+    );
+    return ret;
 }
 
 inline void CameraPathControlledAdaptorMulti::exec( const BaseClass::SimTime sim_time )
@@ -237,14 +253,20 @@ inline void CameraPathControlledAdaptorMulti::execRendering()
     {
         std::vector<int> maximal_indices(viewPointCandidateNum(), 0);
 
-        for ( const auto& location : BaseClass::viewpoint().locations() )
+        // Evaluate the viewpoints at the evaluation image size. The culled
+        // locations, which are the same on all of the ranks, are neither
+        // rendered nor composited.
+        BaseClass::beginEvaluation();
+        const auto& candidates = BaseClass::viewpoint().locations();
+        const auto culled = BaseClass::cullLocations( candidates );
+        BaseClass::readback( candidates, culled, [&] ( const size_t i, const FrameBuffer& frame_buffer )
         {
-            auto frame_buffer = BaseClass::readback( location );
+            const auto& location = candidates[i];
 
             kvs::Timer timer( kvs::Timer::Start );
             if ( BaseClass::world().isRoot() )
             {
-                const auto e = Controller::entropy( frame_buffer );
+                const auto e = culled[i] ? 0.0f : Controller::entropy( frame_buffer );
                 entropies.push_back( e );
                 frame_buffers.push_back( frame_buffer );
 
@@ -256,7 +278,7 @@ inline void CameraPathControlledAdaptorMulti::execRendering()
             }
             timer.stop();
             entr_time += m_entr_timer.time( timer );
-        }
+        } );
 
         if ( BaseClass::world().isRoot() )
         {
@@ -272,6 +294,24 @@ inline void CameraPathControlledAdaptorMulti::execRendering()
             BaseClass::world().broadcast(0, maximal_indices[i]);
         }
 
+        // Evaluate all of the viewpoints at full resolution as well.
+        if ( BaseClass::isEvaluationImageScaled() && BaseClass::isEvaluationCheckEnabled() )
+        {
+            BaseClass::endEvaluation();
+            std::vector<float> full_entropies;
+            BaseClass::readback( candidates, culled, [&] ( const size_t i, const FrameBuffer& frame_buffer )
+            {
+                if ( !BaseClass::world().isRoot() ) { return; }
+                full_entropies.push_back( culled[i] ? 0.0f : Controller::entropy( frame_buffer ) );
+            } );
+
+            if ( BaseClass::world().isRoot() && !maximal_indices.empty() )
+            {
+                const auto full_indices = this->getMaximalLocations( BaseClass::viewpoint().locations(), full_entropies );
+                if ( !full_indices.empty() ) { BaseClass::stampEvaluationCheck( maximal_indices[0], full_indices[0] ); }
+            }
+        }
+
         // ========= For each selected viewpoint candidate =========
         for ( size_t vp_i = 0; vp_i < viewPointCandidateNum(); vp_i++ )
         {
@@ -283,6 +323,8 @@ inline void CameraPathControlledAdaptorMulti::execRendering()
             Controller::setMaxIndex( maximal_indices[vp_i] );
             Controller::setMaxEntropy( max_entropy );
 
+            // The focus points are estimated from the evaluation images.
+            BaseClass::beginEvaluation();
             std::vector<kvs::Vec3> at( focusPointCandidateNum() );
             kvs::Timer timer( kvs::Timer::Start );
 
@@ -326,8 +368,14 @@ inline void CameraPathControlledAdaptorMulti::execRendering()
                 int   estimated_zoom_level = 0;
                 kvs::Vec3 estimated_zoom_position = maximal_position;
 
+                // The zoom levels are evaluated at the evaluation image size
+                // only for the auto zooming.
+                if ( Controller::isAutoZoomingEnabled() ) { BaseClass::beginEvaluation(); }
+                else { BaseClass::endEvaluation(); }
+
                 for ( size_t level = 0; level < m_zoom_level; level++ )
                 {
+                    InSituVis::ProfileScope zoom_scope( "zoom", static_cast<long>( level ) );
                     timer.start();
                     const float t = static_cast<float>(level) / static_cast<float>(m_zoom_level);
                     locations[fp_j].position = (1 - t) * maximal_position + t * at[fp_j];
@@ -380,6 +428,19 @@ inline void CameraPathControlledAdaptorMulti::execRendering()
                     Controller::pushCandPositions( estimated_zoom_position );
                     Controller::pushCandRotations( this->rotation( estimated_zoom_position ) );
 
+                    // Render the selected zoom level at the output image size
+                    // (image composition with all of the ranks).
+                    FrameBuffer full_frame_buffer;
+                    if ( BaseClass::isEvaluationImageScaled() && BaseClass::isOutputImageEnabled() )
+                    {
+                        auto zoom_location = locations[fp_j];
+                        zoom_location.position = estimated_zoom_position;
+                        zoom_location.rotation = this->rotation( estimated_zoom_position );
+                        zoom_location.up_vector = kvs::Quat::Rotate( kvs::Vec3( {0.0f, 0.0f, -1.0f} ), zoom_location.rotation );
+                        BaseClass::endEvaluation();
+                        full_frame_buffer = BaseClass::readback( zoom_location );
+                    }
+
                     if ( BaseClass::world().isRoot() )
                     {
                         if ( BaseClass::isOutputImageEnabled() )
@@ -390,7 +451,8 @@ inline void CameraPathControlledAdaptorMulti::execRendering()
                             locations[fp_j].rotation = this->rotation( estimated_zoom_position );
                             locations[fp_j].up_vector = kvs::Quat::Rotate( kvs::Vec3( {0.0f, 0.0f, -1.0f} ), locations[fp_j].rotation );
                             const size_t level = static_cast<size_t>(estimated_zoom_level);
-                            const auto frame_buffer = zoom_frame_buffers[ level ];
+                            const auto frame_buffer = BaseClass::isEvaluationImageScaled() ?
+                                full_frame_buffer : zoom_frame_buffers[ level ];
 
                             Controller::pushOutputFilenames( outputFinalImageName(location, fp_j, level, 0) );
 
@@ -406,6 +468,7 @@ inline void CameraPathControlledAdaptorMulti::execRendering()
                 }
             }
         }
+        BaseClass::endEvaluation();
     }
     else
     {
@@ -480,12 +543,12 @@ inline void CameraPathControlledAdaptorMulti::execRendering()
     }
 
     // timers
-    m_entr_timer.stamp( entr_time );
+    BaseClass::stampTime( BaseClass::EntrStage, m_entr_timer, entr_time );
     m_focus_timer.stamp( focus_time );
     m_zoom_timer.stamp( zoom_time );
-    BaseClass::saveTimer().stamp( save_time );
-    BaseClass::rendTimer().stamp( BaseClass::rendTime() );
-    BaseClass::compTimer().stamp( BaseClass::compTime() );
+    BaseClass::stampTime( BaseClass::SaveStage, BaseClass::saveTimer(), save_time );
+    BaseClass::stampTime( BaseClass::RendStage, BaseClass::rendTimer(), BaseClass::rendTime() );
+    BaseClass::stampTime( BaseClass::CompStage, BaseClass::compTimer(), BaseClass::compTime() );
 }
 
 /* =========================
@@ -553,7 +616,7 @@ inline std::string CameraPathControlledAdaptorMulti::outputFinalImageName(
         output_basename + "_" + output_time + "_" + output_candidate + "_" +
         output_zoom_level + "_" + output_route + "_" + output_space;
 
-    return BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".bmp";
+    return BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + BaseClass::imageEncoder().extension();
 }
 
 inline void CameraPathControlledAdaptorMulti::outputColorImage(
@@ -564,9 +627,8 @@ inline void CameraPathControlledAdaptorMulti::outputColorImage(
     const size_t from_to )
 {
     const auto size = BaseClass::outputImageSize( location );
-    const auto buffer = frame_buffer.color_buffer;
-    kvs::ColorImage image( size.x(), size.y(), buffer );
-    image.write( this->outputFinalImageName( location, candidateNum, level, from_to ) );
+    const auto filename = this->outputFinalImageName( location, candidateNum, level, from_to );
+    BaseClass::writeColorImage( filename, size, frame_buffer.color_buffer );
 }
 
 inline void CameraPathControlledAdaptorMulti::outputDepthImage(
@@ -577,9 +639,8 @@ inline void CameraPathControlledAdaptorMulti::outputDepthImage(
     const size_t from_to )
 {
     const auto size = BaseClass::outputImageSize( location );
-    const auto buffer = frame_buffer.depth_buffer;
-    kvs::GrayImage image( size.x(), size.y(), buffer );
-    image.write( this->outputFinalImageName( location, candidateNum, level, from_to ) );
+    const auto filename = this->outputFinalImageName( location, candidateNum, level, from_to );
+    BaseClass::writeDepthImage( filename, size, frame_buffer.depth_buffer );
 }
 
 /* =========================
@@ -588,8 +649,8 @@ inline void CameraPathControlledAdaptorMulti::outputDepthImage(
 inline std::vector<kvs::Vec3>
 CameraPathControlledAdaptorMulti::look_at_in_window( const BaseClass::FrameBuffer& frame_buffer )
 {
-    const auto w = BaseClass::imageWidth();
-    const auto h = BaseClass::imageHeight();
+    const auto w = static_cast<size_t>( BaseClass::screen().width() );
+    const auto h = static_cast<size_t>( BaseClass::screen().height() );
     const auto cw = w / m_frame_divs.x() + 1;
     const auto ch = h / m_frame_divs.y() + 1;
 
@@ -716,8 +777,8 @@ CameraPathControlledAdaptorMulti::crop_frame_buffer(
     KVS_ASSERT( indices[0] < static_cast<int>( m_frame_divs[0] ) );
     KVS_ASSERT( indices[1] < static_cast<int>( m_frame_divs[1] ) );
 
-    const auto w  = BaseClass::imageWidth();
-    const auto h  = BaseClass::imageHeight();
+    const auto w  = static_cast<size_t>( BaseClass::screen().width() );
+    const auto h  = static_cast<size_t>( BaseClass::screen().height() );
     const auto cw = w / m_frame_divs.x() + 1;
     const auto ch = h / m_frame_divs.y() + 1;
     const auto ow = cw * indices[0];
@@ -730,8 +791,8 @@ CameraPathControlledAdaptorMulti::crop_frame_buffer(
     const auto ah = ( h >= hh ) ? ch : ch - ( hh - h );
 
     FrameBuffer cropped;
-    cropped.color_buffer.allocate( aw * ah * 4 );
-    cropped.depth_buffer.allocate( aw * ah );
+    cropped.color_buffer = BaseClass::frameBufferPool().colorBuffer( aw * ah * 4 );
+    cropped.depth_buffer = BaseClass::frameBufferPool().depthBuffer( aw * ah );
 
     auto* dst_c = cropped.color_buffer.data();
     auto* dst_d = cropped.depth_buffer.data();
@@ -797,18 +858,10 @@ inline kvs::Quat CameraPathControlledAdaptorMulti::rotation( const kvs::Vec3& po
 inline void CameraPathControlledAdaptorMulti::outputZoomEntropies(
     const std::vector<float> zoom_entropies )
 {
-    const auto time = BaseClass::timeStep();
-    const auto output_time = kvs::String::From( time, 6, '0' );
-    const auto output_filename = "output_zoom_entropies" + output_time;
-    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".csv";
-
-    std::ofstream file( filename );
-    file << "Zoomlevel,Entropy\n";
-    for ( size_t i = 0; i < zoom_entropies.size(); i++ )
-    {
-        file << i << "," << zoom_entropies[i] << "\n";
-    }
-    file.close();
+    const auto basename = "output_zoom_entropies";
+    const auto timestep = BaseClass::timeStep();
+    const auto directory = BaseClass::outputDirectory();
+    Controller::outputZoomEntropies( basename, timestep, directory, zoom_entropies );
 }
 
 /* =========================
@@ -31,6 +31,7 @@ public:
 
 private:
     kvs::mpi::StampTimer m_entr_timer{ BaseClass::world() }; ///< timer for entropy evaluation
+    InSituVis::StreamingSink m_log_sink{}; ///< sink for the log files of the timers
     size_t m_final_time_step = 0;
 
 public:
@@ -40,6 +41,8 @@ public:
     kvs::mpi::StampTimer& entrTimer() { return m_entr_timer; }
 
     void exec( const BaseClass::SimTime sim_time = {} ) override;
+    bool isAsyncExecutionSupported() const override { return false; }
+    bool isAnalysisIntervalAdjustable() const override { return false; }
     bool dump() override;
     void setFinalTimeStep( const size_t step ) { m_final_time_step = step; }
 
@@ -51,11 +54,14 @@ protected:
         const Viewpoint::Direction dir = Viewpoint::Uni );
 
     void execRendering() override;
+    bool streamLogs() override;
+    bool writeLogs( const bool final );
     void process( const Data& data ) override;
     void process( const Data& data , const float radius, const kvs::Quaternion& rotation ) override;
 
     std::string outputColorImageName( const Viewpoint::Location& location );
     std::string outputDepthImageName( const Viewpoint::Location& location );
+    std::string outputStreamName( const std::string& filename ) const override;
 
     void outputColorImage( const Viewpoint::Location& location, const FrameBuffer& frame_buffer );
     void outputDepthImage( const Viewpoint::Location& location, const FrameBuffer& frame_buffer );
@@ -33,24 +33,47 @@ CameraPathControlledAdaptor::erpLocation(
 
 inline bool CameraPathControlledAdaptor::dump()
 {
+    const bool ret = this->writeLogs( true );
+    return BaseClass::dump() && ret;
+}
+
+inline bool CameraPathControlledAdaptor::streamLogs()
+{
+    const bool ret = this->writeLogs( false );
+    return BaseClass::streamLogs() && ret;
+}
+
+inline bool CameraPathControlledAdaptor::writeLogs( const bool final )
+{
+    // The records are flushed into the files every streaming interval in
+    // streaming mode, and the remaining records are written at dump.
+    const auto interval = BaseClass::streamingInterval();
+    const auto directory = BaseClass::outputDirectory();
+    if ( !BaseClass::world().isRoot() )
+    {
+        // Only the root writes the logs, so the records are discarded.
+        if ( final ) { return true; }
+        if ( m_entr_timer.numberOfStamps() >= interval ) { InSituVis::StreamingSink::Erase( m_entr_timer, interval ); }
+        Controller::flushLogs( directory, BaseClass::analysisInterval(), interval, false );
+        return true;
+    }
+
     bool ret = true;
-    if ( BaseClass::world().isRoot() )
+    const auto basedir = directory.baseDirectoryName() + "/";
+    if ( m_entr_timer.title().empty() ) { m_entr_timer.setTitle( "Ent time" ); }
+    ret = m_log_sink.write( basedir + "ent_proc_time.csv", { &m_entr_timer }, interval, final ) && ret;
+
+    const auto File = [&]( const std::string& name ) { return Controller::logDataFilename( name, directory ); };
+    if ( !final )
     {
-        if ( m_entr_timer.title().empty() ) { m_entr_timer.setTitle( "Ent time" ); }
-        kvs::StampTimerList entr_timer_list;
-        entr_timer_list.push( m_entr_timer );
-
-        const auto basedir = BaseClass::outputDirectory().baseDirectoryName() + "/";
-        ret = entr_timer_list.write( basedir + "ent_proc_time.csv" );
-
-        const auto directory = BaseClass::outputDirectory();
-        const auto File = [&]( const std::string& name ) { return Controller::logDataFilename( name, directory ); };
-        Controller::outputPathCalcTimes( File( "output_path_calc_times" ) );
-        Controller::outputViewpointCoords( File( "output_viewpoint_coords" ), BaseClass::viewpoint() );
-        Controller::outputNumImages( File( "output_num_images" ), BaseClass::analysisInterval() );
+        Controller::flushLogs( directory, BaseClass::analysisInterval(), interval );
+        return ret;
     }
 
-    return BaseClass::dump() && ret;
+    Controller::outputPathCalcTimes( File( "output_path_calc_times" ) );
+    Controller::outputViewpointCoords( File( "output_viewpoint_coords" ), BaseClass::viewpoint() );
+    Controller::outputNumImages( File( "output_num_images" ), BaseClass::analysisInterval() );
+    return ret;
 }
 
 inline void CameraPathControlledAdaptor::exec( const BaseClass::SimTime sim_time )
@@ -85,17 +108,19 @@ inline void CameraPathControlledAdaptor::execRendering()
 
     if ( Controller::isEntStep() && !Controller::isErpStep() )
     {
-        // Entropy evaluation
-        for ( const auto& location : BaseClass::viewpoint().locations() )
+        // Entropy evaluation. The culled locations, which are the same on
+        // all of the ranks, are neither rendered nor composited.
+        const auto& locations = BaseClass::viewpoint().locations();
+        const auto culled = BaseClass::cullLocations( locations );
+        BaseClass::readback( locations, culled, [&] ( const size_t i, const FrameBuffer& frame_buffer )
         {
-            // Draw and readback framebuffer
-            auto frame_buffer = BaseClass::readback( location );
+            const auto& location = locations[i];
 
             // Output framebuffer to image file at the root node
             kvs::Timer timer( kvs::Timer::Start );
             if ( BaseClass::world().isRoot() )
             {
-                const auto entropy = Controller::entropy( frame_buffer );
+                const auto entropy = culled[i] ? 0.0f : Controller::entropy( frame_buffer );
                 entropies.push_back( entropy );
                 frame_buffers.push_back( frame_buffer );
 
@@ -117,7 +142,7 @@ inline void CameraPathControlledAdaptor::execRendering()
             }
             timer.stop();
             entr_time += BaseClass::saveTimer().time( timer );
-        }
+        } );
 
         // Output entropies (entropy heatmap)
         if ( BaseClass::world().isRoot() )
@@ -127,8 +152,7 @@ inline void CameraPathControlledAdaptor::execRendering()
                 const auto basename = "output_entropies_";
                 const auto timestep = BaseClass::timeStep();
                 const auto directory = BaseClass::outputDirectory();
-                const auto filename = Controller::logDataFilename( basename, timestep, directory );
-                Controller::outputEntropies( filename, entropies );
+                Controller::outputEntropies( basename, timestep, directory, entropies );
             }
         }
 
@@ -158,7 +182,7 @@ inline void CameraPathControlledAdaptor::execRendering()
         }
         timer.stop();
         save_time += BaseClass::saveTimer().time( timer );
-        m_entr_timer.stamp( entr_time );
+        BaseClass::stampTime( BaseClass::EntrStage, m_entr_timer, entr_time );
     }
     else
     {
@@ -179,9 +203,9 @@ inline void CameraPathControlledAdaptor::execRendering()
         save_time += BaseClass::saveTimer().time( timer );
     }
 
-    BaseClass::saveTimer().stamp( save_time );
-    BaseClass::rendTimer().stamp( BaseClass::rendTime() );
-    BaseClass::compTimer().stamp( BaseClass::compTime() );
+    BaseClass::stampTime( BaseClass::SaveStage, BaseClass::saveTimer(), save_time );
+    BaseClass::stampTime( BaseClass::RendStage, BaseClass::rendTimer(), BaseClass::rendTime() );
+    BaseClass::stampTime( BaseClass::CompStage, BaseClass::compTimer(), BaseClass::compTime() );
 }
 
 inline void CameraPathControlledAdaptor::process( const Data& data )
@@ -211,6 +235,13 @@ inline void CameraPathControlledAdaptor::process( const Data& data, const float
     BaseClass::setTimeStep( current_step );
 }
 
+inline std::string CameraPathControlledAdaptor::outputStreamName( const std::string& filename ) const
+{
+    // The interpolated frames along the camera path make a stream, so the
+    // time step and the sub-time index are removed from the name.
+    return InSituVis::StreamEncoder::StreamName( filename, 2 );
+}
+
 inline std::string CameraPathControlledAdaptor::outputColorImageName( const Viewpoint::Location& location )
 {
     const auto time = BaseClass::timeStep();
@@ -222,9 +253,7 @@ inline std::string CameraPathControlledAdaptor::outputColorImageName( const View
 
     const auto output_basename = BaseClass::outputFilename();
     const auto output_filename = output_basename + "_" + output_time + "_" + output_sub_time+ "_" + output_space;
-    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".bmp";
-    // const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".jpg";
-    // const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".png";
+    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + BaseClass::imageEncoder().extension();
     return filename;
 }
 
@@ -237,7 +266,7 @@ inline std::string CameraPathControlledAdaptor::outputDepthImageName( const View
 
     const auto output_basename = BaseClass::outputFilename();
     const auto output_filename = output_basename + "_depth_" + output_time + "_" + output_space;
-    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".bmp";
+    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + BaseClass::imageEncoder().extension();
     return filename;
 }
 
@@ -246,9 +275,8 @@ inline void CameraPathControlledAdaptor::outputColorImage(
     const FrameBuffer& frame_buffer )
 {
     const auto size = BaseClass::outputImageSize( location );
-    const auto buffer = frame_buffer.color_buffer;
-    kvs::ColorImage image( size.x(), size.y(), buffer );
-    image.write( this->outputColorImageName( location ) );
+    const auto filename = this->outputColorImageName( location );
+    BaseClass::writeColorImage( filename, size, frame_buffer.color_buffer );
 }
 
 inline void CameraPathControlledAdaptor::outputDepthImage(
@@ -256,9 +284,8 @@ inline void CameraPathControlledAdaptor::outputDepthImage(
     const FrameBuffer& frame_buffer )
 {
     const auto size = BaseClass::outputImageSize( location );
-    const auto buffer = frame_buffer.depth_buffer;
-    kvs::GrayImage image( size.x(), size.y(), buffer );
-    image.write( this->outputDepthImageName( location ) );
+    const auto filename = this->outputDepthImageName( location );
+    BaseClass::writeDepthImage( filename, size, frame_buffer.depth_buffer );
 }
 
 } // end of namespace mpi
@@ -31,6 +31,7 @@ private:
     bool m_enable_output_evaluation_image = false;
     bool m_enable_output_evaluation_image_depth = false;
     kvs::StampTimer m_entr_timer{}; ///< timer for entropy evaluation
+    InSituVis::StreamingSink m_log_sink{}; ///< sink for the log files of the timers
     size_t m_final_time_step = 0;
 
 public:
@@ -41,6 +42,7 @@ public:
 
     void exec( const BaseClass::SimTime sim_time = {} ) override;
     bool dump() override;
+    bool isAnalysisIntervalAdjustable() const override { return false; }
     void setFinalTimeStep( const size_t step ) { m_final_time_step = step; }
 
     float divergence( const Controller::Values& P0, const Controller::Values& P1 ) override;
@@ -53,6 +55,8 @@ protected:
         const Viewpoint::Direction dir = Viewpoint::Uni );
 
     void execRendering() override;
+    bool streamLogs() override;
+    bool writeLogs( const bool final );
     void process( const Data& data ) override;
     void process( const Data& data , const float radius, const kvs::Quaternion& rotation ) override;
 
@@ -30,28 +30,49 @@ CameraPathTimeStepControlledAdaptor::erpLocation(
 
 inline bool CameraPathTimeStepControlledAdaptor::dump()
 {
-    bool ret = true;
-    if ( m_entr_timer.title().empty() ) { m_entr_timer.setTitle( "Ent time" ); }
-    kvs::StampTimerList entr_timer_list;
-    entr_timer_list.push( m_entr_timer );
+    // The logs are written after the steps in the visualization thread.
+    BaseClass::waitForVisualization();
+    const bool ret = this->writeLogs( true );
+    return BaseClass::dump() && ret;
+}
 
-    const auto basedir = BaseClass::outputDirectory().baseDirectoryName() + "/";
-    ret = entr_timer_list.write( basedir + "ent_proc_time.csv" );
+inline bool CameraPathTimeStepControlledAdaptor::streamLogs()
+{
+    const bool ret = this->writeLogs( false );
+    return BaseClass::streamLogs() && ret;
+}
 
-    //const auto interval = BaseClass::analysisInterval();
+inline bool CameraPathTimeStepControlledAdaptor::writeLogs( const bool final )
+{
+    // The records are flushed into the files every streaming interval in
+    // streaming mode, and the remaining records are written at dump.
+    const auto interval = BaseClass::streamingInterval();
     const auto directory = BaseClass::outputDirectory();
+
+    bool ret = true;
+    const auto basedir = directory.baseDirectoryName() + "/";
+    if ( m_entr_timer.title().empty() ) { m_entr_timer.setTitle( "Ent time" ); }
+    ret = m_log_sink.write( basedir + "ent_proc_time.csv", { &m_entr_timer }, interval, final ) && ret;
+
     const auto File = [&]( const std::string& name ) { return Controller::logDataFilename( name, directory ); };
-    // Controller::outputPathEntropies( File( "output_path_entropies" ), interval );
-    // Controller::outputPathPositions( File( "output_path_positions"), interval );
+    if ( !final )
+    {
+        Controller::outputPathCalcTimes( File( "output_path_calc_times" ), interval, false );
+        Controller::flushLogs( directory, BaseClass::analysisInterval(), interval, false ); // the numbers of images are not written
+        return ret;
+    }
+
     Controller::outputPathCalcTimes( File( "output_path_calc_times" ) );
     Controller::outputDivergences("Output/output_divergences.csv",Controller::divergences(),Controller::threshold());
     Controller::outputViewpointCoords( File( "output_viewpoint_coords" ), BaseClass::viewpoint() );
-
-    return BaseClass::dump() && ret;
+    return ret;
 }
 
 inline void CameraPathTimeStepControlledAdaptor::exec( const BaseClass::SimTime sim_time )
 {
+    // In async mode, the step is executed in the visualization thread.
+    if ( BaseClass::execAsync( sim_time ) ) { return; }
+
     Controller::setCacheEnabled( BaseClass::isAnalysisStep() );
     Controller::setIsEntStep( this->isEntropyStep() );
     Controller::updateCacheSize();
@@ -82,19 +103,24 @@ inline void CameraPathTimeStepControlledAdaptor::execRendering()
     // if ( this->isEntropyStep() )
     if ( Controller::isValidationStep() )
     {
-        // Entropy evaluation
-        for ( const auto& location : BaseClass::viewpoint().locations() )
+        // Entropy evaluation (the culled locations are not rendered)
+        const auto& locations = BaseClass::viewpoint().locations();
+        const auto culled = BaseClass::cullLocations( locations );
+        for ( size_t i = 0; i < locations.size(); i++ )
         {
             // Draw and readback framebuffer
+            const auto& location = locations[i];
             kvs::Timer timer_rend( kvs::Timer::Start );
-            auto frame_buffer = BaseClass::readbackFrameBuffer( location );
+            auto frame_buffer = culled[i] ?
+                BaseClass::backgroundFrameBuffer( location ) :
+                BaseClass::readbackFrameBuffer( location );
             timer_rend.stop();
             rend_time += BaseClass::rendTimer().time( timer_rend );
 
             // Output framebuffer to image file at the root node
             kvs::Timer timer( kvs::Timer::Start );
 
-            const auto entropy = Controller::entropy( frame_buffer ); 
+            const auto entropy = culled[i] ? 0.0f : Controller::entropy( frame_buffer );
             entropies.push_back( entropy );
             frame_buffers.push_back( frame_buffer );
 
@@ -144,8 +170,7 @@ inline void CameraPathTimeStepControlledAdaptor::execRendering()
             const auto basename = "output_entropies_";
             const auto timestep = BaseClass::timeStep();
             const auto directory = BaseClass::outputDirectory();
-            const auto filename = Controller::logDataFilename( basename, timestep, directory );
-            Controller::outputEntropies( filename, entropies );
+            Controller::outputEntropies( basename, timestep, directory, entropies );
         }
 
         timer.stop();
@@ -173,9 +198,9 @@ inline void CameraPathTimeStepControlledAdaptor::execRendering()
         timer.stop();
         save_time += BaseClass::saveTimer().time( timer );
     }
-    m_entr_timer.stamp( entr_time );
-    BaseClass::saveTimer().stamp( save_time );
-    BaseClass::rendTimer().stamp( rend_time );
+    BaseClass::stampTime( BaseClass::EntrStage, m_entr_timer, entr_time );
+    BaseClass::stampTime( BaseClass::SaveStage, BaseClass::saveTimer(), save_time );
+    BaseClass::stampTime( BaseClass::RendStage, BaseClass::rendTimer(), rend_time );
 }
 
 inline void CameraPathTimeStepControlledAdaptor::process( const Data& data )
@@ -221,7 +246,7 @@ inline std::string CameraPathTimeStepControlledAdaptor::outputDepthImageName( co
 
     const auto output_basename = BaseClass::outputFilename();
     const auto output_filename = output_basename + "_depth_" + output_time + "_" + output_space;
-    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".bmp";
+    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + BaseClass::imageEncoder().extension();
     return filename;
 }
 
@@ -230,9 +255,8 @@ inline void CameraPathTimeStepControlledAdaptor::outputColorImage(
     const FrameBuffer& frame_buffer )
 {
     const auto size = BaseClass::outputImageSize( location );
-    const auto buffer = frame_buffer.color_buffer;
-    kvs::ColorImage image( size.x(), size.y(), buffer );
-    image.write( BaseClass::outputFinalImageName( location ) );
+    const auto filename = BaseClass::outputFinalImageName( location );
+    BaseClass::writeColorImage( filename, size, frame_buffer.color_buffer );
 }
 
 inline void CameraPathTimeStepControlledAdaptor::outputDepthImage(
@@ -240,9 +264,8 @@ inline void CameraPathTimeStepControlledAdaptor::outputDepthImage(
     const FrameBuffer& frame_buffer )
 {
     const auto size = BaseClass::outputImageSize( location );
-    const auto buffer = frame_buffer.depth_buffer;
-    kvs::GrayImage image( size.x(), size.y(), buffer );
-    image.write( this->outputDepthImageName( location ) );
+    const auto filename = this->outputDepthImageName( location );
+    BaseClass::writeDepthImage( filename, size, frame_buffer.depth_buffer );
 }
 
 } // end of namespace InSituVis
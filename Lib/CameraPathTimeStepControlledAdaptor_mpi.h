@@ -35,6 +35,7 @@ private:
     bool m_enable_output_evaluation_image = false;
     bool m_enable_output_evaluation_image_depth = false;
     kvs::mpi::StampTimer m_entr_timer{ BaseClass::world() }; ///< timer for entropy evaluation
+    InSituVis::StreamingSink m_log_sink{}; ///< sink for the log files of the timers
     size_t m_final_time_step = 0;
     int max_index = 0;
 
@@ -45,6 +46,8 @@ public:
     kvs::mpi::StampTimer& entrTimer() { return m_entr_timer; }
 
     void exec( const BaseClass::SimTime sim_time = {} ) override;
+    bool isAsyncExecutionSupported() const override { return false; }
+    bool isAnalysisIntervalAdjustable() const override { return false; }
     bool dump() override;
     void setFinalTimeStep( const size_t step ) { m_final_time_step = step; }
 
@@ -58,6 +61,8 @@ protected:
         const Viewpoint::Direction dir = Viewpoint::Uni );
 
     void execRendering() override;
+    bool streamLogs() override;
+    bool writeLogs( const bool final );
     void process( const Data& data ) override;
     void process( const Data& data , const float radius, const kvs::Quaternion& rotation ) override;
 
@@ -42,27 +42,48 @@ inline float CameraPathTimeStepControlledAdaptor::divergence(
 
 inline bool CameraPathTimeStepControlledAdaptor::dump()
 {
+    const bool ret = this->writeLogs( true );
+    return BaseClass::dump() && ret;
+}
+
+inline bool CameraPathTimeStepControlledAdaptor::streamLogs()
+{
+    const bool ret = this->writeLogs( false );
+    return BaseClass::streamLogs() && ret;
+}
+
+inline bool CameraPathTimeStepControlledAdaptor::writeLogs( const bool final )
+{
+    // The records are flushed into the files every streaming interval in
+    // streaming mode, and the remaining records are written at dump.
+    const auto interval = BaseClass::streamingInterval();
+    const auto directory = BaseClass::outputDirectory();
+    if ( !BaseClass::world().isRoot() )
+    {
+        // Only the root writes the logs, so the records are discarded.
+        if ( final ) { return true; }
+        if ( m_entr_timer.numberOfStamps() >= interval ) { InSituVis::StreamingSink::Erase( m_entr_timer, interval ); }
+        Controller::flushLogs( directory, BaseClass::analysisInterval(), interval, false );
+        return true;
+    }
+
     bool ret = true;
-    if ( BaseClass::world().isRoot() )
+    const auto basedir = directory.baseDirectoryName() + "/";
+    if ( m_entr_timer.title().empty() ) { m_entr_timer.setTitle( "Ent time" ); }
+    ret = m_log_sink.write( basedir + "ent_proc_time.csv", { &m_entr_timer }, interval, final ) && ret;
+
+    const auto File = [&]( const std::string& name ) { return Controller::logDataFilename( name, directory ); };
+    if ( !final )
     {
-        if ( m_entr_timer.title().empty() ) { m_entr_timer.setTitle( "Ent time" ); }
-        kvs::StampTimerList entr_timer_list;
-        entr_timer_list.push( m_entr_timer );
-
-        const auto basedir = BaseClass::outputDirectory().baseDirectoryName() + "/";
-        ret = entr_timer_list.write( basedir + "ent_proc_time.csv" );
-
-        //const auto interval = BaseClass::analysisInterval();
-        const auto directory = BaseClass::outputDirectory();
-        const auto File = [&]( const std::string& name ) { return Controller::logDataFilename( name, directory ); };
-        // Controller::outputPathEntropies( File( "output_path_entropies" ), interval );
-        // Controller::outputPathPositions( File( "output_path_positions"), interval );
-        Controller::outputPathCalcTimes( File( "output_path_calc_times" ) );
-        Controller::outputDivergences("Output/output_divergences.csv",Controller::divergences(),Controller::threshold());
-        Controller::outputViewpointCoords( File( "output_viewpoint_coords" ), BaseClass::viewpoint() );
+        Controller::outputPathCalcTimes( File( "output_path_calc_times" ), interval, false );
+        Controller::flushLogs( directory, BaseClass::analysisInterval(), interval, false ); // the numbers of images are not written
+        return ret;
     }
 
-    return BaseClass::dump() && ret;
+    Controller::outputPathCalcTimes( File( "output_path_calc_times" ) );
+    Controller::outputDivergences("Output/output_divergences.csv",Controller::divergences(),Controller::threshold());
+    Controller::outputViewpointCoords( File( "output_viewpoint_coords" ), BaseClass::viewpoint() );
+    return ret;
 }
 
 inline void CameraPathTimeStepControlledAdaptor::exec( const BaseClass::SimTime sim_time )
@@ -99,17 +120,19 @@ inline void CameraPathTimeStepControlledAdaptor::execRendering()
     if ( Controller::isValidationStep() )
     {
         max_index = 0;
-        // Entropy evaluation
-        for ( const auto& location : BaseClass::viewpoint().locations() )
+        // Entropy evaluation. The culled locations, which are the same on
+        // all of the ranks, are neither rendered nor composited.
+        const auto& locations = BaseClass::viewpoint().locations();
+        const auto culled = BaseClass::cullLocations( locations );
+        BaseClass::readback( locations, culled, [&] ( const size_t i, const FrameBuffer& frame_buffer )
         {
-            // Draw and readback framebuffer
-            auto frame_buffer = BaseClass::readback( location ); 
+            const auto& location = locations[i];
 
             // Output framebuffer to image file at the root node
             kvs::Timer timer( kvs::Timer::Start );
             if ( BaseClass::world().isRoot() )
             {
-                const auto entropy = Controller::entropy( frame_buffer ); 
+                const auto entropy = culled[i] ? 0.0f : Controller::entropy( frame_buffer );
                 entropies.push_back( entropy );
                 frame_buffers.push_back( frame_buffer );
 
@@ -131,7 +154,7 @@ inline void CameraPathTimeStepControlledAdaptor::execRendering()
             }
             timer.stop();
             entr_time += BaseClass::saveTimer().time( timer );
-        }
+        } );
 
         // Distribute the index indicates the max entropy image //並列計算関係
         BaseClass::world().broadcast( max_index );
@@ -161,8 +184,7 @@ inline void CameraPathTimeStepControlledAdaptor::execRendering()
                 const auto basename = "output_entropies_";
                 const auto timestep = BaseClass::timeStep();
                 const auto directory = BaseClass::outputDirectory();
-                const auto filename = Controller::logDataFilename( basename, timestep, directory );
-                Controller::outputEntropies( filename, entropies );
+                Controller::outputEntropies( basename, timestep, directory, entropies );
             }
         }
         timer.stop();
@@ -193,10 +215,10 @@ inline void CameraPathTimeStepControlledAdaptor::execRendering()
         timer.stop();
         save_time += BaseClass::saveTimer().time( timer );
     }
-    m_entr_timer.stamp( entr_time );
-    BaseClass::saveTimer().stamp( save_time );
-    BaseClass::rendTimer().stamp( BaseClass::rendTime() );
-    BaseClass::compTimer().stamp( BaseClass::compTime() );
+    BaseClass::stampTime( BaseClass::EntrStage, m_entr_timer, entr_time );
+    BaseClass::stampTime( BaseClass::SaveStage, BaseClass::saveTimer(), save_time );
+    BaseClass::stampTime( BaseClass::RendStage, BaseClass::rendTimer(), BaseClass::rendTime() );
+    BaseClass::stampTime( BaseClass::CompStage, BaseClass::compTimer(), BaseClass::compTime() );
 }
 
 inline void CameraPathTimeStepControlledAdaptor::process( const Data& data )
@@ -242,7 +264,7 @@ inline std::string CameraPathTimeStepControlledAdaptor::outputDepthImageName( co
 
     const auto output_basename = BaseClass::outputFilename();
     const auto output_filename = output_basename + "_depth_" + output_time + "_" + output_space;
-    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + ".bmp";
+    const auto filename = BaseClass::outputDirectory().baseDirectoryName() + "/" + output_filename + BaseClass::imageEncoder().extension();
     return filename;
 }
 
@@ -251,9 +273,8 @@ inline void CameraPathTimeStepControlledAdaptor::outputColorImage(
     const FrameBuffer& frame_buffer )
 {
     const auto size = BaseClass::outputImageSize( location );
-    const auto buffer = frame_buffer.color_buffer;
-    kvs::ColorImage image( size.x(), size.y(), buffer );
-    image.write( BaseClass::outputFinalImageName( location ) );
+    const auto filename = BaseClass::outputFinalImageName( location );
+    BaseClass::writeColorImage( filename, size, frame_buffer.color_buffer );
 }
 
 inline void CameraPathTimeStepControlledAdaptor::outputDepthImage(
@@ -261,9 +282,8 @@ inline void CameraPathTimeStepControlledAdaptor::outputDepthImage(
     const FrameBuffer& frame_buffer )
 {
     const auto size = BaseClass::outputImageSize( location );
-    const auto buffer = frame_buffer.depth_buffer;
-    kvs::GrayImage image( size.x(), size.y(), buffer );
-    image.write( this->outputDepthImageName( location ) );
+    const auto filename = this->outputDepthImageName( location );
+    BaseClass::writeDepthImage( filename, size, frame_buffer.depth_buffer );
 }
 
 } // end of namespace mpi
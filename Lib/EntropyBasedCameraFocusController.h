@@ -88,6 +88,24 @@ protected:
     {
         BaseClass::outputEntropies( filename, entropies );
     }
+
+    void outputFrameEntropies(
+        const std::string& basename,
+        const kvs::UInt32 timestep,
+        const InSituVis::OutputDirectory& directory,
+        const std::vector<float>& entropies )
+    {
+        BaseClass::outputEntropies( basename, timestep, directory, entropies );
+    }
+
+    void outputZoomEntropies(
+        const std::string& basename,
+        const kvs::UInt32 timestep,
+        const InSituVis::OutputDirectory& directory,
+        const std::vector<float>& entropies )
+    {
+        BaseClass::outputEntropies( basename, timestep, directory, entropies, "Zoomlevel" );
+    }
 };
 
 } // end of namespace InSituVis
@@ -139,6 +139,7 @@ inline void EntropyBasedCameraFocusController::push( const Data& data )
 
 inline void EntropyBasedCameraFocusController::createPath()
 {
+    InSituVis::ProfileScope scope( "path" );
     std::queue<std::pair<float, kvs::Quaternion>> empty;
     BaseClass::path().swap( empty );
 
@@ -126,6 +126,24 @@ protected:
     {
         BaseClass::outputEntropies( filename, entropies );
     }
+
+    void outputFrameEntropies(
+        const std::string& basename,
+        const kvs::UInt32 timestep,
+        const InSituVis::OutputDirectory& directory,
+        const std::vector<float>& entropies )
+    {
+        BaseClass::outputEntropies( basename, timestep, directory, entropies );
+    }
+
+    void outputZoomEntropies(
+        const std::string& basename,
+        const kvs::UInt32 timestep,
+        const InSituVis::OutputDirectory& directory,
+        const std::vector<float>& entropies )
+    {
+        BaseClass::outputEntropies( basename, timestep, directory, entropies, "Zoomlevel" );
+    }
     void outputVideoParams(
         const std::string& filename1,
         const std::vector<std::string>& filename2,
@@ -158,6 +158,7 @@ inline void EntropyBasedCameraFocusControllerMulti::push( const Data& data )
 
 inline void EntropyBasedCameraFocusControllerMulti::createPath()
 {
+    InSituVis::ProfileScope scope( "path" );
     std::queue<std::pair<float, kvs::Quaternion>> empty;
     BaseClass::path().swap( empty );
 
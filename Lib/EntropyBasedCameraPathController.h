@@ -6,12 +6,16 @@
 /*****************************************************************************/
 #pragma once
 #include <queue>
+#include <map>
+#include <memory>
 #include <utility>
 #include <functional>
 #include <kvs/VolumeObjectBase>
 #include <InSituVis/Lib/Adaptor.h>
 #include <InSituVis/Lib/Viewpoint.h>
 #include <InSituVis/Lib/OutputDirectory.h>
+#include <InSituVis/Lib/StreamingSink.h>
+#include <InSituVis/Lib/BinaryLog.h>
 
 
 namespace InSituVis
@@ -62,6 +66,9 @@ private:
     std::queue<std::pair<float, kvs::Quat>> m_path{}; ///< {radius,rotation} on the interpolated path
     std::vector<float> m_path_calc_times{}; ///< path calculation times
     std::vector<size_t> m_num_images{};
+    InSituVis::StreamingSink m_log_sink{}; ///< sink for m_path_calc_times and m_num_images
+    bool m_enable_binary_log = true; ///< if true, per-step records are appended into binary logs
+    std::map<std::string,std::unique_ptr<InSituVis::BinaryLog>> m_binary_logs{}; ///< binary logs for each basename
     DataQueue m_data_queue{}; ///< data queue
     EntropyFunction m_entropy_function = MixedEntropy( LightnessEntropy(), DepthEntropy(), 0.5f ); ///< entropy function
     Interpolator m_interpolator = Slerp(); ///< path interpolator
@@ -164,6 +171,8 @@ public:
     bool isOutputEvaluationImageEnabled() const { return m_enable_output_evaluation_image; }
     bool isOutputEvaluationDepthImageEnabled() const { return m_enable_output_evaluation_image_depth; }
     bool isOutputEntropiesEnabled() const { return m_enable_output_entropies; }
+    void setBinaryLogEnabled( const bool enable = true ) { m_enable_binary_log = enable; }
+    bool isBinaryLogEnabled() const { return m_enable_binary_log; }
 
 protected:
     DataQueue& dataQueue() { return m_data_queue; }
@@ -212,15 +221,28 @@ protected:
         const kvs::UInt32 timestep,
         const InSituVis::OutputDirectory& directory );
 
+    std::string binaryLogFilename(
+        const std::string& basename,
+        const InSituVis::OutputDirectory& directory );
+
     void outputEntropies(
         const std::string& filename,
         const std::vector<float>& entropies );
 
+    void outputEntropies(
+        const std::string& basename,
+        const kvs::UInt32 timestep,
+        const InSituVis::OutputDirectory& directory,
+        const std::vector<float>& entropies,
+        const std::string& index_name = "Index" );
+
     void outputMaxEntropies(
         const std::string& filename );
 
     void outputPathCalcTimes(
-        const std::string& filename );
+        const std::string& filename,
+        const size_t log_interval = 0,
+        const bool final = true );
 
     void outputViewpointCoords(
         const std::string& filename,
@@ -228,7 +250,15 @@ protected:
 
     void outputNumImages(
         const std::string& filename,
-        const size_t interval );
+        const size_t interval,
+        const size_t log_interval = 0,
+        const bool final = true );
+
+    void flushLogs(
+        const InSituVis::OutputDirectory& directory,
+        const size_t interval,
+        const size_t log_interval,
+        const bool output = true );
 
     void updateCacheSize()
     {
@@ -4,6 +4,7 @@
 #include <kvs/LabColor>
 #include <time.h>
 #include <chrono>
+#include <sstream>
 
 
 namespace InSituVis
@@ -336,6 +337,7 @@ inline void EntropyBasedCameraPathController::push( const Data& data )
 
 inline float EntropyBasedCameraPathController::entropy( const FrameBuffer& frame_buffer )
 {
+    InSituVis::ProfileScope scope( "entropy" );
     return m_entropy_function( frame_buffer );
 }
 
@@ -353,6 +355,7 @@ inline kvs::Quat EntropyBasedCameraPathController::pathInterpolation(
 
 inline void EntropyBasedCameraPathController::createPath()
 {
+    InSituVis::ProfileScope scope( "path" );
     std::queue<std::pair<float, kvs::Quat>> empty;
     this->path().swap( empty );
 
@@ -430,6 +433,44 @@ inline void EntropyBasedCameraPathController::outputEntropies(
     file.close();
 }
 
+inline std::string EntropyBasedCameraPathController::binaryLogFilename(
+    const std::string& basename,
+    const InSituVis::OutputDirectory& directory )
+{
+    // "output_entropies_" -> "output_entropies.bin"
+    auto name = basename;
+    while ( !name.empty() && name.back() == '_' ) { name.pop_back(); }
+    return directory.baseDirectoryName() + "/" + name + ".bin";
+}
+
+inline void EntropyBasedCameraPathController::outputEntropies(
+    const std::string& basename,
+    const kvs::UInt32 timestep,
+    const InSituVis::OutputDirectory& directory,
+    const std::vector<float>& entropies,
+    const std::string& index_name )
+{
+    if ( !m_enable_binary_log )
+    {
+        this->outputEntropies( this->logDataFilename( basename, timestep, directory ), entropies );
+        return;
+    }
+
+    // The records of all of the time steps are appended into a single file
+    // instead of creating a file for each time step.
+    auto& log = m_binary_logs[ basename ];
+    if ( !log )
+    {
+        log.reset( new InSituVis::BinaryLog() );
+        const auto filename = this->binaryLogFilename( basename, directory );
+        if ( !log->open( filename, basename, { { index_name, BinaryLog::UInt32 }, { "Entropy", BinaryLog::Float32 } } ) )
+        {
+            kvsMessageError() << "Cannot create " << filename << "." << std::endl;
+        }
+    }
+    log->append( timestep, entropies );
+}
+
 inline void EntropyBasedCameraPathController::outputMaxEntropies(
     const std::string& filename )
 {
@@ -446,18 +487,25 @@ inline void EntropyBasedCameraPathController::outputMaxEntropies(
 }
 
 inline void EntropyBasedCameraPathController::outputPathCalcTimes(
-    const std::string& filename )
+    const std::string& filename,
+    const size_t log_interval,
+    const bool final )
 {
-    std::ofstream file( filename );
+    // The records are moved into the file every log_interval records in
+    // streaming mode, and the remaining records are appended at the end.
+    auto& path_calc_times = this->pathCalcTimes();
+    if ( !final && ( log_interval == 0 || path_calc_times.size() < log_interval ) ) { return; }
+
+    std::ostringstream records;
+    for ( size_t i = 0; i < path_calc_times.size(); i++ )
     {
-        file << "Calculation time" << std::endl;
-        const auto path_calc_times = this->pathCalcTimes();
-        for ( size_t i = 0; i < path_calc_times.size(); i++ )
-        {
-            file << path_calc_times[i] << std::endl;
-        }
+        records << path_calc_times[i] << std::endl;
+    }
+    const auto n = path_calc_times.size();
+    if ( m_log_sink.append( filename, "Calculation time", records.str(), n ) )
+    {
+        path_calc_times.clear();
     }
-    file.close();
 }
 
 inline void EntropyBasedCameraPathController::outputViewpointCoords(
@@ -478,18 +526,53 @@ inline void EntropyBasedCameraPathController::outputViewpointCoords(
 
 inline void EntropyBasedCameraPathController::outputNumImages(
     const std::string& filename,
-    const size_t interval )
+    const size_t interval,
+    const size_t log_interval,
+    const bool final )
 {
-    std::ofstream file( filename );
+    auto& num_images = this->numImages();
+    if ( !final && ( log_interval == 0 || num_images.size() < log_interval ) ) { return; }
+
+    std::ostringstream records;
+    const auto offset = m_log_sink.numberOfRecords( filename );
+    for ( size_t i = 0; i < num_images.size(); i++ )
     {
-        file << "Time,The number of images" << std::endl;
-        const auto num_images = this->numImages();
-        for ( size_t i = 0; i < num_images.size(); i++ )
-        {
-            file << interval * i << "," << num_images[i] << std::endl;
-        }
+        records << interval * ( offset + i ) << "," << num_images[i] << std::endl;
+    }
+    const auto n = num_images.size();
+    if ( m_log_sink.append( filename, "Time,The number of images", records.str(), n ) )
+    {
+        num_images.clear();
+    }
+}
+
+inline void EntropyBasedCameraPathController::flushLogs(
+    const InSituVis::OutputDirectory& directory,
+    const size_t interval,
+    const size_t log_interval,
+    const bool output )
+{
+    // The logs are discarded without output on the processes (ranks) that
+    // do not write them.
+    if ( output )
+    {
+        const auto File = [&]( const std::string& name ) { return this->logDataFilename( name, directory ); };
+        this->outputPathCalcTimes( File( "output_path_calc_times" ), log_interval, false );
+        this->outputNumImages( File( "output_num_images" ), interval, log_interval, false );
+    }
+    else
+    {
+        if ( m_path_calc_times.size() >= log_interval ) { m_path_calc_times.clear(); }
+        if ( m_num_images.size() >= log_interval ) { m_num_images.clear(); }
+    }
+
+    // The max entropies are not written by the adaptors, so that only the
+    // latest records are kept.
+    if ( m_max_entropies.size() > log_interval )
+    {
+        const auto n = m_max_entropies.size() - log_interval;
+        m_max_entropies.erase( m_max_entropies.begin(), m_max_entropies.begin() + n );
     }
-    file.close();
 }
 
 } // end of namespace InSituVis
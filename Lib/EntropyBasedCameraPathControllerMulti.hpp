@@ -203,6 +203,7 @@ inline void EntropyBasedCameraPathControllerMulti::push( const Data& data )
 
 inline void EntropyBasedCameraPathControllerMulti::createPath() // fin
 {
+    InSituVis::ProfileScope scope( "path" );
     std::queue<std::pair<float, kvs::Quaternion>> empty;
     BaseClass::path().swap( empty );
 
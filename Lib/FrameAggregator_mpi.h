@@ -0,0 +1,347 @@
+/*****************************************************************************/
+/**
+ *  @file   FrameAggregator_mpi.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include "FrameContainer.h"
+#if defined( KVS_USE_MPI )
+#include <mpi.h>
+#include <string>
+#include <vector>
+#include <numeric>
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+
+
+namespace InSituVis
+{
+
+namespace mpi
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Frame container shared by all of the ranks.
+ *
+ *  The frames (and any other files, e.g. per-rank logs) appended on each
+ *  rank are funneled to the aggregator of the rank group at each flush, and
+ *  the aggregators write them into a single shared file in the format of
+ *  FrameContainer with MPI-IO collective writes. The ranks are split into
+ *  the given number of contiguous groups, and the first rank of each group
+ *  is the aggregator. The index is gathered to the first aggregator (the
+ *  root rank), which writes it at the end of the file when the file is
+ *  closed. The file can be read with FrameContainerReader (e.g.
+ *  App/FrameExtractor), which scans the frame headers if the file has no
+ *  index (e.g. the simulation was aborted).
+ *
+ *  flush() is a collective operation over the communicator, so it must be
+ *  called at the same points on all of the ranks. The data funneled by a
+ *  rank at a flush must be less than 2 GiB.
+ */
+/*===========================================================================*/
+class FrameAggregator : public InSituVis::FrameContainer
+{
+public:
+    using BaseClass = InSituVis::FrameContainer;
+    using Entry = BaseClass::Entry;
+
+private:
+    MPI_Comm m_world = MPI_COMM_NULL; ///< communicator of all of the ranks
+    MPI_Comm m_group = MPI_COMM_NULL; ///< ranks funneling their data to the same aggregator
+    MPI_Comm m_aggregators = MPI_COMM_NULL; ///< aggregators (MPI_COMM_NULL on the other ranks)
+    MPI_File m_shared_file = MPI_FILE_NULL; ///< shared file (opened by the aggregators at the first flush)
+    std::string m_shared_filename{}; ///< shared filename
+    int m_naggregators = 1; ///< number of the aggregators
+    std::vector<char> m_frames{}; ///< frames appended since the last flush
+    std::vector<Entry> m_local_entries{}; ///< entries of the frames (offsets in m_frames)
+    std::mutex m_frames_mutex{}; ///< mutex for appending from the writer threads
+    std::uint64_t m_shared_end = HeaderSize; ///< end of the frames in the file
+    std::vector<char> m_index{}; ///< serialized index (root rank only)
+    std::uint64_t m_nentries = 0; ///< number of the entries in the index (root rank only)
+
+public:
+    FrameAggregator() = default;
+    ~FrameAggregator()
+    {
+        // The communicators and the file are released by close(), which is
+        // collective, so they are left to MPI_Finalize here.
+    }
+
+    int numberOfAggregators() const { return m_naggregators; }
+    bool isAggregator() const { return m_aggregators != MPI_COMM_NULL; }
+    const std::string& sharedFilename() const { return m_shared_filename; }
+
+    // Collective operation. Splits the ranks into the groups.
+    bool open( MPI_Comm world, const std::string& filename, const int naggregators )
+    {
+        int rank = 0, size = 1;
+        MPI_Comm_rank( world, &rank );
+        MPI_Comm_size( world, &size );
+
+        m_world = world;
+        m_shared_filename = filename;
+        m_naggregators = std::max( 1, std::min( naggregators, size ) );
+
+        const int group = static_cast<int>( static_cast<long>( rank ) * m_naggregators / size );
+        if ( MPI_Comm_split( world, group, rank, &m_group ) != MPI_SUCCESS ) { return false; }
+
+        int group_rank = 0;
+        MPI_Comm_rank( m_group, &group_rank );
+        const int color = group_rank == 0 ? 0 : MPI_UNDEFINED;
+        return MPI_Comm_split( world, color, rank, &m_aggregators ) == MPI_SUCCESS;
+    }
+
+    // Appends the frame into the local buffer. Called from the writer threads.
+    bool append( const std::string& name, const void* data, const size_t size ) override
+    {
+        std::lock_guard<std::mutex> lock( m_frames_mutex );
+        if ( m_group == MPI_COMM_NULL ) { return false; }
+
+        const auto offset = m_frames.size() + FrameHeaderSize + name.size();
+        PutFrame( m_frames, name, data, size );
+        m_local_entries.push_back( { name, Parse( name ), offset, static_cast<std::uint64_t>( size ) } );
+        return true;
+    }
+
+    // Appends the file, which is removed after that (e.g. a per-rank log
+    // file moved into the shared file).
+    bool appendFile( const std::string& name, const std::string& filename )
+    {
+        std::ifstream file( filename, std::ios::binary );
+        if ( !file ) { return false; }
+
+        const std::vector<char> data( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+        file.close();
+        std::remove( filename.c_str() );
+        return this->append( name, data.data(), data.size() );
+    }
+
+    // Collective operation. Funnels the frames to the aggregators, which
+    // write them into the shared file.
+    bool flush() override
+    {
+        return this->flush_frames( false );
+    }
+
+    // Collective operation. Flushes the frames, writes the index and closes
+    // the shared file.
+    void close()
+    {
+        if ( m_group == MPI_COMM_NULL ) { return; }
+
+        this->flush_frames( true );
+        if ( m_shared_file != MPI_FILE_NULL ) { MPI_File_close( &m_shared_file ); }
+        if ( m_aggregators != MPI_COMM_NULL ) { MPI_Comm_free( &m_aggregators ); }
+        MPI_Comm_free( &m_group );
+    }
+
+private:
+    bool flush_frames( const bool index_writing )
+    {
+        if ( m_group == MPI_COMM_NULL ) { return true; }
+
+        std::vector<char> frames;
+        std::vector<Entry> entries;
+        {
+            std::lock_guard<std::mutex> lock( m_frames_mutex );
+            frames.swap( m_frames );
+            entries.swap( m_local_entries );
+        }
+
+        // Index entries with the offsets in the local frames.
+        std::vector<char> index;
+        for ( const auto& e : entries ) { PutEntry( index, e ); }
+
+        // Funnel the frames and the index to the aggregator.
+        std::vector<int> frame_sizes, frame_displs, index_sizes, index_displs;
+        std::vector<char> group_frames, group_index;
+        this->gather( frames, &group_frames, &frame_sizes, &frame_displs );
+        this->gather( index, &group_index, &index_sizes, &index_displs );
+
+        bool ret = true;
+        if ( this->isAggregator() )
+        {
+            // Offsets of the frames of the aggregator in the shared file.
+            std::uint64_t size = group_frames.size();
+            std::uint64_t offset = 0;
+            std::uint64_t total = 0;
+            MPI_Exscan( &size, &offset, 1, MPI_UINT64_T, MPI_SUM, m_aggregators );
+            MPI_Allreduce( &size, &total, 1, MPI_UINT64_T, MPI_SUM, m_aggregators );
+            int agg_rank = 0;
+            MPI_Comm_rank( m_aggregators, &agg_rank );
+            if ( agg_rank == 0 ) { offset = 0; } // undefined on the first rank
+            offset += m_shared_end;
+
+            // Nothing is written until any frame is appended.
+            if ( total == 0 && m_shared_file == MPI_FILE_NULL ) { return this->agree( ret ); }
+
+            // Shift the offsets of the index entries from the rank-local
+            // offsets to the file offsets.
+            const auto shifted = Shift( group_index, index_sizes, index_displs, frame_displs, offset );
+
+            ret = this->write_frames( offset, group_frames, agg_rank == 0 ) && ret;
+            m_shared_end += total;
+
+            // Gather the index to the root rank, which writes it after the
+            // frames only when the file is closed.
+            std::vector<char> all_index;
+            std::vector<int> sizes, displs;
+            this->gather_aggregators( shifted, &all_index, &sizes, &displs );
+            if ( agg_rank == 0 )
+            {
+                m_index.insert( m_index.end(), all_index.begin(), all_index.end() );
+                m_nentries += CountEntries( all_index );
+                if ( index_writing ) { ret = this->write_index() && ret; }
+            }
+            MPI_File_sync( m_shared_file );
+        }
+
+        return this->agree( ret );
+    }
+
+    // Returns true if all of the ranks succeeded.
+    bool agree( const bool ret )
+    {
+        int ok = ret ? 1 : 0;
+        int all_ok = 0;
+        MPI_Allreduce( &ok, &all_ok, 1, MPI_INT, MPI_MIN, m_world );
+        return all_ok == 1;
+    }
+
+    // Gathers the buffers of the group to the aggregator.
+    void gather(
+        const std::vector<char>& buffer,
+        std::vector<char>* gathered,
+        std::vector<int>* sizes,
+        std::vector<int>* displs )
+    {
+        Gatherv( m_group, buffer, gathered, sizes, displs );
+    }
+
+    void gather_aggregators(
+        const std::vector<char>& buffer,
+        std::vector<char>* gathered,
+        std::vector<int>* sizes,
+        std::vector<int>* displs )
+    {
+        Gatherv( m_aggregators, buffer, gathered, sizes, displs );
+    }
+
+    static void Gatherv(
+        MPI_Comm comm,
+        const std::vector<char>& buffer,
+        std::vector<char>* gathered,
+        std::vector<int>* sizes,
+        std::vector<int>* displs )
+    {
+        int rank = 0, nranks = 1;
+        MPI_Comm_rank( comm, &rank );
+        MPI_Comm_size( comm, &nranks );
+
+        const int size = static_cast<int>( buffer.size() );
+        sizes->assign( nranks, 0 );
+        MPI_Gather( &size, 1, MPI_INT, sizes->data(), 1, MPI_INT, 0, comm );
+
+        displs->assign( nranks, 0 );
+        if ( rank == 0 )
+        {
+            std::partial_sum( sizes->begin(), sizes->end() - 1, displs->begin() + 1 );
+            gathered->resize( displs->back() + sizes->back() );
+        }
+        MPI_Gatherv(
+            buffer.data(), size, MPI_BYTE,
+            gathered->data(), sizes->data(), displs->data(), MPI_BYTE, 0, comm );
+    }
+
+    // Shifts the offsets of the entries gathered from each rank of the group
+    // by the displacement of the frames of the rank and the file offset.
+    static std::vector<char> Shift(
+        const std::vector<char>& index,
+        const std::vector<int>& index_sizes,
+        const std::vector<int>& index_displs,
+        const std::vector<int>& frame_displs,
+        const std::uint64_t offset )
+    {
+        std::vector<char> shifted( index );
+        for ( size_t r = 0; r < index_sizes.size(); r++ )
+        {
+            size_t p = index_displs[r];
+            const size_t end = p + index_sizes[r];
+            while ( p < end )
+            {
+                std::uint64_t entry_offset = 0;
+                std::memcpy( &entry_offset, shifted.data() + p, 8 );
+                entry_offset += offset + frame_displs[r];
+                std::memcpy( shifted.data() + p, &entry_offset, 8 );
+
+                std::uint32_t name_length = 0;
+                std::memcpy( &name_length, shifted.data() + p + 16 + sizeof( Ids ), 4 );
+                p += 16 + sizeof( Ids ) + 4 + name_length;
+            }
+        }
+        return shifted;
+    }
+
+    static std::uint64_t CountEntries( const std::vector<char>& index )
+    {
+        std::uint64_t n = 0;
+        size_t p = 0;
+        while ( p < index.size() )
+        {
+            std::uint32_t name_length = 0;
+            std::memcpy( &name_length, index.data() + p + 16 + sizeof( Ids ), 4 );
+            p += 16 + sizeof( Ids ) + 4 + name_length;
+            n++;
+        }
+        return n;
+    }
+
+    bool write_frames( const std::uint64_t offset, const std::vector<char>& frames, const bool header )
+    {
+        if ( m_shared_file == MPI_FILE_NULL )
+        {
+            // The collective buffering is done by the aggregators only.
+            MPI_Info info;
+            MPI_Info_create( &info );
+            MPI_Info_set( info, "cb_nodes", std::to_string( m_naggregators ).c_str() );
+            const int mode = MPI_MODE_CREATE | MPI_MODE_WRONLY;
+            const int err = MPI_File_open( m_aggregators, m_shared_filename.c_str(), mode, info, &m_shared_file );
+            MPI_Info_free( &info );
+            if ( err != MPI_SUCCESS ) { m_shared_file = MPI_FILE_NULL; return false; }
+            MPI_File_set_size( m_shared_file, 0 );
+
+            if ( header )
+            {
+                const auto h = Header();
+                MPI_File_write_at( m_shared_file, 0, h.data(), static_cast<int>( h.size() ), MPI_BYTE, MPI_STATUS_IGNORE );
+            }
+        }
+
+        MPI_Status status;
+        const int err = MPI_File_write_at_all(
+            m_shared_file, static_cast<MPI_Offset>( offset ),
+            frames.data(), static_cast<int>( frames.size() ), MPI_BYTE, &status );
+        return err == MPI_SUCCESS;
+    }
+
+    bool write_index()
+    {
+        std::vector<char> tail( m_index );
+        PutTrailer( tail, m_shared_end, m_nentries );
+
+        MPI_Status status;
+        const int err = MPI_File_write_at(
+            m_shared_file, static_cast<MPI_Offset>( m_shared_end ),
+            tail.data(), static_cast<int>( tail.size() ), MPI_BYTE, &status );
+        return err == MPI_SUCCESS;
+    }
+};
+
+} // end of namespace mpi
+
+} // end of namespace InSituVis
+
+#endif // KVS_USE_MPI
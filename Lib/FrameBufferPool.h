@@ -0,0 +1,178 @@
+/*****************************************************************************/
+/**
+ *  @file   FrameBufferPool.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <kvs/Type>
+#include <kvs/ValueArray>
+#include <kvs/RGBColor>
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Frame buffer pool class.
+ *
+ *  Color and depth buffers are handed out by the number of elements. The
+ *  pool keeps a reference to every buffer it has allocated, and a buffer is
+ *  reused once the pool holds the last reference to it, that is, when all
+ *  of the consumers have released it. The contents of a reused buffer are
+ *  undefined. Constant buffers (e.g. background) are cached and shared
+ *  until the requested size or value changes, so they must not be modified.
+ *  evict() releases the free buffers that have not been handed out since
+ *  the previous eviction, so that the pool keeps only the working set of
+ *  the last time step (e.g. not the buffers of an image size no longer
+ *  used).
+ */
+/*===========================================================================*/
+class FrameBufferPool
+{
+public:
+    using ColorBuffer = kvs::ValueArray<kvs::UInt8>;
+    using DepthBuffer = kvs::ValueArray<kvs::Real32>;
+
+private:
+    template <typename T>
+    struct Slot
+    {
+        kvs::ValueArray<T> buffer; ///< allocated buffer
+        size_t epoch; ///< epoch when the buffer was last handed out
+    };
+
+    template <typename T>
+    using Buffers = std::unordered_map<size_t,std::vector<Slot<T>>>;
+
+    Buffers<kvs::UInt8> m_color_buffers{}; ///< allocated color buffers
+    Buffers<kvs::Real32> m_depth_buffers{}; ///< allocated depth buffers
+    ColorBuffer m_constant_color_buffer{}; ///< cached constant color buffer
+    DepthBuffer m_constant_depth_buffer{}; ///< cached constant depth buffer
+    kvs::RGBColor m_constant_color{}; ///< color of the cached color buffer
+    kvs::Real32 m_constant_depth = 0.0f; ///< depth of the cached depth buffer
+    size_t m_nhits = 0; ///< number of requests served by the pool
+    size_t m_nmisses = 0; ///< number of requests that allocated a new buffer
+    size_t m_epoch = 0; ///< number of the evictions
+    size_t m_nrequests = 0; ///< number of requests since the previous eviction
+    mutable std::mutex m_mutex{}; ///< mutex for the pool
+
+public:
+    FrameBufferPool() = default;
+    FrameBufferPool( const FrameBufferPool& ) = delete;
+    FrameBufferPool& operator = ( const FrameBufferPool& ) = delete;
+
+    size_t numberOfHits() const { std::lock_guard<std::mutex> lock( m_mutex ); return m_nhits; }
+    size_t numberOfMisses() const { std::lock_guard<std::mutex> lock( m_mutex ); return m_nmisses; }
+
+    ColorBuffer colorBuffer( const size_t size )
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return this->acquire( m_color_buffers[ size ], size );
+    }
+
+    DepthBuffer depthBuffer( const size_t size )
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return this->acquire( m_depth_buffers[ size ], size );
+    }
+
+    // RGBA buffer filled with the color (alpha = 255).
+    ColorBuffer constantColorBuffer( const size_t npixels, const kvs::RGBColor& color )
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        auto& buffer = m_constant_color_buffer;
+        if ( buffer.size() == npixels * 4 && m_constant_color == color ) { m_nhits++; return buffer; }
+
+        m_nmisses++;
+        buffer = ColorBuffer( npixels * 4 );
+        for ( size_t i = 0; i < npixels; ++i )
+        {
+            buffer[ 4 * i + 0 ] = color.r();
+            buffer[ 4 * i + 1 ] = color.g();
+            buffer[ 4 * i + 2 ] = color.b();
+            buffer[ 4 * i + 3 ] = 255;
+        }
+        m_constant_color = color;
+        return buffer;
+    }
+
+    DepthBuffer constantDepthBuffer( const size_t npixels, const kvs::Real32 depth )
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        auto& buffer = m_constant_depth_buffer;
+        if ( buffer.size() == npixels && m_constant_depth == depth ) { m_nhits++; return buffer; }
+
+        m_nmisses++;
+        buffer = DepthBuffer( npixels );
+        buffer.fill( depth );
+        m_constant_depth = depth;
+        return buffer;
+    }
+
+    // Releases the buffers which are not used by any consumer.
+    void shrink()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        this->release( m_color_buffers, m_epoch + 1 );
+        this->release( m_depth_buffers, m_epoch + 1 );
+    }
+
+    // Releases the buffers which are not used by any consumer and have not
+    // been handed out since the previous eviction. Nothing is released if no
+    // buffer has been requested since then (e.g. non-analysis time steps).
+    void evict()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( m_nrequests == 0 ) { return; }
+        this->release( m_color_buffers, m_epoch );
+        this->release( m_depth_buffers, m_epoch );
+        m_nrequests = 0;
+        m_epoch++;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_color_buffers.clear();
+        m_depth_buffers.clear();
+        m_constant_color_buffer = ColorBuffer();
+        m_constant_depth_buffer = DepthBuffer();
+    }
+
+private:
+    template <typename T>
+    kvs::ValueArray<T> acquire( std::vector<Slot<T>>& slots, const size_t size )
+    {
+        m_nrequests++;
+        for ( auto& slot : slots )
+        {
+            if ( slot.buffer.unique() ) { m_nhits++; slot.epoch = m_epoch; return slot.buffer; }
+        }
+
+        m_nmisses++;
+        slots.push_back( { kvs::ValueArray<T>( size ), m_epoch } );
+        return slots.back().buffer;
+    }
+
+    // Releases the free buffers last handed out before the epoch.
+    template <typename T>
+    void release( Buffers<T>& buffers, const size_t epoch )
+    {
+        for ( auto b = buffers.begin(); b != buffers.end(); )
+        {
+            auto& v = b->second;
+            v.erase( std::remove_if( v.begin(), v.end(),
+                [&] ( const Slot<T>& slot ) { return slot.buffer.unique() && slot.epoch < epoch; } ), v.end() );
+            b = v.empty() ? buffers.erase( b ) : std::next( b );
+        }
+    }
+};
+
+} // end of namespace InSituVis
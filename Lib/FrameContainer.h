@@ -0,0 +1,404 @@
+/*****************************************************************************/
+/**
+ *  @file   FrameContainer.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <array>
+#include <mutex>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "FrameStore.h"
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Append-only container of the encoded frames.
+ *
+ *  The encoded image files are stored in a single file instead of creating
+ *  a file for each frame. The file consists of the header, the frames and
+ *  the index at the end:
+ *
+ *    header:  magic "ISVFRAME", version, padding (16 bytes)
+ *    frames:  {magic "ISVF", name length, data size, name, data} each
+ *    index:   {data offset, data size, ids[4], name length, name} each
+ *    trailer: index offset, number of frames, magic "ISVFRMIX"
+ *
+ *  The ids are the numbers in the name (e.g. time index, space index and
+ *  zoom/focus ids of output_TTTTTT_SSSSSS_ZZZZZZ.bmp), or -1. The frames
+ *  are batched in memory and written in blocks aligned to the block size.
+ *  The index is written by flush() after the remaining partial block, which
+ *  is kept in memory and rewritten with the following frames. The frames
+ *  written before a crash can be recovered by scanning the frame headers.
+ *  The file is created at the first write, so no file is created by the
+ *  processes writing no frame.
+ */
+/*===========================================================================*/
+class FrameContainer : public InSituVis::FrameStore
+{
+public:
+    using Ids = std::array<std::int64_t,4>;
+
+    struct Entry
+    {
+        std::string name; ///< frame name (image filename)
+        Ids ids; ///< numbers in the name (time, space, zoom/focus ids)
+        std::uint64_t offset; ///< offset of the data
+        std::uint64_t size; ///< data size in bytes
+    };
+
+    static constexpr size_t MagicSize = 8;
+    static constexpr size_t HeaderSize = 16;
+    static constexpr size_t FrameHeaderSize = 16;
+    static constexpr size_t TrailerSize = 8 + 8 + MagicSize;
+    static constexpr const char* Magic() { return "ISVFRAME"; }
+    static constexpr const char* FrameMagic() { return "ISVF"; }
+    static constexpr const char* IndexMagic() { return "ISVFRMIX"; }
+    static constexpr std::uint32_t Version = 1;
+
+private:
+    std::string m_filename{}; ///< container filename
+    size_t m_block_size = 4 * 1024 * 1024; ///< I/O block size in bytes
+    std::fstream m_file{}; ///< container file (opened at the first write)
+    std::vector<char> m_buffer{}; ///< frames not written yet (from m_flushed)
+    std::uint64_t m_flushed = 0; ///< file offset of the buffer (multiple of the block size)
+    std::vector<Entry> m_entries{}; ///< index of the frames
+    std::mutex m_mutex{}; ///< mutex for appending from the writer threads
+
+public:
+    explicit FrameContainer( const size_t block_size = 4 * 1024 * 1024 ): m_block_size( block_size > 0 ? block_size : 1 ) {}
+    FrameContainer( const FrameContainer& ) = delete;
+    FrameContainer& operator = ( const FrameContainer& ) = delete;
+    virtual ~FrameContainer() { this->close(); }
+
+    const std::string& filename() const { return m_filename; }
+    size_t blockSize() const { return m_block_size; }
+    size_t numberOfFrames()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_entries.size();
+    }
+
+    // Sets the filename. The file is created when the first block is
+    // written.
+    void open( const std::string& filename ) override
+    {
+        this->close();
+
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_filename = filename;
+        m_buffer = Header();
+        m_flushed = 0;
+        m_entries.clear();
+    }
+
+    // Appends the encoded frame. Called from the writer threads.
+    bool append( const std::string& name, const void* data, const size_t size ) override
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( m_filename.empty() ) { return false; }
+
+        const auto offset = m_flushed + m_buffer.size() + FrameHeaderSize + name.size();
+        PutFrame( m_buffer, name, data, size );
+        m_entries.push_back( { name, Parse( name ), offset, static_cast<std::uint64_t>( size ) } );
+
+        // Write the full blocks in the buffer.
+        const auto nblocks = m_buffer.size() / m_block_size;
+        if ( nblocks == 0 ) { return true; }
+
+        const auto length = nblocks * m_block_size;
+        if ( !this->write_at( m_flushed, m_buffer.data(), length ) ) { return false; }
+        m_buffer.erase( m_buffer.begin(), m_buffer.begin() + length );
+        m_flushed += length;
+        return true;
+    }
+
+    // Writes the buffered frames and the index, so that the file can be
+    // read. The frames can be still appended after the flush.
+    bool flush() override
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( m_filename.empty() || m_entries.empty() ) { return true; }
+
+        std::vector<char> tail( m_buffer );
+        const auto index_offset = static_cast<std::uint64_t>( m_flushed + m_buffer.size() );
+        for ( const auto& e : m_entries ) { PutEntry( tail, e ); }
+        PutTrailer( tail, index_offset, m_entries.size() );
+
+        // The tail always ends after the previous one since the frames and
+        // the index only grow, so the file does not need to be truncated.
+        if ( !this->write_at( m_flushed, tail.data(), tail.size() ) ) { return false; }
+        m_file.flush();
+        return static_cast<bool>( m_file );
+    }
+
+    void close()
+    {
+        this->flush();
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( m_file.is_open() ) { m_file.close(); }
+        m_filename.clear();
+        m_buffer.clear();
+        m_entries.clear();
+    }
+
+    // Serializes the frame in the frame format (header, name and data).
+    static void PutFrame( std::vector<char>& buffer, const std::string& name, const void* data, const size_t size )
+    {
+        const auto name_length = static_cast<std::uint32_t>( name.size() );
+        const auto data_size = static_cast<std::uint64_t>( size );
+        Put( buffer, FrameMagic(), 4 );
+        Put( buffer, &name_length, 4 );
+        Put( buffer, &data_size, 8 );
+        Put( buffer, name.data(), name.size() );
+        Put( buffer, data, size );
+    }
+
+    // Serializes the index entry in the index format.
+    static void PutEntry( std::vector<char>& buffer, const Entry& e )
+    {
+        const auto name_length = static_cast<std::uint32_t>( e.name.size() );
+        Put( buffer, &e.offset, 8 );
+        Put( buffer, &e.size, 8 );
+        Put( buffer, e.ids.data(), sizeof( Ids ) );
+        Put( buffer, &name_length, 4 );
+        Put( buffer, e.name.data(), e.name.size() );
+    }
+
+    // Serializes the trailer.
+    static void PutTrailer( std::vector<char>& buffer, const std::uint64_t index_offset, const std::uint64_t nentries )
+    {
+        Put( buffer, &index_offset, 8 );
+        Put( buffer, &nentries, 8 );
+        Put( buffer, IndexMagic(), MagicSize );
+    }
+
+    // Returns the header of the file.
+    static std::vector<char> Header()
+    {
+        const std::uint32_t version = Version;
+        std::vector<char> header( HeaderSize, '\0' );
+        std::memcpy( header.data(), Magic(), MagicSize );
+        std::memcpy( header.data() + MagicSize, &version, sizeof( version ) );
+        return header;
+    }
+
+    // Returns the numbers separated by '_' in the name without the extension,
+    // e.g. {10, 3, 1, -1} for output_000010_000003_color_0001.bmp.
+    static Ids Parse( const std::string& name )
+    {
+        Ids ids; ids.fill( -1 );
+        const auto slash = name.find_last_of( '/' );
+        auto stem = name.substr( slash == std::string::npos ? 0 : slash + 1 );
+        const auto dot = stem.find_last_of( '.' );
+        if ( dot != std::string::npos ) { stem = stem.substr( 0, dot ); }
+
+        size_t n = 0;
+        size_t begin = 0;
+        while ( begin <= stem.size() && n < ids.size() )
+        {
+            const auto end = std::min( stem.find( '_', begin ), stem.size() );
+            const auto token = stem.substr( begin, end - begin );
+            bool digits = !token.empty();
+            for ( const auto c : token ) { digits = digits && std::isdigit( static_cast<unsigned char>( c ) ); }
+            if ( digits ) { ids[ n++ ] = std::stoll( token ); }
+            begin = end + 1;
+        }
+        return ids;
+    }
+
+private:
+    static void Put( std::vector<char>& buffer, const void* data, const size_t size )
+    {
+        const auto* p = static_cast<const char*>( data );
+        buffer.insert( buffer.end(), p, p + size );
+    }
+
+    bool write_at( const std::uint64_t offset, const char* data, const size_t size )
+    {
+        if ( !m_file.is_open() )
+        {
+            m_file.open( m_filename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc );
+            if ( !m_file ) { return false; }
+        }
+        m_file.seekp( static_cast<std::streamoff>( offset ) );
+        m_file.write( data, size );
+        return static_cast<bool>( m_file );
+    }
+};
+
+/*===========================================================================*/
+/**
+ *  @brief  Reader of the frame container with memory mapping.
+ */
+/*===========================================================================*/
+class FrameContainerReader
+{
+public:
+    using Entry = FrameContainer::Entry;
+
+private:
+    const char* m_data = nullptr; ///< mapped file
+    size_t m_size = 0; ///< file size
+    bool m_recovered = false; ///< true if the index is rebuilt by scanning
+    std::vector<Entry> m_entries{}; ///< index of the frames
+
+public:
+    FrameContainerReader() = default;
+    explicit FrameContainerReader( const std::string& filename ) { this->open( filename ); }
+    FrameContainerReader( const FrameContainerReader& ) = delete;
+    FrameContainerReader& operator = ( const FrameContainerReader& ) = delete;
+    ~FrameContainerReader() { this->close(); }
+
+    bool isOpened() const { return m_data != nullptr; }
+    bool isRecovered() const { return m_recovered; }
+    const std::vector<Entry>& entries() const { return m_entries; }
+    size_t numberOfFrames() const { return m_entries.size(); }
+    const char* data( const size_t index ) const { return m_data + m_entries[ index ].offset; }
+
+    bool open( const std::string& filename )
+    {
+        this->close();
+
+        const int fd = ::open( filename.c_str(), O_RDONLY );
+        if ( fd < 0 ) { return false; }
+
+        struct stat st;
+        if ( ::fstat( fd, &st ) != 0 || st.st_size < static_cast<off_t>( FrameContainer::HeaderSize ) )
+        {
+            ::close( fd );
+            return false;
+        }
+
+        void* data = ::mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        ::close( fd );
+        if ( data == MAP_FAILED ) { return false; }
+
+        m_data = static_cast<const char*>( data );
+        m_size = static_cast<size_t>( st.st_size );
+        if ( std::memcmp( m_data, FrameContainer::Magic(), FrameContainer::MagicSize ) != 0 )
+        {
+            this->close();
+            return false;
+        }
+
+        if ( !this->read_index() ) { this->scan(); }
+        return true;
+    }
+
+    void close()
+    {
+        if ( m_data ) { ::munmap( const_cast<char*>( m_data ), m_size ); }
+        m_data = nullptr;
+        m_size = 0;
+        m_recovered = false;
+        m_entries.clear();
+    }
+
+    // Returns the index of the frame, or -1.
+    long find( const std::string& name ) const
+    {
+        for ( size_t i = 0; i < m_entries.size(); i++ )
+        {
+            if ( m_entries[i].name == name ) { return static_cast<long>( i ); }
+        }
+        return -1;
+    }
+
+    bool extract( const size_t index, const std::string& filename ) const
+    {
+        std::ofstream file( filename, std::ios::binary );
+        if ( !file ) { return false; }
+
+        file.write( this->data( index ), m_entries[ index ].size );
+        return file.good();
+    }
+
+private:
+    template <typename T>
+    T get( const size_t offset ) const
+    {
+        T v;
+        std::memcpy( &v, m_data + offset, sizeof( T ) );
+        return v;
+    }
+
+    bool read_index()
+    {
+        if ( m_size < FrameContainer::HeaderSize + FrameContainer::TrailerSize ) { return false; }
+
+        const auto trailer = m_size - FrameContainer::TrailerSize;
+        if ( std::memcmp( m_data + trailer + 16, FrameContainer::IndexMagic(), FrameContainer::MagicSize ) != 0 ) { return false; }
+
+        auto offset = this->get<std::uint64_t>( trailer );
+        const auto nentries = this->get<std::uint64_t>( trailer + 8 );
+        for ( std::uint64_t i = 0; i < nentries; i++ )
+        {
+            const size_t entry_size = 8 + 8 + sizeof( FrameContainer::Ids ) + 4;
+            if ( offset + entry_size > trailer ) { m_entries.clear(); return false; }
+
+            Entry e;
+            e.offset = this->get<std::uint64_t>( offset );
+            e.size = this->get<std::uint64_t>( offset + 8 );
+            std::memcpy( e.ids.data(), m_data + offset + 16, sizeof( FrameContainer::Ids ) );
+            const auto name_length = this->get<std::uint32_t>( offset + 16 + sizeof( FrameContainer::Ids ) );
+            offset += entry_size;
+            if ( offset + name_length > trailer || e.offset + e.size > m_size ) { m_entries.clear(); return false; }
+
+            e.name = std::string( m_data + offset, name_length );
+            offset += name_length;
+
+            // The index written by the previous flush may be overwritten
+            // with the following frames, so the frame header is checked.
+            const auto header = e.offset - name_length - FrameContainer::FrameHeaderSize;
+            if ( e.offset < FrameContainer::HeaderSize + FrameContainer::FrameHeaderSize + name_length ||
+                 std::memcmp( m_data + header, FrameContainer::FrameMagic(), 4 ) != 0 ||
+                 std::memcmp( m_data + header + FrameContainer::FrameHeaderSize, e.name.data(), name_length ) != 0 )
+            {
+                m_entries.clear();
+                return false;
+            }
+            m_entries.push_back( e );
+        }
+        return offset == trailer;
+    }
+
+    // Rebuilds the index from the frame headers (e.g. after a crash).
+    void scan()
+    {
+        m_recovered = true;
+        size_t offset = FrameContainer::HeaderSize;
+        while ( offset + FrameContainer::FrameHeaderSize <= m_size )
+        {
+            if ( std::memcmp( m_data + offset, FrameContainer::FrameMagic(), 4 ) != 0 ) { break; }
+
+            const auto name_length = this->get<std::uint32_t>( offset + 4 );
+            const auto size = this->get<std::uint64_t>( offset + 8 );
+            const auto data_offset = offset + FrameContainer::FrameHeaderSize + name_length;
+            if ( data_offset + size > m_size ) { break; }
+
+            Entry e;
+            e.name = std::string( m_data + offset + FrameContainer::FrameHeaderSize, name_length );
+            e.ids = FrameContainer::Parse( e.name );
+            e.offset = data_offset;
+            e.size = size;
+            m_entries.push_back( e );
+            offset = data_offset + size;
+        }
+    }
+};
+
+} // end of namespace InSituVis
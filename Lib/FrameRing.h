@@ -0,0 +1,384 @@
+/*****************************************************************************/
+/**
+ *  @file   FrameRing.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "FrameSink.h"
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Ring buffer of the frames in POSIX shared memory.
+ *
+ *  The rendered frames are published into the slots of the ring in the
+ *  shared memory object (/dev/shm/<name>), so that the processes on the same
+ *  node (e.g. a live monitor or a compressor) can read them without any
+ *  file. The header has the metadata of the ring and the sequence number of
+ *  the next frame, and each slot has the metadata of the frame followed by
+ *  the pixels.
+ *
+ *  The producer never waits for the consumers. With the Overwrite policy,
+ *  the oldest frame is overwritten and the consumers detect the overwritten
+ *  frames by the sequence numbers (seqlock). With the Drop policy, a frame
+ *  is dropped if the ring is full, i.e. the consumer has not read the frame
+ *  in the slot yet (only one consumer can be attached in this case).
+ */
+/*===========================================================================*/
+class FrameRing : public InSituVis::FrameSink
+{
+public:
+    enum Policy
+    {
+        Overwrite = 0, ///< overwrite the oldest frame if the ring is full
+        Drop = 1 ///< drop the new frame if the ring is full
+    };
+
+    struct Frame
+    {
+        std::uint64_t sequence; ///< sequence number of the frame (0, 1, ...)
+        std::uint64_t time_step; ///< time step of the simulation
+        std::uint64_t location; ///< index of the viewpoint location
+        std::uint64_t timestamp; ///< publication time in nanoseconds since the epoch
+        std::uint32_t width; ///< image width
+        std::uint32_t height; ///< image height
+        std::uint32_t channels; ///< number of the channels (4: RGBA)
+        std::uint32_t reserved; ///< padding
+        std::uint64_t size; ///< size of the pixels in bytes
+    };
+
+    struct Header
+    {
+        char magic[8]; ///< "ISVRING\0"
+        std::uint32_t version; ///< format version
+        std::uint32_t policy; ///< producer policy
+        std::uint64_t nslots; ///< number of the slots
+        std::uint64_t slot_size; ///< maximum size of the pixels in a slot
+        std::uint64_t slot_stride; ///< bytes between the slots
+        std::atomic<std::uint64_t> write_sequence; ///< sequence number of the next frame
+        std::atomic<std::uint64_t> read_sequence; ///< sequence number of the next frame to be read (Drop policy)
+        std::atomic<std::uint64_t> ndropped; ///< number of the dropped frames
+        std::atomic<std::uint64_t> closed; ///< 1 if the producer is closed
+    };
+
+    struct Slot
+    {
+        std::atomic<std::uint64_t> state; ///< 2n+1 while writing the n-th frame, 2n+2 after that
+        Frame frame; ///< metadata of the frame
+    };
+
+    static constexpr std::uint32_t Version = 1;
+    static constexpr size_t Alignment = 64;
+    static const char* Magic() { return "ISVRING"; }
+
+    static size_t HeaderSize() { return Align( sizeof( Header ) ); }
+    static size_t SlotStride( const size_t slot_size ) { return Align( sizeof( Slot ) + slot_size ); }
+    static size_t Align( const size_t size ) { return ( size + Alignment - 1 ) / Alignment * Alignment; }
+
+    // Returns the name of the shared memory object, which starts with '/'.
+    static std::string ObjectName( const std::string& name )
+    {
+        return name.empty() || name[0] != '/' ? "/" + name : name;
+    }
+
+private:
+    std::string m_name = ""; ///< name of the shared memory object
+    size_t m_nslots = 8; ///< number of the slots
+    Policy m_policy = Overwrite; ///< producer policy
+    char* m_data = nullptr; ///< mapped memory
+    size_t m_size = 0; ///< size of the mapped memory
+
+public:
+    FrameRing() = default;
+    FrameRing( const std::string& name, const size_t nslots, const Policy policy ):
+        m_name( ObjectName( name ) ),
+        m_nslots( nslots > 0 ? nslots : 1 ),
+        m_policy( policy ) {}
+    FrameRing( const FrameRing& ) = delete;
+    FrameRing& operator = ( const FrameRing& ) = delete;
+    ~FrameRing() { this->close(); }
+
+    const std::string& name() const { return m_name; }
+    size_t numberOfSlots() const { return m_nslots; }
+    Policy policy() const { return m_policy; }
+    bool isOpened() const { return m_data != nullptr; }
+    size_t slotSize() const { return m_data ? this->header()->slot_size : 0; }
+    size_t numberOfPublishedFrames() const { return m_data ? this->header()->write_sequence.load() : 0; }
+    size_t numberOfDroppedFrames() const { return m_data ? this->header()->ndropped.load() : 0; }
+
+    // Creates the shared memory object for the frames of up to the slot size
+    // in bytes. An existing object with the same name is replaced.
+    bool open( const size_t slot_size ) override
+    {
+        this->close();
+        if ( m_name.empty() || slot_size == 0 ) { return false; }
+
+        ::shm_unlink( m_name.c_str() );
+        const int fd = ::shm_open( m_name.c_str(), O_CREAT | O_RDWR | O_EXCL, 0644 );
+        if ( fd < 0 ) { return false; }
+
+        const auto stride = SlotStride( slot_size );
+        const auto size = HeaderSize() + stride * m_nslots;
+        if ( ::ftruncate( fd, static_cast<off_t>( size ) ) != 0 )
+        {
+            ::close( fd );
+            ::shm_unlink( m_name.c_str() );
+            return false;
+        }
+
+        void* data = ::mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        ::close( fd );
+        if ( data == MAP_FAILED )
+        {
+            ::shm_unlink( m_name.c_str() );
+            return false;
+        }
+
+        // The memory is zero-filled by ftruncate, so the sequence numbers and
+        // the slot states are initialized as zero. The magic is written last
+        // to be checked by the consumers.
+        m_data = static_cast<char*>( data );
+        m_size = size;
+        auto* h = this->header();
+        h->version = Version;
+        h->policy = static_cast<std::uint32_t>( m_policy );
+        h->nslots = m_nslots;
+        h->slot_size = slot_size;
+        h->slot_stride = stride;
+        std::atomic_thread_fence( std::memory_order_release );
+        std::memcpy( h->magic, Magic(), sizeof( h->magic ) );
+        return true;
+    }
+
+    // Marks the ring as closed and removes the shared memory object. The
+    // attached consumers can still read the frames left in the ring.
+    void close() override
+    {
+        if ( !m_data ) { return; }
+        this->header()->closed.store( 1, std::memory_order_release );
+        ::munmap( m_data, m_size );
+        ::shm_unlink( m_name.c_str() );
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    // Publishes the frame without blocking. Returns false if the frame is
+    // dropped (the ring is full with the Drop policy, or the frame exceeds
+    // the slot size). Called from a single thread.
+    bool publish(
+        const size_t time_step,
+        const size_t location,
+        const size_t width,
+        const size_t height,
+        const size_t channels,
+        const void* pixels ) override
+    {
+        if ( !m_data ) { return false; }
+
+        auto* h = this->header();
+        const auto size = width * height * channels;
+        const auto n = h->write_sequence.load( std::memory_order_relaxed );
+        const bool full = n - h->read_sequence.load( std::memory_order_acquire ) >= m_nslots;
+        if ( size > h->slot_size || ( m_policy == Drop && full ) )
+        {
+            h->ndropped.fetch_add( 1, std::memory_order_relaxed );
+            return false;
+        }
+
+        const auto now = std::chrono::system_clock::now().time_since_epoch();
+        auto* slot = this->slot( n );
+        slot->state.store( 2 * n + 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+
+        slot->frame.sequence = n;
+        slot->frame.time_step = time_step;
+        slot->frame.location = location;
+        slot->frame.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>( now ).count();
+        slot->frame.width = static_cast<std::uint32_t>( width );
+        slot->frame.height = static_cast<std::uint32_t>( height );
+        slot->frame.channels = static_cast<std::uint32_t>( channels );
+        slot->frame.reserved = 0;
+        slot->frame.size = size;
+        std::memcpy( reinterpret_cast<char*>( slot ) + sizeof( Slot ), pixels, size );
+
+        slot->state.store( 2 * n + 2, std::memory_order_release );
+        h->write_sequence.store( n + 1, std::memory_order_release );
+        return true;
+    }
+
+private:
+    Header* header() const { return reinterpret_cast<Header*>( m_data ); }
+    Slot* slot( const std::uint64_t sequence ) const
+    {
+        const auto index = sequence % m_nslots;
+        return reinterpret_cast<Slot*>( m_data + HeaderSize() + index * this->header()->slot_stride );
+    }
+};
+
+/*===========================================================================*/
+/**
+ *  @brief  Consumer of the frame ring.
+ *
+ *  The frames are read in the order of the sequence numbers. The frames
+ *  overwritten before being read are skipped and counted as missed.
+ */
+/*===========================================================================*/
+class FrameRingReader
+{
+public:
+    using Frame = FrameRing::Frame;
+
+private:
+    std::string m_name = ""; ///< name of the shared memory object
+    char* m_data = nullptr; ///< mapped memory
+    size_t m_size = 0; ///< size of the mapped memory
+    std::uint64_t m_next = 0; ///< sequence number of the next frame
+    size_t m_nmissed = 0; ///< number of the frames overwritten before being read
+
+public:
+    FrameRingReader() = default;
+    explicit FrameRingReader( const std::string& name ) { this->open( name ); }
+    FrameRingReader( const FrameRingReader& ) = delete;
+    FrameRingReader& operator = ( const FrameRingReader& ) = delete;
+    ~FrameRingReader() { this->close(); }
+
+    const std::string& name() const { return m_name; }
+    bool isOpened() const { return m_data != nullptr; }
+    bool isClosed() const { return !m_data || this->header()->closed.load( std::memory_order_acquire ) != 0; }
+    FrameRing::Policy policy() const { return static_cast<FrameRing::Policy>( this->header()->policy ); }
+    size_t numberOfSlots() const { return this->header()->nslots; }
+    size_t slotSize() const { return this->header()->slot_size; }
+    size_t numberOfPublishedFrames() const { return this->header()->write_sequence.load( std::memory_order_acquire ); }
+    size_t numberOfDroppedFrames() const { return this->header()->ndropped.load( std::memory_order_relaxed ); }
+    size_t numberOfMissedFrames() const { return m_nmissed; }
+    std::uint64_t nextSequence() const { return m_next; }
+
+    bool open( const std::string& name )
+    {
+        this->close();
+        m_name = FrameRing::ObjectName( name );
+
+        const int fd = ::shm_open( m_name.c_str(), O_RDWR, 0 );
+        if ( fd < 0 ) { return false; }
+
+        struct stat st;
+        if ( ::fstat( fd, &st ) != 0 || st.st_size < static_cast<off_t>( FrameRing::HeaderSize() ) )
+        {
+            ::close( fd );
+            return false;
+        }
+
+        // Mapped as writable to update the read sequence with Drop policy.
+        void* data = ::mmap( nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        ::close( fd );
+        if ( data == MAP_FAILED ) { return false; }
+
+        m_data = static_cast<char*>( data );
+        m_size = static_cast<size_t>( st.st_size );
+        const auto* h = this->header();
+        const bool valid =
+            std::memcmp( h->magic, FrameRing::Magic(), sizeof( h->magic ) ) == 0 &&
+            h->version == FrameRing::Version &&
+            FrameRing::HeaderSize() + h->slot_stride * h->nslots <= m_size;
+        if ( !valid )
+        {
+            this->close();
+            return false;
+        }
+
+        m_next = h->read_sequence.load( std::memory_order_acquire );
+        m_nmissed = 0;
+        return true;
+    }
+
+    void close()
+    {
+        if ( m_data ) { ::munmap( m_data, m_size ); }
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    // Skips to the latest frame, e.g. for a live monitor.
+    void seekLatest()
+    {
+        const auto n = this->numberOfPublishedFrames();
+        if ( n > m_next + 1 ) { this->skip( n - 1 ); }
+    }
+
+    // Reads the next frame. Returns false if no new frame is published.
+    bool read( Frame& frame, std::vector<std::uint8_t>& pixels )
+    {
+        if ( !m_data ) { return false; }
+
+        auto* h = this->header();
+        for ( ;; )
+        {
+            const auto n = h->write_sequence.load( std::memory_order_acquire );
+            if ( m_next >= n ) { return false; }
+            if ( n - m_next > h->nslots ) { this->skip( n - h->nslots ); }
+
+            // The frame is valid only if the state of the slot is not changed
+            // while copying it.
+            const auto* slot = this->slot( m_next );
+            const auto state = slot->state.load( std::memory_order_acquire );
+            if ( state == 2 * m_next + 2 )
+            {
+                frame = slot->frame;
+                const auto size = std::min<std::uint64_t>( frame.size, h->slot_size );
+                pixels.resize( size );
+                std::memcpy( pixels.data(), reinterpret_cast<const char*>( slot ) + sizeof( FrameRing::Slot ), size );
+                std::atomic_thread_fence( std::memory_order_acquire );
+                if ( slot->state.load( std::memory_order_relaxed ) == state )
+                {
+                    this->advance( m_next + 1 );
+                    return true;
+                }
+            }
+
+            // Overwritten by the producer.
+            m_nmissed++;
+            this->advance( m_next + 1 );
+        }
+    }
+
+private:
+    FrameRing::Header* header() const { return reinterpret_cast<FrameRing::Header*>( m_data ); }
+    const FrameRing::Slot* slot( const std::uint64_t sequence ) const
+    {
+        const auto* h = this->header();
+        const auto index = sequence % h->nslots;
+        return reinterpret_cast<const FrameRing::Slot*>( m_data + FrameRing::HeaderSize() + index * h->slot_stride );
+    }
+
+    void skip( const std::uint64_t sequence )
+    {
+        m_nmissed += sequence - m_next;
+        this->advance( sequence );
+    }
+
+    void advance( const std::uint64_t sequence )
+    {
+        m_next = sequence;
+        if ( this->policy() == FrameRing::Drop )
+        {
+            this->header()->read_sequence.store( m_next, std::memory_order_release );
+        }
+    }
+};
+
+} // end of namespace InSituVis
@@ -0,0 +1,46 @@
+/*****************************************************************************/
+/**
+ *  @file   FrameSink.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <cstddef>
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Interface of the consumer of the rendered frames.
+ *
+ *  If a sink is given to the adaptor (Adaptor::setFrameSink), the final
+ *  RGBA frames are published into the sink in addition to the output image
+ *  files (e.g. FrameRing). The frames are published from the rendering
+ *  thread, so publish() must not wait for the consumers of the sink.
+ */
+/*===========================================================================*/
+class FrameSink
+{
+public:
+    virtual ~FrameSink() = default;
+
+    // Prepares the sink for the frames of up to the size in bytes. Called in
+    // the initialization of the adaptor.
+    virtual bool open( const size_t max_frame_size ) = 0;
+
+    // Publishes the frame. Returns false if the frame is dropped.
+    virtual bool publish(
+        const size_t time_step,
+        const size_t location,
+        const size_t width,
+        const size_t height,
+        const size_t channels,
+        const void* pixels ) = 0;
+
+    // Called in the finalization of the adaptor.
+    virtual void close() = 0;
+};
+
+} // end of namespace InSituVis
@@ -0,0 +1,41 @@
+/*****************************************************************************/
+/**
+ *  @file   FrameStore.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <string>
+#include <cstddef>
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Interface of the storage of the output files.
+ *
+ *  If a store is given to the adaptor (Adaptor::setFrameStore), the output
+ *  files are appended to the store instead of being written into the file
+ *  system (e.g. FrameContainer). Each file is named with the path relative
+ *  to the base output directory, and is appended from the writer threads.
+ */
+/*===========================================================================*/
+class FrameStore
+{
+public:
+    virtual ~FrameStore() = default;
+
+    // Sets the file of the store. Called in the initialization of the
+    // adaptor after the output directory is created.
+    virtual void open( const std::string& filename ) = 0;
+
+    // Appends the file. Called from the writer threads.
+    virtual bool append( const std::string& name, const void* data, const size_t size ) = 0;
+
+    // Makes the appended files readable, e.g. at each dump.
+    virtual bool flush() = 0;
+};
+
+} // end of namespace InSituVis
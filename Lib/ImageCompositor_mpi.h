@@ -0,0 +1,669 @@
+/*****************************************************************************/
+/**
+ *  @file   ImageCompositor_mpi.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#if defined( KVS_USE_MPI )
+#include <mpi.h>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include <kvs/Type>
+#include <kvs/ValueArray>
+#include <kvs/mpi/Communicator>
+#include <kvs/mpi/ImageCompositor>
+
+
+namespace InSituVis
+{
+
+namespace mpi
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Sort-last image compositor.
+ *
+ *  The partial images of the ranks are composited into the image at the
+ *  root rank with one of the methods below. The KVS method delegates the
+ *  composition to kvs::mpi::ImageCompositor (default).
+ *
+ *  - BinarySwap: the ranks exchange the halves of their regions in log2(n)
+ *    rounds. The ranks beyond the largest power of two are folded into
+ *    their neighbors first.
+ *  - RadixK: the ranks exchange the k-th parts of their regions in groups
+ *    of k ranks in each round, where the number of the ranks is factorized
+ *    into the factors of up to k (a larger prime factor makes its own round).
+ *  - DirectSend: each rank receives its part of the image from all of the
+ *    ranks in a single round.
+ *
+ *  Finally, the regions are gathered to the root. The messages are
+ *  compressed with the run-length encoding of the background pixels (depth
+ *  == 1 with depth testing, alpha == 0 with alpha blending), which are not
+ *  sent. With alpha blending, the ranks are ordered by the depth given for
+ *  each rank (front to back), and the pixels are composited with the over
+ *  operator on straight (non-premultiplied) alpha.
+ *
+ *  The composition can be started with start() and completed with wait(),
+ *  so that the next image is rendered while the messages are moving. The
+ *  rounds are received with persistent requests, which are kept while the
+ *  order of the ranks is not changed. The messages are sent with
+ *  non-blocking sends since their sizes change with the compression. The
+ *  KVS method composites the images in start().
+ *
+ *  A rectangle of the pixels drawn by the rank (screen-space bounding
+ *  rectangle of its sub-domain) can be given to start(), and the pixels out
+ *  of the rectangles of the ranks composited into a region are not scanned
+ *  for the run-length encoding. The pixels out of the rectangle must be the
+ *  background.
+ */
+/*===========================================================================*/
+class ImageCompositor
+{
+public:
+    using ColorBuffer = kvs::ValueArray<kvs::UInt8>;
+    using DepthBuffer = kvs::ValueArray<kvs::Real32>;
+
+    struct Rect
+    {
+        size_t x = 0; ///< left (pixels)
+        size_t y = 0; ///< top (pixels, top-down rows)
+        size_t width = 0; ///< width (pixels)
+        size_t height = 0; ///< height (pixels)
+        bool empty() const { return width == 0 || height == 0; }
+    };
+
+    enum Method
+    {
+        KVS, ///< kvs::mpi::ImageCompositor
+        BinarySwap, ///< binary-swap
+        RadixK, ///< radix-k
+        DirectSend ///< direct-send
+    };
+
+private:
+    kvs::mpi::Communicator& m_world; ///< MPI communicator
+    kvs::mpi::ImageCompositor m_compositor; ///< KVS compositor (KVS method)
+    Method m_method = KVS; ///< composition method
+    size_t m_radix = 4; ///< k of the radix-k method
+    bool m_enable_compression = true; ///< flag for the run-length encoding of the messages
+    size_t m_width = 0; ///< image width
+    size_t m_height = 0; ///< image height
+    bool m_depth_testing = true; ///< true: depth testing, false: alpha blending
+    size_t m_sent_bytes = 0; ///< bytes sent by this rank in the last run
+
+    struct Region { size_t begin; size_t end; };
+    struct Receive
+    {
+        int rank; ///< source rank
+        Region region; ///< region of the message
+        bool front; ///< true if the message is in front of the local pixels
+        bool fill; ///< true if the message replaces the local pixels (gather)
+        std::vector<char> buffer{}; ///< receive buffer
+        MPI_Request request = MPI_REQUEST_NULL; ///< persistent request
+    };
+    struct Stage
+    {
+        std::vector<std::pair<int,Region>> sends{}; ///< destination ranks and regions
+        std::vector<Receive> receives{}; ///< receives in the composition order
+        std::vector<int> group{}; ///< ranks composited in the local buffer before the stage
+    };
+
+    std::vector<int> m_order{}; ///< ranks in the composition order of the plan
+    std::vector<Stage> m_stages{}; ///< stages (fold, rounds and gather) of the plan
+    bool m_pending = false; ///< true while a composition is in progress
+    size_t m_stage = 0; ///< index of the current stage
+    size_t m_next_receive = 0; ///< index of the next receive in the current stage
+    bool m_posted = false; ///< true if the current stage is posted
+    ColorBuffer m_color_buffer{}; ///< color buffer in composition
+    DepthBuffer m_depth_buffer{}; ///< depth buffer in composition
+    std::vector<std::vector<char>> m_send_messages{}; ///< messages in sending
+    std::vector<MPI_Request> m_send_requests{}; ///< requests of the messages in sending
+    std::vector<Rect> m_rects{}; ///< rectangles of the ranks in composition (empty: no rectangle)
+
+public:
+    ImageCompositor( kvs::mpi::Communicator& world ): m_world( world ), m_compositor( world ) {}
+    ImageCompositor( const ImageCompositor& ) = delete;
+    ImageCompositor& operator = ( const ImageCompositor& ) = delete;
+
+    Method method() const { return m_method; }
+    size_t radix() const { return m_radix; }
+    bool isCompressionEnabled() const { return m_enable_compression; }
+    size_t sentBytes() const { return m_sent_bytes; }
+
+    // The method must be set before initialize().
+    void setMethod( const Method method, const size_t radix = 4 )
+    {
+        m_method = method;
+        m_radix = std::max( radix, size_t( 2 ) );
+    }
+
+    void setCompressionEnabled( const bool enable = true ) { m_enable_compression = enable; }
+
+    bool initialize( const size_t width, const size_t height, const bool depth_testing = true )
+    {
+        m_width = width;
+        m_height = height;
+        m_depth_testing = depth_testing;
+        this->release_plan();
+        if ( m_method == KVS ) { return m_compositor.initialize( width, height, depth_testing ); }
+        return true;
+    }
+
+    bool destroy()
+    {
+        this->wait();
+        this->release_plan();
+        if ( m_method == KVS ) { return m_compositor.destroy(); }
+        return true;
+    }
+
+    // Collective operation. Composites the images with depth testing.
+    bool run( ColorBuffer& color_buffer, DepthBuffer& depth_buffer )
+    {
+        return this->start( color_buffer, depth_buffer ) && this->wait();
+    }
+
+    // Collective operation. Composites the images with alpha blending in the
+    // order of the depths of the ranks.
+    bool run( ColorBuffer& color_buffer, const float depth )
+    {
+        return this->start( color_buffer, depth ) && this->wait();
+    }
+
+    // Starts the composition. The buffers are held and must not be modified
+    // until the composition is completed with wait(). A composition in
+    // progress is completed first.
+    bool start( ColorBuffer& color_buffer, DepthBuffer& depth_buffer )
+    {
+        if ( m_method == KVS ) { return m_compositor.run( color_buffer, depth_buffer ); }
+        if ( depth_buffer.size() < m_width * m_height ) { return false; }
+        return this->begin( color_buffer, depth_buffer, 0.0f, nullptr );
+    }
+
+    bool start( ColorBuffer& color_buffer, const float depth )
+    {
+        if ( m_method == KVS ) { return m_compositor.run( color_buffer, depth ); }
+        return this->begin( color_buffer, DepthBuffer(), depth, nullptr );
+    }
+
+    // Starts the composition with the rectangle drawn by the rank. Either all
+    // or none of the ranks give the rectangles.
+    bool start( ColorBuffer& color_buffer, DepthBuffer& depth_buffer, const Rect& rect )
+    {
+        if ( m_method == KVS ) { return m_compositor.run( color_buffer, depth_buffer ); }
+        if ( depth_buffer.size() < m_width * m_height ) { return false; }
+        return this->begin( color_buffer, depth_buffer, 0.0f, &rect );
+    }
+
+    bool start( ColorBuffer& color_buffer, const float depth, const Rect& rect )
+    {
+        if ( m_method == KVS ) { return m_compositor.run( color_buffer, depth ); }
+        return this->begin( color_buffer, DepthBuffer(), depth, &rect );
+    }
+
+    // Advances the composition without blocking. Returns true if completed.
+    bool test() { return !m_pending || this->progress( false ); }
+
+    // Completes the composition.
+    bool wait() { return !m_pending || this->progress( true ); }
+
+    bool isPending() const { return m_pending; }
+
+    // Returns the factors of the rounds for the number of the ranks.
+    static std::vector<int> Factors( const int nranks, const Method method, const size_t radix )
+    {
+        std::vector<int> factors;
+        if ( nranks <= 1 ) { return factors; }
+        switch ( method )
+        {
+        case DirectSend: factors.push_back( nranks ); break;
+        case BinarySwap: for ( int n = nranks; n > 1; n /= 2 ) { factors.push_back( 2 ); } break;
+        default:
+        {
+            // Prime factors combined up to k.
+            std::vector<int> primes;
+            int n = nranks;
+            for ( int p = 2; p * p <= n; p++ ) { while ( n % p == 0 ) { primes.push_back( p ); n /= p; } }
+            if ( n > 1 ) { primes.push_back( n ); }
+            int f = 1;
+            for ( const auto p : primes )
+            {
+                if ( f > 1 && static_cast<size_t>( f * p ) > radix ) { factors.push_back( f ); f = 1; }
+                f *= p;
+            }
+            factors.push_back( f );
+            break;
+        }
+        }
+        return factors;
+    }
+
+private:
+    static Region Split( const Region& r, const int f, const int j )
+    {
+        const size_t n = r.end - r.begin;
+        return { r.begin + n * j / f, r.begin + n * ( j + 1 ) / f };
+    }
+
+    bool is_active( const kvs::UInt8* color, const float* depth, const size_t i ) const
+    {
+        return depth ? depth[i] < 1.0f : color[ 4 * i + 3 ] != 0;
+    }
+
+    // Encodes the pixels in the region as (background color, runs of the
+    // skipped and the active pixels, active pixels). Only the pixels in the
+    // rectangle are scanned if given.
+    std::vector<char> encode( const kvs::UInt8* color, const float* depth, const Region& r, const Rect* rect ) const
+    {
+        std::vector<std::uint32_t> runs;
+        std::uint8_t background[4] = { 0, 0, 0, 0 };
+        bool has_background = false;
+        size_t nactive = 0;
+        if ( m_enable_compression )
+        {
+            std::vector<Region> spans;
+            if ( !rect ) { spans.push_back( r ); }
+            else
+            {
+                for ( size_t y = rect->y; y < rect->y + rect->height; y++ )
+                {
+                    const size_t begin = std::max( r.begin, y * m_width + rect->x );
+                    const size_t end = std::min( r.end, y * m_width + rect->x + rect->width );
+                    if ( begin >= end ) { continue; }
+                    // The rows of a full-width rectangle are contiguous and
+                    // merged so that an active run is not split at the rows.
+                    if ( !spans.empty() && spans.back().end == begin ) { spans.back().end = end; }
+                    else { spans.push_back( { begin, end } ); }
+                }
+            }
+
+            size_t last = r.begin; // end of the last run
+            auto Push = [&] ( const size_t begin, const size_t end )
+            {
+                if ( begin > last && !has_background )
+                {
+                    std::memcpy( background, color + 4 * last, 4 );
+                    has_background = true;
+                }
+                runs.push_back( static_cast<std::uint32_t>( begin - last ) );
+                runs.push_back( static_cast<std::uint32_t>( end - begin ) );
+                nactive += end - begin;
+                last = end;
+            };
+            for ( const auto& span : spans )
+            {
+                size_t i = span.begin;
+                while ( i < span.end )
+                {
+                    while ( i < span.end && !this->is_active( color, depth, i ) ) { i++; }
+                    const size_t active_begin = i;
+                    while ( i < span.end && this->is_active( color, depth, i ) ) { i++; }
+                    if ( i > active_begin ) { Push( active_begin, i ); }
+                }
+            }
+            if ( last < r.end ) { Push( r.end, r.end ); }
+        }
+        else
+        {
+            runs = { 0, static_cast<std::uint32_t>( r.end - r.begin ) };
+            nactive = r.end - r.begin;
+        }
+
+        const size_t pixel_size = depth ? 8 : 4;
+        const auto nruns = static_cast<std::uint32_t>( runs.size() / 2 );
+        std::vector<char> message( 8 + runs.size() * 4 + nactive * pixel_size );
+        char* p = message.data();
+        std::memcpy( p, &nruns, 4 ); p += 4;
+        std::memcpy( p, background, 4 ); p += 4;
+        std::memcpy( p, runs.data(), runs.size() * 4 ); p += runs.size() * 4;
+
+        size_t i = r.begin;
+        for ( size_t k = 0; k < runs.size(); k += 2 )
+        {
+            i += runs[k];
+            std::memcpy( p, color + 4 * i, runs[k+1] * 4 ); p += runs[k+1] * 4;
+            if ( depth ) { std::memcpy( p, depth + i, runs[k+1] * 4 ); p += runs[k+1] * 4; }
+            i += runs[k+1];
+        }
+        return message;
+    }
+
+    // Decodes the message into the region. If front is true, the pixels in
+    // the message are in front of the local pixels (alpha blending). If fill
+    // is true, the skipped pixels are filled with the background.
+    void decode(
+        const std::vector<char>& message,
+        kvs::UInt8* color,
+        float* depth,
+        const Region& r,
+        const bool front,
+        const bool fill ) const
+    {
+        std::uint32_t nruns = 0;
+        std::uint8_t background[4];
+        const char* p = message.data();
+        std::memcpy( &nruns, p, 4 ); p += 4;
+        std::memcpy( background, p, 4 ); p += 4;
+        std::vector<std::uint32_t> runs( nruns * 2 );
+        std::memcpy( runs.data(), p, runs.size() * 4 ); p += runs.size() * 4;
+
+        size_t i = r.begin;
+        for ( size_t k = 0; k < runs.size(); k += 2 )
+        {
+            if ( fill )
+            {
+                for ( size_t j = i; j < i + runs[k]; j++ )
+                {
+                    std::memcpy( color + 4 * j, background, 4 );
+                    if ( depth ) { depth[j] = 1.0f; }
+                }
+            }
+            i += runs[k];
+
+            const auto n = runs[k+1];
+            const auto* c = reinterpret_cast<const kvs::UInt8*>( p ); p += n * 4;
+            const float* d = nullptr;
+            if ( depth ) { d = reinterpret_cast<const float*>( p ); p += n * 4; }
+            for ( size_t j = 0; j < n; j++, i++ )
+            {
+                if ( fill ) { std::memcpy( color + 4 * i, c + 4 * j, 4 ); }
+                else if ( depth ) { Depth( c + 4 * j, d[j], front, color + 4 * i, depth[i] ); }
+                else if ( front ) { Over( c + 4 * j, color + 4 * i, color + 4 * i ); }
+                else { Over( color + 4 * i, c + 4 * j, color + 4 * i ); }
+                if ( fill && depth ) { std::memcpy( depth + i, d + j, 4 ); }
+            }
+        }
+        if ( fill )
+        {
+            for ( ; i < r.end; i++ )
+            {
+                std::memcpy( color + 4 * i, background, 4 );
+                if ( depth ) { depth[i] = 1.0f; }
+            }
+        }
+    }
+
+    // The pixel of the lower rank wins at the same depth.
+    static void Depth( const kvs::UInt8* c, const float d, const bool front, kvs::UInt8* color, float& depth )
+    {
+        if ( d < depth || ( front && d == depth ) ) { std::memcpy( color, c, 4 ); depth = d; }
+    }
+
+    static void Over( const kvs::UInt8* front, const kvs::UInt8* back, kvs::UInt8* result )
+    {
+        const float af = front[3] / 255.0f;
+        const float ab = back[3] / 255.0f * ( 1.0f - af );
+        const float a = af + ab;
+        if ( a <= 0.0f ) { std::memcpy( result, back, 4 ); return; }
+        for ( int k = 0; k < 3; k++ )
+        {
+            const float c = ( front[k] * af + back[k] * ab ) / a;
+            result[k] = static_cast<kvs::UInt8>( std::min( c + 0.5f, 255.0f ) );
+        }
+        result[3] = static_cast<kvs::UInt8>( std::min( a * 255.0f + 0.5f, 255.0f ) );
+    }
+
+    static size_t MaxMessageSize( const Region& r, const size_t pixel_size )
+    {
+        // An active run is followed by at least one skipped pixel, since the
+        // contiguous rows of the rectangle are merged in encode().
+        const size_t n = r.end - r.begin;
+        return 4 + 4 + ( n / 2 + 1 ) * 8 + n * pixel_size;
+    }
+
+    // Bounding rectangle of the rectangles of the ranks.
+    Rect bounding_rect( const std::vector<int>& ranks ) const
+    {
+        if ( m_rects.empty() ) { return Rect(); }
+        size_t x0 = m_width, y0 = m_height, x1 = 0, y1 = 0;
+        for ( const auto k : ranks )
+        {
+            const auto& r = m_rects[k];
+            if ( r.empty() ) { continue; }
+            x0 = std::min( x0, r.x ); x1 = std::max( x1, r.x + r.width );
+            y0 = std::min( y0, r.y ); y1 = std::max( y1, r.y + r.height );
+        }
+        if ( x0 >= x1 || y0 >= y1 ) { return Rect(); }
+        return { x0, y0, x1 - x0, y1 - y0 };
+    }
+
+    void release_plan()
+    {
+        for ( auto& stage : m_stages )
+        {
+            for ( auto& r : stage.receives )
+            {
+                if ( r.request != MPI_REQUEST_NULL ) { MPI_Request_free( &r.request ); }
+            }
+        }
+        m_stages.clear();
+        m_order.clear();
+    }
+
+    // Builds the stages of the composition for the ranks in the order, and
+    // initializes the persistent receives.
+    void build_plan( const std::vector<int>& order )
+    {
+        if ( order == m_order && !m_stages.empty() ) { return; }
+        this->release_plan();
+        m_order = order;
+
+        MPI_Comm comm = m_world.handler();
+        int rank = 0;
+        MPI_Comm_rank( comm, &rank );
+        const int root = m_world.root();
+        const int nranks = static_cast<int>( order.size() );
+        const auto vrank = static_cast<int>( std::find( order.begin(), order.end(), rank ) - order.begin() );
+        const Region image = { 0, m_width * m_height };
+
+        // Fold the ranks beyond the power of two into the front neighbors.
+        std::vector<int> participants = order;
+        if ( m_method == BinarySwap )
+        {
+            int p2 = 1;
+            while ( p2 * 2 <= nranks ) { p2 *= 2; }
+            const int extra = nranks - p2;
+            Stage fold;
+            if ( vrank < 2 * extra )
+            {
+                if ( vrank % 2 == 1 ) { fold.sends.push_back( { order[ vrank - 1 ], image } ); }
+                else { fold.receives.push_back( { order[ vrank + 1 ], image, false, false } ); }
+            }
+            fold.group = { rank };
+            m_stages.push_back( std::move( fold ) );
+            participants.clear();
+            for ( int v = 0; v < nranks; v++ ) { if ( v >= 2 * extra || v % 2 == 0 ) { participants.push_back( order[v] ); } }
+        }
+
+        // Exchange the parts of the regions in the rounds.
+        const auto nparticipants = static_cast<int>( participants.size() );
+        const auto v = static_cast<int>( std::find( participants.begin(), participants.end(), rank ) - participants.begin() );
+        std::vector<Region> regions( nparticipants, image ); // regions of all of the participants
+        std::vector<std::vector<int>> groups( nparticipants ); // ranks composited in the buffers of the participants
+        const int extra = nranks - nparticipants; // folded ranks
+        for ( int u = 0; u < nparticipants; u++ )
+        {
+            groups[u] = { participants[u] };
+            if ( u < extra ) { groups[u].push_back( order[ 2 * u + 1 ] ); }
+        }
+        int stride = 1;
+        for ( const auto f : Factors( nparticipants, m_method, m_radix ) )
+        {
+            Stage round;
+            if ( v < nparticipants )
+            {
+                round.group = groups[v];
+                const int d = ( v / stride ) % f;
+                const int base = v - d * stride;
+                const auto region = Split( regions[v], f, d );
+                for ( int j = d - 1; j >= 0; j-- ) { round.receives.push_back( { participants[ base + j * stride ], region, true, false } ); }
+                for ( int j = d + 1; j < f; j++ ) { round.receives.push_back( { participants[ base + j * stride ], region, false, false } ); }
+                for ( int j = 0; j < f; j++ )
+                {
+                    if ( j != d ) { round.sends.push_back( { participants[ base + j * stride ], Split( regions[v], f, j ) } ); }
+                }
+            }
+            m_stages.push_back( std::move( round ) );
+            for ( int u = 0; u < nparticipants; u++ ) { regions[u] = Split( regions[u], f, ( u / stride ) % f ); }
+            auto merged = groups;
+            for ( int u = 0; u < nparticipants; u++ )
+            {
+                const int base = u - ( ( u / stride ) % f ) * stride;
+                merged[u].clear();
+                for ( int j = 0; j < f; j++ )
+                {
+                    const auto& g = groups[ base + j * stride ];
+                    merged[u].insert( merged[u].end(), g.begin(), g.end() );
+                }
+            }
+            groups.swap( merged );
+            stride *= f;
+        }
+
+        // Gather the regions to the root.
+        Stage gather;
+        if ( rank != root )
+        {
+            if ( v < nparticipants ) { gather.sends.push_back( { root, regions[v] } ); gather.group = groups[v]; }
+        }
+        else
+        {
+            for ( int u = 0; u < nparticipants; u++ )
+            {
+                if ( participants[u] != root ) { gather.receives.push_back( { participants[u], regions[u], false, true } ); }
+            }
+        }
+        m_stages.push_back( std::move( gather ) );
+
+        const size_t pixel_size = m_depth_testing ? 8 : 4;
+        for ( size_t k = 0; k < m_stages.size(); k++ )
+        {
+            for ( auto& r : m_stages[k].receives )
+            {
+                r.buffer.resize( MaxMessageSize( r.region, pixel_size ) );
+                const int tag = 100 + static_cast<int>( k );
+                MPI_Recv_init( r.buffer.data(), static_cast<int>( r.buffer.size() ), MPI_BYTE, r.rank, tag, comm, &r.request );
+            }
+        }
+    }
+
+    bool begin( ColorBuffer& color_buffer, const DepthBuffer& depth_buffer, const float rank_depth, const Rect* rect )
+    {
+        this->wait();
+        m_sent_bytes = 0;
+        MPI_Comm comm = m_world.handler();
+        int nranks = 0;
+        MPI_Comm_size( comm, &nranks );
+        if ( color_buffer.size() < m_width * m_height * 4 ) { return false; }
+        if ( nranks == 1 ) { return true; }
+
+        // Ranks in the composition order (front to back with alpha blending).
+        std::vector<int> order( nranks );
+        std::iota( order.begin(), order.end(), 0 );
+        m_rects.clear();
+        if ( !m_depth_testing || rect )
+        {
+            // The depths and the rectangles of the ranks are gathered at once.
+            const Rect r = rect ? *rect : Rect();
+            const double local[5] = { rank_depth, double( r.x ), double( r.y ), double( r.width ), double( r.height ) };
+            std::vector<double> values( nranks * 5 );
+            MPI_Allgather( local, 5, MPI_DOUBLE, values.data(), 5, MPI_DOUBLE, comm );
+            auto Depth = [&] ( int k ) { return values[ k * 5 ]; };
+            if ( !m_depth_testing )
+            {
+                std::stable_sort( order.begin(), order.end(), [&] ( int a, int b ) { return Depth( a ) < Depth( b ); } );
+            }
+            if ( rect )
+            {
+                m_rects.resize( nranks );
+                for ( int k = 0; k < nranks; k++ )
+                {
+                    const auto* v = &values[ k * 5 + 1 ];
+                    m_rects[k] = { size_t( v[0] ), size_t( v[1] ), size_t( v[2] ), size_t( v[3] ) };
+                }
+            }
+        }
+        this->build_plan( order );
+
+        m_color_buffer = color_buffer;
+        m_depth_buffer = depth_buffer;
+        m_stage = 0;
+        m_next_receive = 0;
+        m_posted = false;
+        m_pending = true;
+        this->progress( false );
+        return true;
+    }
+
+    // Posts the stages and composites the received regions in order. Returns
+    // true if the composition is completed.
+    bool progress( const bool blocking )
+    {
+        MPI_Comm comm = m_world.handler();
+        auto* color = m_color_buffer.data();
+        auto* depth = m_depth_testing ? m_depth_buffer.data() : nullptr;
+        while ( m_stage < m_stages.size() )
+        {
+            auto& stage = m_stages[ m_stage ];
+            if ( !m_posted )
+            {
+                for ( auto& r : stage.receives ) { MPI_Start( &r.request ); }
+                const auto rect = this->bounding_rect( stage.group );
+                for ( const auto& send : stage.sends )
+                {
+                    m_send_messages.push_back( this->encode( color, depth, send.second, m_rects.empty() ? nullptr : &rect ) );
+                    const auto& message = m_send_messages.back();
+                    m_send_requests.emplace_back();
+                    m_sent_bytes += message.size();
+                    const int tag = 100 + static_cast<int>( m_stage );
+                    MPI_Isend( message.data(), static_cast<int>( message.size() ), MPI_BYTE, send.first, tag, comm, &m_send_requests.back() );
+                }
+                m_posted = true;
+                m_next_receive = 0;
+            }
+
+            while ( m_next_receive < stage.receives.size() )
+            {
+                auto& r = stage.receives[ m_next_receive ];
+                if ( blocking ) { MPI_Wait( &r.request, MPI_STATUS_IGNORE ); }
+                else
+                {
+                    int completed = 0;
+                    MPI_Test( &r.request, &completed, MPI_STATUS_IGNORE );
+                    if ( !completed ) { return false; }
+                }
+                this->decode( r.buffer, color, depth, r.region, r.front, r.fill );
+                m_next_receive++;
+            }
+            m_stage++;
+            m_posted = false;
+        }
+
+        const auto nrequests = static_cast<int>( m_send_requests.size() );
+        if ( blocking ) { MPI_Waitall( nrequests, m_send_requests.data(), MPI_STATUSES_IGNORE ); }
+        else
+        {
+            int completed = 0;
+            MPI_Testall( nrequests, m_send_requests.data(), &completed, MPI_STATUSES_IGNORE );
+            if ( !completed ) { return false; }
+        }
+        m_send_messages.clear();
+        m_send_requests.clear();
+        m_color_buffer = ColorBuffer();
+        m_depth_buffer = DepthBuffer();
+        m_pending = false;
+        return true;
+    }
+};
+
+} // end of namespace mpi
+
+} // end of namespace InSituVis
+
+#endif // KVS_USE_MPI
@@ -0,0 +1,97 @@
+/*****************************************************************************/
+/**
+ *  @file   ImageEncoder.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <kvs/Type>
+#include "ThreadPool.h"
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Image encoder class.
+ *
+ *  Pixel data (1 channel for gray, 4 channels for RGBA) are encoded and
+ *  written to the file directly. The alpha channel of RGBA data is ignored
+ *  except for the Raw format. Large BMP and PNG images are encoded in
+ *  parallel row strips when the number of threads is set.
+ *
+ *  The PNG format needs zlib, which is used only when INSITUVIS_USE_ZLIB
+ *  is defined (link with -lz). The JPEG format needs libjpeg, which is used
+ *  only when INSITUVIS_USE_JPEG is defined (link with -ljpeg). Otherwise,
+ *  the images of these formats cannot be encoded.
+ */
+/*===========================================================================*/
+class ImageEncoder
+{
+public:
+    enum Format
+    {
+        BMP, ///< uncompressed 24-bit bitmap
+        PNG, ///< lossless compression (zlib, INSITUVIS_USE_ZLIB)
+        JPEG, ///< lossy compression (libjpeg, INSITUVIS_USE_JPEG)
+        Raw ///< pixel data as is (no header)
+    };
+
+    using Bytes = std::vector<kvs::UInt8>;
+
+    // Encoders
+    static ImageEncoder BMPEncoder() { return ImageEncoder( BMP ); }
+    static ImageEncoder PNGEncoder( const int level = 6 ) { return ImageEncoder( PNG, level ); }
+    static ImageEncoder JPEGEncoder( const int quality = 90 ) { return ImageEncoder( JPEG, quality ); }
+    static ImageEncoder RawEncoder() { return ImageEncoder( Raw ); }
+    static bool IsSupported( const Format format );
+
+private:
+    Format m_format = BMP; ///< image format
+    int m_level = 6; ///< compression level (PNG: 0-9) or quality (JPEG: 1-100)
+    size_t m_min_strip_pixels = 1024 * 1024; ///< min. number of pixels encoded in parallel
+    std::shared_ptr<InSituVis::ThreadPool> m_pool{}; ///< thread pool for strip encoding
+
+public:
+    ImageEncoder( const Format format = BMP, const int level = -1 );
+
+    Format format() const { return m_format; }
+    int level() const { return m_level; }
+    int quality() const { return m_level; }
+    size_t numberOfThreads() const { return m_pool ? m_pool->numberOfThreads() : 0; }
+    std::string extension() const;
+
+    void setNumberOfThreads( const size_t nthreads );
+    void setMinStripPixels( const size_t npixels ) { m_min_strip_pixels = npixels; }
+
+    bool write(
+        const std::string& filename,
+        const size_t width,
+        const size_t height,
+        const size_t nchannels,
+        const kvs::UInt8* pixels ) const;
+
+    Bytes encode(
+        const size_t width,
+        const size_t height,
+        const size_t nchannels,
+        const kvs::UInt8* pixels ) const;
+
+private:
+    size_t number_of_strips( const size_t width, const size_t height ) const;
+    template <typename Func>
+    void for_each_strip( const size_t nstrips, Func func ) const;
+
+    Bytes encode_bmp( const size_t w, const size_t h, const size_t c, const kvs::UInt8* pixels ) const;
+    Bytes encode_png( const size_t w, const size_t h, const size_t c, const kvs::UInt8* pixels ) const;
+    Bytes encode_jpeg( const size_t w, const size_t h, const size_t c, const kvs::UInt8* pixels ) const;
+    Bytes encode_raw( const size_t w, const size_t h, const size_t c, const kvs::UInt8* pixels ) const;
+};
+
+} // end of namespace InSituVis
+
+#include "ImageEncoder.hpp"
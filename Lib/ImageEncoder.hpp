@@ -0,0 +1,394 @@
+/*****************************************************************************/
+/**
+ *  @file   ImageEncoder.hpp
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#if defined( INSITUVIS_USE_ZLIB )
+#include <zlib.h>
+#endif
+#if defined( INSITUVIS_USE_JPEG )
+#include <cstdio>
+#include <cstdlib>
+#include <csetjmp>
+#include <jpeglib.h>
+#endif
+
+
+namespace
+{
+
+inline void Put16BE( InSituVis::ImageEncoder::Bytes& bytes, const size_t v )
+{
+    bytes.push_back( kvs::UInt8( ( v >> 8 ) & 0xFF ) );
+    bytes.push_back( kvs::UInt8( v & 0xFF ) );
+}
+
+inline void Put32BE( InSituVis::ImageEncoder::Bytes& bytes, const size_t v )
+{
+    Put16BE( bytes, ( v >> 16 ) & 0xFFFF );
+    Put16BE( bytes, v & 0xFFFF );
+}
+
+inline void Put16LE( kvs::UInt8* p, const size_t v )
+{
+    p[0] = kvs::UInt8( v & 0xFF );
+    p[1] = kvs::UInt8( ( v >> 8 ) & 0xFF );
+}
+
+inline void Put32LE( kvs::UInt8* p, const size_t v )
+{
+    Put16LE( p, v & 0xFFFF );
+    Put16LE( p + 2, ( v >> 16 ) & 0xFFFF );
+}
+
+} // end of namespace
+
+
+namespace InSituVis
+{
+
+inline ImageEncoder::ImageEncoder( const Format format, const int level ):
+    m_format( format )
+{
+    switch ( format )
+    {
+    case PNG: m_level = level < 0 ? 6 : std::min( level, 9 ); break;
+    case JPEG: m_level = level < 0 ? 90 : std::min( std::max( level, 1 ), 100 ); break;
+    default: m_level = level; break;
+    }
+}
+
+inline bool ImageEncoder::IsSupported( const Format format )
+{
+    switch ( format )
+    {
+#if !defined( INSITUVIS_USE_ZLIB )
+    case PNG: return false;
+#endif
+#if !defined( INSITUVIS_USE_JPEG )
+    case JPEG: return false;
+#endif
+    default: return true;
+    }
+}
+
+inline std::string ImageEncoder::extension() const
+{
+    switch ( m_format )
+    {
+    case PNG: return ".png";
+    case JPEG: return ".jpg";
+    case Raw: return ".raw";
+    default: return ".bmp";
+    }
+}
+
+inline void ImageEncoder::setNumberOfThreads( const size_t nthreads )
+{
+    if ( nthreads > 0 ) { m_pool = std::make_shared<InSituVis::ThreadPool>( nthreads ); }
+    else { m_pool.reset(); }
+}
+
+inline bool ImageEncoder::write(
+    const std::string& filename,
+    const size_t width,
+    const size_t height,
+    const size_t nchannels,
+    const kvs::UInt8* pixels ) const
+{
+    const auto bytes = this->encode( width, height, nchannels, pixels );
+    if ( bytes.empty() ) { return false; }
+
+    std::ofstream file( filename, std::ios::binary );
+    if ( !file ) { return false; }
+
+    file.write( reinterpret_cast<const char*>( bytes.data() ), bytes.size() );
+    return file.good();
+}
+
+inline ImageEncoder::Bytes ImageEncoder::encode(
+    const size_t width,
+    const size_t height,
+    const size_t nchannels,
+    const kvs::UInt8* pixels ) const
+{
+    if ( nchannels != 1 && nchannels != 4 ) { return {}; }
+    if ( width == 0 || height == 0 ) { return {}; }
+
+    switch ( m_format )
+    {
+    case PNG: return this->encode_png( width, height, nchannels, pixels );
+    case JPEG: return this->encode_jpeg( width, height, nchannels, pixels );
+    case Raw: return this->encode_raw( width, height, nchannels, pixels );
+    default: return this->encode_bmp( width, height, nchannels, pixels );
+    }
+}
+
+inline size_t ImageEncoder::number_of_strips( const size_t width, const size_t height ) const
+{
+    if ( !m_pool || m_pool->numberOfThreads() == 0 ) { return 1; }
+    if ( width * height < m_min_strip_pixels ) { return 1; }
+    return std::min( m_pool->numberOfThreads() + 1, std::max( height / 8, size_t(1) ) );
+}
+
+template <typename Func>
+inline void ImageEncoder::for_each_strip( const size_t nstrips, Func func ) const
+{
+    auto range = [&] ( const size_t begin, const size_t end )
+    {
+        for ( size_t i = begin; i < end; ++i ) { func( i ); }
+    };
+
+    if ( nstrips > 1 && m_pool ) { m_pool->parallelFor( nstrips, range, nstrips ); }
+    else { range( 0, nstrips ); }
+}
+
+inline ImageEncoder::Bytes ImageEncoder::encode_bmp(
+    const size_t w,
+    const size_t h,
+    const size_t c,
+    const kvs::UInt8* pixels ) const
+{
+    const size_t header_size = 14 + 40;
+    const size_t row_size = ( w * 3 + 3 ) & ~size_t(3);
+    const size_t image_size = row_size * h;
+
+    Bytes bytes( header_size + image_size, 0 );
+    auto* p = bytes.data();
+
+    // File header and info header.
+    p[0] = 'B'; p[1] = 'M';
+    Put32LE( p + 2, bytes.size() );
+    Put32LE( p + 10, header_size );
+    Put32LE( p + 14, 40 );
+    Put32LE( p + 18, w );
+    Put32LE( p + 22, h );
+    Put16LE( p + 26, 1 ); // planes
+    Put16LE( p + 28, 24 ); // bits per pixel
+    Put32LE( p + 34, image_size );
+    Put32LE( p + 38, 2835 ); // 72 dpi
+    Put32LE( p + 42, 2835 );
+
+    // Pixel data (bottom-up, BGR).
+    const size_t nstrips = this->number_of_strips( w, h );
+    const size_t rows = ( h + nstrips - 1 ) / nstrips;
+    this->for_each_strip( nstrips, [&] ( const size_t s )
+    {
+        const size_t j_end = std::min( ( s + 1 ) * rows, h );
+        for ( size_t j = s * rows; j < j_end; ++j )
+        {
+            const auto* src = pixels + j * w * c;
+            auto* dst = p + header_size + ( h - 1 - j ) * row_size;
+            for ( size_t i = 0; i < w; ++i, src += c, dst += 3 )
+            {
+                dst[0] = src[ c == 1 ? 0 : 2 ];
+                dst[1] = src[ c == 1 ? 0 : 1 ];
+                dst[2] = src[0];
+            }
+        }
+    } );
+
+    return bytes;
+}
+
+inline ImageEncoder::Bytes ImageEncoder::encode_png(
+    const size_t w,
+    const size_t h,
+    const size_t c,
+    const kvs::UInt8* pixels ) const
+{
+#if defined( INSITUVIS_USE_ZLIB )
+    const size_t oc = c == 1 ? 1 : 3; // gray or RGB
+    const size_t stride = 1 + w * oc; // filter type byte + pixel data
+
+    // Each strip is filtered and compressed to a raw deflate stream
+    // independently. The streams are concatenated by ending every strip
+    // except the last one with a sync flush, and the checksums are combined.
+    struct Strip { Bytes data; uLong adler = 1; size_t length = 0; bool ok = true; };
+    const size_t nstrips = this->number_of_strips( w, h );
+    const size_t rows = ( h + nstrips - 1 ) / nstrips;
+    std::vector<Strip> strips( nstrips );
+    this->for_each_strip( nstrips, [&] ( const size_t s )
+    {
+        auto& strip = strips[s];
+        const size_t j_begin = std::min( s * rows, h );
+        const size_t j_end = std::min( ( s + 1 ) * rows, h );
+        if ( j_begin == j_end ) { return; }
+
+        // Sub filter: each byte is stored as the difference from the
+        // corresponding byte of the left pixel.
+        Bytes filtered( ( j_end - j_begin ) * stride );
+        auto* dst = filtered.data();
+        for ( size_t j = j_begin; j < j_end; ++j )
+        {
+            *(dst++) = 1;
+            const auto* src = pixels + j * w * c;
+            for ( size_t i = 0; i < w; ++i, src += c )
+            {
+                for ( size_t k = 0; k < oc; ++k )
+                {
+                    *(dst++) = kvs::UInt8( src[k] - ( i > 0 ? src[ k - c ] : 0 ) );
+                }
+            }
+        }
+
+        z_stream z;
+        std::memset( &z, 0, sizeof( z ) );
+        if ( deflateInit2( &z, m_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+        {
+            strip.ok = false;
+            return;
+        }
+
+        const bool last = j_end == h;
+        strip.data.resize( deflateBound( &z, filtered.size() ) + 16 );
+        z.next_in = filtered.data();
+        z.avail_in = static_cast<uInt>( filtered.size() );
+        z.next_out = strip.data.data();
+        z.avail_out = static_cast<uInt>( strip.data.size() );
+        for ( ;; )
+        {
+            const int ret = deflate( &z, last ? Z_FINISH : Z_SYNC_FLUSH );
+            if ( ret == Z_STREAM_ERROR ) { strip.ok = false; break; }
+            if ( last ? ret == Z_STREAM_END : ( z.avail_in == 0 && z.avail_out > 0 ) ) { break; }
+
+            // Grow the output buffer.
+            const size_t used = strip.data.size() - z.avail_out;
+            strip.data.resize( strip.data.size() * 2 );
+            z.next_out = strip.data.data() + used;
+            z.avail_out = static_cast<uInt>( strip.data.size() - used );
+        }
+        strip.data.resize( strip.data.size() - z.avail_out );
+        deflateEnd( &z );
+
+        strip.adler = adler32( adler32( 0L, Z_NULL, 0 ), filtered.data(), static_cast<uInt>( filtered.size() ) );
+        strip.length = filtered.size();
+    } );
+
+    // zlib stream.
+    Bytes idat = { 0x78, 0x9C };
+    uLong adler = adler32( 0L, Z_NULL, 0 );
+    for ( const auto& strip : strips )
+    {
+        if ( !strip.ok ) { return {}; }
+        if ( strip.length == 0 ) { continue; }
+        idat.insert( idat.end(), strip.data.begin(), strip.data.end() );
+        adler = adler32_combine( adler, strip.adler, static_cast<z_off_t>( strip.length ) );
+    }
+    Put32BE( idat, adler );
+
+    // PNG chunks.
+    Bytes bytes = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    auto put_chunk = [&] ( const char* type, const Bytes& data )
+    {
+        Put32BE( bytes, data.size() );
+        const size_t offset = bytes.size();
+        bytes.insert( bytes.end(), type, type + 4 );
+        bytes.insert( bytes.end(), data.begin(), data.end() );
+        const auto crc = crc32( crc32( 0L, Z_NULL, 0 ), bytes.data() + offset, static_cast<uInt>( data.size() + 4 ) );
+        Put32BE( bytes, crc );
+    };
+
+    Bytes ihdr;
+    Put32BE( ihdr, w );
+    Put32BE( ihdr, h );
+    ihdr.push_back( 8 ); // bit depth
+    ihdr.push_back( c == 1 ? 0 : 2 ); // color type (gray or RGB)
+    ihdr.push_back( 0 ); // compression method
+    ihdr.push_back( 0 ); // filter method
+    ihdr.push_back( 0 ); // interlace method
+
+    put_chunk( "IHDR", ihdr );
+    put_chunk( "IDAT", idat );
+    put_chunk( "IEND", {} );
+
+    return bytes;
+#else
+    return {};
+#endif
+}
+
+inline ImageEncoder::Bytes ImageEncoder::encode_jpeg(
+    const size_t w,
+    const size_t h,
+    const size_t c,
+    const kvs::UInt8* pixels ) const
+{
+#if defined( INSITUVIS_USE_JPEG )
+    // The default error handler of libjpeg exits the program, so the errors
+    // are returned to the compression with longjmp instead. The states
+    // changed by libjpeg are kept out of the function calling setjmp, whose
+    // non-volatile locals are indeterminate after longjmp.
+    struct ErrorManager { jpeg_error_mgr mgr; std::jmp_buf jump; };
+    ErrorManager error;
+    jpeg_compress_struct cinfo = {};
+    cinfo.err = jpeg_std_error( &error.mgr );
+    error.mgr.error_exit = [] ( j_common_ptr info )
+    {
+        std::longjmp( reinterpret_cast<ErrorManager*>( info->err )->jump, 1 );
+    };
+
+    unsigned char* buffer = nullptr;
+    unsigned long length = 0;
+    Bytes row( c == 1 ? 0 : w * 3 );
+    auto compress = [&] () -> bool
+    {
+        if ( setjmp( error.jump ) ) { return false; }
+
+        jpeg_create_compress( &cinfo );
+        jpeg_mem_dest( &cinfo, &buffer, &length );
+        cinfo.image_width = static_cast<JDIMENSION>( w );
+        cinfo.image_height = static_cast<JDIMENSION>( h );
+        cinfo.input_components = c == 1 ? 1 : 3;
+        cinfo.in_color_space = c == 1 ? JCS_GRAYSCALE : JCS_RGB;
+        jpeg_set_defaults( &cinfo );
+        jpeg_set_quality( &cinfo, m_level, TRUE );
+        jpeg_start_compress( &cinfo, TRUE );
+
+        while ( cinfo.next_scanline < cinfo.image_height )
+        {
+            const auto* src = pixels + cinfo.next_scanline * w * c;
+            JSAMPROW line = const_cast<JSAMPROW>( src );
+            if ( c != 1 )
+            {
+                // RGB(A) to RGB.
+                for ( size_t i = 0; i < w; ++i )
+                {
+                    row[ 3 * i + 0 ] = src[ c * i + 0 ];
+                    row[ 3 * i + 1 ] = src[ c * i + 1 ];
+                    row[ 3 * i + 2 ] = src[ c * i + 2 ];
+                }
+                line = row.data();
+            }
+            jpeg_write_scanlines( &cinfo, &line, 1 );
+        }
+        jpeg_finish_compress( &cinfo );
+        return true;
+    };
+
+    const bool compressed = compress();
+    jpeg_destroy_compress( &cinfo );
+
+    Bytes bytes;
+    if ( compressed ) { bytes.assign( buffer, buffer + length ); }
+    std::free( buffer );
+    return bytes;
+#else
+    return {};
+#endif
+}
+
+inline ImageEncoder::Bytes ImageEncoder::encode_raw(
+    const size_t w,
+    const size_t h,
+    const size_t c,
+    const kvs::UInt8* pixels ) const
+{
+    return Bytes( pixels, pixels + w * h * c );
+}
+
+} // end of namespace InSituVis
@@ -0,0 +1,178 @@
+/*****************************************************************************/
+/**
+ *  @file   ImageWriter.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <string>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <kvs/Timer>
+#include <kvs/StampTimer>
+#include <kvs/Message>
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Image writer class.
+ *
+ *  Image files are written by a pool of background threads. The jobs are
+ *  stored in a bounded queue and the caller is blocked while the queue is
+ *  full (backpressure). If no thread is started, each job is executed
+ *  immediately in the calling thread (synchronous writing).
+ */
+/*===========================================================================*/
+class ImageWriter
+{
+public:
+    using Function = std::function<bool(const std::string&)>;
+
+    struct Job
+    {
+        std::string filename; ///< output filename
+        Function write; ///< function to encode and write the buffer
+    };
+
+private:
+    size_t m_max_jobs = 32; ///< max. number of jobs in the queue
+    size_t m_nactive = 0; ///< number of jobs being processed by the threads
+    bool m_terminated = false; ///< flag for terminating the threads
+    std::vector<std::thread> m_threads{}; ///< writer threads
+    std::queue<Job> m_jobs{}; ///< job queue
+    std::mutex m_mutex{}; ///< mutex for the job queue
+    std::condition_variable m_pushed{}; ///< notified when a job is pushed
+    std::condition_variable m_popped{}; ///< notified when a job is popped or completed
+    kvs::Timer m_timer{}; ///< timer for measuring the drain time
+    float m_busy_time = 0.0f; ///< busy time of the threads since the last stamp [msec]
+    kvs::StampTimer m_drain_timer{}; ///< busy time of the threads in each time step
+
+public:
+    ImageWriter() = default;
+    ImageWriter( const ImageWriter& ) = delete;
+    ImageWriter& operator = ( const ImageWriter& ) = delete;
+    ~ImageWriter() { this->stop(); }
+
+    bool isAsync() const { return !m_threads.empty(); }
+    size_t numberOfThreads() const { return m_threads.size(); }
+    size_t maxNumberOfJobs() const { return m_max_jobs; }
+    kvs::StampTimer& drainTimer() { return m_drain_timer; }
+
+    void start( const size_t nthreads, const size_t max_jobs = 32 )
+    {
+        this->stop();
+
+        m_max_jobs = max_jobs == 0 ? 1 : max_jobs;
+        m_terminated = false;
+        for ( size_t i = 0; i < nthreads; ++i )
+        {
+            m_threads.emplace_back( [this] { this->run(); } );
+        }
+    }
+
+    void stop()
+    {
+        if ( m_threads.empty() ) { return; }
+
+        this->flush();
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_terminated = true;
+        }
+        m_pushed.notify_all();
+
+        for ( auto& thread : m_threads ) { thread.join(); }
+        m_threads.clear();
+    }
+
+    void push( const std::string& filename, Function write )
+    {
+        if ( !this->isAsync() )
+        {
+            this->execute( { filename, write } );
+            return;
+        }
+
+        {
+            // Wait until the queue has a free slot (backpressure).
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_popped.wait( lock, [this] { return m_jobs.size() < m_max_jobs; } );
+
+            // Start measuring the drain time when the writer gets busy.
+            if ( m_jobs.empty() && m_nactive == 0 ) { m_timer.start(); }
+            m_jobs.push( { filename, write } );
+        }
+        m_pushed.notify_one();
+    }
+
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_popped.wait( lock, [this] { return m_jobs.empty() && m_nactive == 0; } );
+    }
+
+    // Stamps the time that the threads have been busy since the previous
+    // stamp (0 if idle). Called once per time step, so that the drain times
+    // are recorded step by step.
+    void stampDrainTime()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( !m_jobs.empty() || m_nactive > 0 )
+        {
+            m_timer.stop();
+            m_busy_time += m_drain_timer.time( m_timer );
+            m_timer.start();
+        }
+        m_drain_timer.stamp( m_busy_time );
+        m_busy_time = 0.0f;
+    }
+
+private:
+    void run()
+    {
+        for ( ;; )
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock( m_mutex );
+                m_pushed.wait( lock, [this] { return m_terminated || !m_jobs.empty(); } );
+                if ( m_jobs.empty() ) { return; } // terminated
+
+                job = std::move( m_jobs.front() );
+                m_jobs.pop();
+                m_nactive++;
+            }
+            m_popped.notify_all();
+
+            this->execute( job );
+
+            {
+                std::lock_guard<std::mutex> lock( m_mutex );
+                m_nactive--;
+                if ( m_jobs.empty() && m_nactive == 0 )
+                {
+                    m_timer.stop();
+                    m_busy_time += m_drain_timer.time( m_timer );
+                }
+            }
+            m_popped.notify_all();
+        }
+    }
+
+    void execute( const Job& job )
+    {
+        if ( !job.write( job.filename ) )
+        {
+            kvsMessageError() << "Cannot write " << job.filename << "." << std::endl;
+        }
+    }
+};
+
+} // end of namespace InSituVis
@@ -0,0 +1,152 @@
+/*****************************************************************************/
+/**
+ *  @file   MetricsBuffer.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Ring buffer of the recent values of a metric.
+ *
+ *  The latest values (up to the capacity) are kept, and the statistics are
+ *  computed over them. The values can be pushed and queried from different
+ *  threads (e.g. the visualization thread in async mode and the solver).
+ */
+/*===========================================================================*/
+class MetricsBuffer
+{
+public:
+    struct Statistics
+    {
+        size_t count = 0; ///< number of the values in the window
+        float last = 0.0f; ///< latest value
+        float average = 0.0f; ///< moving average
+        float min = 0.0f; ///< minimum value
+        float max = 0.0f; ///< maximum value
+        float p50 = 0.0f; ///< 50th percentile (median)
+        float p90 = 0.0f; ///< 90th percentile
+        float p99 = 0.0f; ///< 99th percentile
+    };
+
+private:
+    std::vector<float> m_values{}; ///< values in the window
+    size_t m_capacity = 64; ///< window size
+    size_t m_next = 0; ///< index of the next value in the buffer
+    size_t m_npushed = 0; ///< total number of the pushed values
+    mutable std::mutex m_mutex{}; ///< mutex for the values
+
+public:
+    MetricsBuffer() = default;
+    explicit MetricsBuffer( const size_t capacity ): m_capacity( std::max( capacity, size_t( 1 ) ) ) {}
+    MetricsBuffer( const MetricsBuffer& ) = delete;
+    MetricsBuffer& operator = ( const MetricsBuffer& ) = delete;
+
+    size_t capacity() const { return m_capacity; }
+    size_t numberOfPushedValues() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_npushed;
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        return m_values.size();
+    }
+
+    // Changes the window size. The values in the window are discarded.
+    void setCapacity( const size_t capacity )
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_capacity = std::max( capacity, size_t( 1 ) );
+        m_values.clear();
+        m_next = 0;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_values.clear();
+        m_next = 0;
+        m_npushed = 0;
+    }
+
+    void push( const float value )
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( m_values.size() < m_capacity ) { m_values.push_back( value ); }
+        else { m_values[ m_next ] = value; }
+        m_next = ( m_next + 1 ) % m_capacity;
+        m_npushed++;
+    }
+
+    float last() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( m_values.empty() ) { return 0.0f; }
+        return m_values[ ( m_next + m_capacity - 1 ) % m_capacity ];
+    }
+
+    float average() const
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        if ( m_values.empty() ) { return 0.0f; }
+        return std::accumulate( m_values.begin(), m_values.end(), 0.0f ) / m_values.size();
+    }
+
+    // Returns the p-th percentile (p in [0,100]) with the nearest-rank method.
+    float percentile( const float p ) const
+    {
+        std::vector<float> sorted;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            sorted = m_values;
+        }
+        std::sort( sorted.begin(), sorted.end() );
+        return Percentile( sorted, p );
+    }
+
+    Statistics statistics() const
+    {
+        Statistics stats;
+        std::vector<float> sorted;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            if ( m_values.empty() ) { return stats; }
+            sorted = m_values;
+            stats.last = m_values[ ( m_next + m_capacity - 1 ) % m_capacity ];
+        }
+        std::sort( sorted.begin(), sorted.end() );
+
+        stats.count = sorted.size();
+        stats.average = std::accumulate( sorted.begin(), sorted.end(), 0.0f ) / sorted.size();
+        stats.min = sorted.front();
+        stats.max = sorted.back();
+        stats.p50 = Percentile( sorted, 50.0f );
+        stats.p90 = Percentile( sorted, 90.0f );
+        stats.p99 = Percentile( sorted, 99.0f );
+        return stats;
+    }
+
+private:
+    static float Percentile( const std::vector<float>& sorted, const float p )
+    {
+        if ( sorted.empty() ) { return 0.0f; }
+        const float q = std::min( std::max( p, 0.0f ), 100.0f ) / 100.0f;
+        const auto rank = static_cast<size_t>( std::ceil( q * sorted.size() ) );
+        return sorted[ rank > 0 ? rank - 1 : 0 ];
+    }
+};
+
+} // end of namespace InSituVis
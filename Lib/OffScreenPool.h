@@ -0,0 +1,142 @@
+/*****************************************************************************/
+/**
+ *  @file   OffScreenPool.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+#include <kvs/OffScreen>
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Pool of off-screen rendering contexts.
+ *
+ *  Each thread creates and owns its own off-screen (e.g. OSMesa) context, so
+ *  that the GL calls for the context are always issued from the same thread.
+ *  A job is executed on every context at the same time. The calling thread
+ *  takes part in the job with the given screen as the context 0.
+ */
+/*===========================================================================*/
+class OffScreenPool
+{
+public:
+    using Screen = kvs::OffScreen;
+    using Job = std::function<void(Screen&,size_t)>;
+
+private:
+    bool m_terminated = false; ///< flag for terminating the threads
+    size_t m_generation = 0; ///< number of the submitted jobs
+    size_t m_nfinished = 0; ///< number of the threads finished the current job
+    Job m_job{}; ///< current job
+    std::vector<std::thread> m_threads{}; ///< rendering threads
+    std::mutex m_mutex{}; ///< mutex for the job
+    std::condition_variable m_started{}; ///< notified when a job is submitted
+    std::condition_variable m_finished{}; ///< notified when a thread finished the job
+
+public:
+    OffScreenPool() = default;
+    OffScreenPool( const OffScreenPool& ) = delete;
+    OffScreenPool& operator = ( const OffScreenPool& ) = delete;
+    ~OffScreenPool() { this->stop(); }
+
+    size_t numberOfThreads() const { return m_threads.size(); }
+    size_t numberOfContexts() const { return m_threads.size() + 1; }
+
+    void start( const size_t nthreads, const size_t width, const size_t height )
+    {
+        this->stop();
+
+        m_terminated = false;
+        m_nfinished = 0;
+        for ( size_t i = 0; i < nthreads; ++i )
+        {
+            const size_t context = i + 1;
+            m_threads.emplace_back( [this,context,width,height]
+            {
+                this->run( context, width, height );
+            } );
+        }
+
+        // Wait until all of the contexts are created.
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_finished.wait( lock, [this] { return m_nfinished == m_threads.size(); } );
+    }
+
+    void stop()
+    {
+        if ( m_threads.empty() ) { return; }
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_terminated = true;
+        }
+        m_started.notify_all();
+
+        for ( auto& thread : m_threads ) { thread.join(); }
+        m_threads.clear();
+    }
+
+    void execute( Screen& screen, Job job )
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_job = job;
+            m_nfinished = 0;
+            m_generation++;
+        }
+        m_started.notify_all();
+
+        job( screen, 0 );
+
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_finished.wait( lock, [this] { return m_nfinished == m_threads.size(); } );
+        m_job = nullptr;
+    }
+
+private:
+    void run( const size_t context, const size_t width, const size_t height )
+    {
+        Screen screen;
+        screen.setSize( width, height );
+        screen.create();
+
+        size_t generation = 0;
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            generation = m_generation;
+            m_nfinished++;
+        }
+        m_finished.notify_all();
+
+        for ( ;; )
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock( m_mutex );
+                m_started.wait( lock, [&] { return m_terminated || m_generation != generation; } );
+                if ( m_terminated ) { return; }
+
+                generation = m_generation;
+                job = m_job;
+            }
+
+            job( screen, context );
+
+            {
+                std::lock_guard<std::mutex> lock( m_mutex );
+                m_nfinished++;
+            }
+            m_finished.notify_all();
+        }
+    }
+};
+
+} // end of namespace InSituVis
@@ -28,6 +28,8 @@ private:
     std::string m_base_dirname = "Output"; ///< base directory name (e.g. "Output")
     std::string m_sub_dirname = "Process"; ///< sub directory name (e.g. "Process")
     std::string m_dirname = ""; ///< output directory name (e.g. "Output/Process0000")
+    bool m_lazy_creation = true; ///< flag for creating the sub-directory at the first write
+    bool m_created = false; ///< true after the output directory is created
 
 public:
     OutputDirectory(
@@ -41,6 +43,7 @@ public:
     const std::string& baseDirectoryName() const { return m_base_dirname; }
     const std::string& subDirectoryName() const { return m_sub_dirname; }
     const std::string& name() const { return m_dirname; }
+    bool isLazyCreationEnabled() const { return m_lazy_creation; }
 
     void setBaseDirectoryName( const std::string& dirname )
     {
@@ -52,6 +55,26 @@ public:
         m_sub_dirname = dirname;
     }
 
+    // If enabled, the sub-directory of each rank is not created by create()
+    // but by createSubDirectory(), which is called before writing the files
+    // into it, so that no directory is created on the ranks writing nothing.
+    void setLazyCreationEnabled( const bool enable = true )
+    {
+        m_lazy_creation = enable;
+    }
+
+    bool createSubDirectory()
+    {
+        if ( m_created || m_dirname.empty() ) { return true; }
+        if ( !kvs::Directory::Exists( m_dirname ) && mkdir( m_dirname.c_str(), 0777 ) != 0 )
+        {
+            kvsMessageError() << "Cannot create " << m_dirname << "." << std::endl;
+            return false;
+        }
+        m_created = true;
+        return true;
+    }
+
     bool create()
     {
         if ( !kvs::Directory::Exists( m_base_dirname ) )
@@ -64,6 +87,7 @@ public:
         }
 
         m_dirname = m_base_dirname;
+        m_created = true;
         return true;
     }
 
@@ -84,18 +108,9 @@ public:
 
         // Create sub-directories.
         const std::string rank_name = kvs::String::From( rank, 4, '0' );
-        const std::string output_dirname = m_base_dirname + sp + m_sub_dirname + rank_name + sp;
-        if ( !kvs::Directory::Exists( output_dirname ) )
-        {
-            if ( mkdir( output_dirname.c_str(), 0777 ) != 0 )
-            {
-                kvsMessageError() << "Cannot create " << output_dirname << "." << std::endl;
-                return false;
-            }
-        }
-
-        m_dirname = output_dirname;
-        return true;
+        m_dirname = m_base_dirname + sp + m_sub_dirname + rank_name + sp;
+        m_created = false;
+        return m_lazy_creation ? true : this->createSubDirectory();
     }
 #endif
 };
@@ -0,0 +1,267 @@
+/*****************************************************************************/
+/**
+ *  @file   Profiler.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Scoped-region profiler.
+ *
+ *  The regions measured with ProfileScope are recorded as complete events
+ *  into a buffer owned by each thread, and written as a Chrome trace-event
+ *  (JSON) timeline, which can be loaded into chrome://tracing or Perfetto.
+ *  The nesting of the regions is given by the time ranges in each thread.
+ *  Nothing is recorded while the profiler is disabled (default). The events
+ *  are moved from the buffers into the file at each write, so the memory
+ *  usage is bounded by the events recorded between the writes.
+ */
+/*===========================================================================*/
+class Profiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Event
+    {
+        const char* name; ///< region name (string literal)
+        Clock::time_point begin; ///< begin time
+        Clock::time_point end; ///< end time
+        long arg; ///< argument (e.g. viewpoint index), or -1
+    };
+
+private:
+    struct Buffer
+    {
+        size_t tid = 0; ///< thread index in the trace
+        bool named = false; ///< true after the thread name is written into the file
+        std::mutex mutex{}; ///< mutex for the events (locked by the writer)
+        std::vector<Event> events{}; ///< recorded events
+    };
+
+    std::atomic<bool> m_enabled{ false }; ///< flag for recording the events
+    int m_pid = 0; ///< process ID in the trace (e.g. MPI rank)
+    Clock::time_point m_origin = Clock::now(); ///< origin of the time stamps
+    std::mutex m_mutex{}; ///< mutex for the buffer list
+    std::vector<std::shared_ptr<Buffer>> m_buffers{}; ///< buffers for each thread
+    std::string m_filename{}; ///< trace file that the events have been written into
+
+public:
+    static Profiler& Instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    bool isEnabled() const { return m_enabled.load( std::memory_order_relaxed ); }
+    int processID() const { return m_pid; }
+
+    void setEnabled( const bool enable = true ) { m_enabled = enable; }
+    void setProcessID( const int pid ) { m_pid = pid; }
+
+    // Sets the origin of the time stamps to the current time. Called at the
+    // same time (e.g. after a barrier) on every process to align timelines.
+    void resetOrigin() { m_origin = Clock::now(); }
+
+    void record( const char* name, const Clock::time_point begin, const Clock::time_point end, const long arg = -1 )
+    {
+        auto& buffer = this->local_buffer();
+        std::lock_guard<std::mutex> lock( buffer.mutex );
+        buffer.events.push_back( { name, begin, end, arg } );
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        for ( auto& buffer : m_buffers )
+        {
+            std::lock_guard<std::mutex> buffer_lock( buffer->mutex );
+            buffer->events.clear();
+        }
+    }
+
+    // Appends the recorded events into the trace file in the trace-event
+    // format, and removes them from the buffers. The file is created at the
+    // first write, and the closing bracket is overwritten by the following
+    // writes, so the file is complete after each write.
+    bool write( const std::string& filename )
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        const bool created = filename != m_filename;
+        std::ostringstream events;
+        if ( created )
+        {
+            events << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << m_pid;
+            events << ",\"tid\":0,\"args\":{\"name\":\"rank " << m_pid << "\"}}";
+        }
+
+        for ( auto& buffer : m_buffers )
+        {
+            std::lock_guard<std::mutex> buffer_lock( buffer->mutex );
+            if ( created || !buffer->named )
+            {
+                events << "," << std::endl;
+                events << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << m_pid;
+                events << ",\"tid\":" << buffer->tid << ",\"args\":{\"name\":\"thread " << buffer->tid << "\"}}";
+                buffer->named = true;
+            }
+            for ( const auto& e : buffer->events )
+            {
+                const auto ts = std::chrono::duration<double,std::micro>( e.begin - m_origin ).count();
+                const auto dur = std::chrono::duration<double,std::micro>( e.end - e.begin ).count();
+                events << "," << std::endl;
+                events << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":" << m_pid;
+                events << ",\"tid\":" << buffer->tid;
+                events << ",\"ts\":" << std::fixed << ts << ",\"dur\":" << dur << std::defaultfloat;
+                if ( e.arg >= 0 ) { events << ",\"args\":{\"index\":" << e.arg << "}"; }
+                events << "}";
+            }
+            buffer->events.clear();
+        }
+
+        const std::string tail = "\n],\"displayTimeUnit\":\"ms\"}\n";
+        if ( created )
+        {
+            std::ofstream file( filename );
+            if ( !file ) { return false; }
+            file << "{\"traceEvents\":[" << std::endl << events.str() << tail;
+            m_filename = filename;
+            return file.good();
+        }
+
+        std::fstream file( filename, std::ios::in | std::ios::out );
+        if ( !file ) { return false; }
+        file.seekp( -static_cast<std::streamoff>( tail.size() ), std::ios::end );
+        file << events.str() << tail;
+        return file.good();
+    }
+
+    // Merges the events of the trace files (e.g. one for each rank) into a
+    // single timeline.
+    static bool Merge( const std::vector<std::string>& filenames, const std::string& filename )
+    {
+        std::ofstream file( filename );
+        if ( !file ) { return false; }
+
+        file << "{\"traceEvents\":[";
+        bool first = true;
+        for ( const auto& name : filenames )
+        {
+            std::ifstream input( name );
+            if ( !input ) { return false; }
+
+            const std::string text( ( std::istreambuf_iterator<char>( input ) ), std::istreambuf_iterator<char>() );
+            std::vector<std::string> events;
+            if ( !ReadEvents( text, events ) ) { return false; }
+            for ( const auto& e : events )
+            {
+                file << ( first ? "" : "," ) << std::endl << e;
+                first = false;
+            }
+        }
+        file << std::endl << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+        return true;
+    }
+
+    // Extracts the event objects in the "traceEvents" array of the trace.
+    // The objects are delimited by the JSON structure (the braces outside of
+    // the strings), so they may be written in any layout.
+    static bool ReadEvents( const std::string& text, std::vector<std::string>& events )
+    {
+        const auto key = text.find( "\"traceEvents\"" );
+        if ( key == std::string::npos ) { return false; }
+        auto pos = text.find( '[', key );
+        if ( pos == std::string::npos ) { return false; }
+
+        int depth = 0;
+        bool in_string = false;
+        size_t begin = 0;
+        for ( ++pos; pos < text.size(); ++pos )
+        {
+            const char c = text[ pos ];
+            if ( in_string )
+            {
+                if ( c == '\\' ) { ++pos; }
+                else if ( c == '"' ) { in_string = false; }
+                continue;
+            }
+
+            switch ( c )
+            {
+            case '"': in_string = true; break;
+            case '{': if ( depth++ == 0 ) { begin = pos; } break;
+            case '}':
+                if ( --depth < 0 ) { return false; }
+                if ( depth == 0 ) { events.push_back( text.substr( begin, pos - begin + 1 ) ); }
+                break;
+            case ']': if ( depth == 0 ) { return true; } break;
+            default: break;
+            }
+        }
+        return false;
+    }
+
+private:
+    Profiler() = default;
+
+    Buffer& local_buffer()
+    {
+        thread_local std::shared_ptr<Buffer> buffer;
+        if ( !buffer )
+        {
+            buffer = std::make_shared<Buffer>();
+            std::lock_guard<std::mutex> lock( m_mutex );
+            buffer->tid = m_buffers.size() + 1;
+            m_buffers.push_back( buffer );
+        }
+        return *buffer;
+    }
+};
+
+/*===========================================================================*/
+/**
+ *  @brief  Region measured from the construction to the destruction.
+ */
+/*===========================================================================*/
+class ProfileScope
+{
+private:
+    const char* m_name; ///< region name (string literal)
+    long m_arg; ///< argument (e.g. viewpoint index), or -1
+    bool m_enabled; ///< flag for recording the region
+    Profiler::Clock::time_point m_begin{}; ///< begin time
+
+public:
+    ProfileScope( const char* name, const long arg = -1 ):
+        m_name( name ),
+        m_arg( arg ),
+        m_enabled( Profiler::Instance().isEnabled() )
+    {
+        if ( m_enabled ) { m_begin = Profiler::Clock::now(); }
+    }
+
+    ~ProfileScope()
+    {
+        if ( m_enabled ) { Profiler::Instance().record( m_name, m_begin, Profiler::Clock::now(), m_arg ); }
+    }
+
+    ProfileScope( const ProfileScope& ) = delete;
+    ProfileScope& operator = ( const ProfileScope& ) = delete;
+};
+
+} // end of namespace InSituVis
@@ -5,10 +5,16 @@
  */
 /*****************************************************************************/
 #pragma once
+#include <kvs/Type>
 #include <kvs/ValueArray>
 #include <kvs/Vector2>
 #include <kvs/CubicImage>
 #include <array>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <algorithm>
 
 
 namespace InSituVis
@@ -16,49 +22,56 @@ namespace InSituVis
 
 /*===========================================================================*/
 /**
- *  @brief  Spherical buffer class.
+ *  @brief  Remap table from the cube faces to the stitched (equirectangular)
+ *          image.
+ *
+ *  The table depends only on the face size, so it is computed once for each
+ *  (width, height) and shared by all of the spherical buffers.
  */
 /*===========================================================================*/
-template <typename PixelType>
-class SphericalBuffer
+class SphericalBufferTable
 {
 public:
     using Direction = kvs::CubicImage::Direction;
-    using Buffer = kvs::ValueArray<PixelType>;
-    using Buffers = std::array<Buffer,Direction::NumberOfDirections>;
 
-    static std::string DirectionName( const Direction dir ) { return kvs::CubicImage::DirectionName( dir ); }
-    static kvs::Vec3 DirectionVector( const Direction dir ) { return kvs::CubicImage::DirectionVector( dir ); }
-    static kvs::Vec3 UpVector( const Direction dir ) { return kvs::CubicImage::UpVector( dir ); }
+    struct Entry
+    {
+        kvs::UInt32 index; ///< pixel index (x0, y0) in the face
+        kvs::UInt8 face; ///< face (direction)
+        kvs::UInt8 dx; ///< x1 - x0 (0 or 1)
+        kvs::UInt8 dy; ///< y1 - y0 (0 or 1)
+        kvs::UInt8 padding;
+        kvs::Real32 xratio; ///< bilinear weight
+        kvs::Real32 yratio; ///< bilinear weight
+    };
 
 private:
-    size_t m_width = 512; ///< width size of original image
-    size_t m_height = 512; ///< height size of original image
-    Buffers m_buffers; ///< buffers for each direction (6 directions)
+    size_t m_width = 0; ///< width of face
+    size_t m_height = 0; ///< height of face
+    std::vector<Entry> m_entries{}; ///< entries for each stitched pixel
 
 public:
-    SphericalBuffer( const size_t width, const size_t height ):
-        m_width( width ),
-        m_height( height )
+    static std::shared_ptr<const SphericalBufferTable> Get( const size_t width, const size_t height )
     {
-    }
-
-    size_t width() const { return m_width; }
-    size_t height() const { return m_height; }
-    size_t stitchedWidth() const { return m_width * 4; }
-    size_t stitchedHeight() const { return m_height * 3; }
+        static std::mutex mutex;
+        static std::map<std::pair<size_t,size_t>,std::shared_ptr<const SphericalBufferTable>> tables;
 
-    void setBuffer( const Direction dir, const Buffer& buffer ) { m_buffers[dir] = buffer; }
+        std::lock_guard<std::mutex> lock( mutex );
+        auto& table = tables[ { width, height } ];
+        if ( !table ) { table = std::make_shared<const SphericalBufferTable>( width, height ); }
+        return table;
+    }
 
-    template <size_t N> // N: number of channels
-    Buffer stitch()
+    SphericalBufferTable( const size_t width, const size_t height ):
+        m_width( width ),
+        m_height( height )
     {
-        const auto w = this->width();
-        const auto h = this->height();
-        const auto stitched_width = this->stitchedWidth();
-        const auto stitched_height = this->stitchedHeight();
-        Buffer stitched_buffer( stitched_width * stitched_height * N );
-        stitched_buffer.fill(0);
+        const auto stitched_width = width * 4;
+        const auto stitched_height = height * 3;
+        m_entries.resize( stitched_width * stitched_height );
+
+        const auto w = width;
+        const auto h = height;
         for ( size_t j = 0; j < stitched_height; j++ )
         {
             const float v = 1.0f - (float)j / ( stitched_height - 1 );
@@ -78,124 +91,193 @@ public:
                 const float ya = y / a;
                 const float za = z / a;
 
-                std::array<PixelType,N> pixel;
+                Direction face = Direction::Front;
+                float si = 0.0f;
+                float sj = 0.0f;
                 if ( xa == 1 )
                 {
-                    const float si = kvs::Math::Abs( ( ( za + 1.0f ) / 2.0f - 1.0f ) * ( w - 1 ) );
-                    const float sj = kvs::Math::Abs( ( ( ya + 1.0f ) / 2.0f ) * ( h - 1 ) );
-                    pixel = this->get_pixel<N>( m_buffers[Direction::Right], {si, sj} );
+                    face = Direction::Right;
+                    si = kvs::Math::Abs( ( ( za + 1.0f ) / 2.0f - 1.0f ) * ( w - 1 ) );
+                    sj = kvs::Math::Abs( ( ( ya + 1.0f ) / 2.0f ) * ( h - 1 ) );
                 }
                 else if ( xa == -1 )
                 {
-                    const float si = kvs::Math::Abs( ( ( za + 1.0f ) / 2.0f ) * ( w - 1 ) );
-                    const float sj = kvs::Math::Abs( ( ( ya + 1.0f ) / 2.0f ) * ( h - 1 ) );
-                    pixel = this->get_pixel<N>( m_buffers[Direction::Left], {si, sj} );
+                    face = Direction::Left;
+                    si = kvs::Math::Abs( ( ( za + 1.0f ) / 2.0f ) * ( w - 1 ) );
+                    sj = kvs::Math::Abs( ( ( ya + 1.0f ) / 2.0f ) * ( h - 1 ) );
                 }
                 else if ( ya == 1 )
                 {
-                    const float si = kvs::Math::Abs( ( ( xa + 1.0f ) / 2.0f ) * ( w - 1 ) );
-                    const float sj = kvs::Math::Abs( ( ( za + 1.0f ) / 2.0f - 1.0f ) * ( h - 1 ) );
-                    pixel = this->get_pixel<N>( m_buffers[Direction::Bottom], {si, sj} );
+                    face = Direction::Bottom;
+                    si = kvs::Math::Abs( ( ( xa + 1.0f ) / 2.0f ) * ( w - 1 ) );
+                    sj = kvs::Math::Abs( ( ( za + 1.0f ) / 2.0f - 1.0f ) * ( h - 1 ) );
                 }
                 else if ( ya == -1 )
                 {
-                    const float si = kvs::Math::Abs( ( ( xa + 1.0f ) / 2.0f ) * ( w - 1 ) );
-                    const float sj = kvs::Math::Abs( ( ( za + 1.0f ) / 2.0f ) * ( h - 1 ) );
-                    pixel = this->get_pixel<N>( m_buffers[Direction::Top], {si, sj} );
+                    face = Direction::Top;
+                    si = kvs::Math::Abs( ( ( xa + 1.0f ) / 2.0f ) * ( w - 1 ) );
+                    sj = kvs::Math::Abs( ( ( za + 1.0f ) / 2.0f ) * ( h - 1 ) );
                 }
                 else if ( za == 1 )
                 {
-                    const float si = kvs::Math::Abs( ( ( xa + 1.0f ) / 2.0f ) * ( w - 1 ) );
-                    const float sj = kvs::Math::Abs( ( ( ya + 1.0f ) / 2.0f ) * ( h - 1 ) );
-                    pixel = this->get_pixel<N>( m_buffers[Direction::Front], {si, sj} );
+                    face = Direction::Front;
+                    si = kvs::Math::Abs( ( ( xa + 1.0f ) / 2.0f ) * ( w - 1 ) );
+                    sj = kvs::Math::Abs( ( ( ya + 1.0f ) / 2.0f ) * ( h - 1 ) );
                 }
                 else if ( za == -1 )
                 {
-                    const float si = kvs::Math::Abs( ( ( xa + 1.0f ) / 2.0f - 1.0f ) * ( w - 1 ) );
-                    const float sj = kvs::Math::Abs( ( ( ya + 1.0f ) / 2.0f ) * ( h - 1 ) );
-                    pixel = this->get_pixel<N>( m_buffers[Direction::Back], {si, sj} );
+                    face = Direction::Back;
+                    si = kvs::Math::Abs( ( ( xa + 1.0f ) / 2.0f - 1.0f ) * ( w - 1 ) );
+                    sj = kvs::Math::Abs( ( ( ya + 1.0f ) / 2.0f ) * ( h - 1 ) );
                 }
-                this->set_stitched_pixel<N>( pixel, kvs::Vec2ui(i, j), stitched_buffer );
+
+                const size_t x0 = kvs::Math::Floor( si );
+                const size_t y0 = kvs::Math::Floor( sj );
+                auto& entry = m_entries[ j * stitched_width + i ];
+                entry.index = static_cast<kvs::UInt32>( y0 * w + x0 );
+                entry.face = static_cast<kvs::UInt8>( face );
+                entry.dx = w - 1 > x0 ? 1 : 0;
+                entry.dy = h - 1 > y0 ? 1 : 0;
+                entry.padding = 0;
+                entry.xratio = si - x0;
+                entry.yratio = sj - y0;
             }
         }
-
-        return stitched_buffer;
     }
 
+    size_t width() const { return m_width; }
+    size_t height() const { return m_height; }
+    const Entry* entries() const { return m_entries.data(); }
+};
+
+/*===========================================================================*/
+/**
+ *  @brief  Spherical buffer class.
+ */
+/*===========================================================================*/
+template <typename PixelType>
+class SphericalBuffer
+{
+public:
+    using Direction = kvs::CubicImage::Direction;
+    using Buffer = kvs::ValueArray<PixelType>;
+    using Buffers = std::array<Buffer,Direction::NumberOfDirections>;
+    using Table = SphericalBufferTable;
+
+    static std::string DirectionName( const Direction dir ) { return kvs::CubicImage::DirectionName( dir ); }
+    static kvs::Vec3 DirectionVector( const Direction dir ) { return kvs::CubicImage::DirectionVector( dir ); }
+    static kvs::Vec3 UpVector( const Direction dir ) { return kvs::CubicImage::UpVector( dir ); }
+
 private:
-    template <size_t N>
-    void set_stitched_pixel( const std::array<PixelType,N>& pixel, const kvs::Vec2ui& p, Buffer& stitched_buffer )
+    size_t m_width = 512; ///< width size of original image
+    size_t m_height = 512; ///< height size of original image
+    Buffers m_buffers; ///< buffers for each direction (6 directions)
+
+public:
+    SphericalBuffer( const size_t width, const size_t height ):
+        m_width( width ),
+        m_height( height )
     {
-        const size_t i = p[0];
-        const size_t j = p[1];
-        const auto width = this->stitchedWidth();
-        for ( size_t offset = 0; offset < N; ++offset )
-        {
-            stitched_buffer[ N * ( j * width + i ) + offset ] = pixel[ offset ];
-        }
     }
 
-    template <size_t N>
-    std::array<PixelType,N> get_pixel( const Buffer& buffer, const kvs::Vec2& p )
+    size_t width() const { return m_width; }
+    size_t height() const { return m_height; }
+    size_t stitchedWidth() const { return m_width * 4; }
+    size_t stitchedHeight() const { return m_height * 3; }
+
+    void setBuffer( const Direction dir, const Buffer& buffer ) { m_buffers[dir] = buffer; }
+
+    template <size_t N> // N: number of channels
+    Buffer stitch()
     {
-        std::array<PixelType,N> pixel;
-        for ( size_t offset = 0; offset < N; ++offset )
-        {
-            pixel[ offset ] = this->get_value<N>( buffer, p, offset );
-        }
-        return pixel;
+        const auto size = this->stitchedWidth() * this->stitchedHeight() * N;
+        return this->template stitch<N>( Buffer( size ) );
     }
 
-    template <size_t N>
-    PixelType get_value( const Buffer& buffer, const kvs::Vec2& p, const size_t offset )
+    // Stitches the buffers into the given buffer (e.g. a pooled buffer),
+    // which has stitchedWidth() * stitchedHeight() * N elements.
+    template <size_t N> // N: number of channels
+    Buffer stitch( Buffer stitched_buffer )
     {
-        const float x = p.x();
-        const float y = p.y();
-        const size_t x0 = kvs::Math::Floor(x);
-        const size_t y0 = kvs::Math::Floor(y);
-        const size_t x1 = x0 + ( m_width - 1 > x0 ? 1 : 0 );
-        const size_t y1 = y0 + ( m_height - 1 > y0 ? 1 : 0 );
-        const float xratio = x - x0;
-        const float yratio = y - y0;
-
-        const auto p0 = buffer[ N * ( y0 * m_width + x0 ) + offset ];
-        const auto p1 = buffer[ N * ( y0 * m_width + x1 ) + offset ];
-        const auto p2 = buffer[ N * ( y1 * m_width + x0 ) + offset ];
-        const auto p3 = buffer[ N * ( y1 * m_width + x1 ) + offset ];
+        const auto table = Table::Get( m_width, m_height );
+        const auto npixels = this->stitchedWidth() * this->stitchedHeight();
+        this->template gather<N>( table->entries(), npixels, stitched_buffer.data() );
+        return stitched_buffer;
+    }
 
+private:
+    template <size_t N>
+    void gather(
+        const Table::Entry* entries,
+        const size_t npixels,
+        PixelType* stitched_buffer ) const
+    {
         const auto zero = PixelType(0);
         const auto one = PixelType(1);
-        const auto d = p0 * ( one - xratio ) + p2 * xratio;
-        const auto e = p1 * ( one - xratio ) + p3 * xratio;
-        return kvs::Math::Clamp( d * ( one - yratio ) + e * yratio, zero, one );
+        std::array<const PixelType*,Direction::NumberOfDirections> faces;
+        for ( size_t f = 0; f < faces.size(); ++f ) { faces[f] = m_buffers[f].data(); }
+
+        for ( size_t k = 0; k < npixels; ++k )
+        {
+            const auto& e = entries[k];
+            const auto* p0 = faces[ e.face ] + N * e.index;
+            const auto* p1 = p0 + N * e.dx;
+            const auto* p2 = p0 + N * e.dy * m_width;
+            const auto* p3 = p2 + N * e.dx;
+            const auto xratio = e.xratio;
+            const auto yratio = e.yratio;
+
+            auto* pixel = stitched_buffer + N * k;
+            for ( size_t c = 0; c < N; ++c )
+            {
+                const auto d = p0[c] * ( one - xratio ) + p2[c] * xratio;
+                const auto f = p1[c] * ( one - xratio ) + p3[c] * xratio;
+                pixel[c] = kvs::Math::Clamp( d * ( one - yratio ) + f * yratio, zero, one );
+            }
+        }
     }
 };
 
+// The color values are interpolated in the normalized floating-point values
+// and rounded, which is the same as the per-pixel stitching.
 template <>
 template <size_t N>
-inline kvs::UInt8 SphericalBuffer<kvs::UInt8>::get_value(
-    const kvs::ValueArray<kvs::UInt8>& buffer,
-    const kvs::Vec2& p,
-    const size_t offset )
+inline void SphericalBuffer<kvs::UInt8>::gather(
+    const Table::Entry* entries,
+    const size_t npixels,
+    kvs::UInt8* stitched_buffer ) const
 {
-    const float x = p.x();
-    const float y = p.y();
-    const size_t x0 = kvs::Math::Floor(x);
-    const size_t y0 = kvs::Math::Floor(y);
-    const size_t x1 = x0 + ( m_width - 1 > x0 ? 1 : 0 );
-    const size_t y1 = y0 + ( m_height - 1 > y0 ? 1 : 0 );
-    const float xratio = x - x0;
-    const float yratio = y - y0;
-
-    const float p0 = static_cast<float>( buffer[ N * ( y0 * m_width + x0 ) + offset ] ) / 255.0f;
-    const float p1 = static_cast<float>( buffer[ N * ( y0 * m_width + x1 ) + offset ] ) / 255.0f;
-    const float p2 = static_cast<float>( buffer[ N * ( y1 * m_width + x0 ) + offset ] ) / 255.0f;
-    const float p3 = static_cast<float>( buffer[ N * ( y1 * m_width + x1 ) + offset ] ) / 255.0f;
-
-    const float d = p0 * ( 1.0f - xratio ) + p2 * xratio;
-    const float e = p1 * ( 1.0f - xratio ) + p3 * xratio;
-    const float v = kvs::Math::Clamp( d * ( 1.0f - yratio ) + e * yratio, 0.0f, 1.0f );
-    return kvs::Math::Round( v * 255.0f );
+    std::array<const kvs::UInt8*,Direction::NumberOfDirections> faces;
+    for ( size_t f = 0; f < faces.size(); ++f ) { faces[f] = m_buffers[f].data(); }
+
+    // Normalized values (same as the division for each value).
+    std::array<float,256> normalized;
+    for ( size_t i = 0; i < normalized.size(); ++i ) { normalized[i] = static_cast<float>( i ) / 255.0f; }
+
+    for ( size_t k = 0; k < npixels; ++k )
+    {
+        const auto& e = entries[k];
+        const auto* p0 = faces[ e.face ] + N * e.index;
+        const auto* p1 = p0 + N * e.dx;
+        const auto* p2 = p0 + N * e.dy * m_width;
+        const auto* p3 = p2 + N * e.dx;
+        const float xratio = e.xratio;
+        const float yratio = e.yratio;
+
+        auto* pixel = stitched_buffer + N * k;
+        for ( size_t c = 0; c < N; ++c )
+        {
+            const float v0 = normalized[ p0[c] ];
+            const float v1 = normalized[ p1[c] ];
+            const float v2 = normalized[ p2[c] ];
+            const float v3 = normalized[ p3[c] ];
+
+            const float d = v0 * ( 1.0f - xratio ) + v2 * xratio;
+            const float f = v1 * ( 1.0f - xratio ) + v3 * xratio;
+            const float v = kvs::Math::Clamp( d * ( 1.0f - yratio ) + f * yratio, 0.0f, 1.0f );
+            pixel[c] = kvs::Math::Round( v * 255.0f );
+        }
+    }
 }
 
 } // end of namespace InSituVis
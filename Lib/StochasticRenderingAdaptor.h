@@ -36,6 +36,10 @@ public:
         return m_rendering_compositor.repetitionLevel();
     }
 
+    // The ensemble averaging of the compositor is bound to the main screen,
+    // so the views are not rendered by the rendering threads.
+    bool isParallelRenderingSupported() const override { return false; }
+
 private:
     ColorBuffer drawScreen() override;
 //    virtual ColorBuffer drawColorBuffer();
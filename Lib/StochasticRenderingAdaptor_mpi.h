@@ -55,6 +55,13 @@ public:
         return m_rendering_compositor.repetitionLevel();
     }
 
+    // The images are composited in each ensemble rendering pass, which is
+    // not pipelined with the rendering of the next view.
+    bool isPipelinedCompositionEnabled() const override { return false; }
+
+    // The ensemble averaging of the compositor is bound to the main screen.
+    bool isParallelRenderingSupported() const override { return false; }
+
 private:
 //    virtual FrameBuffer drawScreen( std::function<void(const FrameBuffer&)> func = [] ( const FrameBuffer& ) {} );
     FrameBuffer drawScreen( std::function<void(const FrameBuffer&)> func ) override;
@@ -32,8 +32,8 @@ inline void StochasticRenderingAdaptor::RenderingCompositor::ensembleRenderPass(
     kvs::OpenGL::SetPixelStorageMode( GL_PACK_ALIGNMENT, GLint(4) );
     const auto width = m_parent->screen().width();
     const auto height = m_parent->screen().height();
-    kvs::ValueArray<kvs::UInt8> color_buffer( width * height * 4 );
-    kvs::ValueArray<kvs::Real32> depth_buffer( width * height );
+    auto color_buffer = m_parent->frameBufferPool().colorBuffer( width * height * 4 );
+    auto depth_buffer = m_parent->frameBufferPool().depthBuffer( width * height );
     kvs::OpenGL::ReadPixels( 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, color_buffer.data() );
     kvs::OpenGL::ReadPixels( 0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, depth_buffer.data() );
     {
@@ -64,8 +64,8 @@ inline StochasticRenderingAdaptor::FrameBuffer StochasticRenderingAdaptor::drawS
     BaseClass::setRendTime( BaseClass::rendTime() + m_rendering_compositor.rendTime() );
     BaseClass::setCompTime( BaseClass::compTime() + m_rendering_compositor.compTime() );
 
-    const auto color_buffer = BaseClass::screen().readbackColorBuffer();
-    const auto depth_buffer = BaseClass::screen().readbackDepthBuffer();
+    const auto color_buffer = BaseClass::readbackColorBuffer( BaseClass::screen() );
+    const auto depth_buffer = BaseClass::readbackDepthBuffer( BaseClass::screen() );
     func( { color_buffer, depth_buffer } );
 
     return { color_buffer, depth_buffer };
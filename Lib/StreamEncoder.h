@@ -0,0 +1,79 @@
+/*****************************************************************************/
+/**
+ *  @file   StreamEncoder.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstddef>
+#include <kvs/Type>
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Interface of the encoder of the color images as frame streams.
+ *
+ *  If an encoder is given to the adaptor (Adaptor::setStreamEncoder), each
+ *  color image is encoded with the previous frames of the same stream (e.g.
+ *  the same viewpoint location) instead of being written as an image file
+ *  (e.g. TileDeltaEncoder).
+ */
+/*===========================================================================*/
+class StreamEncoder
+{
+public:
+    using Bytes = std::vector<kvs::UInt8>;
+    using Job = std::function<Bytes()>;
+
+    virtual ~StreamEncoder() = default;
+
+    // Returns false if the encoder cannot be used in this build.
+    virtual bool isSupported() const = 0;
+
+    // File extension of the encoded frames (e.g. ".delta").
+    virtual std::string extension() const = 0;
+
+    // Takes the frame into the stream. Called from the rendering thread in
+    // the order of the frames. The returned job serializes the frame, and
+    // is run in the writer threads. An empty result means an error.
+    virtual Job encode(
+        const std::string& stream,
+        const size_t width,
+        const size_t height,
+        const size_t channels,
+        const kvs::UInt8* pixels ) = 0;
+
+    // Returns the name without the first n numeric tokens separated by '_'
+    // (e.g. the time step), which is used as the stream name.
+    static std::string StreamName( const std::string& name, const size_t n = 1 )
+    {
+        const auto slash = name.find_last_of( '/' );
+        const auto begin = slash == std::string::npos ? 0 : slash + 1;
+        const auto dot = name.find_last_of( '.' );
+        const auto end = dot == std::string::npos || dot < begin ? name.size() : dot;
+
+        std::string stream = name.substr( 0, begin );
+        size_t removed = 0;
+        size_t pos = begin;
+        while ( pos <= end )
+        {
+            auto next = name.find( '_', pos );
+            if ( next == std::string::npos || next > end ) { next = end; }
+            const auto token = name.substr( pos, next - pos );
+            const bool numeric = !token.empty() && token.find_first_not_of( "0123456789" ) == std::string::npos;
+            if ( numeric && removed < n ) { removed++; }
+            else { stream += token + "_"; }
+            pos = next + 1;
+        }
+        if ( stream.size() > begin ) { stream.pop_back(); }
+        return stream;
+    }
+};
+
+} // end of namespace InSituVis
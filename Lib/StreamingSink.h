@@ -0,0 +1,176 @@
+/*****************************************************************************/
+/**
+ *  @file   StreamingSink.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+#include <kvs/StampTimer>
+#include <kvs/StampTimerList>
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Streaming sink class for the log files.
+ *
+ *  The records stored in the stamp timers (or in the other log buffers) are
+ *  moved into the file in chunks, so that the memory usage does not grow
+ *  with the number of time steps and the records written before a crash
+ *  are kept. The file is created with the header at the first write, and
+ *  the following chunks are appended without the header. The file written
+ *  in chunks is identical to the one written at once. A sink can stream
+ *  any number of files, whose states are kept by their filenames.
+ */
+/*===========================================================================*/
+class StreamingSink
+{
+public:
+    using Timers = std::vector<kvs::StampTimer*>;
+
+private:
+    struct File
+    {
+        bool opened = false; ///< true after the file is created with the header
+        size_t nrecords = 0; ///< number of the records written into the file
+    };
+
+    std::map<std::string,File> m_files{}; ///< states of the files
+
+public:
+    StreamingSink() = default;
+
+    bool isOpened( const std::string& filename ) const
+    {
+        const auto f = m_files.find( filename );
+        return f != m_files.end() && f->second.opened;
+    }
+
+    size_t numberOfRecords( const std::string& filename ) const
+    {
+        const auto f = m_files.find( filename );
+        return f != m_files.end() ? f->second.nrecords : 0;
+    }
+
+    void reset() { m_files.clear(); }
+
+    // Moves the first records, which all of the timers have, into the file
+    // when the number of the records reaches the interval. All of the
+    // records are moved if final is true.
+    bool write(
+        const std::string& filename,
+        const Timers& timers,
+        const size_t interval,
+        const bool final = false )
+    {
+        const auto n = final ? MaxRecords( timers ) : MinRecords( timers );
+        if ( !final && ( interval == 0 || n < interval ) ) { return true; }
+        if ( this->isOpened( filename ) && n == 0 ) { return true; }
+
+        kvs::StampTimerList list;
+        for ( const auto* timer : timers ) { list.push( Head( *timer, n ) ); }
+        if ( !this->append( filename, list, n ) ) { return false; }
+
+        for ( auto* timer : timers ) { Erase( *timer, n ); }
+        return true;
+    }
+
+    // Appends the records of the timer list. The list is written into a
+    // temporary file by itself in order to keep the format of the records.
+    bool append( const std::string& filename, kvs::StampTimerList& list, const size_t nrecords )
+    {
+        auto& f = m_files[ filename ];
+        if ( !f.opened )
+        {
+            if ( !list.write( filename ) ) { return false; }
+            f.opened = true;
+            f.nrecords = nrecords;
+            return true;
+        }
+
+        const auto chunk = filename + ".chunk";
+        if ( !list.write( chunk ) ) { return false; }
+
+        std::ifstream input( chunk );
+        std::ofstream file( filename, std::ios::app );
+        if ( !input || !file ) { return false; }
+
+        std::string line;
+        std::getline( input, line ); // skip the header
+        while ( std::getline( input, line ) ) { file << line << std::endl; }
+        input.close();
+        std::remove( chunk.c_str() );
+
+        f.nrecords += nrecords;
+        return true;
+    }
+
+    // Appends the records given as text lines.
+    bool append(
+        const std::string& filename,
+        const std::string& header,
+        const std::string& records,
+        const size_t nrecords )
+    {
+        auto& f = m_files[ filename ];
+        const auto mode = f.opened ? std::ios::app : std::ios::trunc;
+        std::ofstream file( filename, std::ios::out | mode );
+        if ( !file ) { return false; }
+
+        if ( !f.opened ) { file << header << std::endl; }
+        file << records;
+
+        f.opened = true;
+        f.nrecords += nrecords;
+        return true;
+    }
+
+    static size_t MinRecords( const Timers& timers )
+    {
+        if ( timers.empty() ) { return 0; }
+        size_t n = timers.front()->numberOfStamps();
+        for ( const auto* timer : timers ) { n = std::min( n, timer->numberOfStamps() ); }
+        return n;
+    }
+
+    static size_t MaxRecords( const Timers& timers )
+    {
+        size_t n = 0;
+        for ( const auto* timer : timers ) { n = std::max( n, timer->numberOfStamps() ); }
+        return n;
+    }
+
+    // Returns a timer with the first n stamps of the given timer.
+    static kvs::StampTimer Head( const kvs::StampTimer& timer, const size_t n )
+    {
+        kvs::StampTimer head;
+        head.setTitle( timer.title() );
+        const auto m = std::min( n, timer.numberOfStamps() );
+        const auto& stamps = timer.stamps();
+        for ( size_t i = 0; i < m; ++i ) { head.stamp( stamps[i] ); }
+        return head;
+    }
+
+    // Removes the first n stamps from the timer.
+    static void Erase( kvs::StampTimer& timer, const size_t n )
+    {
+        const auto m = std::min( n, timer.numberOfStamps() );
+        if ( m == 0 ) { return; }
+
+        kvs::StampTimer rest;
+        rest.setTitle( timer.title() );
+        const auto& stamps = timer.stamps();
+        for ( size_t i = m; i < stamps.size(); ++i ) { rest.stamp( stamps[i] ); }
+        timer = rest;
+    }
+};
+
+} // end of namespace InSituVis
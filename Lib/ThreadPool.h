@@ -0,0 +1,135 @@
+/*****************************************************************************/
+/**
+ *  @file   ThreadPool.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <queue>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Thread pool class.
+ *
+ *  The tasks can be submitted from several threads at the same time. If no
+ *  thread is started, the tasks are executed in the calling thread.
+ */
+/*===========================================================================*/
+class ThreadPool
+{
+private:
+    bool m_terminated = false; ///< flag for terminating the threads
+    std::vector<std::thread> m_threads{}; ///< worker threads
+    std::queue<std::function<void()>> m_tasks{}; ///< task queue
+    std::mutex m_mutex{}; ///< mutex for the task queue
+    std::condition_variable m_cond{}; ///< notified when a task is pushed
+
+public:
+    ThreadPool( const size_t nthreads = 0 ) { this->start( nthreads ); }
+    ThreadPool( const ThreadPool& ) = delete;
+    ThreadPool& operator = ( const ThreadPool& ) = delete;
+    ~ThreadPool() { this->stop(); }
+
+    size_t numberOfThreads() const { return m_threads.size(); }
+
+    void start( const size_t nthreads )
+    {
+        this->stop();
+
+        m_terminated = false;
+        for ( size_t i = 0; i < nthreads; ++i )
+        {
+            m_threads.emplace_back( [this] { this->run(); } );
+        }
+    }
+
+    void stop()
+    {
+        if ( m_threads.empty() ) { return; }
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_terminated = true;
+        }
+        m_cond.notify_all();
+
+        for ( auto& thread : m_threads ) { thread.join(); }
+        m_threads.clear();
+    }
+
+    template <typename Func>
+    auto submit( Func func ) -> std::future<decltype( func() )>
+    {
+        using Result = decltype( func() );
+        auto task = std::make_shared<std::packaged_task<Result()>>( func );
+        auto result = task->get_future();
+        if ( m_threads.empty() )
+        {
+            ( *task )();
+            return result;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_tasks.push( [task] { ( *task )(); } );
+        }
+        m_cond.notify_one();
+        return result;
+    }
+
+    // Calls func( begin, end ) for nchunks sub-ranges of [0,n) and waits for
+    // all of them. The calling thread processes the first sub-range.
+    template <typename Func>
+    void parallelFor( const size_t n, Func func, const size_t nchunks = 0 )
+    {
+        const size_t m = nchunks > 0 ? nchunks : m_threads.size() + 1;
+        const size_t nranges = std::min( std::max( m, size_t(1) ), std::max( n, size_t(1) ) );
+        if ( nranges == 1 || m_threads.empty() )
+        {
+            func( size_t(0), n );
+            return;
+        }
+
+        std::vector<std::future<void>> results;
+        const size_t step = ( n + nranges - 1 ) / nranges;
+        for ( size_t begin = step; begin < n; begin += step )
+        {
+            const size_t end = std::min( begin + step, n );
+            results.push_back( this->submit( [&func,begin,end] { func( begin, end ); } ) );
+        }
+
+        func( size_t(0), std::min( step, n ) );
+        for ( auto& result : results ) { result.get(); }
+    }
+
+private:
+    void run()
+    {
+        for ( ;; )
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock( m_mutex );
+                m_cond.wait( lock, [this] { return m_terminated || !m_tasks.empty(); } );
+                if ( m_tasks.empty() ) { return; } // terminated
+
+                task = std::move( m_tasks.front() );
+                m_tasks.pop();
+            }
+            task();
+        }
+    }
+};
+
+} // end of namespace InSituVis
@@ -0,0 +1,393 @@
+/*****************************************************************************/
+/**
+ *  @file   TileDeltaEncoder.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#if defined( INSITUVIS_USE_ZLIB )
+#include <zlib.h>
+#endif
+#include <kvs/Type>
+#include "StreamEncoder.h"
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Temporal delta encoder of the frames based on the tiles.
+ *
+ *  Each frame is divided into the tiles, and only the tiles changed since
+ *  the previous frame of the same stream (e.g. the same viewpoint location)
+ *  are stored with the deflate compression. The changes are detected by
+ *  comparing the pixels of the tiles with the previous frame, which is kept
+ *  for each stream. Every keyframe interval, and when the image size is
+ *  changed, all of the tiles are stored (keyframe). The streams not
+ *  continued for a while (e.g. the removed viewpoint locations) are dropped
+ *  with their previous frames, and restart with a keyframe. The frames can
+ *  be rebuilt with TileDeltaDecoder (e.g. App/DeltaFrameDecoder).
+ *
+ *  The delta must be taken in the order of the frames, so diff() is called
+ *  from the rendering thread, and the compression with Encode() can be done
+ *  in the writer threads.
+ *
+ *  The compression needs zlib, which is used only when INSITUVIS_USE_ZLIB
+ *  is defined (link with -lz). Otherwise, the frames cannot be encoded or
+ *  decoded.
+ */
+/*===========================================================================*/
+class TileDeltaEncoder : public InSituVis::StreamEncoder
+{
+public:
+    using Bytes = InSituVis::StreamEncoder::Bytes;
+
+    struct Delta
+    {
+        std::string stream; ///< stream name
+        std::uint64_t sequence = 0; ///< frame number in the stream
+        bool keyframe = false; ///< true if all of the tiles are stored
+        std::uint32_t width = 0; ///< image width
+        std::uint32_t height = 0; ///< image height
+        std::uint32_t channels = 0; ///< number of the channels
+        std::uint32_t tile_size = 0; ///< tile size in pixels
+        std::vector<std::uint32_t> tiles{}; ///< indices of the stored tiles
+        Bytes data{}; ///< pixels of the stored tiles (row by row in each tile)
+    };
+
+    static constexpr std::uint32_t Version = 1;
+    static constexpr size_t MagicSize = 8;
+    static constexpr size_t HeaderSize = 64;
+    static const char* Magic() { return "ISVDELTA"; }
+    static const char* Extension() { return ".delta"; }
+
+private:
+    struct Stream
+    {
+        std::uint32_t width = 0; ///< image width of the previous frame
+        std::uint32_t height = 0; ///< image height of the previous frame
+        std::uint32_t channels = 0; ///< number of the channels of the previous frame
+        std::uint64_t nframes = 0; ///< number of the frames in the stream
+        std::uint64_t last = 0; ///< clock of the encoder at the previous frame
+        Bytes pixels{}; ///< pixels of the previous frame
+    };
+
+    size_t m_tile_size = 32; ///< tile size in pixels
+    size_t m_keyframe_interval = 30; ///< number of the frames between the keyframes
+    int m_level = 1; ///< compression level (0-9)
+    std::map<std::string,Stream> m_streams{}; ///< streams
+    std::uint64_t m_clock = 0; ///< number of the frames taken by the encoder
+    std::mutex m_mutex{}; ///< mutex for the streams
+
+public:
+    TileDeltaEncoder( const size_t tile_size = 32, const size_t keyframe_interval = 30, const int level = 1 ):
+        m_tile_size( std::max( tile_size, size_t( 1 ) ) ),
+        m_keyframe_interval( std::max( keyframe_interval, size_t( 1 ) ) ),
+        m_level( std::min( std::max( level, 0 ), 9 ) ) {}
+
+    size_t tileSize() const { return m_tile_size; }
+    size_t keyframeInterval() const { return m_keyframe_interval; }
+    int level() const { return m_level; }
+
+    bool isSupported() const override { return IsSupported(); }
+    std::string extension() const override { return Extension(); }
+
+    // The delta is taken here, and only the compression is done in the job.
+    Job encode(
+        const std::string& stream,
+        const size_t width,
+        const size_t height,
+        const size_t channels,
+        const kvs::UInt8* pixels ) override
+    {
+        const auto delta = this->diff( stream, width, height, channels, pixels );
+        const auto level = m_level;
+        return [delta,level] () { return Encode( *delta, level ); };
+    }
+
+    // Returns the tiles changed since the previous frame of the stream.
+    std::shared_ptr<Delta> diff(
+        const std::string& stream,
+        const size_t width,
+        const size_t height,
+        const size_t channels,
+        const kvs::UInt8* pixels )
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        auto& s = m_streams[ stream ];
+        s.last = ++m_clock;
+        const bool keyframe =
+            s.width != width || s.height != height || s.channels != channels ||
+            s.nframes % m_keyframe_interval == 0;
+
+        auto delta = std::make_shared<Delta>();
+        delta->stream = stream;
+        delta->sequence = s.nframes++;
+        delta->keyframe = keyframe;
+        delta->width = static_cast<std::uint32_t>( width );
+        delta->height = static_cast<std::uint32_t>( height );
+        delta->channels = static_cast<std::uint32_t>( channels );
+        delta->tile_size = static_cast<std::uint32_t>( m_tile_size );
+
+        const size_t tx = ( width + m_tile_size - 1 ) / m_tile_size;
+        const size_t ty = ( height + m_tile_size - 1 ) / m_tile_size;
+        s.width = delta->width;
+        s.height = delta->height;
+        s.channels = delta->channels;
+
+        for ( size_t index = 0; index < tx * ty; index++ )
+        {
+            if ( !keyframe && SameTile( *delta, index, s.pixels.data(), pixels ) ) { continue; }
+
+            delta->tiles.push_back( static_cast<std::uint32_t>( index ) );
+            ForEachRow( *delta, index, [&] ( const size_t offset, const size_t length )
+            {
+                delta->data.insert( delta->data.end(), pixels + offset, pixels + offset + length );
+            } );
+        }
+        s.pixels.assign( pixels, pixels + width * height * channels );
+
+        this->prune();
+        return delta;
+    }
+
+    // Removes the stream, e.g. to start it with a keyframe again.
+    void reset( const std::string& stream )
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        m_streams.erase( stream );
+    }
+
+    static bool IsSupported()
+    {
+#if defined( INSITUVIS_USE_ZLIB )
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Serializes the delta with the compressed pixels of the tiles.
+    static Bytes Encode( const Delta& delta, const int level = 1 )
+    {
+#if defined( INSITUVIS_USE_ZLIB )
+        uLongf compressed_size = compressBound( static_cast<uLong>( delta.data.size() ) );
+        Bytes compressed( compressed_size );
+        if ( compress2( compressed.data(), &compressed_size, delta.data.data(), delta.data.size(), level ) != Z_OK )
+        {
+            return {};
+        }
+
+        Bytes bytes( HeaderSize, 0 );
+        const std::uint32_t version = Version;
+        const std::uint32_t flags = delta.keyframe ? 1 : 0;
+        const auto ntiles = static_cast<std::uint32_t>( delta.tiles.size() );
+        const auto stream_length = static_cast<std::uint32_t>( delta.stream.size() );
+        const auto data_size = static_cast<std::uint64_t>( delta.data.size() );
+        const auto payload_size = static_cast<std::uint64_t>( compressed_size );
+        auto* p = bytes.data();
+        std::memcpy( p, Magic(), MagicSize );
+        std::memcpy( p + 8, &version, 4 );
+        std::memcpy( p + 12, &flags, 4 );
+        std::memcpy( p + 16, &delta.width, 4 );
+        std::memcpy( p + 20, &delta.height, 4 );
+        std::memcpy( p + 24, &delta.channels, 4 );
+        std::memcpy( p + 28, &delta.tile_size, 4 );
+        std::memcpy( p + 32, &delta.sequence, 8 );
+        std::memcpy( p + 40, &ntiles, 4 );
+        std::memcpy( p + 44, &stream_length, 4 );
+        std::memcpy( p + 48, &data_size, 8 );
+        std::memcpy( p + 56, &payload_size, 8 );
+
+        const auto* stream = reinterpret_cast<const kvs::UInt8*>( delta.stream.data() );
+        const auto* tiles = reinterpret_cast<const kvs::UInt8*>( delta.tiles.data() );
+        bytes.insert( bytes.end(), stream, stream + delta.stream.size() );
+        bytes.insert( bytes.end(), tiles, tiles + delta.tiles.size() * 4 );
+        bytes.insert( bytes.end(), compressed.begin(), compressed.begin() + compressed_size );
+        return bytes;
+#else
+        return {};
+#endif
+    }
+
+    // Calls the function with the offset and the length of each row of the
+    // tile in the image.
+    template <typename Func>
+    static void ForEachRow( const Delta& delta, const size_t index, Func func )
+    {
+        const size_t t = delta.tile_size;
+        const size_t tx = ( delta.width + t - 1 ) / t;
+        const size_t x0 = ( index % tx ) * t;
+        const size_t y0 = ( index / tx ) * t;
+        const size_t x1 = std::min( x0 + t, size_t( delta.width ) );
+        const size_t y1 = std::min( y0 + t, size_t( delta.height ) );
+        const size_t c = delta.channels;
+        for ( size_t y = y0; y < y1; y++ )
+        {
+            func( ( y * delta.width + x0 ) * c, ( x1 - x0 ) * c );
+        }
+    }
+
+private:
+    // Returns true if the pixels of the tile are the same in both frames.
+    static bool SameTile( const Delta& delta, const size_t index, const kvs::UInt8* p0, const kvs::UInt8* p1 )
+    {
+        bool same = true;
+        ForEachRow( delta, index, [&] ( const size_t offset, const size_t length )
+        {
+            same = same && std::memcmp( p0 + offset, p1 + offset, length ) == 0;
+        } );
+        return same;
+    }
+
+    // Removes the streams not continued during the keyframe intervals of all
+    // of the streams. Checked once every number of the streams frames.
+    void prune()
+    {
+        const auto nstreams = m_streams.size();
+        if ( m_clock % nstreams != 0 ) { return; }
+
+        const auto idle = m_keyframe_interval * nstreams;
+        for ( auto s = m_streams.begin(); s != m_streams.end(); )
+        {
+            if ( m_clock - s->second.last > idle ) { s = m_streams.erase( s ); }
+            else { ++s; }
+        }
+    }
+};
+
+/*===========================================================================*/
+/**
+ *  @brief  Decoder of the frames encoded with TileDeltaEncoder.
+ *
+ *  The frames of a stream are decoded in the order of the sequence numbers
+ *  from a keyframe, since each frame has only the tiles changed since the
+ *  previous frame.
+ */
+/*===========================================================================*/
+class TileDeltaDecoder
+{
+public:
+    using Bytes = TileDeltaEncoder::Bytes;
+    using Delta = TileDeltaEncoder::Delta;
+
+private:
+    Delta m_frame{}; ///< current frame (all of the pixels in data)
+    bool m_valid = false; ///< true if the current frame is decoded from a keyframe
+
+public:
+    TileDeltaDecoder() = default;
+
+    bool isValid() const { return m_valid; }
+    const std::string& stream() const { return m_frame.stream; }
+    std::uint64_t sequence() const { return m_frame.sequence; }
+    size_t width() const { return m_frame.width; }
+    size_t height() const { return m_frame.height; }
+    size_t channels() const { return m_frame.channels; }
+    const Bytes& pixels() const { return m_frame.data; }
+
+    // Reads the header and the stream name. The tiles are not read.
+    static bool ReadHeader( const kvs::UInt8* bytes, const size_t size, Delta& delta, std::uint64_t* payload_size = nullptr )
+    {
+        if ( size < TileDeltaEncoder::HeaderSize ) { return false; }
+        if ( std::memcmp( bytes, TileDeltaEncoder::Magic(), TileDeltaEncoder::MagicSize ) != 0 ) { return false; }
+
+        std::uint32_t version, flags, ntiles, stream_length;
+        std::uint64_t data_size, compressed_size;
+        std::memcpy( &version, bytes + 8, 4 );
+        std::memcpy( &flags, bytes + 12, 4 );
+        std::memcpy( &delta.width, bytes + 16, 4 );
+        std::memcpy( &delta.height, bytes + 20, 4 );
+        std::memcpy( &delta.channels, bytes + 24, 4 );
+        std::memcpy( &delta.tile_size, bytes + 28, 4 );
+        std::memcpy( &delta.sequence, bytes + 32, 8 );
+        std::memcpy( &ntiles, bytes + 40, 4 );
+        std::memcpy( &stream_length, bytes + 44, 4 );
+        std::memcpy( &data_size, bytes + 48, 8 );
+        std::memcpy( &compressed_size, bytes + 56, 8 );
+        if ( version != TileDeltaEncoder::Version || delta.tile_size == 0 ) { return false; }
+
+        const auto tiles_offset = TileDeltaEncoder::HeaderSize + stream_length;
+        if ( size < tiles_offset + ntiles * size_t( 4 ) + compressed_size ) { return false; }
+
+        delta.keyframe = ( flags & 1 ) != 0;
+        delta.stream.assign( reinterpret_cast<const char*>( bytes ) + TileDeltaEncoder::HeaderSize, stream_length );
+        delta.tiles.resize( ntiles );
+        std::memcpy( delta.tiles.data(), bytes + tiles_offset, ntiles * size_t( 4 ) );
+        delta.data.resize( data_size );
+        if ( payload_size ) { *payload_size = compressed_size; }
+        return true;
+    }
+
+    // Applies the encoded frame to the current frame. Returns false if the
+    // frame cannot be decoded, e.g. the previous frame is missing.
+    bool decode( const kvs::UInt8* bytes, const size_t size )
+    {
+        Delta delta;
+        std::uint64_t compressed_size = 0;
+        if ( !ReadHeader( bytes, size, delta, &compressed_size ) ) { return false; }
+
+#if defined( INSITUVIS_USE_ZLIB )
+        const auto* payload = bytes + size_t( TileDeltaEncoder::HeaderSize ) + delta.stream.size() + delta.tiles.size() * 4;
+        uLongf data_size = static_cast<uLongf>( delta.data.size() );
+        if ( uncompress( delta.data.data(), &data_size, payload, static_cast<uLong>( compressed_size ) ) != Z_OK ||
+             data_size != delta.data.size() )
+        {
+            return false;
+        }
+#else
+        return false;
+#endif
+
+        if ( delta.keyframe )
+        {
+            m_frame.stream = delta.stream;
+            m_frame.width = delta.width;
+            m_frame.height = delta.height;
+            m_frame.channels = delta.channels;
+            m_frame.tile_size = delta.tile_size;
+            m_frame.data.assign( size_t( delta.width ) * delta.height * delta.channels, 0 );
+            m_valid = true;
+        }
+        else
+        {
+            const bool continued =
+                m_valid && delta.stream == m_frame.stream && delta.sequence == m_frame.sequence + 1 &&
+                delta.width == m_frame.width && delta.height == m_frame.height &&
+                delta.channels == m_frame.channels && delta.tile_size == m_frame.tile_size;
+            if ( !continued ) { m_valid = false; return false; }
+        }
+
+        const size_t ntiles =
+            ( ( delta.width + delta.tile_size - 1 ) / delta.tile_size ) *
+            ( ( delta.height + delta.tile_size - 1 ) / delta.tile_size );
+        size_t offset = 0;
+        bool ret = true;
+        for ( const auto index : delta.tiles )
+        {
+            if ( index >= ntiles ) { ret = false; break; }
+            TileDeltaEncoder::ForEachRow( m_frame, index, [&] ( const size_t o, const size_t length )
+            {
+                if ( offset + length > delta.data.size() ) { ret = false; return; }
+                std::memcpy( m_frame.data.data() + o, delta.data.data() + offset, length );
+                offset += length;
+            } );
+            if ( !ret ) { break; }
+        }
+
+        m_frame.sequence = delta.sequence;
+        m_valid = ret;
+        return ret;
+    }
+};
+
+} // end of namespace InSituVis
@@ -0,0 +1,199 @@
+/*****************************************************************************/
+/**
+ *  @file   TimeBudgetController.h
+ *  @author Naohisa Sakamoto
+ */
+/*****************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <fstream>
+#include <algorithm>
+#include <kvs/Timer>
+#include <kvs/StampTimer>
+
+
+namespace InSituVis
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Feedback controller for the visualization time budget.
+ *
+ *  The times of the solver and the visualization are accumulated cycle by
+ *  cycle (the time between the time steps), and the overhead (visualization time / solver time) is evaluated
+ *  every update interval. When the overhead exceeds the target, one of the
+ *  registered knobs is changed by its step to make the visualization cheaper
+ *  (the knobs are tried in the registered order). When the overhead falls
+ *  below the target, the knobs are restored in the reverse order. The
+ *  tolerance gives a dead band around the target to avoid oscillation.
+ *  The knobs must be changeable between the time steps. Only the latest
+ *  adjustments are kept for the log, so that the memory usage does not grow
+ *  with the number of time steps.
+ */
+/*===========================================================================*/
+class TimeBudgetController
+{
+public:
+    struct Knob
+    {
+        std::string name; ///< knob name
+        std::function<int()> get; ///< getter of the current value
+        std::function<void(int)> set; ///< setter of the value
+        int min; ///< lower bound
+        int max; ///< upper bound
+        int step; ///< step of the adjustment
+        bool costly_up; ///< true if the cost increases with the value (e.g. zoom level)
+    };
+
+    struct Adjustment
+    {
+        size_t time_step; ///< time step of the adjustment
+        std::string name; ///< knob name
+        int from; ///< value before the adjustment
+        int to; ///< value after the adjustment
+        float overhead; ///< overhead that triggered the adjustment
+    };
+
+private:
+    float m_target = 0.1f; ///< target overhead (visualization time / solver time)
+    float m_tolerance = 0.2f; ///< relative tolerance around the target
+    size_t m_interval = 10; ///< number of steps between the updates
+    std::vector<Knob> m_knobs{}; ///< registered knobs in the priority order
+    std::deque<Adjustment> m_adjustments{}; ///< latest adjustments
+    size_t m_max_adjustments = 1000; ///< max. number of the kept adjustments
+    size_t m_nadjustments = 0; ///< number of the adjustments including the dropped ones
+    double m_solver_time = 0.0; ///< accumulated solver time in the current interval
+    double m_vis_time = 0.0; ///< accumulated visualization time in the current interval
+    size_t m_nsteps = 0; ///< number of steps in the current interval
+    kvs::Timer m_cycle_timer{}; ///< timer for the current cycle
+    double m_cycle_vis_time = 0.0; ///< visualization time in the current cycle
+    bool m_cycle_started = false; ///< flag set after the first cycle is started
+
+public:
+    TimeBudgetController() = default;
+
+    float targetOverhead() const { return m_target; }
+    float tolerance() const { return m_tolerance; }
+    size_t updateInterval() const { return m_interval; }
+    const std::vector<Knob>& knobs() const { return m_knobs; }
+    const std::deque<Adjustment>& adjustments() const { return m_adjustments; }
+    size_t maxAdjustments() const { return m_max_adjustments; }
+    size_t numberOfAdjustments() const { return m_nadjustments; }
+
+    void setTargetOverhead( const float target ) { m_target = std::max( target, 0.0f ); }
+    void setTolerance( const float tolerance ) { m_tolerance = std::max( tolerance, 0.0f ); }
+    void setUpdateInterval( const size_t interval ) { m_interval = std::max( interval, size_t( 1 ) ); }
+    void setMaxAdjustments( const size_t max ) { m_max_adjustments = std::max( max, size_t( 1 ) ); }
+
+    void addKnob(
+        const std::string& name,
+        std::function<int()> get,
+        std::function<void(int)> set,
+        const int min,
+        const int max,
+        const int step = 1,
+        const bool costly_up = true )
+    {
+        m_knobs.push_back( { name, get, set, std::min( min, max ), std::max( min, max ), std::max( step, 1 ), costly_up } );
+    }
+
+    // Adds the visualization time in the current cycle.
+    void addVisTime( const float time ) { m_cycle_vis_time += std::max( time, 0.0f ); }
+
+    // Ends the current cycle and starts the next one. The cycle time is
+    // converted with the given timer in the unit of the visualization times.
+    // Returns true when the overhead of the interval is ready to be evaluated.
+    bool endCycle( const kvs::StampTimer& unit )
+    {
+        if ( !m_cycle_started )
+        {
+            m_cycle_started = true;
+            m_cycle_vis_time = 0.0;
+            m_cycle_timer.start();
+            return false;
+        }
+
+        m_cycle_timer.stop();
+        const auto cycle_time = unit.time( m_cycle_timer );
+        const auto vis_time = static_cast<float>( m_cycle_vis_time );
+        m_cycle_vis_time = 0.0;
+        m_cycle_timer.start();
+        return this->accumulate( cycle_time - vis_time, vis_time );
+    }
+
+    // Accumulates the times of a cycle. Returns true when the overhead of the
+    // interval is ready to be evaluated.
+    bool accumulate( const float solver_time, const float vis_time )
+    {
+        m_solver_time += std::max( solver_time, 0.0f );
+        m_vis_time += std::max( vis_time, 0.0f );
+        return ++m_nsteps >= m_interval;
+    }
+
+    float overhead() const
+    {
+        return m_solver_time > 0.0 ? static_cast<float>( m_vis_time / m_solver_time ) : 0.0f;
+    }
+
+    // Adjusts a knob according to the overhead, which must be the same on
+    // all of the processes, and starts the next interval. Returns true if
+    // a knob is changed.
+    bool adjust( const size_t time_step, const float overhead )
+    {
+        m_solver_time = 0.0;
+        m_vis_time = 0.0;
+        m_nsteps = 0;
+
+        if ( overhead > m_target * ( 1.0f + m_tolerance ) )
+        {
+            for ( auto& knob : m_knobs )
+            {
+                if ( this->change( knob, !knob.costly_up, time_step, overhead ) ) { return true; }
+            }
+        }
+        else if ( overhead < m_target * ( 1.0f - m_tolerance ) )
+        {
+            for ( auto knob = m_knobs.rbegin(); knob != m_knobs.rend(); ++knob )
+            {
+                if ( this->change( *knob, knob->costly_up, time_step, overhead ) ) { return true; }
+            }
+        }
+        return false;
+    }
+
+    bool write( const std::string& filename ) const
+    {
+        std::ofstream file( filename );
+        if ( !file ) { return false; }
+
+        // The adjustments dropped from the log are still written into the
+        // log stream of the adaptor.
+        file << "Time step,Knob,From,To,Overhead" << std::endl;
+        for ( const auto& a : m_adjustments )
+        {
+            file << a.time_step << "," << a.name << "," << a.from << "," << a.to << "," << a.overhead << std::endl;
+        }
+        return true;
+    }
+
+private:
+    bool change( Knob& knob, const bool increase, const size_t time_step, const float overhead )
+    {
+        const int from = knob.get();
+        const int to = increase ?
+            std::min( from + knob.step, knob.max ) :
+            std::max( from - knob.step, knob.min );
+        if ( increase ? to <= from : to >= from ) { return false; }
+
+        knob.set( to );
+        m_adjustments.push_back( { time_step, knob.name, from, to, overhead } );
+        if ( m_adjustments.size() > m_max_adjustments ) { m_adjustments.pop_front(); }
+        m_nadjustments++;
+        return true;
+    }
+};
+
+} // end of namespace InSituVis
@@ -25,6 +25,7 @@ public:
     virtual ~TimestepControlledAdaptor() = default;
 
     void exec( const BaseClass::SimTime sim_time = {} ) override;
+    bool isAnalysisIntervalAdjustable() const override { return false; }
 
 private:
     void process( const Data& data ) override;
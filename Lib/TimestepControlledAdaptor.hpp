@@ -4,6 +4,9 @@ namespace InSituVis
 
 inline void TimestepControlledAdaptor::exec( const BaseClass::SimTime sim_time )
 {
+    // In async mode, the step is executed in the visualization thread.
+    if ( BaseClass::execAsync( sim_time ) ) { return; }
+
     Controller::setCacheEnabled( BaseClass::isAnalysisStep() );
     Controller::push( BaseClass::objects() );
 
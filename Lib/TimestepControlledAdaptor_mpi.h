@@ -29,6 +29,8 @@ public:
     virtual ~TimestepControlledAdaptor() = default;
 
     void exec( const BaseClass::SimTime sim_time = {} ) override;
+    bool isAsyncExecutionSupported() const override { return false; }
+    bool isAnalysisIntervalAdjustable() const override { return false; }
 
 private:
     void process( const Data& data ) override;
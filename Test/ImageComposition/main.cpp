@@ -0,0 +1,293 @@
+#include <mpi.h>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <kvs/Type>
+#include <kvs/ValueArray>
+#include <kvs/mpi/Communicator>
+#include "../../Lib/ImageCompositor_mpi.h"
+
+using Compositor = InSituVis::mpi::ImageCompositor;
+
+
+void Usage( const char* program )
+{
+    std::cerr << "Usage: " << program << " [-w width] [-h height] [-m kvs|bs|rk|ds] [-k radix] [-c 0|1] [-a] [-n iterations] [-f fill_ratio] [-r render_msec] [-p] [-b] [-s] [-v]" << std::endl;
+}
+
+Compositor::Method Method( const std::string& name )
+{
+    if ( name == "bs" ) { return Compositor::BinarySwap; }
+    if ( name == "rk" ) { return Compositor::RadixK; }
+    if ( name == "ds" ) { return Compositor::DirectSend; }
+    return Compositor::KVS;
+}
+
+// Bounding rectangle of the disk drawn by the rank, or the full image for
+// the stripes.
+Compositor::Rect Bounds( const int rank, const int nranks, const size_t width, const size_t height, const float fill, const bool stripes )
+{
+    if ( stripes ) { return { 0, 0, width, height }; }
+    const float t = 2.0f * 3.14159265f * rank / nranks;
+    const float cx = width * ( 0.5f + 0.25f * std::cos( t ) );
+    const float cy = height * ( 0.5f + 0.25f * std::sin( t ) );
+    const float r = std::sqrt( fill * width * height / 3.14159265f );
+    auto Clamp = [] ( const float v, const size_t n ) { return static_cast<size_t>( std::min( std::max( v, 0.0f ), float( n ) ) ); };
+    const auto x0 = Clamp( std::floor( cx - r ), width );
+    const auto x1 = Clamp( std::ceil( cx + r ) + 1.0f, width );
+    const auto y0 = Clamp( std::floor( cy - r ), height );
+    const auto y1 = Clamp( std::ceil( cy + r ) + 1.0f, height );
+    Compositor::Rect rect;
+    if ( x0 < x1 && y0 < y1 ) { rect = { x0, y0, x1 - x0, y1 - y0 }; }
+    return rect;
+}
+
+// Partial image of the rank: a disk covering the given ratio of the image,
+// placed at a different position for each rank on the background. With
+// stripes, the pixels in the even columns are drawn instead, so that the
+// active runs end at the last column of odd-width rows and continue at the
+// first column of the next row.
+void Draw(
+    const int rank,
+    const int nranks,
+    const size_t width,
+    const size_t height,
+    const float fill,
+    const bool stripes,
+    std::vector<kvs::UInt8>& color,
+    std::vector<kvs::Real32>& depth )
+{
+    const size_t npixels = width * height;
+    color.assign( npixels * 4, 0 );
+    depth.assign( npixels, 1.0f );
+    if ( stripes )
+    {
+        for ( size_t y = 0; y < height; y++ )
+        {
+            for ( size_t x = 0; x < width; x += 2 )
+            {
+                const size_t i = x + y * width;
+                color[ 4 * i + 0 ] = static_cast<kvs::UInt8>( 255 * ( rank % 3 == 0 ) );
+                color[ 4 * i + 1 ] = static_cast<kvs::UInt8>( 255 * ( rank % 3 == 1 ) );
+                color[ 4 * i + 2 ] = static_cast<kvs::UInt8>( 255 * ( rank % 3 == 2 ) );
+                color[ 4 * i + 3 ] = 128;
+                depth[i] = 0.5f * ( 1.0f + float( ( rank + y ) % nranks ) / nranks );
+            }
+        }
+        return;
+    }
+    const float t = 2.0f * 3.14159265f * rank / nranks;
+    const float cx = width * ( 0.5f + 0.25f * std::cos( t ) );
+    const float cy = height * ( 0.5f + 0.25f * std::sin( t ) );
+    const float r = std::sqrt( fill * npixels / 3.14159265f );
+    for ( size_t y = 0; y < height; y++ )
+    {
+        for ( size_t x = 0; x < width; x++ )
+        {
+            const float dx = x - cx;
+            const float dy = y - cy;
+            const float d2 = ( dx * dx + dy * dy ) / ( r * r );
+            if ( d2 >= 1.0f ) { continue; }
+            const size_t i = x + y * width;
+            color[ 4 * i + 0 ] = static_cast<kvs::UInt8>( 255 * ( rank % 3 == 0 ) );
+            color[ 4 * i + 1 ] = static_cast<kvs::UInt8>( 255 * ( rank % 3 == 1 ) );
+            color[ 4 * i + 2 ] = static_cast<kvs::UInt8>( 255 * ( rank % 3 == 2 ) );
+            color[ 4 * i + 3 ] = 128;
+            depth[i] = 0.5f * ( 1.0f - std::sqrt( 1.0f - d2 ) ) + 0.5f * rank / nranks;
+        }
+    }
+}
+
+// Busy loop standing in for the rendering of the next image, during which
+// the composition in progress is advanced.
+void Render( Compositor& compositor, const double msec )
+{
+    const double end = MPI_Wtime() + msec / 1000.0;
+    while ( MPI_Wtime() < end ) { compositor.test(); }
+}
+
+// Reference image composited at the root from all of the partial images.
+void Reference(
+    const int nranks,
+    const size_t width,
+    const size_t height,
+    const float fill,
+    const bool stripes,
+    const bool depth_testing,
+    std::vector<kvs::UInt8>& color,
+    std::vector<kvs::Real32>& depth )
+{
+    // The rank depths for alpha blending are given in the rank order.
+    Draw( 0, nranks, width, height, fill, stripes, color, depth );
+    std::vector<kvs::UInt8> c;
+    std::vector<kvs::Real32> d;
+    for ( int rank = 1; rank < nranks; rank++ )
+    {
+        Draw( rank, nranks, width, height, fill, stripes, c, d );
+        for ( size_t i = 0; i < width * height; i++ )
+        {
+            if ( depth_testing )
+            {
+                if ( d[i] < depth[i] ) { std::copy_n( &c[ 4 * i ], 4, &color[ 4 * i ] ); depth[i] = d[i]; }
+                continue;
+            }
+            const float af = color[ 4 * i + 3 ] / 255.0f;
+            const float ab = c[ 4 * i + 3 ] / 255.0f * ( 1.0f - af );
+            const float a = af + ab;
+            if ( a <= 0.0f ) { continue; }
+            for ( int k = 0; k < 3; k++ )
+            {
+                color[ 4 * i + k ] = static_cast<kvs::UInt8>( std::min( ( color[ 4 * i + k ] * af + c[ 4 * i + k ] * ab ) / a + 0.5f, 255.0f ) );
+            }
+            color[ 4 * i + 3 ] = static_cast<kvs::UInt8>( std::min( a * 255.0f + 0.5f, 255.0f ) );
+        }
+    }
+}
+
+// Benchmark of the image composition methods with the synthetic partial
+// images, e.g. on a single node:
+//   mpirun -np 8 ./run -w 1024 -h 1024 -m rk -k 4 -n 20 -f 0.1
+// The composition time is the maximum over the ranks averaged over the
+// iterations. With -r, each image is rendered for the given time before its
+// composition, and the frame time (rendering and composition) is reported.
+// With -p, the composition is started before rendering the next image and
+// completed afterwards, as in Adaptor::setPipelinedCompositionEnabled. With
+// -b, the bounding rectangle of the disk is given to the compositor, as in
+// Adaptor::setBoundingRectangleEnabled. With -s, the stripes are drawn
+// instead of the disks and the full image is given as the bounding
+// rectangle, which makes the most runs per message for an odd width. With a
+// width of 1, every pixel is a run unless the rows are merged, e.g.:
+//   mpirun -np 4 ./run -w 1 -h 64 -m bs -b -s -v
+// With -v, the composited image is compared with the reference
+// composited at the root.
+int main( int argc, char** argv )
+{
+    MPI_Init( &argc, &argv );
+    kvs::mpi::Communicator world( MPI_COMM_WORLD, 0 );
+    const int rank = world.rank();
+    const int nranks = world.size();
+
+    size_t width = 512;
+    size_t height = 512;
+    std::string method = "kvs";
+    size_t radix = 4;
+    bool compression = true;
+    bool depth_testing = true;
+    size_t niterations = 10;
+    float fill = 0.1f;
+    double render = 0.0;
+    bool pipelined = false;
+    bool bounds = false;
+    bool stripes = false;
+    bool verify = false;
+    for ( int i = 1; i < argc; ++i )
+    {
+        const std::string arg( argv[i] );
+        if ( arg == "-w" && i + 1 < argc ) { width = std::stoul( argv[++i] ); }
+        else if ( arg == "-h" && i + 1 < argc ) { height = std::stoul( argv[++i] ); }
+        else if ( arg == "-m" && i + 1 < argc ) { method = argv[++i]; }
+        else if ( arg == "-k" && i + 1 < argc ) { radix = std::stoul( argv[++i] ); }
+        else if ( arg == "-c" && i + 1 < argc ) { compression = std::stoi( argv[++i] ) != 0; }
+        else if ( arg == "-a" ) { depth_testing = false; }
+        else if ( arg == "-n" && i + 1 < argc ) { niterations = std::stoul( argv[++i] ); }
+        else if ( arg == "-f" && i + 1 < argc ) { fill = std::stof( argv[++i] ); }
+        else if ( arg == "-r" && i + 1 < argc ) { render = std::stod( argv[++i] ); }
+        else if ( arg == "-p" ) { pipelined = true; }
+        else if ( arg == "-b" ) { bounds = true; }
+        else if ( arg == "-s" ) { stripes = true; }
+        else if ( arg == "-v" ) { verify = true; }
+        else
+        {
+            if ( world.isRoot() ) { Usage( argv[0] ); }
+            MPI_Finalize();
+            return 1;
+        }
+    }
+
+    Compositor compositor( world );
+    compositor.setMethod( Method( method ), radix );
+    compositor.setCompressionEnabled( compression );
+    if ( !compositor.initialize( width, height, depth_testing ) )
+    {
+        if ( world.isRoot() ) { std::cerr << "ERROR: Cannot initialize image compositor." << std::endl; }
+        MPI_Finalize();
+        return 1;
+    }
+
+    std::vector<kvs::UInt8> color;
+    std::vector<kvs::Real32> depth;
+    Draw( rank, nranks, width, height, fill, stripes, color, depth );
+    const auto rect = Bounds( rank, nranks, width, height, fill, stripes );
+
+    kvs::ValueArray<kvs::UInt8> color_buffer( color.size() );
+    kvs::ValueArray<kvs::Real32> depth_buffer( depth.size() );
+    double total = 0.0;
+    double sent = 0.0;
+    for ( size_t i = 0; i <= niterations; i++ )
+    {
+        std::copy( color.begin(), color.end(), color_buffer.data() );
+        std::copy( depth.begin(), depth.end(), depth_buffer.data() );
+
+        MPI_Barrier( MPI_COMM_WORLD );
+        const double start = MPI_Wtime();
+        if ( !pipelined ) { Render( compositor, render ); }
+        bool success =
+            bounds && depth_testing ? compositor.start( color_buffer, depth_buffer, rect ) :
+            bounds ? compositor.start( color_buffer, float( rank ), rect ) :
+            depth_testing ? compositor.start( color_buffer, depth_buffer ) :
+            compositor.start( color_buffer, float( rank ) );
+        if ( pipelined ) { Render( compositor, render ); }
+        success = compositor.wait() && success;
+        double time = MPI_Wtime() - start;
+        if ( !success )
+        {
+            if ( world.isRoot() ) { std::cerr << "ERROR: Cannot compose images." << std::endl; }
+            MPI_Finalize();
+            return 1;
+        }
+        MPI_Allreduce( MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD );
+
+        // The first iteration is a warm-up.
+        if ( i == 0 ) { continue; }
+        double bytes = static_cast<double>( compositor.sentBytes() );
+        MPI_Allreduce( MPI_IN_PLACE, &bytes, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD );
+        total += time;
+        sent += bytes;
+    }
+
+    if ( world.isRoot() )
+    {
+        const auto n = static_cast<double>( std::max( niterations, size_t( 1 ) ) );
+        std::cout << "Ranks: " << nranks << std::endl;
+        std::cout << "Image: " << width << " x " << height << std::endl;
+        std::cout << "Method: " << method << ( method == "rk" ? " (k = " + std::to_string( radix ) + ")" : "" ) << std::endl;
+        std::cout << "Mode: " << ( depth_testing ? "depth testing" : "alpha blending" ) << std::endl;
+        std::cout << "Compression: " << ( compression ? "on" : "off" ) << std::endl;
+        std::cout << "Bounding rectangles: " << ( bounds ? "on" : "off" ) << std::endl;
+        if ( render > 0.0 ) { std::cout << "Pipelined: " << ( pipelined ? "on" : "off" ) << std::endl; }
+        std::cout << ( render > 0.0 ? "Frame time: " : "Composition time: " ) << total / n * 1000.0 << " msec" << std::endl;
+        if ( method != "kvs" ) { std::cout << "Sent bytes: " << sent / n << std::endl; }
+
+        if ( verify )
+        {
+            std::vector<kvs::UInt8> ref_color;
+            std::vector<kvs::Real32> ref_depth;
+            Reference( nranks, width, height, fill, stripes, depth_testing, ref_color, ref_depth );
+            size_t ndiffs = 0;
+            for ( size_t i = 0; i < width * height; i++ )
+            {
+                for ( size_t k = 0; k < 4; k++ )
+                {
+                    if ( std::abs( int( ref_color[ 4 * i + k ] ) - int( color_buffer[ 4 * i + k ] ) ) > 1 ) { ndiffs++; break; }
+                }
+            }
+            std::cout << "Different pixels: " << ndiffs << std::endl;
+        }
+    }
+
+    compositor.destroy();
+    MPI_Finalize();
+    return 0;
+}